@@ -55,6 +55,7 @@ static inline void *alloc_node(struct alloc_state *s, size_t node_size)
 {
 	void *ret;
 
+	object_state_lock();
 	if (!s->nr) {
 		s->nr = BLOCKING;
 		s->p = xmalloc(BLOCKING * node_size);
@@ -65,6 +66,7 @@ static inline void *alloc_node(struct alloc_state *s, size_t node_size)
 	s->nr--;
 	ret = s->p;
 	s->p = (char *)s->p + node_size;
+	object_state_unlock();
 	memset(ret, 0, node_size);
 
 	return ret;
@@ -106,7 +108,12 @@ void *alloc_object_node(struct repository *r)
 static unsigned int alloc_commit_index(void)
 {
 	static unsigned int parsed_commits_count;
-	return parsed_commits_count++;
+	unsigned int ret;
+
+	object_state_lock();
+	ret = parsed_commits_count++;
+	object_state_unlock();
+	return ret;
 }
 
 void init_commit_node(struct commit *c)
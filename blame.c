@@ -1357,7 +1357,9 @@ static struct blame_origin *find_origin(struct repository *r,
 		if (origin->commit->parents &&
 		    oideq(&parent->object.oid,
 			  &origin->commit->parents->item->object.oid))
-			compute_diff = maybe_changed_path(r, origin, bd);
+			compute_diff = maybe_changed_path(r, origin, bd) &&
+				       commit_graph_changes_pathspec(r, origin->commit,
+								     &diff_opts.pathspec);
 
 		if (compute_diff)
 			diff_tree_oid(get_commit_tree_oid(parent),
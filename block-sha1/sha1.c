@@ -10,6 +10,7 @@
 #include "../git-compat-util.h"
 
 #include "sha1.h"
+#include "../hash-mb.h"
 
 #define SHA_ROT(X,l,r)	(((X) << (l)) | ((X) >> (r)))
 #define SHA_ROL(X,n)	SHA_ROT(X,n,32-(n))
@@ -62,16 +63,16 @@
 #define T_40_59(t, A, B, C, D, E) SHA_ROUND(t, SHA_MIX, ((B&C)+(D&(B^C))) , 0x8f1bbcdc, A, B, C, D, E )
 #define T_60_79(t, A, B, C, D, E) SHA_ROUND(t, SHA_MIX, (B^C^D) ,  0xca62c1d6, A, B, C, D, E )
 
-static void blk_SHA1_Block(blk_SHA_CTX *ctx, const void *block)
+static void blk_SHA1_Block(uint32_t *H, const unsigned char *block)
 {
 	unsigned int A,B,C,D,E;
 	unsigned int array[16];
 
-	A = ctx->H[0];
-	B = ctx->H[1];
-	C = ctx->H[2];
-	D = ctx->H[3];
-	E = ctx->H[4];
+	A = H[0];
+	B = H[1];
+	C = H[2];
+	D = H[3];
+	E = H[4];
 
 	/* Round 1 - iterations 0-16 take their input from 'block' */
 	T_0_15( 0, A, B, C, D, E);
@@ -163,11 +164,11 @@ static void blk_SHA1_Block(blk_SHA_CTX *ctx, const void *block)
 	T_60_79(78, C, D, E, A, B);
 	T_60_79(79, B, C, D, E, A);
 
-	ctx->H[0] += A;
-	ctx->H[1] += B;
-	ctx->H[2] += C;
-	ctx->H[3] += D;
-	ctx->H[4] += E;
+	H[0] += A;
+	H[1] += B;
+	H[2] += C;
+	H[3] += D;
+	H[4] += E;
 }
 
 void blk_SHA1_Init(blk_SHA_CTX *ctx)
@@ -199,10 +200,10 @@ void blk_SHA1_Update(blk_SHA_CTX *ctx, const void *data, size_t len)
 		data = ((const char *)data + left);
 		if (lenW)
 			return;
-		blk_SHA1_Block(ctx, ctx->W);
+		blk_SHA1_Block(ctx->H, (const unsigned char *)ctx->W);
 	}
 	while (len >= 64) {
-		blk_SHA1_Block(ctx, data);
+		blk_SHA1_Block(ctx->H, data);
 		data = ((const char *)data + 64);
 		len -= 64;
 	}
@@ -228,3 +229,180 @@ void blk_SHA1_Final(unsigned char hashout[20], blk_SHA_CTX *ctx)
 	for (i = 0; i < 5; i++)
 		put_be32(hashout + i * 4, ctx->H[i]);
 }
+
+#ifdef HASH_MB_VECTORS
+
+/*
+ * Eight SHA-1 computations side by side, one in each 32-bit lane. See
+ * the SHA-256 equivalent in sha256/block/sha256.c.
+ */
+typedef uint32_t sha1_vec __attribute__((vector_size(32)));
+
+#define VROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static inline __attribute__((always_inline))
+void sha1_lanes_body(uint32_t *state[HASH_MB_LANES],
+		     const unsigned char *block[HASH_MB_LANES])
+{
+	sha1_vec S[5], A, B, C, D, E, W[16], f, temp;
+	uint32_t k;
+	int t, l;
+
+	for (t = 0; t < 5; t++)
+		for (l = 0; l < HASH_MB_LANES; l++)
+			S[t][l] = state[l][t];
+
+	A = S[0]; B = S[1]; C = S[2]; D = S[3]; E = S[4];
+
+	for (t = 0; t < 80; t++) {
+		if (t < 16) {
+			for (l = 0; l < HASH_MB_LANES; l++)
+				W[t][l] = get_be32(block[l] + t * 4);
+		} else {
+			sha1_vec mix = W[(t + 13) & 15] ^ W[(t + 8) & 15] ^
+				       W[(t + 2) & 15] ^ W[t & 15];
+			W[t & 15] = VROL(mix, 1);
+		}
+
+		if (t < 20) {
+			f = ((C ^ D) & B) ^ D;
+			k = 0x5a827999;
+		} else if (t < 40) {
+			f = B ^ C ^ D;
+			k = 0x6ed9eba1;
+		} else if (t < 60) {
+			f = (B & C) + (D & (B ^ C));
+			k = 0x8f1bbcdc;
+		} else {
+			f = B ^ C ^ D;
+			k = 0xca62c1d6;
+		}
+
+		temp = VROL(A, 5) + f + E + k + W[t & 15];
+		E = D;
+		D = C;
+		C = VROL(B, 30);
+		B = A;
+		A = temp;
+	}
+
+	S[0] += A; S[1] += B; S[2] += C; S[3] += D; S[4] += E;
+
+	for (t = 0; t < 5; t++)
+		for (l = 0; l < HASH_MB_LANES; l++)
+			state[l][t] = S[t][l];
+}
+
+static void sha1_lanes_generic(uint32_t *state[HASH_MB_LANES],
+			       const unsigned char *block[HASH_MB_LANES])
+{
+	sha1_lanes_body(state, block);
+}
+
+#ifdef HASH_MB_AVX2
+__attribute__((target("avx2")))
+static void sha1_lanes_avx2(uint32_t *state[HASH_MB_LANES],
+			    const unsigned char *block[HASH_MB_LANES])
+{
+	sha1_lanes_body(state, block);
+}
+#endif
+
+static hash_mb_lanes_fn sha1_lanes(void)
+{
+#ifdef HASH_MB_AVX2
+	if (hash_mb_have_avx2())
+		return sha1_lanes_avx2;
+#endif
+	return sha1_lanes_generic;
+}
+
+#else
+
+static hash_mb_lanes_fn sha1_lanes(void)
+{
+	return NULL;
+}
+
+#endif
+
+void blk_SHA1_Update_multi(blk_SHA_CTX **ctx, const void **data,
+			   const size_t *len, size_t nr)
+{
+	struct hash_mb_job *jobs;
+	size_t i;
+
+	CALLOC_ARRAY(jobs, nr);
+	for (i = 0; i < nr; i++) {
+		const unsigned char *p = data[i];
+		size_t n = len[i];
+		unsigned int lenW = ctx[i]->size & 63;
+
+		ctx[i]->size += n;
+		jobs[i].state = ctx[i]->H;
+
+		/* Top up a partial block first, just like blk_SHA1_Update(). */
+		if (lenW) {
+			unsigned int left = 64 - lenW;
+
+			if (n < left) {
+				memcpy(lenW + (char *)ctx[i]->W, p, n);
+				continue;
+			}
+			memcpy(lenW + (char *)ctx[i]->W, p, left);
+			jobs[i].first = (const unsigned char *)ctx[i]->W;
+			p += left;
+			n -= left;
+		}
+		jobs[i].data = p;
+		jobs[i].blocks = n / 64;
+	}
+
+	hash_mb_run(jobs, nr, 5, sha1_lanes(), blk_SHA1_Block);
+
+	/*
+	 * Only now buffer what is left of each message, as "W" may have
+	 * been a block to compress.
+	 */
+	for (i = 0; i < nr; i++) {
+		unsigned int tail = ctx[i]->size & 63;
+
+		if (jobs[i].data && tail)
+			memcpy(ctx[i]->W, jobs[i].data, tail);
+	}
+	free(jobs);
+}
+
+void blk_SHA1_Final_multi(unsigned char **hashout, blk_SHA_CTX **ctx,
+			  size_t nr)
+{
+	unsigned char (*pad)[64 + 8];
+	const void **in;
+	size_t *len;
+	size_t i;
+	int j;
+
+	ALLOC_ARRAY(pad, nr);
+	ALLOC_ARRAY(in, nr);
+	ALLOC_ARRAY(len, nr);
+
+	/* Pad with a binary 1 (ie 0x80), then zeroes, then length */
+	for (i = 0; i < nr; i++) {
+		size_t n = 1 + (63 & (55 - (ctx[i]->size & 63)));
+
+		memset(pad[i], 0, n);
+		pad[i][0] = 0x80;
+		put_be64(pad[i] + n, ctx[i]->size << 3);
+		in[i] = pad[i];
+		len[i] = n + 8;
+	}
+	blk_SHA1_Update_multi(ctx, in, len, nr);
+
+	for (i = 0; i < nr; i++)
+		for (j = 0; j < 5; j++)
+			put_be32(hashout[i] + j * 4, ctx[i]->H[j]);
+
+	free(pad);
+	free(in);
+	free(len);
+}
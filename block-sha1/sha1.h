@@ -8,7 +8,7 @@
 
 typedef struct {
 	unsigned long long size;
-	unsigned int H[5];
+	uint32_t H[5];
 	unsigned int W[16];
 } blk_SHA_CTX;
 
@@ -16,7 +16,19 @@ void blk_SHA1_Init(blk_SHA_CTX *ctx);
 void blk_SHA1_Update(blk_SHA_CTX *ctx, const void *dataIn, size_t len);
 void blk_SHA1_Final(unsigned char hashout[20], blk_SHA_CTX *ctx);
 
+/*
+ * Like blk_SHA1_Update() and blk_SHA1_Final(), but for "nr" independent
+ * contexts at once, whose blocks are compressed in parallel where the CPU
+ * allows.
+ */
+void blk_SHA1_Update_multi(blk_SHA_CTX **ctx, const void **data,
+			   const size_t *len, size_t nr);
+void blk_SHA1_Final_multi(unsigned char **hashout, blk_SHA_CTX **ctx,
+			  size_t nr);
+
 #define platform_SHA_CTX	blk_SHA_CTX
 #define platform_SHA1_Init	blk_SHA1_Init
 #define platform_SHA1_Update	blk_SHA1_Update
 #define platform_SHA1_Final	blk_SHA1_Final
+#define platform_SHA1_Update_multi	blk_SHA1_Update_multi
+#define platform_SHA1_Final_multi	blk_SHA1_Final_multi
@@ -1,7 +1,6 @@
 #include "git-compat-util.h"
 #include "bloom.h"
 #include "diff.h"
-#include "diffcore.h"
 #include "hashmap.h"
 #include "commit-graph.h"
 #include "commit.h"
@@ -210,6 +209,59 @@ static int pathmap_cmp(const void *hashmap_cmp_fn_data UNUSED,
 	return strcmp(e1->path, e2->path);
 }
 
+/*
+ * The changed paths of a commit are collected straight from the tree walk
+ * rather than from the diff queue, which is global; this is what allows
+ * computing filters from several threads.
+ */
+struct changed_paths {
+	struct diff_options diffopt;
+	struct hashmap pathmap;
+	int nr, max;
+};
+
+static int add_changed_path(struct diff_options *opt,
+			    struct combine_diff_path *p)
+{
+	struct changed_paths *cp = container_of(opt, struct changed_paths,
+						diffopt);
+	char *path = p->path;
+
+	if (++cp->nr > cp->max) {
+		/* too many changes for a filter; stop the walk */
+		opt->flags.has_changes = 1;
+		return 0;
+	}
+
+	/*
+	 * Add each leading directory of the changed file, i.e. for
+	 * 'dir/subdir/file' add 'dir' and 'dir/subdir' as well, so
+	 * the Bloom filter could be used to speed up commands like
+	 * 'git log dir/subdir', too.
+	 *
+	 * Note that directories are added without the trailing '/'.
+	 */
+	do {
+		struct pathmap_hash_entry *e;
+		char *last_slash = strrchr(path, '/');
+
+		FLEX_ALLOC_STR(e, path, path);
+		hashmap_entry_init(&e->entry, strhash(path));
+
+		if (!hashmap_get(&cp->pathmap, &e->entry, NULL))
+			hashmap_add(&cp->pathmap, &e->entry);
+		else
+			free(e);
+
+		if (!last_slash)
+			last_slash = path;
+		*last_slash = '\0';
+
+	} while (*path);
+
+	return 0;	/* we are done with p */
+}
+
 static void init_truncated_large_filter(struct bloom_filter *filter)
 {
 	filter->data = xmalloc(1);
@@ -224,8 +276,10 @@ struct bloom_filter *get_or_compute_bloom_filter(struct repository *r,
 						 enum bloom_filter_computed *computed)
 {
 	struct bloom_filter *filter;
-	int i;
-	struct diff_options diffopt;
+	struct changed_paths cp = { 0 };
+	struct combine_diff_path phead;
+	const struct object_id *parent_oid = NULL;
+	struct strbuf base = STRBUF_INIT;
 
 	if (computed)
 		*computed = BLOOM_NOT_COMPUTED;
@@ -247,65 +301,36 @@ struct bloom_filter *get_or_compute_bloom_filter(struct repository *r,
 	if (!compute_if_not_present)
 		return NULL;
 
-	repo_diff_setup(r, &diffopt);
-	diffopt.flags.recursive = 1;
-	diffopt.detect_rename = 0;
-	diffopt.max_changes = settings->max_changed_paths;
-	diff_setup_done(&diffopt);
+	/*
+	 * Only the tree walk is used, which needs none of what
+	 * diff_setup_done() sets up (nor its lazily initialized globals).
+	 */
+	repo_diff_setup(r, &cp.diffopt);
+	cp.diffopt.flags.recursive = 1;
+	cp.diffopt.flags.quick = 1;
+	cp.diffopt.detect_rename = 0;
+	cp.diffopt.pathchange = add_changed_path;
+	cp.max = settings->max_changed_paths;
+	hashmap_init(&cp.pathmap, pathmap_cmp, NULL, 0);
 
 	/* ensure commit is parsed so we have parent information */
 	repo_parse_commit(r, c);
 
 	if (c->parents)
-		diff_tree_oid(&c->parents->item->object.oid, &c->object.oid, "", &diffopt);
-	else
-		diff_tree_oid(NULL, &c->object.oid, "", &diffopt);
-	diffcore_std(&diffopt);
+		parent_oid = &c->parents->item->object.oid;
+	phead.next = NULL;
+	diff_tree_paths(&phead, &c->object.oid, &parent_oid, 1, &base, &cp.diffopt);
 
-	if (diff_queued_diff.nr <= settings->max_changed_paths) {
-		struct hashmap pathmap = HASHMAP_INIT(pathmap_cmp, NULL);
+	if (cp.nr > cp.max ||
+	    hashmap_get_size(&cp.pathmap) > settings->max_changed_paths) {
+		init_truncated_large_filter(filter);
+		if (computed)
+			*computed |= BLOOM_TRUNC_LARGE;
+	} else {
 		struct pathmap_hash_entry *e;
 		struct hashmap_iter iter;
 
-		for (i = 0; i < diff_queued_diff.nr; i++) {
-			const char *path = diff_queued_diff.queue[i]->two->path;
-
-			/*
-			 * Add each leading directory of the changed file, i.e. for
-			 * 'dir/subdir/file' add 'dir' and 'dir/subdir' as well, so
-			 * the Bloom filter could be used to speed up commands like
-			 * 'git log dir/subdir', too.
-			 *
-			 * Note that directories are added without the trailing '/'.
-			 */
-			do {
-				char *last_slash = strrchr(path, '/');
-
-				FLEX_ALLOC_STR(e, path, path);
-				hashmap_entry_init(&e->entry, strhash(path));
-
-				if (!hashmap_get(&pathmap, &e->entry, NULL))
-					hashmap_add(&pathmap, &e->entry);
-				else
-					free(e);
-
-				if (!last_slash)
-					last_slash = (char*)path;
-				*last_slash = '\0';
-
-			} while (*path);
-
-			diff_free_filepair(diff_queued_diff.queue[i]);
-		}
-
-		if (hashmap_get_size(&pathmap) > settings->max_changed_paths) {
-			init_truncated_large_filter(filter);
-			if (computed)
-				*computed |= BLOOM_TRUNC_LARGE;
-			goto cleanup;
-		}
-
-		filter->len = (hashmap_get_size(&pathmap) * settings->bits_per_entry + BITS_PER_WORD - 1) / BITS_PER_WORD;
+		filter->len = (hashmap_get_size(&cp.pathmap) * settings->bits_per_entry + BITS_PER_WORD - 1) / BITS_PER_WORD;
 		if (!filter->len) {
 			if (computed)
 				*computed |= BLOOM_TRUNC_EMPTY;
@@ -313,29 +338,19 @@ struct bloom_filter *get_or_compute_bloom_filter(struct repository *r,
 		}
 		CALLOC_ARRAY(filter->data, filter->len);
 
-		hashmap_for_each_entry(&pathmap, &iter, e, entry) {
+		hashmap_for_each_entry(&cp.pathmap, &iter, e, entry) {
 			struct bloom_key key;
 			fill_bloom_key(e->path, strlen(e->path), &key, settings);
 			add_key_to_filter(&key, filter, settings);
 			clear_bloom_key(&key);
 		}
-
-	cleanup:
-		hashmap_clear_and_free(&pathmap, struct pathmap_hash_entry, entry);
-	} else {
-		for (i = 0; i < diff_queued_diff.nr; i++)
-			diff_free_filepair(diff_queued_diff.queue[i]);
-		init_truncated_large_filter(filter);
-
-		if (computed)
-			*computed |= BLOOM_TRUNC_LARGE;
 	}
 
 	if (computed)
 		*computed |= BLOOM_COMPUTED;
 
-	free(diff_queued_diff.queue);
-	DIFF_QUEUE_CLEAR(&diff_queued_diff);
+	hashmap_clear_and_free(&cp.pathmap, struct pathmap_hash_entry, entry);
+	strbuf_release(&base);
 
 	return filter;
 }
@@ -22,6 +22,7 @@
 #include "replace-object.h"
 #include "promisor-remote.h"
 #include "setup.h"
+#include "trace2.h"
 
 static const char index_pack_usage[] =
 "git index-pack [-v] [-o <index-file>] [--keep | --keep=<msg>] [--[no-]rev-index] [--verify] [--strict[=<msg-id>=<severity>...]] [--fsck-objects[=<msg-id>=<severity>...]] (<pack-file> | --stdin [--fix-thin] [<pack-file>])";
@@ -124,6 +125,53 @@ static int ref_deltas_alloc;
 static int nr_resolved_deltas;
 static int nr_threads;
 
+/*
+ * With pack.indexStreamDeltas, worker threads resolve OFS_DELTAs while the
+ * first pass is still reading the rest of the pack, as soon as the delta
+ * and its base are both on disk and the base has been resolved. Whatever
+ * they could not resolve (REF_DELTAs, and deltas against a base which is
+ * itself a delta that has left the cache) is left to resolve_deltas(),
+ * which skips the work already done.
+ */
+enum stream_state {
+	STREAM_PENDING = 0,
+	STREAM_RESOLVED,
+	STREAM_ABANDONED,
+};
+
+struct stream_cached {
+	int obj_no;
+	int retain_data;
+	void *data;
+	unsigned long size;
+	struct list_head lru;
+};
+
+struct stream_object {
+	/* For an OFS_DELTA, the position of its base in "objects". */
+	int base;
+	/* Deltas whose base is this object, waiting for it to be resolved. */
+	int waiting, next_waiting;
+	enum stream_state state;
+	struct stream_cached *cached;
+};
+
+static int stream_deltas;
+static struct stream_object *stream;
+
+/* Guarded by work_mutex, like the rest of the delta resolution state. */
+static pthread_cond_t stream_cond;
+static int *stream_ready;
+static int stream_ready_nr, stream_ready_alloc;
+static int stream_done;
+static LIST_HEAD(stream_lru);
+static size_t stream_cache_used;
+static int nr_streamed_deltas;
+
+/* OFS_DELTAs parsed, but possibly not yet flushed to the pack. */
+static int *stream_deferred;
+static int stream_deferred_nr, stream_deferred_first, stream_deferred_alloc;
+
 static int from_stdin;
 static int strict;
 static int do_fsck_object;
@@ -898,7 +946,7 @@ static void sha1_object(const void *data, struct object_entry *obj_entry,
  * Ensure that this node has been reconstructed and return its contents.
  *
  * In the typical and best case, this node would already be reconstructed
- * (through the invocation to resolve_delta() in threaded_second_pass()) and it
+ * (through the invocation to resolve_delta_batch() in threaded_second_pass()) and it
  * would not be pruned. However, if pruning of this node was necessary due to
  * reaching delta_base_cache_limit, this function will find the closest
  * ancestor with reconstructed data that has not been pruned (or if there is
@@ -959,44 +1007,120 @@ static struct base_data *make_base(struct object_entry *obj,
 	return base;
 }
 
-static struct base_data *resolve_delta(struct object_entry *delta_obj,
-				       struct base_data *base)
+static void *patch_delta_from_pack(struct object_entry *delta_obj,
+				   const void *base_data, unsigned long base_size,
+				   unsigned long *result_size)
 {
 	void *delta_data, *result_data;
-	struct base_data *result;
-	unsigned long result_size;
-
-	if (show_stat) {
-		int i = delta_obj - objects;
-		int j = base->obj - objects;
-		obj_stat[i].delta_depth = obj_stat[j].delta_depth + 1;
-		deepest_delta_lock();
-		if (deepest_delta < obj_stat[i].delta_depth)
-			deepest_delta = obj_stat[i].delta_depth;
-		deepest_delta_unlock();
-		obj_stat[i].base_object_no = j;
-	}
+
 	delta_data = get_data_from_pack(delta_obj);
-	assert(base->data);
-	result_data = patch_delta(base->data, base->size,
-				  delta_data, delta_obj->size, &result_size);
+	result_data = patch_delta(base_data, base_size,
+				  delta_data, delta_obj->size, result_size);
 	free(delta_data);
 	if (!result_data)
 		bad_object(delta_obj->idx.offset, _("failed to apply delta"));
-	hash_object_file(the_hash_algo, result_data, result_size,
-			 delta_obj->real_type, &delta_obj->idx.oid);
-	sha1_object(result_data, NULL, result_size, delta_obj->real_type,
-		    &delta_obj->idx.oid);
+	return result_data;
+}
+
+/*
+ * The most deltas against the same base that are resolved at once, so
+ * that the object IDs of their results can be computed in one batch.
+ */
+#define RESOLVE_BATCH 8
+
+/*
+ * Apply each of the "nr" deltas in "delta_obj" to the contents of their
+ * common base "base_obj", and compute (and check) the object IDs of the
+ * results, which are returned in "result" and "result_size".
+ */
+static void resolve_delta_data(struct object_entry **delta_obj, int nr,
+			       struct object_entry *base_obj,
+			       const void *base_data, unsigned long base_size,
+			       void **result, unsigned long *result_size)
+{
+	struct hash_object_job jobs[RESOLVE_BATCH];
+	int i;
+
+	if (nr > RESOLVE_BATCH)
+		BUG("too many deltas to resolve at once: %d", nr);
+	if (!nr)
+		return;
+
+	for (i = 0; i < nr; i++) {
+		if (show_stat) {
+			int k = delta_obj[i] - objects;
+			int j = base_obj - objects;
+			obj_stat[k].delta_depth = obj_stat[j].delta_depth + 1;
+			deepest_delta_lock();
+			if (deepest_delta < obj_stat[k].delta_depth)
+				deepest_delta = obj_stat[k].delta_depth;
+			deepest_delta_unlock();
+			obj_stat[k].base_object_no = j;
+		}
+		result[i] = patch_delta_from_pack(delta_obj[i], base_data,
+						  base_size, &result_size[i]);
+		jobs[i].buf = result[i];
+		jobs[i].len = result_size[i];
+		jobs[i].type = delta_obj[i]->real_type;
+		jobs[i].oid = &delta_obj[i]->idx.oid;
+	}
+
+	hash_object_file_batch(the_hash_algo, jobs, nr);
 
-	result = make_base(delta_obj, base);
-	result->data = result_data;
-	result->size = result_size;
+	for (i = 0; i < nr; i++)
+		sha1_object(result[i], NULL, result_size[i],
+			    delta_obj[i]->real_type, &delta_obj[i]->idx.oid);
 
 	counter_lock();
-	nr_resolved_deltas++;
+	nr_resolved_deltas += nr;
 	counter_unlock();
+}
+
+static int resolved_while_receiving(struct object_entry *obj)
+{
+	return stream && stream[obj - objects].state == STREAM_RESOLVED;
+}
+
+static void resolve_delta_batch(struct object_entry **delta_obj, int nr,
+				struct base_data *base,
+				struct base_data **result)
+{
+	struct object_entry *todo[RESOLVE_BATCH];
+	void *result_data[RESOLVE_BATCH];
+	unsigned long result_size[RESOLVE_BATCH];
+	int i, j, todo_nr = 0;
+
+	assert(base->data);
+
+	for (i = 0; i < nr; i++)
+		if (!resolved_while_receiving(delta_obj[i]))
+			todo[todo_nr++] = delta_obj[i];
+
+	resolve_delta_data(todo, todo_nr, base->obj, base->data, base->size,
+			   result_data, result_size);
+
+	for (i = j = 0; i < nr; i++) {
+		result[i] = make_base(delta_obj[i], base);
+
+		if (resolved_while_receiving(delta_obj[i])) {
+			/*
+			 * Its object ID is already known and checked, so we
+			 * only need its contents if there are deltas against
+			 * it.
+			 */
+			if (result[i]->children_remaining)
+				result[i]->data =
+					patch_delta_from_pack(delta_obj[i],
+							      base->data,
+							      base->size,
+							      &result[i]->size);
+			continue;
+		}
 
-	return result;
+		result[i]->data = result_data[j];
+		result[i]->size = result_size[j];
+		j++;
+	}
 }
 
 static int compare_ofs_delta_entry(const void *a, const void *b)
@@ -1017,14 +1141,38 @@ static int compare_ref_delta_entry(const void *a, const void *b)
 	return oidcmp(&delta_a->oid, &delta_b->oid);
 }
 
+/* Caller must hold work_mutex. */
+static struct object_entry *take_child(struct base_data *parent)
+{
+	struct object_entry *child_obj;
+
+	if (parent->ref_first <= parent->ref_last) {
+		int offset = ref_deltas[parent->ref_first++].obj_no;
+		child_obj = objects + offset;
+		if (child_obj->real_type != OBJ_REF_DELTA)
+			die("REF_DELTA at offset %"PRIuMAX" already resolved (duplicate base %s?)",
+			    (uintmax_t) child_obj->idx.offset,
+			    oid_to_hex(&parent->obj->idx.oid));
+		child_obj->real_type = parent->obj->real_type;
+	} else {
+		child_obj = objects +
+			ofs_deltas[parent->ofs_first++].obj_no;
+		assert(child_obj->real_type == OBJ_OFS_DELTA ||
+		       resolved_while_receiving(child_obj));
+		child_obj->real_type = parent->obj->real_type;
+	}
+	return child_obj;
+}
+
 static void *threaded_second_pass(void *data)
 {
 	if (data)
 		set_thread_data(data);
 	for (;;) {
 		struct base_data *parent = NULL;
-		struct object_entry *child_obj;
-		struct base_data *child;
+		struct object_entry *child_obj[RESOLVE_BATCH];
+		struct base_data *child[RESOLVE_BATCH];
+		int i, nr_children = 0;
 
 		counter_lock();
 		display_progress(progress, nr_resolved_deltas);
@@ -1042,29 +1190,29 @@ static void *threaded_second_pass(void *data)
 				work_unlock();
 				break;
 			}
-			child_obj = &objects[nr_dispatched++];
+			child_obj[nr_children++] = &objects[nr_dispatched++];
 		} else {
+			int remaining, batch;
+
 			/*
-			 * Peek at the top of the stack, and take a child from
-			 * it.
+			 * Peek at the top of the stack, and take children
+			 * from it. Resolving several at once lets us hash
+			 * them in a batch, but leave enough of them for the
+			 * other threads to work on in parallel.
 			 */
 			parent = list_first_entry(&work_head, struct base_data,
 						  list);
 
-			if (parent->ref_first <= parent->ref_last) {
-				int offset = ref_deltas[parent->ref_first++].obj_no;
-				child_obj = objects + offset;
-				if (child_obj->real_type != OBJ_REF_DELTA)
-					die("REF_DELTA at offset %"PRIuMAX" already resolved (duplicate base %s?)",
-					    (uintmax_t) child_obj->idx.offset,
-					    oid_to_hex(&parent->obj->idx.oid));
-				child_obj->real_type = parent->obj->real_type;
-			} else {
-				child_obj = objects +
-					ofs_deltas[parent->ofs_first++].obj_no;
-				assert(child_obj->real_type == OBJ_OFS_DELTA);
-				child_obj->real_type = parent->obj->real_type;
-			}
+			remaining = parent->ref_last - parent->ref_first +
+				parent->ofs_last - parent->ofs_first + 2;
+			batch = remaining / (nr_threads > 1 ? nr_threads : 1);
+			if (batch > RESOLVE_BATCH)
+				batch = RESOLVE_BATCH;
+			if (batch < 1)
+				batch = 1;
+
+			while (nr_children < batch)
+				child_obj[nr_children++] = take_child(parent);
 
 			if (parent->ref_first > parent->ref_last &&
 			    parent->ofs_first > parent->ofs_last) {
@@ -1093,12 +1241,14 @@ static void *threaded_second_pass(void *data)
 		work_unlock();
 
 		if (parent) {
-			child = resolve_delta(child_obj, parent);
-			if (!child->children_remaining)
-				FREE_AND_NULL(child->data);
+			resolve_delta_batch(child_obj, nr_children, parent,
+					    child);
+			for (i = 0; i < nr_children; i++)
+				if (!child[i]->children_remaining)
+					FREE_AND_NULL(child[i]->data);
 		} else {
-			child = make_base(child_obj, NULL);
-			if (child->children_remaining) {
+			child[0] = make_base(child_obj[0], NULL);
+			if (child[0]->children_remaining) {
 				/*
 				 * Since this child has its own delta children,
 				 * we will need this data in the future.
@@ -1106,52 +1256,287 @@ static void *threaded_second_pass(void *data)
 				 * have access to this object's data while
 				 * outside the work mutex.
 				 */
-				child->data = get_data_from_pack(child_obj);
-				child->size = child_obj->size;
+				child[0]->data = get_data_from_pack(child_obj[0]);
+				child[0]->size = child_obj[0]->size;
 			}
 		}
 
 		work_lock();
 		if (parent)
 			parent->retain_data--;
-		if (child->data) {
-			/*
-			 * This child has its own children, so add it to
-			 * work_head.
-			 */
-			list_add(&child->list, &work_head);
-			base_cache_used += child->size;
-			prune_base_data(NULL);
-			free_base_data(child);
+		for (i = 0; i < nr_children; i++) {
+			if (child[i]->data) {
+				/*
+				 * This child has its own children, so add it
+				 * to work_head.
+				 */
+				list_add(&child[i]->list, &work_head);
+				base_cache_used += child[i]->size;
+				prune_base_data(NULL);
+				free_base_data(child[i]);
+			} else {
+				/*
+				 * This child does not have its own children.
+				 * It may be the last descendant of its
+				 * ancestors; free those that we can. The
+				 * parent outlives the loop, as it counts the
+				 * children that are still to come.
+				 */
+				struct base_data *p = parent;
+
+				while (p) {
+					struct base_data *next_p;
+
+					p->children_remaining--;
+					if (p->children_remaining)
+						break;
+
+					next_p = p->base;
+					free_base_data(p);
+					list_del(&p->list);
+					free(p);
+
+					p = next_p;
+				}
+				FREE_AND_NULL(child[i]);
+			}
+		}
+		work_unlock();
+	}
+	return NULL;
+}
+
+/* Caller must hold work_mutex. */
+static void stream_cache_add(int obj_no, void *data, unsigned long size)
+{
+	struct list_head *pos, *tmp;
+	struct stream_cached *c;
+
+	if (size > base_cache_limit) {
+		free(data);
+		return;
+	}
+
+	CALLOC_ARRAY(c, 1);
+	c->obj_no = obj_no;
+	c->data = data;
+	c->size = size;
+	list_add(&c->lru, &stream_lru);
+	stream[obj_no].cached = c;
+	stream_cache_used += size;
+
+	list_for_each_prev_safe(pos, tmp, &stream_lru) {
+		if (stream_cache_used <= base_cache_limit)
+			break;
+		c = list_entry(pos, struct stream_cached, lru);
+		if (c->retain_data)
+			continue;
+		stream_cache_used -= c->size;
+		stream[c->obj_no].cached = NULL;
+		list_del(&c->lru);
+		free(c->data);
+		free(c);
+	}
+}
+
+/* Caller must hold work_mutex. */
+static void stream_set_state(int obj_no, enum stream_state state)
+{
+	struct stream_object *o = &stream[obj_no];
+	int child;
+
+	o->state = state;
+	for (child = o->waiting; child >= 0; child = stream[child].next_waiting) {
+		if (state == STREAM_RESOLVED) {
+			ALLOC_GROW(stream_ready, stream_ready_nr + 1,
+				   stream_ready_alloc);
+			stream_ready[stream_ready_nr++] = child;
 		} else {
-			/*
-			 * This child does not have its own children. It may be
-			 * the last descendant of its ancestors; free those
-			 * that we can.
-			 */
-			struct base_data *p = parent;
+			stream_set_state(child, state);
+		}
+	}
+	o->waiting = -1;
+	if (state == STREAM_RESOLVED && stream_ready_nr)
+		pthread_cond_broadcast(&stream_cond);
+}
+
+/* Caller must hold work_mutex. */
+static void stream_add_delta(int obj_no)
+{
+	struct stream_object *o = &stream[obj_no];
+
+	if (o->base < 0) {
+		o->state = STREAM_ABANDONED;
+		return;
+	}
 
-			while (p) {
-				struct base_data *next_p;
+	switch (stream[o->base].state) {
+	case STREAM_RESOLVED:
+		ALLOC_GROW(stream_ready, stream_ready_nr + 1, stream_ready_alloc);
+		stream_ready[stream_ready_nr++] = obj_no;
+		pthread_cond_signal(&stream_cond);
+		break;
+	case STREAM_PENDING:
+		o->next_waiting = stream[o->base].waiting;
+		stream[o->base].waiting = obj_no;
+		break;
+	case STREAM_ABANDONED:
+		o->state = STREAM_ABANDONED;
+		break;
+	}
+}
 
-				p->children_remaining--;
-				if (p->children_remaining)
-					break;
+static void *stream_resolve_deltas(void *data)
+{
+	set_thread_data(data);
+	for (;;) {
+		struct object_entry *delta_obj, *base_obj;
+		struct stream_cached *cached;
+		void *base_data, *result;
+		unsigned long base_size, result_size;
+		int obj_no;
 
-				next_p = p->base;
-				free_base_data(p);
-				list_del(&p->list);
-				free(p);
+		work_lock();
+		while (!stream_ready_nr && !stream_done)
+			pthread_cond_wait(&stream_cond, &work_mutex);
+		if (!stream_ready_nr) {
+			work_unlock();
+			break;
+		}
+		/*
+		 * Take the most recently readied delta, as its base is the
+		 * most likely to still be cached.
+		 */
+		obj_no = stream_ready[--stream_ready_nr];
+		delta_obj = &objects[obj_no];
+		base_obj = &objects[stream[obj_no].base];
+		cached = stream[stream[obj_no].base].cached;
+		if (cached) {
+			cached->retain_data++;
+			base_data = cached->data;
+			base_size = cached->size;
+		}
+		work_unlock();
 
-				p = next_p;
+		if (!cached) {
+			if (is_delta_type(base_obj->type)) {
+				work_lock();
+				stream_set_state(obj_no, STREAM_ABANDONED);
+				work_unlock();
+				continue;
 			}
-			FREE_AND_NULL(child);
+			base_data = get_data_from_pack(base_obj);
+			base_size = base_obj->size;
 		}
+
+		delta_obj->real_type = base_obj->real_type;
+		resolve_delta_data(&delta_obj, 1, base_obj,
+				   base_data, base_size, &result, &result_size);
+
+		work_lock();
+		if (cached)
+			cached->retain_data--;
+		else
+			free(base_data);
+		stream_cache_add(obj_no, result, result_size);
+		stream_set_state(obj_no, STREAM_RESOLVED);
+		nr_streamed_deltas++;
 		work_unlock();
 	}
 	return NULL;
 }
 
+static void start_streaming_deltas(void)
+{
+	int i;
+
+	CALLOC_ARRAY(stream, st_add(nr_objects, 1));
+	for (i = 0; i < nr_objects; i++)
+		stream[i].base = stream[i].waiting = stream[i].next_waiting = -1;
+	base_cache_limit = delta_base_cache_limit * nr_threads;
+
+	init_thread();
+	pthread_cond_init(&stream_cond, NULL);
+	for (i = 0; i < nr_threads; i++) {
+		int ret = pthread_create(&thread_data[i].thread, NULL,
+					 stream_resolve_deltas, thread_data + i);
+		if (ret)
+			die(_("unable to create thread: %s"), strerror(ret));
+	}
+}
+
+/*
+ * Hand the deltas parsed so far over to the worker threads, once they (and
+ * hence their bases) have been written to the pack that they read from.
+ */
+static void stream_dispatch_deltas(int parsed_nr)
+{
+	off_t flushed = consumed_bytes - input_offset;
+
+	work_lock();
+	while (stream_deferred_first < stream_deferred_nr) {
+		int obj_no = stream_deferred[stream_deferred_first];
+
+		/* unpack_data() needs to know where the next object starts */
+		if (obj_no + 1 >= parsed_nr ||
+		    objects[obj_no + 1].idx.offset > flushed)
+			break;
+		stream_add_delta(obj_no);
+		stream_deferred_first++;
+	}
+	work_unlock();
+
+	if (stream_deferred_first == stream_deferred_nr)
+		stream_deferred_first = stream_deferred_nr = 0;
+}
+
+static void finish_streaming_deltas(void)
+{
+	struct list_head *pos, *tmp;
+	int i;
+
+	work_lock();
+	stream_done = 1;
+	pthread_cond_broadcast(&stream_cond);
+	work_unlock();
+
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(thread_data[i].thread, NULL);
+	pthread_cond_destroy(&stream_cond);
+	cleanup_thread();
+
+	list_for_each_safe(pos, tmp, &stream_lru) {
+		struct stream_cached *c = list_entry(pos, struct stream_cached, lru);
+		list_del(&c->lru);
+		free(c->data);
+		free(c);
+	}
+	stream_cache_used = 0;
+	FREE_AND_NULL(stream_ready);
+	FREE_AND_NULL(stream_deferred);
+	stream_ready_nr = stream_ready_alloc = 0;
+
+	trace2_data_intmax("index-pack", the_repository,
+			   "deltas_resolved_while_receiving",
+			   nr_streamed_deltas);
+}
+
+static int find_ofs_delta_base(off_t offset, int nr)
+{
+	int lo = 0, hi = nr;
+
+	while (lo < hi) {
+		int mi = lo + (hi - lo) / 2;
+		if (objects[mi].idx.offset == offset)
+			return mi;
+		if (objects[mi].idx.offset < offset)
+			lo = mi + 1;
+		else
+			hi = mi;
+	}
+	return -1;
+}
+
 /*
  * First pass:
  * - find locations of all objects;
@@ -1171,6 +1556,8 @@ static void parse_pack_objects(unsigned char *hash)
 				progress_title ? progress_title :
 				from_stdin ? _("Receiving objects") : _("Indexing objects"),
 				nr_objects);
+	if (stream_deltas)
+		start_streaming_deltas();
 	for (i = 0; i < nr_objects; i++) {
 		struct object_entry *obj = &objects[i];
 		void *data = unpack_raw_entry(obj, &ofs_delta->offset,
@@ -1178,6 +1565,12 @@ static void parse_pack_objects(unsigned char *hash)
 					      &obj->idx.oid);
 		obj->real_type = obj->type;
 		if (obj->type == OBJ_OFS_DELTA) {
+			if (stream) {
+				stream[i].base = find_ofs_delta_base(ofs_delta->offset, i);
+				ALLOC_GROW(stream_deferred, stream_deferred_nr + 1,
+					   stream_deferred_alloc);
+				stream_deferred[stream_deferred_nr++] = i;
+			}
 			nr_ofs_deltas++;
 			ofs_delta->obj_no = i;
 			ofs_delta++;
@@ -1186,14 +1579,28 @@ static void parse_pack_objects(unsigned char *hash)
 			oidcpy(&ref_deltas[nr_ref_deltas].oid, &ref_delta_oid);
 			ref_deltas[nr_ref_deltas].obj_no = i;
 			nr_ref_deltas++;
+			if (stream)
+				stream[i].state = STREAM_ABANDONED;
 		} else if (!data) {
 			/* large blobs, check later */
 			obj->real_type = OBJ_BAD;
 			nr_delays++;
-		} else
+			if (stream)
+				stream[i].state = STREAM_ABANDONED;
+		} else {
 			sha1_object(data, NULL, obj->size, obj->type,
 				    &obj->idx.oid);
+			if (stream) {
+				work_lock();
+				stream_cache_add(i, data, obj->size);
+				stream_set_state(i, STREAM_RESOLVED);
+				work_unlock();
+				data = NULL;
+			}
+		}
 		free(data);
+		if (stream)
+			stream_dispatch_deltas(i + 1);
 		display_progress(progress, i+1);
 	}
 	objects[i].idx.offset = consumed_bytes;
@@ -1201,6 +1608,10 @@ static void parse_pack_objects(unsigned char *hash)
 
 	/* Check pack integrity */
 	flush();
+	if (stream) {
+		stream_dispatch_deltas(nr_objects + 1);
+		finish_streaming_deltas();
+	}
 	the_hash_algo->init_fn(&tmp_ctx);
 	the_hash_algo->clone_fn(&tmp_ctx, &input_ctx);
 	the_hash_algo->final_fn(hash, &tmp_ctx);
@@ -1606,6 +2017,14 @@ static int git_index_pack_config(const char *k, const char *v,
 		}
 		return 0;
 	}
+	if (!strcmp(k, "pack.indexstreamdeltas")) {
+		stream_deltas = git_config_bool(k, v);
+		if (!HAVE_THREADS && stream_deltas) {
+			warning(_("no threads support, ignoring %s"), k);
+			stream_deltas = 0;
+		}
+		return 0;
+	}
 	if (!strcmp(k, "pack.writereverseindex")) {
 		if (git_config_bool(k, v))
 			opts->flags |= WRITE_REV;
@@ -1927,6 +2346,7 @@ int cmd_index_pack(int argc, const char **argv, const char *prefix)
 		write_in_full(2, "\0", 1);
 	resolve_deltas();
 	conclude_pack(fix_thin_pack, curr_pack, pack_hash);
+	FREE_AND_NULL(stream);
 	free(ofs_deltas);
 	free(ref_deltas);
 	if (strict)
@@ -11,7 +11,7 @@
 
 #define BUILTIN_MIDX_WRITE_USAGE \
 	N_("git multi-pack-index [<options>] write [--preferred-pack=<pack>]" \
-	   "[--refs-snapshot=<path>]")
+	   "[--refs-snapshot=<path>] [--incremental]")
 
 #define BUILTIN_MIDX_VERIFY_USAGE \
 	N_("git multi-pack-index [<options>] verify")
@@ -132,6 +132,9 @@ static int cmd_multi_pack_index_write(int argc, const char **argv,
 			 N_("write multi-pack index containing only given indexes")),
 		OPT_FILENAME(0, "refs-snapshot", &opts.refs_snapshot,
 			     N_("refs snapshot for selecting bitmap commits")),
+		OPT_BIT(0, "incremental", &opts.flags,
+			N_("write a new layer on top of the multi-pack-index chain"),
+			MIDX_WRITE_INCREMENTAL),
 		OPT_END(),
 	};
 
@@ -154,6 +157,10 @@ static int cmd_multi_pack_index_write(int argc, const char **argv,
 
 	FREE_AND_NULL(options);
 
+	if ((opts.flags & MIDX_WRITE_INCREMENTAL) && opts.stdin_packs)
+		die(_("options '%s' and '%s' cannot be used together"),
+		    "--incremental", "--stdin-packs");
+
 	if (opts.stdin_packs) {
 		struct string_list packs = STRING_LIST_INIT_DUP;
 		int ret;
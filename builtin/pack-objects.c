@@ -212,6 +212,7 @@ static int window = 10;
 static unsigned long pack_size_limit;
 static int depth = 50;
 static int delta_search_threads;
+static int threads_given;
 static int pack_to_stdout;
 static int sparse;
 static int thin;
@@ -290,22 +291,25 @@ static void index_commit_for_bitmap(struct commit *commit)
 	indexed_commits[indexed_commits_nr++] = commit;
 }
 
-static void *get_delta(struct object_entry *entry)
+static void *get_delta(struct object_entry *entry, struct object_entry *base,
+		       unsigned long expect_size)
 {
 	unsigned long size, base_size, delta_size;
 	void *buf, *base_buf, *delta_buf;
 	enum object_type type;
 
+	packing_data_lock(&to_pack);
 	buf = repo_read_object_file(the_repository, &entry->idx.oid, &type,
 				    &size);
 	if (!buf)
 		die(_("unable to read %s"), oid_to_hex(&entry->idx.oid));
 	base_buf = repo_read_object_file(the_repository,
-					 &DELTA(entry)->idx.oid, &type,
+					 &base->idx.oid, &type,
 					 &base_size);
 	if (!base_buf)
 		die("unable to read %s",
-		    oid_to_hex(&DELTA(entry)->idx.oid));
+		    oid_to_hex(&base->idx.oid));
+	packing_data_unlock(&to_pack);
 	delta_buf = diff_delta(base_buf, base_size,
 			       buf, size, &delta_size, 0);
 	/*
@@ -313,7 +317,7 @@ static void *get_delta(struct object_entry *entry)
 	 * memory reasons. Something is very wrong if this time we
 	 * recompute and create a different delta.
 	 */
-	if (!delta_buf || delta_size != DELTA_SIZE(entry))
+	if (!delta_buf || delta_size != expect_size)
 		BUG("delta size changed");
 	free(buf);
 	free(base_buf);
@@ -358,7 +362,9 @@ static unsigned long write_large_blob_data(struct git_istream *st, struct hashfi
 	for (;;) {
 		ssize_t readlen;
 		int zret = Z_OK;
+		packing_data_lock(&to_pack);
 		readlen = read_istream(st, ibuf, sizeof(ibuf));
+		packing_data_unlock(&to_pack);
 		if (readlen == -1)
 			die(_("unable to read %s"), oid_to_hex(oid));
 
@@ -384,6 +390,20 @@ static unsigned long write_large_blob_data(struct git_istream *st, struct hashfi
 	return olen;
 }
 
+static void unuse_object_window(struct pack_window **w_curs)
+{
+	packing_data_lock(&to_pack);
+	unuse_pack(w_curs);
+	packing_data_unlock(&to_pack);
+}
+
+static void close_object_istream(struct git_istream *st)
+{
+	packing_data_lock(&to_pack);
+	close_istream(st);
+	packing_data_unlock(&to_pack);
+}
+
 /*
  * we are going to reuse the existing object data as is.  make
  * sure it is not corrupt.
@@ -424,7 +444,9 @@ static void copy_pack_data(struct hashfile *f,
 	unsigned long avail;
 
 	while (len) {
+		packing_data_lock(&to_pack);
 		in = use_pack(p, w_curs, offset, &avail);
+		packing_data_unlock(&to_pack);
 		if (avail > len)
 			avail = (unsigned long)len;
 		hashwrite(f, in, avail);
@@ -444,6 +466,304 @@ static inline int oe_size_greater_than(struct packing_data *pack,
 	return oe_get_size_slow(pack, lhs) > rhs;
 }
 
+/*
+ * Decide whether an object is copied verbatim from the pack it lives
+ * in, or has to be (re)deflated.
+ */
+static int want_reuse_object(struct object_entry *entry, int usable_delta)
+{
+	if (!reuse_object)
+		return 0;	/* explicit */
+	else if (!IN_PACK(entry))
+		return 0;	/* can't reuse what we don't have */
+	else if (oe_type(entry) == OBJ_REF_DELTA ||
+		 oe_type(entry) == OBJ_OFS_DELTA)
+				/* check_object() decided it for us ... */
+		return usable_delta;
+				/* ... but pack split may override that */
+	else if (oe_type(entry) != entry->in_pack_type)
+		return 0;	/* pack has delta which is unusable */
+	else if (DELTA(entry))
+		return 0;	/* we want to pack afresh */
+	else
+		return 1;	/* we have it in-pack undeltified,
+				 * and we do not need to deltify it.
+				 */
+}
+
+/*
+ * Deflating the objects we cannot reuse is the bulk of the work in
+ * the write phase.  When threads are allowed, worker threads walk the
+ * write order ahead of the writer and deflate those objects into a
+ * ring of jobs, one slot per position in the write order.  The writer
+ * picks the result up when it reaches the object, so the pack is
+ * still written and checksummed in order by a single thread.
+ *
+ * Only the writer looks at object entries: it copies whatever a worker
+ * needs into the job when it dispatches it, and checks that the result
+ * still matches the entry (e.g. that the delta base did not change)
+ * before using it.  The object database is protected by the
+ * packing_data lock, exactly as during the delta search.
+ *
+ * This is only used when we know up front that all objects go to a
+ * single pack; with --max-pack-size, whether a delta is usable is only
+ * known once its base has been written.
+ */
+enum deflate_job_state {
+	DEFLATE_JOB_NONE = 0,	/* nothing to deflate at this position */
+	DEFLATE_JOB_PENDING,	/* waiting for a worker */
+	DEFLATE_JOB_RUNNING,	/* being deflated */
+	DEFLATE_JOB_DONE	/* deflated data is ready */
+};
+
+struct deflate_job {
+	struct object_entry *entry;
+	struct object_entry *base;	/* delta base, NULL if not a delta */
+	void *data;		/* cached delta, then deflated data */
+	unsigned long size;	/* inflated size */
+	unsigned long datalen;	/* deflated size */
+	enum object_type type;	/* canonical type if not a delta */
+	enum deflate_job_state state;
+};
+
+/* How far the workers may run ahead of the writer, per thread */
+#define DEFLATE_AHEAD_OBJECTS	64
+#define DEFLATE_AHEAD_SIZE	(16 * 1024 * 1024)
+
+static struct object_entry **deflate_write_order;
+static uint32_t deflate_nr;
+static struct deflate_job *deflate_jobs;
+static uint32_t deflate_nr_jobs;
+static uint32_t deflate_write_pos;	/* where the writer is */
+static uint32_t deflate_dispatch_pos;	/* first position not dispatched */
+static uint32_t deflate_claim_pos;	/* first position no worker looked at */
+static unsigned long deflate_pending_size, deflate_max_pending_size;
+static int deflate_stop;
+static pthread_t *deflate_threads;
+static int deflate_nr_threads;
+static pthread_mutex_t deflate_mutex;
+static pthread_cond_t deflate_work_cond;
+static pthread_cond_t deflate_done_cond;
+
+static void deflate_one(struct deflate_job *job)
+{
+	if (job->base) {
+		if (!job->data)
+			job->data = get_delta(job->entry, job->base, job->size);
+	} else {
+		unsigned long size;
+
+		packing_data_lock(&to_pack);
+		job->data = repo_read_object_file(the_repository,
+						  &job->entry->idx.oid,
+						  &job->type, &size);
+		packing_data_unlock(&to_pack);
+		if (!job->data)
+			die(_("unable to read %s"),
+			    oid_to_hex(&job->entry->idx.oid));
+		if (size != job->size)
+			die(_("object %s inconsistent object length (%"PRIuMAX" vs %"PRIuMAX")"),
+			    oid_to_hex(&job->entry->idx.oid), (uintmax_t)size,
+			    (uintmax_t)job->size);
+	}
+	job->datalen = do_compress(&job->data, job->size);
+}
+
+/* Fill the ring as far as we may; called by the writer with deflate_mutex */
+static void deflate_dispatch(void)
+{
+	while (deflate_dispatch_pos < deflate_nr &&
+	       deflate_dispatch_pos - deflate_write_pos < deflate_nr_jobs &&
+	       (deflate_pending_size < deflate_max_pending_size ||
+		deflate_dispatch_pos == deflate_write_pos)) {
+		struct object_entry *e = deflate_write_order[deflate_dispatch_pos];
+		struct deflate_job *job;
+		struct object_entry *base;
+
+		job = &deflate_jobs[deflate_dispatch_pos++ % deflate_nr_jobs];
+
+		if (e->idx.offset || e->preferred_base)
+			continue;	/* already written, or not to be */
+		base = DELTA(e);
+		if (want_reuse_object(e, !!base))
+			continue;
+		if (base) {
+			if (e->z_delta_size)
+				continue; /* deflated by find_deltas() */
+			job->size = DELTA_SIZE(e);
+			job->data = e->delta_data;
+			e->delta_data = NULL;
+		} else {
+			if (oe_type(e) == OBJ_BLOB &&
+			    oe_size_greater_than(&to_pack, e, big_file_threshold))
+				continue; /* streamed by write_no_reuse_object() */
+			job->size = SIZE(e);
+		}
+		job->entry = e;
+		job->base = base;
+		job->state = DEFLATE_JOB_PENDING;
+		deflate_pending_size += job->size;
+	}
+	pthread_cond_broadcast(&deflate_work_cond);
+}
+
+static void *deflate_worker(void *data UNUSED)
+{
+	pthread_mutex_lock(&deflate_mutex);
+	for (;;) {
+		struct deflate_job *job;
+
+		while (!deflate_stop &&
+		       deflate_claim_pos == deflate_dispatch_pos)
+			pthread_cond_wait(&deflate_work_cond, &deflate_mutex);
+		if (deflate_stop)
+			break;
+
+		job = &deflate_jobs[deflate_claim_pos++ % deflate_nr_jobs];
+		if (job->state != DEFLATE_JOB_PENDING)
+			continue;
+		job->state = DEFLATE_JOB_RUNNING;
+		pthread_mutex_unlock(&deflate_mutex);
+
+		deflate_one(job);
+
+		pthread_mutex_lock(&deflate_mutex);
+		job->state = DEFLATE_JOB_DONE;
+		pthread_cond_broadcast(&deflate_done_cond);
+	}
+	pthread_mutex_unlock(&deflate_mutex);
+	return NULL;
+}
+
+static void start_deflate_workers(struct object_entry **write_order,
+				  uint32_t nr)
+{
+	int i, ret;
+
+	if (!HAVE_THREADS || delta_search_threads <= 1 || pack_size_limit)
+		return;
+
+	deflate_write_order = write_order;
+	deflate_nr = nr;
+	deflate_nr_jobs = delta_search_threads * DEFLATE_AHEAD_OBJECTS;
+	deflate_max_pending_size = delta_search_threads * DEFLATE_AHEAD_SIZE;
+	CALLOC_ARRAY(deflate_jobs, deflate_nr_jobs);
+	deflate_write_pos = deflate_dispatch_pos = deflate_claim_pos = 0;
+	deflate_pending_size = 0;
+	deflate_stop = 0;
+
+	pthread_mutex_init(&deflate_mutex, NULL);
+	pthread_cond_init(&deflate_work_cond, NULL);
+	pthread_cond_init(&deflate_done_cond, NULL);
+
+	pthread_mutex_lock(&deflate_mutex);
+	deflate_dispatch();
+	pthread_mutex_unlock(&deflate_mutex);
+
+	CALLOC_ARRAY(deflate_threads, delta_search_threads);
+	for (i = 0; i < delta_search_threads; i++) {
+		ret = pthread_create(&deflate_threads[i], NULL,
+				     deflate_worker, NULL);
+		if (ret)
+			die(_("unable to create thread: %s"), strerror(ret));
+		deflate_nr_threads++;
+	}
+	trace2_data_intmax("pack-objects", the_repository,
+			   "write_pack_file/deflate_threads",
+			   deflate_nr_threads);
+}
+
+/*
+ * Hand the deflated data for "entry" to the writer, if we have it.
+ * The caller owns job->data afterwards.
+ */
+static int take_deflated_object(struct object_entry *entry, int usable_delta,
+				struct deflate_job *out)
+{
+	struct deflate_job *job;
+	int ok;
+
+	if (!deflate_nr_threads)
+		return 0;
+
+	pthread_mutex_lock(&deflate_mutex);
+	job = &deflate_jobs[deflate_write_pos % deflate_nr_jobs];
+	if (job->state == DEFLATE_JOB_NONE || job->entry != entry) {
+		/* e.g. a delta base written out of order */
+		pthread_mutex_unlock(&deflate_mutex);
+		return 0;
+	}
+	if (job->state == DEFLATE_JOB_PENDING) {
+		/* no worker got to it yet; do it ourselves */
+		job->state = DEFLATE_JOB_RUNNING;
+		pthread_mutex_unlock(&deflate_mutex);
+		deflate_one(job);
+		pthread_mutex_lock(&deflate_mutex);
+		job->state = DEFLATE_JOB_DONE;
+	}
+	while (job->state != DEFLATE_JOB_DONE)
+		pthread_cond_wait(&deflate_done_cond, &deflate_mutex);
+
+	ok = job->base == (usable_delta ? DELTA(entry) : NULL);
+	if (ok) {
+		*out = *job;
+		job->data = NULL;
+	}
+	pthread_mutex_unlock(&deflate_mutex);
+	return ok;
+}
+
+/* The writer is done with the current position in the write order */
+static void advance_deflate_workers(void)
+{
+	struct deflate_job *job;
+
+	if (!deflate_nr_threads)
+		return;
+
+	pthread_mutex_lock(&deflate_mutex);
+	job = &deflate_jobs[deflate_write_pos % deflate_nr_jobs];
+	while (job->state == DEFLATE_JOB_RUNNING)
+		pthread_cond_wait(&deflate_done_cond, &deflate_mutex);
+	if (job->state != DEFLATE_JOB_NONE) {
+		deflate_pending_size -= job->size;
+		free(job->data);
+	}
+	memset(job, 0, sizeof(*job));
+
+	deflate_write_pos++;
+	if (deflate_claim_pos < deflate_write_pos)
+		deflate_claim_pos = deflate_write_pos;
+	deflate_dispatch();
+	pthread_mutex_unlock(&deflate_mutex);
+}
+
+static void stop_deflate_workers(void)
+{
+	uint32_t i;
+	int t;
+
+	if (!deflate_nr_threads)
+		return;
+
+	pthread_mutex_lock(&deflate_mutex);
+	deflate_stop = 1;
+	pthread_cond_broadcast(&deflate_work_cond);
+	pthread_mutex_unlock(&deflate_mutex);
+
+	for (t = 0; t < deflate_nr_threads; t++)
+		pthread_join(deflate_threads[t], NULL);
+	for (i = 0; i < deflate_nr_jobs; i++)
+		free(deflate_jobs[i].data);
+
+	pthread_cond_destroy(&deflate_done_cond);
+	pthread_cond_destroy(&deflate_work_cond);
+	pthread_mutex_destroy(&deflate_mutex);
+	FREE_AND_NULL(deflate_jobs);
+	FREE_AND_NULL(deflate_threads);
+	deflate_nr_threads = 0;
+}
+
 /* Return 0 if we will bust the pack-size limit */
 static unsigned long write_no_reuse_object(struct hashfile *f, struct object_entry *entry,
 					   unsigned long limit, int usable_delta)
@@ -456,8 +776,21 @@ static unsigned long write_no_reuse_object(struct hashfile *f, struct object_ent
 	void *buf;
 	struct git_istream *st = NULL;
 	const unsigned hashsz = the_hash_algo->rawsz;
-
-	if (!usable_delta) {
+	struct deflate_job deflated;
+	int have_deflated = take_deflated_object(entry, usable_delta, &deflated);
+
+	if (have_deflated) {
+		buf = deflated.data;
+		size = deflated.size;
+		if (deflated.base)
+			type = (allow_ofs_delta && DELTA(entry)->idx.offset) ?
+				OBJ_OFS_DELTA : OBJ_REF_DELTA;
+		else
+			type = deflated.type;
+		FREE_AND_NULL(entry->delta_data);
+		entry->z_delta_size = 0;
+	} else if (!usable_delta) {
+		packing_data_lock(&to_pack);
 		if (oe_type(entry) == OBJ_BLOB &&
 		    oe_size_greater_than(&to_pack, entry, big_file_threshold) &&
 		    (st = open_istream(the_repository, &entry->idx.oid, &type,
@@ -471,6 +804,7 @@ static unsigned long write_no_reuse_object(struct hashfile *f, struct object_ent
 				die(_("unable to read %s"),
 				    oid_to_hex(&entry->idx.oid));
 		}
+		packing_data_unlock(&to_pack);
 		/*
 		 * make sure no cached delta data remains from a
 		 * previous attempt before a pack split occurred.
@@ -484,13 +818,15 @@ static unsigned long write_no_reuse_object(struct hashfile *f, struct object_ent
 		type = (allow_ofs_delta && DELTA(entry)->idx.offset) ?
 			OBJ_OFS_DELTA : OBJ_REF_DELTA;
 	} else {
-		buf = get_delta(entry);
 		size = DELTA_SIZE(entry);
+		buf = get_delta(entry, DELTA(entry), size);
 		type = (allow_ofs_delta && DELTA(entry)->idx.offset) ?
 			OBJ_OFS_DELTA : OBJ_REF_DELTA;
 	}
 
-	if (st)	/* large blob case, just assume we don't compress well */
+	if (have_deflated)
+		datalen = deflated.datalen;
+	else if (st)	/* large blob case, just assume we don't compress well */
 		datalen = size;
 	else if (entry->z_delta_size)
 		datalen = entry->z_delta_size;
@@ -517,7 +853,7 @@ static unsigned long write_no_reuse_object(struct hashfile *f, struct object_ent
 			dheader[--pos] = 128 | (--ofs & 127);
 		if (limit && hdrlen + sizeof(dheader) - pos + datalen + hashsz >= limit) {
 			if (st)
-				close_istream(st);
+				close_object_istream(st);
 			free(buf);
 			return 0;
 		}
@@ -531,7 +867,7 @@ static unsigned long write_no_reuse_object(struct hashfile *f, struct object_ent
 		 */
 		if (limit && hdrlen + hashsz + datalen + hashsz >= limit) {
 			if (st)
-				close_istream(st);
+				close_object_istream(st);
 			free(buf);
 			return 0;
 		}
@@ -541,7 +877,7 @@ static unsigned long write_no_reuse_object(struct hashfile *f, struct object_ent
 	} else {
 		if (limit && hdrlen + datalen + hashsz >= limit) {
 			if (st)
-				close_istream(st);
+				close_object_istream(st);
 			free(buf);
 			return 0;
 		}
@@ -549,7 +885,7 @@ static unsigned long write_no_reuse_object(struct hashfile *f, struct object_ent
 	}
 	if (st) {
 		datalen = write_large_blob_data(st, f, &entry->idx.oid);
-		close_istream(st);
+		close_object_istream(st);
 	} else {
 		hashwrite(f, buf, datalen);
 		free(buf);
@@ -581,6 +917,7 @@ static off_t write_reuse_object(struct hashfile *f, struct object_entry *entry,
 					      type, entry_size);
 
 	offset = entry->in_pack_offset;
+	packing_data_lock(&to_pack);
 	if (offset_to_pack_pos(p, offset, &pos) < 0)
 		die(_("write_reuse_object: could not locate %s, expected at "
 		      "offset %"PRIuMAX" in pack %s"),
@@ -593,6 +930,7 @@ static off_t write_reuse_object(struct hashfile *f, struct object_entry *entry,
 		error(_("bad packed object CRC for %s"),
 		      oid_to_hex(&entry->idx.oid));
 		unuse_pack(&w_curs);
+		packing_data_unlock(&to_pack);
 		return write_no_reuse_object(f, entry, limit, usable_delta);
 	}
 
@@ -604,8 +942,10 @@ static off_t write_reuse_object(struct hashfile *f, struct object_entry *entry,
 		error(_("corrupt packed object for %s"),
 		      oid_to_hex(&entry->idx.oid));
 		unuse_pack(&w_curs);
+		packing_data_unlock(&to_pack);
 		return write_no_reuse_object(f, entry, limit, usable_delta);
 	}
+	packing_data_unlock(&to_pack);
 
 	if (type == OBJ_OFS_DELTA) {
 		off_t ofs = entry->idx.offset - DELTA(entry)->idx.offset;
@@ -614,7 +954,7 @@ static off_t write_reuse_object(struct hashfile *f, struct object_entry *entry,
 		while (ofs >>= 7)
 			dheader[--pos] = 128 | (--ofs & 127);
 		if (limit && hdrlen + sizeof(dheader) - pos + datalen + hashsz >= limit) {
-			unuse_pack(&w_curs);
+			unuse_object_window(&w_curs);
 			return 0;
 		}
 		hashwrite(f, header, hdrlen);
@@ -623,7 +963,7 @@ static off_t write_reuse_object(struct hashfile *f, struct object_entry *entry,
 		reused_delta++;
 	} else if (type == OBJ_REF_DELTA) {
 		if (limit && hdrlen + hashsz + datalen + hashsz >= limit) {
-			unuse_pack(&w_curs);
+			unuse_object_window(&w_curs);
 			return 0;
 		}
 		hashwrite(f, header, hdrlen);
@@ -632,13 +972,13 @@ static off_t write_reuse_object(struct hashfile *f, struct object_entry *entry,
 		reused_delta++;
 	} else {
 		if (limit && hdrlen + datalen + hashsz >= limit) {
-			unuse_pack(&w_curs);
+			unuse_object_window(&w_curs);
 			return 0;
 		}
 		hashwrite(f, header, hdrlen);
 	}
 	copy_pack_data(f, p, &w_curs, offset, datalen);
-	unuse_pack(&w_curs);
+	unuse_object_window(&w_curs);
 	reused++;
 	return hdrlen + datalen;
 }
@@ -678,23 +1018,7 @@ static off_t write_object(struct hashfile *f,
 	else
 		usable_delta = 0;	/* base could end up in another pack */
 
-	if (!reuse_object)
-		to_reuse = 0;	/* explicit */
-	else if (!IN_PACK(entry))
-		to_reuse = 0;	/* can't reuse what we don't have */
-	else if (oe_type(entry) == OBJ_REF_DELTA ||
-		 oe_type(entry) == OBJ_OFS_DELTA)
-				/* check_object() decided it for us ... */
-		to_reuse = usable_delta;
-				/* ... but pack split may override that */
-	else if (oe_type(entry) != entry->in_pack_type)
-		to_reuse = 0;	/* pack has delta which is unusable */
-	else if (DELTA(entry))
-		to_reuse = 0;	/* we want to pack afresh */
-	else
-		to_reuse = 1;	/* we have it in-pack undeltified,
-				 * and we do not need to deltify it.
-				 */
+	to_reuse = want_reuse_object(entry, usable_delta);
 
 	if (!to_reuse)
 		len = write_no_reuse_object(f, entry, limit, usable_delta);
@@ -1274,12 +1598,15 @@ static void write_pack_file(void)
 		}
 
 		nr_written = 0;
+		start_deflate_workers(write_order, to_pack.nr_objects);
 		for (; i < to_pack.nr_objects; i++) {
 			struct object_entry *e = write_order[i];
 			if (write_one(f, e, &offset) == WRITE_ONE_BREAK)
 				break;
+			advance_deflate_workers();
 			display_progress(progress_state, written);
 		}
+		stop_deflate_workers();
 
 		if (pack_to_stdout) {
 			/*
@@ -4156,6 +4483,10 @@ static void get_object_list(struct rev_info *revs, int ac, const char **av)
 
 	if (!fn_show_object)
 		fn_show_object = show_object;
+	/* --threads=0 means autodetect, for the walk as well */
+	if (threads_given)
+		revs->traverse_threads = delta_search_threads ?
+			delta_search_threads : online_cpus();
 	traverse_commit_list(revs,
 			     show_commit, fn_show_object,
 			     NULL);
@@ -4269,6 +4600,17 @@ static int option_parse_cruft_expiration(const struct option *opt UNUSED,
 	return 0;
 }
 
+static int option_parse_threads(const struct option *opt UNUSED,
+				const char *arg, int unset)
+{
+	BUG_ON_OPT_NEG(unset);
+
+	if (strtol_i(arg, 10, &delta_search_threads))
+		die(_("invalid number of threads specified (%s)"), arg);
+	threads_given = 1;
+	return 0;
+}
+
 int cmd_pack_objects(int argc, const char **argv, const char *prefix)
 {
 	int use_internal_rev_list = 0;
@@ -4314,8 +4656,9 @@ int cmd_pack_objects(int argc, const char **argv, const char *prefix)
 			 N_("reuse existing objects")),
 		OPT_BOOL(0, "delta-base-offset", &allow_ofs_delta,
 			 N_("use OFS_DELTA objects")),
-		OPT_INTEGER(0, "threads", &delta_search_threads,
-			    N_("use threads when searching for best delta matches")),
+		OPT_CALLBACK_F(0, "threads", NULL, N_("n"),
+			       N_("use threads when searching for best delta matches"),
+			       PARSE_OPT_NONEG, option_parse_threads),
 		OPT_BOOL(0, "non-empty", &non_empty,
 			 N_("do not create an empty pack output")),
 		OPT_BOOL(0, "revs", &use_internal_rev_list,
@@ -20,6 +20,7 @@
 #include "reflog-walk.h"
 #include "oidset.h"
 #include "packfile.h"
+#include "thread-utils.h"
 
 static const char rev_list_usage[] =
 "git rev-list [<options>] <commit>... [--] [<path>...]\n"
@@ -52,6 +53,7 @@ static const char rev_list_usage[] =
 "    --objects | --objects-edge\n"
 "    --disk-usage[=human]\n"
 "    --unpacked\n"
+"    --threads=<n>\n"
 "    --header | --pretty\n"
 "    --[no-]object-names\n"
 "    --abbrev=<n> | --no-abbrev\n"
@@ -610,6 +612,17 @@ int cmd_rev_list(int argc, const char **argv, const char *prefix)
 			test_bitmap_walk(&revs);
 			goto cleanup;
 		}
+		if (skip_prefix(arg, "--threads=", &arg)) {
+			if (strtol_i(arg, 10, &revs.traverse_threads) ||
+			    revs.traverse_threads < 0)
+				die(_("invalid value for '%s': '%s'"),
+				    "--threads", arg);
+			if (!revs.traverse_threads)
+				revs.traverse_threads = online_cpus();
+			if (!HAVE_THREADS && revs.traverse_threads != 1)
+				warning(_("no threads support, ignoring --threads"));
+			continue;
+		}
 		if (skip_prefix(arg, "--progress=", &arg)) {
 			show_progress = arg;
 			continue;
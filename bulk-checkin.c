@@ -3,6 +3,7 @@
  */
 #include "git-compat-util.h"
 #include "bulk-checkin.h"
+#include "dir.h"
 #include "environment.h"
 #include "gettext.h"
 #include "hex.h"
@@ -15,9 +16,19 @@
 #include "packfile.h"
 #include "object-file.h"
 #include "object-store-ll.h"
+#include "config.h"
+#include "oidmap.h"
+#include "tempfile.h"
+#include "midx.h"
 
 static int odb_transaction_nesting;
 
+/*
+ * Set while a transaction begun by begin_command_odb_transaction() is
+ * active, in which case all objects go to the transaction's pack.
+ */
+static int command_odb_transaction;
+
 static struct tmp_objdir *bulk_fsync_objdir;
 
 static struct bulk_checkin_packfile {
@@ -29,8 +40,213 @@ static struct bulk_checkin_packfile {
 	struct pack_idx_entry **written;
 	uint32_t alloc_written;
 	uint32_t nr_written;
+
+	/* the objects written so far, to be read back before the flush */
+	struct oidmap pending;
+	struct tempfile *tempfile;
 } bulk_checkin_packfile;
 
+struct pending_object {
+	struct oidmap_entry entry;
+	enum object_type type;
+	unsigned long size;
+	off_t offset;
+	off_t disk_size;
+};
+
+/*
+ * Each flush of a command transaction finishes a pack, so that a
+ * command like rebase would otherwise leave one pack per step behind.
+ * Remember the packs the command finished, oldest first: a new pack
+ * absorbs the previous ones while they are less than twice its size,
+ * which keeps their number logarithmic in the number of objects, and
+ * they are all combined into one when the command ends. Packs that
+ * have been kept or are listed in a multi-pack-index in the meantime
+ * are left alone.
+ */
+struct command_pack_entry {
+	struct object_id oid;
+	off_t offset;
+	off_t disk_size;
+	uint32_t crc32;
+};
+
+static struct command_pack {
+	char *path;
+	struct command_pack_entry *entries;
+	uint32_t nr;
+} *command_packs;
+static size_t command_packs_nr, command_packs_alloc;
+
+static void clear_command_pack(struct command_pack *p)
+{
+	free(p->path);
+	free(p->entries);
+}
+
+/*
+ * Whether the given command packs can be deleted once absorbed: none of
+ * them may have been kept, nor be listed in a multi-pack-index.
+ */
+static int command_packs_removable(const struct command_pack *packs, size_t n)
+{
+	struct strbuf buf = STRBUF_INIT;
+	struct multi_pack_index *m;
+	int ret = 1;
+	size_t i;
+
+	for (i = 0; ret && i < n; i++) {
+		strbuf_reset(&buf);
+		strbuf_addstr(&buf, packs[i].path);
+		strbuf_strip_suffix(&buf, ".pack");
+		strbuf_addstr(&buf, ".keep");
+		if (file_exists(buf.buf))
+			ret = 0;
+	}
+
+	/*
+	 * Do not trust the multi-pack-index loaded earlier, as another
+	 * process may have written one since then.
+	 */
+	m = load_multi_pack_index(get_object_directory(), 1);
+	for (i = 0; ret && m && i < n; i++)
+		if (midx_contains_pack(m, strrchr(packs[i].path, '/') + 1))
+			ret = 0;
+	if (m) {
+		close_midx(m);
+	} else if (ret) {
+		/* ...nor a multi-pack-index we failed to read */
+		strbuf_reset(&buf);
+		get_midx_filename(&buf, get_object_directory());
+		if (file_exists(buf.buf))
+			ret = 0;
+		strbuf_reset(&buf);
+		get_midx_chain_filename(&buf, get_object_directory());
+		if (file_exists(buf.buf))
+			ret = 0;
+	}
+
+	strbuf_release(&buf);
+	return ret;
+}
+
+/*
+ * How many of the most recent command packs the pack being written
+ * should absorb, or all of them if "all" is set.
+ */
+static size_t command_packs_to_absorb(struct bulk_checkin_packfile *state,
+				      int all)
+{
+	uint32_t nr = state->nr_written;
+	size_t n = 0;
+
+	/* Objects are copied as they are, so the pack could grow too big. */
+	if (pack_size_limit_cfg)
+		return 0;
+
+	while (n < command_packs_nr) {
+		struct command_pack *p = &command_packs[command_packs_nr - n - 1];
+
+		if (!all && p->nr >= 2 * nr)
+			break;
+		nr += p->nr;
+		n++;
+	}
+
+	/* Rewriting a single pack as it is would gain nothing. */
+	if (n == 1 && !state->nr_written)
+		return 0;
+	if (n && !command_packs_removable(command_packs + command_packs_nr - n, n))
+		return 0;
+	return n;
+}
+
+/*
+ * Copy the objects of a pack we finished earlier to the end of the
+ * current one. They are stored whole, so their data can be copied
+ * without looking at it.
+ */
+static void absorb_command_pack(struct bulk_checkin_packfile *state,
+				const struct command_pack *p)
+{
+	struct strbuf buf = STRBUF_INIT;
+	uint32_t i;
+	int fd = open(p->path, O_RDONLY);
+
+	/* A concurrent repack may have taken care of it already. */
+	if (fd < 0) {
+		if (errno != ENOENT)
+			die_errno(_("unable to open '%s'"), p->path);
+		return;
+	}
+
+	for (i = 0; i < p->nr; i++) {
+		const struct command_pack_entry *e = &p->entries[i];
+		struct pack_idx_entry *idx;
+
+		if (oidmap_get(&state->pending, &e->oid))
+			continue;
+
+		strbuf_grow(&buf, e->disk_size);
+		if (pread_in_full(fd, buf.buf, e->disk_size,
+				  e->offset) != e->disk_size)
+			die_errno(_("unable to read back %s from %s"),
+				  oid_to_hex(&e->oid), p->path);
+
+		CALLOC_ARRAY(idx, 1);
+		oidcpy(&idx->oid, &e->oid);
+		idx->offset = state->offset;
+		idx->crc32 = e->crc32;
+		hashwrite(state->f, buf.buf, e->disk_size);
+		state->offset += e->disk_size;
+
+		ALLOC_GROW(state->written,
+			   state->nr_written + 1,
+			   state->alloc_written);
+		state->written[state->nr_written++] = idx;
+	}
+
+	close(fd);
+	strbuf_release(&buf);
+}
+
+static void remove_command_pack(const struct command_pack *p)
+{
+	struct packed_git *pack;
+
+	for (pack = get_all_packs(the_repository); pack; pack = pack->next)
+		if (!strcmp(pack->pack_name, p->path))
+			close_pack(pack);
+	unlink_pack_path(p->path, 0);
+}
+
+/*
+ * Remember the pack about to be finished; this has to happen before
+ * its index is written, which sorts the entries by object name.
+ */
+static void add_command_pack(struct bulk_checkin_packfile *state,
+			     const char *path)
+{
+	struct command_pack *p;
+	uint32_t i;
+
+	ALLOC_GROW(command_packs, command_packs_nr + 1, command_packs_alloc);
+	p = &command_packs[command_packs_nr++];
+	p->path = xstrdup(path);
+	p->nr = state->nr_written;
+	ALLOC_ARRAY(p->entries, p->nr);
+	for (i = 0; i < p->nr; i++) {
+		struct pack_idx_entry *idx = state->written[i];
+		off_t end = i + 1 < p->nr ?
+			state->written[i + 1]->offset : state->offset;
+
+		oidcpy(&p->entries[i].oid, &idx->oid);
+		p->entries[i].offset = idx->offset;
+		p->entries[i].disk_size = end - idx->offset;
+		p->entries[i].crc32 = idx->crc32;
+	}
+}
+
 static void finish_tmp_packfile(struct strbuf *basename,
 				const char *pack_tmp_name,
 				struct pack_idx_entry **written_list,
@@ -47,18 +263,37 @@ static void finish_tmp_packfile(struct strbuf *basename,
 	free(idx_tmp_name);
 }
 
-static void flush_bulk_checkin_packfile(struct bulk_checkin_packfile *state)
+static void prepare_to_stream(struct bulk_checkin_packfile *state,
+			      unsigned flags);
+
+/*
+ * Finish the pack being written. When "all" is set, all packs the
+ * current command finished before are combined with it.
+ */
+static void flush_bulk_checkin_packfile(struct bulk_checkin_packfile *state,
+					int all)
 {
 	unsigned char hash[GIT_MAX_RAWSZ];
 	struct strbuf packname = STRBUF_INIT;
+	int track = odb_transaction_packs_objects();
+	size_t absorb = 0, first, j;
 	int i;
 
-	if (!state->f)
-		return;
+	if (track)
+		absorb = command_packs_to_absorb(state, all);
+	first = command_packs_nr - absorb;
+
+	if (!state->f) {
+		if (!absorb)
+			return;
+		prepare_to_stream(state, HASH_WRITE_OBJECT);
+	}
+	for (j = 0; j < absorb; j++)
+		absorb_command_pack(state, &command_packs[first + j]);
 
 	if (state->nr_written == 0) {
 		close(state->f->fd);
-		unlink(state->pack_tmp_name);
+		delete_tempfile(&state->tempfile);
 		goto clear_exit;
 	} else if (state->nr_written == 1) {
 		finalize_hashfile(state->f, hash, FSYNC_COMPONENT_PACK,
@@ -73,14 +308,31 @@ static void flush_bulk_checkin_packfile(struct bulk_checkin_packfile *state)
 
 	strbuf_addf(&packname, "%s/pack/pack-%s.", get_object_directory(),
 		    hash_to_hex(hash));
+	if (track) {
+		strbuf_addstr(&packname, "pack");
+		add_command_pack(state, packname.buf);
+		strbuf_strip_suffix(&packname, "pack");
+	}
 	finish_tmp_packfile(&packname, state->pack_tmp_name,
 			    state->written, state->nr_written,
 			    &state->pack_idx_opts, hash);
 	for (i = 0; i < state->nr_written; i++)
 		free(state->written[i]);
+	/* the pack is in place under its final name */
+	delete_tempfile(&state->tempfile);
 
 clear_exit:
+	/* Only now that the new pack is in place can the old ones go. */
+	for (j = 0; j < absorb; j++) {
+		remove_command_pack(&command_packs[first + j]);
+		clear_command_pack(&command_packs[first + j]);
+	}
+	MOVE_ARRAY(command_packs + first, command_packs + first + absorb,
+		   command_packs_nr - first - absorb);
+	command_packs_nr -= absorb;
+
 	free(state->written);
+	oidmap_free(&state->pending, 1);
 	memset(state, 0, sizeof(*state));
 
 	strbuf_release(&packname);
@@ -124,21 +376,38 @@ static void flush_batch_fsync(void)
 
 static int already_written(struct bulk_checkin_packfile *state, struct object_id *oid)
 {
-	int i;
-
 	/* The object may already exist in the repository */
 	if (repo_has_object_file(the_repository, oid))
 		return 1;
 
-	/* Might want to keep the list sorted */
-	for (i = 0; i < state->nr_written; i++)
-		if (oideq(&state->written[i]->oid, oid))
-			return 1;
+	/* ...or have been written to this pack */
+	if (oidmap_get(&state->pending, oid))
+		return 1;
 
 	/* This is a new object we need to keep */
 	return 0;
 }
 
+static void record_written(struct bulk_checkin_packfile *state,
+			   struct pack_idx_entry *idx,
+			   enum object_type type, unsigned long size)
+{
+	struct pending_object *po;
+
+	ALLOC_GROW(state->written,
+		   state->nr_written + 1,
+		   state->alloc_written);
+	state->written[state->nr_written++] = idx;
+
+	CALLOC_ARRAY(po, 1);
+	oidcpy(&po->entry.oid, &idx->oid);
+	po->type = type;
+	po->size = size;
+	po->offset = idx->offset;
+	po->disk_size = state->offset - idx->offset;
+	oidmap_put(&state->pending, po);
+}
+
 /*
  * Read the contents from fd for size bytes, streaming it to the
  * packfile in state while updating the hash in ctx. Signal a failure
@@ -238,6 +507,7 @@ static void prepare_to_stream(struct bulk_checkin_packfile *state,
 		return;
 
 	state->f = create_tmp_packfile(&state->pack_tmp_name);
+	state->tempfile = register_tempfile(state->pack_tmp_name);
 	reset_pack_idx_option(&state->pack_idx_opts);
 
 	/* Pretend we are going to write only one object */
@@ -293,7 +563,7 @@ static int deflate_blob_to_pack(struct bulk_checkin_packfile *state,
 			BUG("should not happen");
 		hashfile_truncate(state->f, &checkpoint);
 		state->offset = checkpoint.offset;
-		flush_bulk_checkin_packfile(state);
+		flush_bulk_checkin_packfile(state, 0);
 		if (lseek(fd, seekback, SEEK_SET) == (off_t) -1)
 			return error("cannot seek back");
 	}
@@ -308,14 +578,151 @@ static int deflate_blob_to_pack(struct bulk_checkin_packfile *state,
 		free(idx);
 	} else {
 		oidcpy(&idx->oid, result_oid);
-		ALLOC_GROW(state->written,
-			   state->nr_written + 1,
-			   state->alloc_written);
-		state->written[state->nr_written++] = idx;
+		record_written(state, idx, OBJ_BLOB, size);
 	}
 	return 0;
 }
 
+/*
+ * Deflate an object held in core to the packfile. Like
+ * stream_blob_to_pack(), return a negative value without writing
+ * anything when this would exceed the pack size limit, and this is not
+ * the first object in the pack.
+ */
+static int deflate_buffer_to_pack(struct bulk_checkin_packfile *state,
+				  enum object_type type,
+				  const void *buf, unsigned long size)
+{
+	git_zstream s;
+	unsigned char obuf[16384];
+	unsigned char *out;
+	unsigned long maxsize;
+	unsigned hdrlen;
+	int status;
+
+	hdrlen = encode_in_pack_object_header(obuf, sizeof(obuf), type, size);
+
+	git_deflate_init(&s, pack_compression_level);
+	maxsize = git_deflate_bound(&s, size);
+	out = maxsize + hdrlen <= sizeof(obuf) ? obuf : xmalloc(maxsize + hdrlen);
+	if (out != obuf)
+		memcpy(out, obuf, hdrlen);
+
+	s.next_in = (void *)buf;
+	s.avail_in = size;
+	s.next_out = out + hdrlen;
+	s.avail_out = maxsize;
+	while ((status = git_deflate(&s, Z_FINISH)) == Z_OK)
+		; /* nothing */
+	if (status != Z_STREAM_END)
+		die("unexpected deflate failure: %d", status);
+	git_deflate_end(&s);
+
+	if (state->nr_written &&
+	    pack_size_limit_cfg &&
+	    pack_size_limit_cfg < state->offset + hdrlen + s.total_out) {
+		if (out != obuf)
+			free(out);
+		return -1;
+	}
+
+	hashwrite(state->f, out, hdrlen + s.total_out);
+	state->offset += hdrlen + s.total_out;
+	if (out != obuf)
+		free(out);
+	return 0;
+}
+
+int write_object_bulk_checkin(const void *buf, unsigned long len,
+			      enum object_type type,
+			      const struct object_id *oid)
+{
+	struct bulk_checkin_packfile *state = &bulk_checkin_packfile;
+	struct pack_idx_entry *idx;
+
+	if (oidmap_get(&state->pending, oid))
+		return 0;
+
+	CALLOC_ARRAY(idx, 1);
+	for (;;) {
+		prepare_to_stream(state, HASH_WRITE_OBJECT);
+		idx->offset = state->offset;
+		crc32_begin(state->f);
+		if (!deflate_buffer_to_pack(state, type, buf, len))
+			break;
+		/* Nothing was written; start a new pack and try again. */
+		flush_bulk_checkin_packfile(state, 0);
+	}
+	idx->crc32 = crc32_end(state->f);
+	oidcpy(&idx->oid, oid);
+	record_written(state, idx, type, len);
+	return 0;
+}
+
+static void *read_pending_object(struct bulk_checkin_packfile *state,
+				 const struct pending_object *po)
+{
+	unsigned char *in = xmalloc(po->disk_size);
+	unsigned char *out;
+	enum object_type type;
+	unsigned long size, hdrlen;
+	git_zstream s;
+	int status;
+
+	/* Make sure everything we wrote has made it to the file. */
+	hashflush(state->f);
+	if (pread_in_full(state->f->fd, in, po->disk_size,
+			  po->offset) != po->disk_size)
+		die_errno(_("unable to read back %s from %s"),
+			  oid_to_hex(&po->entry.oid), state->pack_tmp_name);
+
+	hdrlen = unpack_object_header_buffer(in, po->disk_size, &type, &size);
+	if (!hdrlen || type != po->type || size != po->size)
+		die(_("object %s in %s is corrupt"),
+		    oid_to_hex(&po->entry.oid), state->pack_tmp_name);
+
+	out = xmallocz(size);
+	memset(&s, 0, sizeof(s));
+	git_inflate_init(&s);
+	s.next_in = in + hdrlen;
+	s.avail_in = po->disk_size - hdrlen;
+	s.next_out = out;
+	s.avail_out = size;
+	status = git_inflate(&s, Z_FINISH);
+	git_inflate_end(&s);
+	if (status != Z_STREAM_END || s.total_out != size)
+		die(_("object %s in %s is corrupt"),
+		    oid_to_hex(&po->entry.oid), state->pack_tmp_name);
+
+	free(in);
+	return out;
+}
+
+int bulk_checkin_object_info(const struct object_id *oid,
+			     struct object_info *oi)
+{
+	struct bulk_checkin_packfile *state = &bulk_checkin_packfile;
+	struct pending_object *po = oidmap_get(&state->pending, oid);
+
+	if (!po)
+		return -1;
+
+	if (oi->typep)
+		*oi->typep = po->type;
+	if (oi->sizep)
+		*oi->sizep = po->size;
+	if (oi->disk_sizep)
+		*oi->disk_sizep = po->disk_size;
+	if (oi->delta_base_oid)
+		oidclr(oi->delta_base_oid);
+	if (oi->type_name)
+		strbuf_addstr(oi->type_name, type_name(po->type));
+	if (oi->contentp)
+		*oi->contentp = read_pending_object(state, po);
+	oi->whence = OI_PENDING;
+	return 0;
+}
+
 void prepare_loose_object_bulk_checkin(void)
 {
 	/*
@@ -356,7 +763,7 @@ int index_blob_bulk_checkin(struct object_id *oid,
 	int status = deflate_blob_to_pack(&bulk_checkin_packfile, oid, fd, size,
 					  path, flags);
 	if (!odb_transaction_nesting)
-		flush_bulk_checkin_packfile(&bulk_checkin_packfile);
+		flush_bulk_checkin_packfile(&bulk_checkin_packfile, 0);
 	return status;
 }
 
@@ -368,7 +775,7 @@ void begin_odb_transaction(void)
 void flush_odb_transaction(void)
 {
 	flush_batch_fsync();
-	flush_bulk_checkin_packfile(&bulk_checkin_packfile);
+	flush_bulk_checkin_packfile(&bulk_checkin_packfile, 0);
 }
 
 void end_odb_transaction(void)
@@ -382,3 +789,42 @@ void end_odb_transaction(void)
 
 	flush_odb_transaction();
 }
+
+void begin_command_odb_transaction(void)
+{
+	int enabled = 0;
+
+	if (command_odb_transaction ||
+	    repo_config_get_bool(the_repository, "core.packobjectwrites",
+				 &enabled) ||
+	    !enabled)
+		return;
+
+	command_odb_transaction = 1;
+	begin_odb_transaction();
+}
+
+void end_command_odb_transaction(void)
+{
+	size_t i;
+
+	if (!command_odb_transaction)
+		return;
+
+	/* Leave a single pack behind for the whole command. */
+	flush_bulk_checkin_packfile(&bulk_checkin_packfile, 1);
+	command_odb_transaction = 0;
+	end_odb_transaction();
+
+	for (i = 0; i < command_packs_nr; i++)
+		clear_command_pack(&command_packs[i]);
+	FREE_AND_NULL(command_packs);
+	command_packs_nr = command_packs_alloc = 0;
+}
+
+int odb_transaction_packs_objects(void)
+{
+	/* A temporary object directory should not leave packs behind. */
+	return command_odb_transaction &&
+		!the_repository->objects->odb->will_destroy;
+}
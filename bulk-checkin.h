@@ -13,6 +13,23 @@ int index_blob_bulk_checkin(struct object_id *oid,
 			    int fd, size_t size,
 			    const char *path, unsigned flags);
 
+/*
+ * Write an object with the given contents and object name to the pack
+ * of the current transaction, see odb_transaction_packs_objects().
+ */
+int write_object_bulk_checkin(const void *buf, unsigned long len,
+			      enum object_type type,
+			      const struct object_id *oid);
+
+/*
+ * Look up an object written to the pack of the current transaction,
+ * which is not visible the usual way until the pack is finished.
+ * Returns -1 if there is no such object.
+ */
+struct object_info;
+int bulk_checkin_object_info(const struct object_id *oid,
+			     struct object_info *oi);
+
 /*
  * Tell the object database to optimize for adding
  * multiple objects. end_odb_transaction must be called
@@ -36,4 +53,19 @@ void flush_odb_transaction(void);
  */
 void end_odb_transaction(void);
 
+/*
+ * Wrap a whole command in a transaction when `core.packObjectWrites` is
+ * set. While it is active, all objects written by the command (not only
+ * large blobs) go into a single pack instead of loose object files. The
+ * objects can be read back by the command right away, but become visible
+ * to other processes only once the transaction is flushed, which happens
+ * before references or the index are updated, and before running a Git
+ * subprocess or hook.
+ */
+void begin_command_odb_transaction(void);
+void end_command_odb_transaction(void);
+
+/* Whether newly written objects should go to the transaction's pack. */
+int odb_transaction_packs_objects(void);
+
 #endif
@@ -25,6 +25,13 @@
 #include "trace2.h"
 #include "tree.h"
 #include "chunk-format.h"
+#include "thread-utils.h"
+#include "ident.h"
+#include "pretty.h"
+#include "strmap.h"
+#include "utf8.h"
+#include "diff.h"
+#include "pathspec.h"
 
 void git_test_write_commit_graph_or_die(void)
 {
@@ -50,6 +57,13 @@ void git_test_write_commit_graph_or_die(void)
 #define GRAPH_CHUNKID_BLOOMINDEXES 0x42494458 /* "BIDX" */
 #define GRAPH_CHUNKID_BLOOMDATA 0x42444154 /* "BDAT" */
 #define GRAPH_CHUNKID_BASE 0x42415345 /* "BASE" */
+#define GRAPH_CHUNKID_REACHABILITY 0x52494458 /* "RIDX" */
+#define GRAPH_CHUNKID_LOG_METADATA 0x4c4f474d /* "LOGM" */
+#define GRAPH_CHUNKID_IDENTS 0x49444e54 /* "IDNT" */
+#define GRAPH_CHUNKID_SUBJECTS 0x5355424a /* "SUBJ" */
+#define GRAPH_CHUNKID_CHANGED_PATH_INDEX 0x43504958 /* "CPIX" */
+#define GRAPH_CHUNKID_CHANGED_PATH_LISTS 0x43504c53 /* "CPLS" */
+#define GRAPH_CHUNKID_CHANGED_PATH_TABLE 0x43505442 /* "CPTB" */
 
 #define GRAPH_DATA_WIDTH (the_hash_algo->rawsz + 16)
 
@@ -62,6 +76,11 @@ void git_test_write_commit_graph_or_die(void)
 
 #define GRAPH_LAST_EDGE 0x80000000
 
+#define GRAPH_LOG_METADATA_WIDTH 36
+#define GRAPH_LOG_METADATA_NONE 0xffffffff
+
+#define GRAPH_CHANGED_PATHS_NONE 0x80000000
+
 #define GRAPH_HEADER_SIZE 8
 #define GRAPH_FANOUT_SIZE (4 * 256)
 #define GRAPH_MIN_SIZE (GRAPH_HEADER_SIZE + 4 * CHUNK_TOC_ENTRY_SIZE \
@@ -108,18 +127,30 @@ static int get_configured_generation_version(struct repository *r)
 	return version;
 }
 
+/*
+ * The slab is shared by all threads parsing commits; see
+ * enable_object_table_lock().
+ */
+static struct commit_graph_data *commit_graph_data_peek(const struct commit *c)
+{
+	struct commit_graph_data *data;
+
+	object_state_lock();
+	data = commit_graph_data_slab_peek(&commit_graph_data_slab, c);
+	object_state_unlock();
+	return data;
+}
+
 uint32_t commit_graph_position(const struct commit *c)
 {
-	struct commit_graph_data *data =
-		commit_graph_data_slab_peek(&commit_graph_data_slab, c);
+	struct commit_graph_data *data = commit_graph_data_peek(c);
 
 	return data ? data->graph_pos : COMMIT_NOT_FROM_GRAPH;
 }
 
 timestamp_t commit_graph_generation(const struct commit *c)
 {
-	struct commit_graph_data *data =
-		commit_graph_data_slab_peek(&commit_graph_data_slab, c);
+	struct commit_graph_data *data = commit_graph_data_peek(c);
 
 	if (data && data->generation)
 		return data->generation;
@@ -129,8 +160,7 @@ timestamp_t commit_graph_generation(const struct commit *c)
 
 static timestamp_t commit_graph_generation_from_graph(const struct commit *c)
 {
-	struct commit_graph_data *data =
-		commit_graph_data_slab_peek(&commit_graph_data_slab, c);
+	struct commit_graph_data *data = commit_graph_data_peek(c);
 
 	if (!data || data->graph_pos == COMMIT_NOT_FROM_GRAPH)
 		return GENERATION_NUMBER_INFINITY;
@@ -140,11 +170,14 @@ static timestamp_t commit_graph_generation_from_graph(const struct commit *c)
 static struct commit_graph_data *commit_graph_data_at(const struct commit *c)
 {
 	unsigned int i, nth_slab;
-	struct commit_graph_data *data =
-		commit_graph_data_slab_peek(&commit_graph_data_slab, c);
+	struct commit_graph_data *data;
 
-	if (data)
+	object_state_lock();
+	data = commit_graph_data_slab_peek(&commit_graph_data_slab, c);
+	if (data) {
+		object_state_unlock();
 		return data;
+	}
 
 	nth_slab = c->index / commit_graph_data_slab.slab_size;
 	data = commit_graph_data_slab_at(&commit_graph_data_slab, c);
@@ -160,6 +193,7 @@ static struct commit_graph_data *commit_graph_data_at(const struct commit *c)
 		commit_graph_data_slab.slab[nth_slab][i].graph_pos =
 			COMMIT_NOT_FROM_GRAPH;
 	}
+	object_state_unlock();
 
 	return data;
 }
@@ -370,6 +404,42 @@ static int graph_read_bloom_data(const unsigned char *chunk_start,
 	return 0;
 }
 
+static int graph_read_reachability_index(const unsigned char *chunk_start,
+					 size_t chunk_size, void *data)
+{
+	struct commit_graph *g = data;
+	if (chunk_size / (3 * sizeof(uint32_t)) != g->num_commits) {
+		warning(_("commit-graph reachability index chunk is wrong size"));
+		return -1;
+	}
+	g->chunk_reachability_index = chunk_start;
+	return 0;
+}
+
+static int graph_read_log_metadata(const unsigned char *chunk_start,
+				   size_t chunk_size, void *data)
+{
+	struct commit_graph *g = data;
+	if (chunk_size / GRAPH_LOG_METADATA_WIDTH != g->num_commits) {
+		warning(_("commit-graph log metadata chunk is wrong size"));
+		return -1;
+	}
+	g->chunk_log_metadata = chunk_start;
+	return 0;
+}
+
+static int graph_read_changed_path_index(const unsigned char *chunk_start,
+					 size_t chunk_size, void *data)
+{
+	struct commit_graph *g = data;
+	if (chunk_size / sizeof(uint32_t) != g->num_commits) {
+		warning(_("commit-graph changed-path list index chunk is wrong size"));
+		return -1;
+	}
+	g->chunk_changed_path_index = chunk_start;
+	return 0;
+}
+
 struct commit_graph *parse_commit_graph(struct repo_settings *s,
 					void *graph_map, size_t graph_size)
 {
@@ -466,6 +536,48 @@ struct commit_graph *parse_commit_graph(struct repo_settings *s,
 			   graph_read_bloom_data, graph);
 	}
 
+	if (s->commit_graph_read_reachability_index)
+		read_chunk(cf, GRAPH_CHUNKID_REACHABILITY,
+			   graph_read_reachability_index, graph);
+
+	if (s->commit_graph_read_log_metadata) {
+		read_chunk(cf, GRAPH_CHUNKID_LOG_METADATA,
+			   graph_read_log_metadata, graph);
+		pair_chunk(cf, GRAPH_CHUNKID_IDENTS, &graph->chunk_idents,
+			   &graph->chunk_idents_size);
+		pair_chunk(cf, GRAPH_CHUNKID_SUBJECTS, &graph->chunk_subjects,
+			   &graph->chunk_subjects_size);
+	}
+
+	/* Every string in these chunks, including the last one, ends in a NUL. */
+	if (graph->chunk_log_metadata &&
+	    (!graph->chunk_idents_size ||
+	     graph->chunk_idents[graph->chunk_idents_size - 1] ||
+	     !graph->chunk_subjects_size ||
+	     graph->chunk_subjects[graph->chunk_subjects_size - 1])) {
+		warning(_("ignoring commit-graph log metadata without proper string tables"));
+		graph->chunk_log_metadata = NULL;
+	}
+
+	if (s->commit_graph_read_changed_path_lists) {
+		read_chunk(cf, GRAPH_CHUNKID_CHANGED_PATH_INDEX,
+			   graph_read_changed_path_index, graph);
+		pair_chunk(cf, GRAPH_CHUNKID_CHANGED_PATH_LISTS,
+			   &graph->chunk_changed_path_lists,
+			   &graph->chunk_changed_path_lists_size);
+		pair_chunk(cf, GRAPH_CHUNKID_CHANGED_PATH_TABLE,
+			   &graph->chunk_changed_path_table,
+			   &graph->chunk_changed_path_table_size);
+	}
+
+	if (graph->chunk_changed_path_index &&
+	    (graph->chunk_changed_path_lists_size % sizeof(uint32_t) ||
+	     !graph->chunk_changed_path_table_size ||
+	     graph->chunk_changed_path_table[graph->chunk_changed_path_table_size - 1])) {
+		warning(_("ignoring commit-graph changed-path lists without proper path table"));
+		graph->chunk_changed_path_index = NULL;
+	}
+
 	if (graph->chunk_bloom_indexes && graph->chunk_bloom_data) {
 		init_bloom_filters();
 	} else {
@@ -720,7 +832,7 @@ static void prepare_commit_graph_one(struct repository *r,
  * On the first invocation, this function attempts to load the commit
  * graph if the_repository is configured to have one.
  */
-static int prepare_commit_graph(struct repository *r)
+int prepare_commit_graph(struct repository *r)
 {
 	struct object_directory *odb;
 
@@ -804,6 +916,215 @@ struct bloom_filter_settings *get_bloom_filter_settings(struct repository *r)
 	return NULL;
 }
 
+int commit_graph_can_reach(struct repository *r,
+			   struct commit *from, struct commit *to)
+{
+	struct commit_graph *g;
+	uint32_t from_pos, to_pos;
+	const unsigned char *from_labels, *to_labels;
+
+	if (from == to)
+		return 1;
+	if (!prepare_commit_graph(r))
+		return -1;
+
+	/* only the base layer has the index, covering all of its history */
+	for (g = r->objects->commit_graph; g->base_graph; g = g->base_graph)
+		; /* nothing */
+	if (!g->chunk_reachability_index)
+		return -1;
+
+	from_pos = commit_graph_position(from);
+	to_pos = commit_graph_position(to);
+	if (from_pos >= g->num_commits || to_pos >= g->num_commits)
+		return -1;
+
+	from_labels = g->chunk_reachability_index + st_mult(12, from_pos);
+	to_labels = g->chunk_reachability_index + st_mult(12, to_pos);
+
+	/* "to" was finished after "from", or reaches further down */
+	if (get_be32(to_labels + 4) > get_be32(from_labels + 4) ||
+	    get_be32(to_labels + 8) < get_be32(from_labels + 8))
+		return 0;
+
+	/* the traversal got to "to" by way of "from" */
+	if (get_be32(from_labels) <= get_be32(to_labels) &&
+	    get_be32(to_labels + 4) <= get_be32(from_labels + 4))
+		return 1;
+
+	return -1;
+}
+
+static int log_metadata_at(struct commit_graph *g, uint32_t lex_index,
+			   struct commit_graph_log_metadata *meta)
+{
+	const unsigned char *rec;
+	uint32_t author, committer, subject;
+
+	rec = g->chunk_log_metadata +
+		st_mult(GRAPH_LOG_METADATA_WIDTH, lex_index);
+	author = get_be32(rec);
+	committer = get_be32(rec + 4);
+	subject = get_be32(rec + 32);
+
+	/* this also catches GRAPH_LOG_METADATA_NONE */
+	if (author >= g->chunk_idents_size ||
+	    committer >= g->chunk_idents_size ||
+	    subject >= g->chunk_subjects_size)
+		return 0;
+
+	meta->author = (const char *)g->chunk_idents + author;
+	meta->author_len = strlen(meta->author);
+	meta->committer = (const char *)g->chunk_idents + committer;
+	meta->committer_len = strlen(meta->committer);
+	meta->author_date = get_be64(rec + 8);
+	meta->committer_date = get_be64(rec + 16);
+	meta->author_tz = (int32_t)get_be32(rec + 24);
+	meta->committer_tz = (int32_t)get_be32(rec + 28);
+	meta->subject = (const char *)g->chunk_subjects + subject;
+	meta->subject_len = strlen(meta->subject);
+	return 1;
+}
+
+int commit_graph_log_metadata(struct repository *r, const struct commit *c,
+			      struct commit_graph_log_metadata *meta)
+{
+	uint32_t pos = commit_graph_position(c);
+	struct commit_graph *g;
+
+	if (pos == COMMIT_NOT_FROM_GRAPH || !prepare_commit_graph(r))
+		return 0;
+
+	g = r->objects->commit_graph;
+	while (g && pos < g->num_commits_in_base)
+		g = g->base_graph;
+	if (!g || !g->chunk_log_metadata)
+		return 0;
+
+	return log_metadata_at(g, pos - g->num_commits_in_base, meta);
+}
+
+static int changed_paths_at(struct commit_graph *g, uint32_t lex_index,
+			    struct commit_graph_changed_paths *list)
+{
+	uint32_t start = 0, end;
+
+	end = get_be32(g->chunk_changed_path_index +
+		       st_mult(sizeof(uint32_t), lex_index));
+	if (end & GRAPH_CHANGED_PATHS_NONE)
+		return 0;
+	if (lex_index)
+		start = get_be32(g->chunk_changed_path_index +
+				 st_mult(sizeof(uint32_t), lex_index - 1)) &
+			~GRAPH_CHANGED_PATHS_NONE;
+	if (end < start ||
+	    end > g->chunk_changed_path_lists_size / sizeof(uint32_t))
+		return 0;
+
+	list->ids = g->chunk_changed_path_lists +
+		st_mult(sizeof(uint32_t), start);
+	list->nr = end - start;
+	list->table = (const char *)g->chunk_changed_path_table;
+	list->table_size = g->chunk_changed_path_table_size;
+	return 1;
+}
+
+int commit_graph_changed_paths(struct repository *r, const struct commit *c,
+			       struct commit_graph_changed_paths *list)
+{
+	uint32_t pos = commit_graph_position(c);
+	struct commit_graph *g;
+
+	if (pos == COMMIT_NOT_FROM_GRAPH || !prepare_commit_graph(r))
+		return 0;
+
+	g = r->objects->commit_graph;
+	while (g && pos < g->num_commits_in_base)
+		g = g->base_graph;
+	if (!g || !g->chunk_changed_path_index)
+		return 0;
+
+	return changed_paths_at(g, pos - g->num_commits_in_base, list);
+}
+
+const char *commit_graph_changed_path(const struct commit_graph_changed_paths *list,
+				      uint32_t i)
+{
+	uint32_t id = get_be32(list->ids + st_mult(sizeof(uint32_t), i));
+
+	if (id >= list->table_size)
+		return NULL;
+	return list->table + id;
+}
+
+/*
+ * Return 1 if "path" is matched by "pathspec", the way tree_entry_interesting()
+ * would match it, 0 if it is not, and -1 if that depends on what kind of
+ * entry "path" is.
+ */
+static int changed_path_matches(const struct pathspec *pathspec,
+				const char *path)
+{
+	size_t path_len = strlen(path);
+	int i, unsure = 0;
+
+	if (!pathspec->nr)
+		return 1;
+
+	for (i = 0; i < pathspec->nr; i++) {
+		const struct pathspec_item *item = &pathspec->items[i];
+		size_t len = item->len;
+
+		if (path_len < len) {
+			/* "sub/" matches the submodule "sub", but not a file */
+			if (path_len + 1 == len && item->match[path_len] == '/' &&
+			    !memcmp(path, item->match, path_len))
+				unsure = 1;
+			continue;
+		}
+		if (memcmp(path, item->match, len))
+			continue;
+		if (!len || path_len == len ||
+		    item->match[len - 1] == '/' || path[len] == '/')
+			return 1;
+	}
+
+	return unsure ? -1 : 0;
+}
+
+int commit_graph_changes_pathspec(struct repository *r, const struct commit *c,
+				  const struct pathspec *pathspec)
+{
+	struct commit_graph_changed_paths list;
+	uint32_t i;
+	int j, unsure = 0;
+
+	if (pathspec->has_wildcard || (pathspec->magic & ~PATHSPEC_LITERAL))
+		return -1;
+	for (j = 0; j < pathspec->nr; j++)
+		if (pathspec->items[j].magic & ~PATHSPEC_LITERAL)
+			return -1;
+
+	if (!commit_graph_changed_paths(r, c, &list))
+		return -1;
+
+	for (i = 0; i < list.nr; i++) {
+		const char *path = commit_graph_changed_path(&list, i);
+
+		if (!path)
+			return -1;
+		switch (changed_path_matches(pathspec, path)) {
+		case 1:
+			return 1;
+		case -1:
+			unsure = 1;
+			break;
+		}
+	}
+
+	return unsure ? -1 : 0;
+}
+
 void close_commit_graph(struct raw_object_store *o)
 {
 	if (!o->commit_graph)
@@ -926,7 +1247,7 @@ static int fill_commit_in_graph(struct repository *r,
 	lex_index = pos - g->num_commits_in_base;
 	commit_data = g->chunk_commit_data + st_mult(g->hash_len + 16, lex_index);
 
-	item->object.parsed = 1;
+	set_object_parsed(&item->object, 1);
 
 	set_commit_tree(item, NULL);
 
@@ -951,7 +1272,7 @@ static int fill_commit_in_graph(struct repository *r,
 			error(_("commit-graph extra-edges pointer out of bounds"));
 			free_commit_list(item->parents);
 			item->parents = NULL;
-			item->object.parsed = 0;
+			set_object_parsed(&item->object, 0);
 			return 0;
 		}
 		edge_value = get_be32(g->chunk_extra_edges +
@@ -1047,11 +1368,12 @@ int parse_commit_in_graph(struct repository *r, struct commit *item)
 {
 	static int checked_env = 0;
 
-	if (!checked_env &&
-	    git_env_bool(GIT_TEST_COMMIT_GRAPH_DIE_ON_PARSE, 0))
-		die("dying as requested by the '%s' variable on commit-graph parse!",
-		    GIT_TEST_COMMIT_GRAPH_DIE_ON_PARSE);
-	checked_env = 1;
+	if (!checked_env) {
+		if (git_env_bool(GIT_TEST_COMMIT_GRAPH_DIE_ON_PARSE, 0))
+			die("dying as requested by the '%s' variable on commit-graph parse!",
+			    GIT_TEST_COMMIT_GRAPH_DIE_ON_PARSE);
+		checked_env = 1;
+	}
 
 	if (!prepare_commit_graph(r))
 		return 0;
@@ -1136,7 +1458,10 @@ struct write_commit_graph_context {
 		 changed_paths:1,
 		 order_by_pack:1,
 		 write_generation_data:1,
-		 trust_generation_numbers:1;
+		 trust_generation_numbers:1,
+		 write_reachability_index:1,
+		 write_log_metadata:1,
+		 write_changed_path_lists:1;
 
 	struct topo_level_slab *topo_levels;
 	const struct commit_graph_opts *opts;
@@ -1147,6 +1472,18 @@ struct write_commit_graph_context {
 	int count_bloom_filter_not_computed;
 	int count_bloom_filter_trunc_empty;
 	int count_bloom_filter_trunc_large;
+
+	/* pre-order, post-order and lowest reachable post-order per commit */
+	uint32_t *reachability_index;
+
+	unsigned char *log_metadata;
+	struct strbuf idents;
+	struct strbuf subjects;
+
+	uint32_t *changed_path_index;
+	uint32_t *changed_path_ids;
+	size_t changed_path_ids_nr, changed_path_ids_alloc;
+	struct strbuf changed_path_table;
 };
 
 static int write_graph_chunk_fanout(struct hashfile *f,
@@ -1397,6 +1734,88 @@ static int write_graph_chunk_extra_edges(struct hashfile *f,
 	return 0;
 }
 
+static int write_graph_chunk_reachability_index(struct hashfile *f,
+						void *data)
+{
+	struct write_commit_graph_context *ctx = data;
+	const uint32_t *labels = ctx->reachability_index;
+	int i;
+
+	for (i = 0; i < ctx->commits.nr; i++) {
+		display_progress(ctx->progress, ++ctx->progress_cnt);
+		hashwrite_be32(f, *labels++);
+		hashwrite_be32(f, *labels++);
+		hashwrite_be32(f, *labels++);
+	}
+
+	return 0;
+}
+
+static int write_graph_chunk_log_metadata(struct hashfile *f,
+					  void *data)
+{
+	struct write_commit_graph_context *ctx = data;
+	int i;
+
+	for (i = 0; i < ctx->commits.nr; i++) {
+		display_progress(ctx->progress, ++ctx->progress_cnt);
+		hashwrite(f, ctx->log_metadata +
+			     st_mult(GRAPH_LOG_METADATA_WIDTH, i),
+			  GRAPH_LOG_METADATA_WIDTH);
+	}
+
+	return 0;
+}
+
+static int write_graph_chunk_idents(struct hashfile *f,
+				    void *data)
+{
+	struct write_commit_graph_context *ctx = data;
+	hashwrite(f, ctx->idents.buf, ctx->idents.len);
+	return 0;
+}
+
+static int write_graph_chunk_subjects(struct hashfile *f,
+				      void *data)
+{
+	struct write_commit_graph_context *ctx = data;
+	hashwrite(f, ctx->subjects.buf, ctx->subjects.len);
+	return 0;
+}
+
+static int write_graph_chunk_changed_path_index(struct hashfile *f,
+						void *data)
+{
+	struct write_commit_graph_context *ctx = data;
+	int i;
+
+	for (i = 0; i < ctx->commits.nr; i++) {
+		display_progress(ctx->progress, ++ctx->progress_cnt);
+		hashwrite_be32(f, ctx->changed_path_index[i]);
+	}
+
+	return 0;
+}
+
+static int write_graph_chunk_changed_path_lists(struct hashfile *f,
+						void *data)
+{
+	struct write_commit_graph_context *ctx = data;
+	size_t i;
+
+	for (i = 0; i < ctx->changed_path_ids_nr; i++)
+		hashwrite_be32(f, ctx->changed_path_ids[i]);
+	return 0;
+}
+
+static int write_graph_chunk_changed_path_table(struct hashfile *f,
+						void *data)
+{
+	struct write_commit_graph_context *ctx = data;
+	hashwrite(f, ctx->changed_path_table.buf, ctx->changed_path_table.len);
+	return 0;
+}
+
 static int write_graph_chunk_bloom_indexes(struct hashfile *f,
 					   void *data)
 {
@@ -1715,6 +2134,389 @@ static void compute_generation_numbers(struct write_commit_graph_context *ctx)
 	stop_progress(&ctx->progress);
 }
 
+static int parse_log_ident(const char *line, size_t len, const char **ident,
+			   size_t *ident_len, timestamp_t *date, int *tz)
+{
+	struct ident_split split;
+	struct strbuf check = STRBUF_INIT;
+	int ret;
+
+	if (split_ident_line(&split, line, len) ||
+	    !split.date_begin || !split.tz_begin)
+		return -1;
+
+	*ident = line;
+	*ident_len = split.mail_end + 1 - line;
+	*date = parse_timestamp(split.date_begin, NULL, 10);
+	*tz = strtol(split.tz_begin, NULL, 10);
+
+	/* only take what can be put back together exactly */
+	strbuf_addf(&check, "%.*s %"PRItime" %+05d",
+		    (int)*ident_len, line, *date, *tz);
+	ret = check.len == len && !memcmp(check.buf, line, len) ? 0 : -1;
+	strbuf_release(&check);
+	return ret;
+}
+
+/*
+ * Pick what pretty.c would show for the commit in "buf". The strings
+ * point into "buf", and are not NUL-terminated. Returns -1 if the commit
+ * is not in UTF-8, or if its idents cannot be stored faithfully.
+ */
+static int parse_log_metadata(const char *buf,
+			      struct commit_graph_log_metadata *meta)
+{
+	const char *author = NULL, *committer = NULL, *name;
+	size_t author_len = 0, committer_len = 0;
+	int i;
+
+	/* the same header lines as parse_commit_header() in pretty.c */
+	for (i = 0; buf[i]; i++) {
+		int eol;
+		for (eol = i; buf[eol] && buf[eol] != '\n'; eol++)
+			; /* do nothing */
+
+		if (i == eol) {
+			break;
+		} else if (skip_prefix(buf + i, "author ", &name)) {
+			author = name;
+			author_len = buf + eol - name;
+		} else if (skip_prefix(buf + i, "committer ", &name)) {
+			committer = name;
+			committer_len = buf + eol - name;
+		} else if (skip_prefix(buf + i, "encoding ", &name)) {
+			char *encoding = xmemdupz(name, buf + eol - name);
+			int utf8 = is_encoding_utf8(encoding);
+
+			free(encoding);
+			if (!utf8)
+				return -1;
+		}
+		i = eol;
+	}
+
+	if (!author || !committer ||
+	    parse_log_ident(author, author_len, &meta->author,
+			    &meta->author_len, &meta->author_date,
+			    &meta->author_tz) ||
+	    parse_log_ident(committer, committer_len, &meta->committer,
+			    &meta->committer_len, &meta->committer_date,
+			    &meta->committer_tz))
+		return -1;
+
+	meta->subject = skip_blank_lines(buf + i);
+	meta->subject_len = format_subject(NULL, meta->subject, NULL) -
+			    meta->subject;
+	return 0;
+}
+
+static uint32_t add_log_string(struct strbuf *table, struct strintmap *seen,
+			       const char *str, size_t len)
+{
+	char *key = xmemdupz(str, len);
+	int offset = seen ? strintmap_get(seen, key) : -1;
+
+	if (offset < 0 && table->len + len < INT_MAX) {
+		offset = table->len;
+		strbuf_add(table, key, len + 1);
+		if (seen)
+			strintmap_set(seen, key, offset);
+	}
+	free(key);
+	return offset < 0 ? GRAPH_LOG_METADATA_NONE : offset;
+}
+
+static void compute_log_metadata(struct write_commit_graph_context *ctx)
+{
+	struct strintmap idents;
+	int i;
+
+	if (ctx->report_progress)
+		ctx->progress = start_delayed_progress(
+					_("Collecting commit log metadata"),
+					ctx->commits.nr);
+
+	strintmap_init_with_options(&idents, -1, NULL, 1);
+	CALLOC_ARRAY(ctx->log_metadata,
+		     st_mult(GRAPH_LOG_METADATA_WIDTH, ctx->commits.nr));
+
+	/* start both tables with an empty string, so that neither is empty */
+	strbuf_addch(&ctx->idents, '\0');
+	strbuf_addch(&ctx->subjects, '\0');
+
+	for (i = 0; i < ctx->commits.nr; i++) {
+		struct commit *c = ctx->commits.list[i];
+		unsigned char *rec = ctx->log_metadata +
+			st_mult(GRAPH_LOG_METADATA_WIDTH, i);
+		struct commit_graph_log_metadata meta;
+		uint32_t author, committer, subject;
+		const char *buf;
+
+		display_progress(ctx->progress, i + 1);
+
+		buf = repo_get_commit_buffer(ctx->r, c, NULL);
+		if (parse_log_metadata(buf, &meta)) {
+			put_be32(rec, GRAPH_LOG_METADATA_NONE);
+			repo_unuse_commit_buffer(ctx->r, c, buf);
+			continue;
+		}
+
+		author = add_log_string(&ctx->idents, &idents,
+					meta.author, meta.author_len);
+		committer = add_log_string(&ctx->idents, &idents,
+					   meta.committer, meta.committer_len);
+		subject = add_log_string(&ctx->subjects, NULL,
+					 meta.subject, meta.subject_len);
+		repo_unuse_commit_buffer(ctx->r, c, buf);
+
+		if (author == GRAPH_LOG_METADATA_NONE ||
+		    committer == GRAPH_LOG_METADATA_NONE ||
+		    subject == GRAPH_LOG_METADATA_NONE) {
+			put_be32(rec, GRAPH_LOG_METADATA_NONE);
+			continue;
+		}
+
+		put_be32(rec, author);
+		put_be32(rec + 4, committer);
+		put_be64(rec + 8, meta.author_date);
+		put_be64(rec + 16, meta.committer_date);
+		put_be32(rec + 24, (uint32_t)meta.author_tz);
+		put_be32(rec + 28, (uint32_t)meta.committer_tz);
+		put_be32(rec + 32, subject);
+	}
+
+	strintmap_clear(&idents);
+	stop_progress(&ctx->progress);
+}
+
+struct changed_path_list {
+	struct diff_options diffopt;
+	struct write_commit_graph_context *ctx;
+	struct strintmap *seen;
+	size_t nr, max;
+	unsigned too_many:1;
+};
+
+static int add_changed_path_to_list(struct diff_options *opt,
+				    struct combine_diff_path *p)
+{
+	struct changed_path_list *list = container_of(opt,
+						      struct changed_path_list,
+						      diffopt);
+	struct write_commit_graph_context *ctx = list->ctx;
+	struct strbuf *table = &ctx->changed_path_table;
+	int offset;
+
+	if (list->nr >= list->max) {
+		/* too many changes for a list; stop the walk */
+		list->too_many = 1;
+		opt->flags.has_changes = 1;
+		return 0;
+	}
+
+	offset = strintmap_get(list->seen, p->path);
+	if (offset < 0) {
+		size_t len = strlen(p->path);
+
+		if (table->len + len >= INT_MAX) {
+			list->too_many = 1;
+			opt->flags.has_changes = 1;
+			return 0;
+		}
+		offset = table->len;
+		strbuf_add(table, p->path, len + 1);
+		strintmap_set(list->seen, p->path, offset);
+	}
+
+	ALLOC_GROW(ctx->changed_path_ids, ctx->changed_path_ids_nr + 1,
+		   ctx->changed_path_ids_alloc);
+	ctx->changed_path_ids[ctx->changed_path_ids_nr++] = offset;
+	list->nr++;
+	return 0;	/* we are done with p */
+}
+
+/*
+ * List the paths each commit changes relative to its first parent, the
+ * same way the changed-path Bloom filters are computed, except that only
+ * the changed files are recorded, and not their leading directories.
+ */
+static void compute_changed_path_lists(struct write_commit_graph_context *ctx)
+{
+	struct strintmap seen;
+	struct strbuf base = STRBUF_INIT;
+	int i;
+
+	if (ctx->report_progress)
+		ctx->progress = start_delayed_progress(
+					_("Computing changed-path lists"),
+					ctx->commits.nr);
+
+	strintmap_init_with_options(&seen, -1, NULL, 1);
+	ALLOC_ARRAY(ctx->changed_path_index, ctx->commits.nr);
+
+	/* start the table with an empty string, so that it is not empty */
+	strbuf_addch(&ctx->changed_path_table, '\0');
+
+	for (i = 0; i < ctx->commits.nr; i++) {
+		struct commit *c = ctx->commits.list[i];
+		struct changed_path_list list = {
+			.ctx = ctx,
+			.seen = &seen,
+			.max = ctx->bloom_settings->max_changed_paths,
+		};
+		struct combine_diff_path phead;
+		const struct object_id *parent_oid = NULL;
+		size_t start = ctx->changed_path_ids_nr;
+
+		display_progress(ctx->progress, i + 1);
+
+		repo_diff_setup(ctx->r, &list.diffopt);
+		list.diffopt.flags.recursive = 1;
+		list.diffopt.flags.quick = 1;
+		list.diffopt.detect_rename = 0;
+		list.diffopt.pathchange = add_changed_path_to_list;
+
+		repo_parse_commit(ctx->r, c);
+		if (c->parents)
+			parent_oid = &c->parents->item->object.oid;
+		phead.next = NULL;
+		diff_tree_paths(&phead, &c->object.oid, &parent_oid, 1, &base,
+				&list.diffopt);
+
+		if (list.too_many ||
+		    ctx->changed_path_ids_nr >= GRAPH_CHANGED_PATHS_NONE) {
+			ctx->changed_path_ids_nr = start;
+			ctx->changed_path_index[i] = start | GRAPH_CHANGED_PATHS_NONE;
+		} else {
+			ctx->changed_path_index[i] = ctx->changed_path_ids_nr;
+		}
+		strbuf_reset(&base);
+	}
+
+	strbuf_release(&base);
+	strintmap_clear(&seen);
+	stop_progress(&ctx->progress);
+}
+
+static int reachability_root_cmp(const void *va, const void *vb, void *data)
+{
+	struct commit **list = data;
+	uint32_t a = *(const uint32_t *)va;
+	uint32_t b = *(const uint32_t *)vb;
+
+	/* newest first, so that the tips people ask about come first */
+	if (list[a]->date != list[b]->date)
+		return list[a]->date < list[b]->date ? 1 : -1;
+	return a < b ? -1 : a > b;
+}
+
+/*
+ * Label every commit with its pre-order and post-order number in a
+ * depth-first traversal that starts from the commits nothing else in the
+ * graph points to, and with the lowest post-order number of any commit
+ * reachable from it (itself included).
+ *
+ * When "to" is reachable from "from", the traversal is done with "to"
+ * before it is done with "from", and everything reachable from "to" is
+ * reachable from "from". So post(to) > post(from) or low(to) < low(from)
+ * proves that "to" is not reachable. Conversely, a pre/post interval of
+ * "to" nested in the one of "from" means the traversal got to "to" through
+ * "from", proving that it is reachable.
+ */
+static void compute_reachability_index(struct write_commit_graph_context *ctx)
+{
+	struct commit **list = ctx->commits.list;
+	uint32_t nr = ctx->commits.nr;
+	uint32_t *first_edge, *edges, *roots, *labels;
+	uint32_t i, nr_edges = 0, nr_roots = 0, pre = 0, post = 0;
+	char *has_child;
+	struct reachability_frame {
+		uint32_t pos, next_edge;
+	} *stack;
+	uint32_t stack_nr = 0;
+
+	if (ctx->report_progress)
+		ctx->progress = start_delayed_progress(
+					_("Computing commit graph reachability index"),
+					nr);
+
+	ALLOC_ARRAY(first_edge, st_add(nr, 1));
+	for (i = 0; i < nr; i++) {
+		first_edge[i] = nr_edges;
+		nr_edges += commit_list_count(list[i]->parents);
+	}
+	first_edge[nr] = nr_edges;
+
+	ALLOC_ARRAY(edges, nr_edges);
+	CALLOC_ARRAY(has_child, nr);
+	for (i = 0; i < nr; i++) {
+		struct commit_list *parent;
+		uint32_t e = first_edge[i];
+
+		for (parent = list[i]->parents; parent; parent = parent->next) {
+			int pos = oid_pos(&parent->item->object.oid, list, nr,
+					  commit_to_oid);
+			if (pos < 0)
+				BUG("missing parent %s for commit %s",
+				    oid_to_hex(&parent->item->object.oid),
+				    oid_to_hex(&list[i]->object.oid));
+			edges[e++] = pos;
+			has_child[pos] = 1;
+		}
+	}
+
+	ALLOC_ARRAY(roots, nr);
+	for (i = 0; i < nr; i++)
+		if (!has_child[i])
+			roots[nr_roots++] = i;
+	QSORT_S(roots, nr_roots, reachability_root_cmp, list);
+
+	CALLOC_ARRAY(labels, st_mult(3, nr));
+	ALLOC_ARRAY(stack, nr);
+	for (i = 0; i < nr_roots; i++) {
+		labels[3 * roots[i]] = ++pre;
+		stack[stack_nr].pos = roots[i];
+		stack[stack_nr++].next_edge = first_edge[roots[i]];
+
+		while (stack_nr) {
+			struct reachability_frame *top = &stack[stack_nr - 1];
+			uint32_t pos = top->pos, low, e;
+
+			if (top->next_edge < first_edge[pos + 1]) {
+				uint32_t parent = edges[top->next_edge++];
+
+				if (!labels[3 * parent]) {
+					labels[3 * parent] = ++pre;
+					stack[stack_nr].pos = parent;
+					stack[stack_nr++].next_edge = first_edge[parent];
+				}
+				continue;
+			}
+
+			stack_nr--;
+			low = labels[3 * pos + 1] = ++post;
+			for (e = first_edge[pos]; e < first_edge[pos + 1]; e++)
+				if (labels[3 * edges[e] + 2] < low)
+					low = labels[3 * edges[e] + 2];
+			labels[3 * pos + 2] = low;
+			display_progress(ctx->progress, post);
+		}
+	}
+
+	if (post != nr)
+		BUG("reachability index labels %"PRIu32" out of %"PRIu32" commits",
+		    post, nr);
+
+	ctx->reachability_index = labels;
+	stop_progress(&ctx->progress);
+
+	free(first_edge);
+	free(edges);
+	free(has_child);
+	free(roots);
+	free(stack);
+}
+
 static void set_generation_in_graph_data(struct commit *c, timestamp_t t,
 					 void *data UNUSED)
 {
@@ -1756,12 +2558,60 @@ static void trace2_bloom_filter_write_statistics(struct write_commit_graph_conte
 			   ctx->count_bloom_filter_trunc_large);
 }
 
+/*
+ * Filters are computed by several threads, each of which takes every
+ * "nr_threads"-th commit of those needing a filter. Which commits get a new
+ * filter is decided up front, so that the result does not depend on the
+ * number of threads.
+ */
+struct bloom_filter_thread {
+	struct write_commit_graph_context *ctx;
+	struct commit **commits;
+	enum bloom_filter_computed *computed;
+	size_t *todo, nr_todo;
+	int nr_threads;
+	int offset;
+	pthread_t thread;
+
+	/* for showing progress from the main thread */
+	pthread_mutex_t *mutex;
+	size_t *done;
+	struct progress *progress;
+	size_t progress_base;
+};
+
+static void *compute_bloom_filters_thread(void *data)
+{
+	struct bloom_filter_thread *t = data;
+	size_t i;
+
+	for (i = t->offset; i < t->nr_todo; i += t->nr_threads) {
+		size_t pos = t->todo[i];
+
+		get_or_compute_bloom_filter(t->ctx->r, t->commits[pos], 1,
+					    t->ctx->bloom_settings,
+					    &t->computed[pos]);
+
+		pthread_mutex_lock(t->mutex);
+		(*t->done)++;
+		if (!t->offset)
+			display_progress(t->progress,
+					 t->progress_base + *t->done);
+		pthread_mutex_unlock(t->mutex);
+	}
+	return NULL;
+}
+
 static void compute_bloom_filters(struct write_commit_graph_context *ctx)
 {
-	int i;
+	int i, nr_threads;
 	struct progress *progress = NULL;
 	struct commit **sorted_commits;
+	enum bloom_filter_computed *computed;
+	size_t *todo, nr_todo = 0, done = 0;
 	int max_new_filters;
+	struct bloom_filter_thread *threads;
+	pthread_mutex_t mutex;
 
 	init_bloom_filters();
 
@@ -1780,31 +2630,90 @@ static void compute_bloom_filters(struct write_commit_graph_context *ctx)
 	max_new_filters = ctx->opts && ctx->opts->max_new_filters >= 0 ?
 		ctx->opts->max_new_filters : ctx->commits.nr;
 
+	/*
+	 * Load the filters we already have, and pick the commits to compute
+	 * filters for: the first "max_new_filters" that have none.
+	 */
+	CALLOC_ARRAY(computed, ctx->commits.nr);
+	ALLOC_ARRAY(todo, ctx->commits.nr);
 	for (i = 0; i < ctx->commits.nr; i++) {
-		enum bloom_filter_computed computed = 0;
 		struct commit *c = sorted_commits[i];
-		struct bloom_filter *filter = get_or_compute_bloom_filter(
-			ctx->r,
-			c,
-			ctx->count_bloom_filter_computed < max_new_filters,
-			ctx->bloom_settings,
-			&computed);
-		if (computed & BLOOM_COMPUTED) {
+
+		if (get_or_compute_bloom_filter(ctx->r, c, 0,
+						ctx->bloom_settings,
+						&computed[i]))
+			continue;
+		if (nr_todo >= max_new_filters)
+			continue;
+		repo_parse_commit(ctx->r, c);
+		todo[nr_todo++] = i;
+	}
+	display_progress(progress, ctx->commits.nr - nr_todo);
+
+	nr_threads = ctx->opts && ctx->opts->threads > 0 ?
+		ctx->opts->threads : online_cpus();
+	if (nr_threads > nr_todo)
+		nr_threads = nr_todo;
+	if (!HAVE_THREADS || nr_threads < 1)
+		nr_threads = 1;
+	trace2_data_intmax("commit-graph", ctx->r, "filter-threads", nr_threads);
+
+	CALLOC_ARRAY(threads, nr_threads);
+	pthread_mutex_init(&mutex, NULL);
+	for (i = 0; i < nr_threads; i++) {
+		threads[i].ctx = ctx;
+		threads[i].commits = sorted_commits;
+		threads[i].computed = computed;
+		threads[i].todo = todo;
+		threads[i].nr_todo = nr_todo;
+		threads[i].nr_threads = nr_threads;
+		threads[i].offset = i;
+		threads[i].mutex = &mutex;
+		threads[i].done = &done;
+		threads[i].progress = progress;
+		threads[i].progress_base = ctx->commits.nr - nr_todo;
+	}
+
+	if (nr_threads > 1)
+		enable_obj_read_lock();
+	for (i = 1; i < nr_threads; i++) {
+		int err = pthread_create(&threads[i].thread, NULL,
+					 compute_bloom_filters_thread,
+					 &threads[i]);
+		if (err)
+			die(_("unable to create thread: %s"), strerror(err));
+	}
+	/* The main thread does its share, and shows the progress. */
+	compute_bloom_filters_thread(&threads[0]);
+	for (i = 1; i < nr_threads; i++)
+		pthread_join(threads[i].thread, NULL);
+	if (nr_threads > 1)
+		disable_obj_read_lock();
+	pthread_mutex_destroy(&mutex);
+
+	for (i = 0; i < ctx->commits.nr; i++) {
+		struct bloom_filter *filter;
+
+		if (computed[i] & BLOOM_COMPUTED) {
 			ctx->count_bloom_filter_computed++;
-			if (computed & BLOOM_TRUNC_EMPTY)
+			if (computed[i] & BLOOM_TRUNC_EMPTY)
 				ctx->count_bloom_filter_trunc_empty++;
-			if (computed & BLOOM_TRUNC_LARGE)
+			if (computed[i] & BLOOM_TRUNC_LARGE)
 				ctx->count_bloom_filter_trunc_large++;
-		} else if (computed & BLOOM_NOT_COMPUTED)
+		} else if (computed[i] & BLOOM_NOT_COMPUTED)
 			ctx->count_bloom_filter_not_computed++;
+
+		filter = get_bloom_filter(ctx->r, sorted_commits[i]);
 		ctx->total_bloom_filter_data_size += filter
 			? sizeof(unsigned char) * filter->len : 0;
-		display_progress(progress, i + 1);
 	}
 
 	if (trace2_is_enabled())
 		trace2_bloom_filter_write_statistics(ctx);
 
+	free(threads);
+	free(todo);
+	free(computed);
 	free(sorted_commits);
 	stop_progress(&progress);
 }
@@ -2084,6 +2993,30 @@ static int write_commit_graph_file(struct write_commit_graph_context *ctx)
 				 ctx->total_bloom_filter_data_size),
 			  write_graph_chunk_bloom_data);
 	}
+	if (ctx->write_reachability_index)
+		add_chunk(cf, GRAPH_CHUNKID_REACHABILITY,
+			  st_mult(3 * sizeof(uint32_t), ctx->commits.nr),
+			  write_graph_chunk_reachability_index);
+	if (ctx->write_log_metadata) {
+		add_chunk(cf, GRAPH_CHUNKID_LOG_METADATA,
+			  st_mult(GRAPH_LOG_METADATA_WIDTH, ctx->commits.nr),
+			  write_graph_chunk_log_metadata);
+		add_chunk(cf, GRAPH_CHUNKID_IDENTS, ctx->idents.len,
+			  write_graph_chunk_idents);
+		add_chunk(cf, GRAPH_CHUNKID_SUBJECTS, ctx->subjects.len,
+			  write_graph_chunk_subjects);
+	}
+	if (ctx->write_changed_path_lists) {
+		add_chunk(cf, GRAPH_CHUNKID_CHANGED_PATH_INDEX,
+			  st_mult(sizeof(uint32_t), ctx->commits.nr),
+			  write_graph_chunk_changed_path_index);
+		add_chunk(cf, GRAPH_CHUNKID_CHANGED_PATH_LISTS,
+			  st_mult(sizeof(uint32_t), ctx->changed_path_ids_nr),
+			  write_graph_chunk_changed_path_lists);
+		add_chunk(cf, GRAPH_CHUNKID_CHANGED_PATH_TABLE,
+			  ctx->changed_path_table.len,
+			  write_graph_chunk_changed_path_table);
+	}
 	if (ctx->num_commit_graphs_after > 1)
 		add_chunk(cf, GRAPH_CHUNKID_BASE,
 			  st_mult(hashsz, ctx->num_commit_graphs_after - 1),
@@ -2468,6 +3401,9 @@ int write_commit_graph(struct object_directory *odb,
 	uint32_t i;
 	int res = 0;
 	int replace = 0;
+	int write_reachability_index = 0;
+	int write_log_metadata = 0;
+	int write_changed_path_lists = 0;
 	struct bloom_filter_settings bloom_settings = DEFAULT_BLOOM_FILTER_SETTINGS;
 	struct topo_level_slab topo_levels;
 
@@ -2489,6 +3425,9 @@ int write_commit_graph(struct object_directory *odb,
 	ctx->total_bloom_filter_data_size = 0;
 	ctx->write_generation_data = (get_configured_generation_version(r) == 2);
 	ctx->num_generation_data_overflows = 0;
+	strbuf_init(&ctx->idents, 0);
+	strbuf_init(&ctx->subjects, 0);
+	strbuf_init(&ctx->changed_path_table, 0);
 
 	bloom_settings.bits_per_entry = git_env_ulong("GIT_TEST_BLOOM_SETTINGS_BITS_PER_ENTRY",
 						      bloom_settings.bits_per_entry);
@@ -2596,6 +3535,23 @@ int write_commit_graph(struct object_directory *odb,
 	} else
 		ctx->num_commit_graphs_after = 1;
 
+	/*
+	 * The reachability index labels the whole history, so it can only
+	 * be written for a graph that does not sit on top of another one.
+	 */
+	repo_config_get_bool(ctx->r, "commitgraph.writereachabilityindex",
+			     &write_reachability_index);
+	ctx->write_reachability_index = write_reachability_index &&
+					!ctx->new_base_graph;
+
+	repo_config_get_bool(ctx->r, "commitgraph.writelogmetadata",
+			     &write_log_metadata);
+	ctx->write_log_metadata = write_log_metadata;
+
+	repo_config_get_bool(ctx->r, "commitgraph.writechangedpathlists",
+			     &write_changed_path_lists);
+	ctx->write_changed_path_lists = write_changed_path_lists;
+
 	ctx->trust_generation_numbers = validate_mixed_generation_chain(ctx->r->objects->commit_graph);
 
 	compute_topological_levels(ctx);
@@ -2605,6 +3561,15 @@ int write_commit_graph(struct object_directory *odb,
 	if (ctx->changed_paths)
 		compute_bloom_filters(ctx);
 
+	if (ctx->write_reachability_index)
+		compute_reachability_index(ctx);
+
+	if (ctx->write_log_metadata)
+		compute_log_metadata(ctx);
+
+	if (ctx->write_changed_path_lists)
+		compute_changed_path_lists(ctx);
+
 	res = write_commit_graph_file(ctx);
 
 	if (ctx->split)
@@ -2616,6 +3581,13 @@ int write_commit_graph(struct object_directory *odb,
 	free(ctx->graph_name);
 	free(ctx->base_graph_name);
 	free(ctx->commits.list);
+	free(ctx->reachability_index);
+	free(ctx->log_metadata);
+	strbuf_release(&ctx->idents);
+	strbuf_release(&ctx->subjects);
+	free(ctx->changed_path_index);
+	free(ctx->changed_path_ids);
+	strbuf_release(&ctx->changed_path_table);
 	oid_array_clear(&ctx->oids);
 	clear_topo_level_slab(&topo_levels);
 
@@ -2655,6 +3627,119 @@ static int commit_graph_checksum_valid(struct commit_graph *g)
 	return hashfile_checksum_valid(g->data, g->data_len);
 }
 
+static void verify_reachability_labels(struct commit_graph *g, uint32_t pos,
+				       const struct object_id *oid,
+				       struct commit *parent)
+{
+	uint32_t parent_pos = commit_graph_position(parent);
+	const unsigned char *labels, *parent_labels;
+
+	if (parent_pos >= g->num_commits) {
+		graph_report(_("commit-graph reachability index misses parent %s of commit %s"),
+			     oid_to_hex(&parent->object.oid), oid_to_hex(oid));
+		return;
+	}
+
+	labels = g->chunk_reachability_index + st_mult(12, pos);
+	parent_labels = g->chunk_reachability_index + st_mult(12, parent_pos);
+	if (get_be32(parent_labels + 4) >= get_be32(labels + 4) ||
+	    get_be32(parent_labels + 8) < get_be32(labels + 8))
+		graph_report(_("commit-graph reachability index for commit %s is inconsistent with its parent %s"),
+			     oid_to_hex(oid), oid_to_hex(&parent->object.oid));
+}
+
+static void verify_log_metadata(struct repository *r, struct commit_graph *g,
+				uint32_t pos, struct commit *odb_commit)
+{
+	struct commit_graph_log_metadata graph_meta, odb_meta;
+	const char *buf;
+	int ok;
+
+	if (get_be32(g->chunk_log_metadata +
+		     st_mult(GRAPH_LOG_METADATA_WIDTH, pos)) == GRAPH_LOG_METADATA_NONE)
+		return;
+
+	buf = repo_get_commit_buffer(r, odb_commit, NULL);
+	ok = log_metadata_at(g, pos, &graph_meta) &&
+	     !parse_log_metadata(buf, &odb_meta) &&
+	     graph_meta.author_len == odb_meta.author_len &&
+	     !memcmp(graph_meta.author, odb_meta.author, odb_meta.author_len) &&
+	     graph_meta.committer_len == odb_meta.committer_len &&
+	     !memcmp(graph_meta.committer, odb_meta.committer, odb_meta.committer_len) &&
+	     graph_meta.author_date == odb_meta.author_date &&
+	     graph_meta.committer_date == odb_meta.committer_date &&
+	     graph_meta.author_tz == odb_meta.author_tz &&
+	     graph_meta.committer_tz == odb_meta.committer_tz &&
+	     graph_meta.subject_len == odb_meta.subject_len &&
+	     !memcmp(graph_meta.subject, odb_meta.subject, odb_meta.subject_len);
+	repo_unuse_commit_buffer(r, odb_commit, buf);
+
+	if (!ok)
+		graph_report(_("commit-graph log metadata for commit %s does not match the object database"),
+			     oid_to_hex(&odb_commit->object.oid));
+}
+
+struct changed_path_list_check {
+	struct diff_options diffopt;
+	const struct commit_graph_changed_paths *list;
+	uint32_t nr;
+	unsigned mismatch:1;
+};
+
+static int check_changed_path_in_list(struct diff_options *opt,
+				      struct combine_diff_path *p)
+{
+	struct changed_path_list_check *check =
+		container_of(opt, struct changed_path_list_check, diffopt);
+	const char *path = NULL;
+
+	if (check->nr < check->list->nr)
+		path = commit_graph_changed_path(check->list, check->nr++);
+	if (!path || strcmp(path, p->path)) {
+		check->mismatch = 1;
+		opt->flags.has_changes = 1;
+	}
+	return 0;
+}
+
+static void verify_changed_path_list(struct repository *r,
+				     struct commit_graph *g, uint32_t pos,
+				     struct commit *odb_commit)
+{
+	struct commit_graph_changed_paths list;
+	struct changed_path_list_check check = { .list = &list };
+	struct combine_diff_path phead;
+	const struct object_id *parent_oid = NULL;
+	struct strbuf base = STRBUF_INIT;
+
+	if (get_be32(g->chunk_changed_path_index +
+		     st_mult(sizeof(uint32_t), pos)) & GRAPH_CHANGED_PATHS_NONE)
+		return;
+
+	if (!changed_paths_at(g, pos, &list)) {
+		graph_report(_("commit-graph changed-path list for commit %s is out of bounds"),
+			     oid_to_hex(&odb_commit->object.oid));
+		return;
+	}
+
+	repo_diff_setup(r, &check.diffopt);
+	check.diffopt.flags.recursive = 1;
+	check.diffopt.flags.quick = 1;
+	check.diffopt.detect_rename = 0;
+	check.diffopt.pathchange = check_changed_path_in_list;
+
+	if (odb_commit->parents)
+		parent_oid = &odb_commit->parents->item->object.oid;
+	phead.next = NULL;
+	diff_tree_paths(&phead, &odb_commit->object.oid, &parent_oid, 1,
+			&base, &check.diffopt);
+	strbuf_release(&base);
+
+	if (check.mismatch || check.nr != list.nr)
+		graph_report(_("commit-graph changed-path list for commit %s does not match its trees"),
+			     oid_to_hex(&odb_commit->object.oid));
+}
+
 static int verify_one_commit_graph(struct repository *r,
 				   struct commit_graph *g,
 				   struct progress *progress,
@@ -2757,6 +3842,10 @@ static int verify_one_commit_graph(struct repository *r,
 			if (generation > max_generation)
 				max_generation = generation;
 
+			if (g->chunk_reachability_index && !g->base_graph)
+				verify_reachability_labels(g, i, &cur_oid,
+							   graph_parents->item);
+
 			graph_parents = graph_parents->next;
 			odb_parents = odb_parents->next;
 		}
@@ -2765,6 +3854,12 @@ static int verify_one_commit_graph(struct repository *r,
 			graph_report(_("commit-graph parent list for commit %s terminates early"),
 				     oid_to_hex(&cur_oid));
 
+		if (g->chunk_log_metadata)
+			verify_log_metadata(r, g, i, odb_commit);
+
+		if (g->chunk_changed_path_index)
+			verify_changed_path_list(r, g, i, odb_commit);
+
 		if (commit_graph_generation_from_graph(graph_commit))
 			seen_gen_non_zero = graph_commit;
 		else
@@ -25,6 +25,7 @@ void git_test_write_commit_graph_or_die(void);
 
 struct commit;
 struct bloom_filter_settings;
+struct pathspec;
 struct repository;
 struct raw_object_store;
 struct string_list;
@@ -108,6 +109,17 @@ struct commit_graph {
 	const unsigned char *chunk_bloom_indexes;
 	const unsigned char *chunk_bloom_data;
 	size_t chunk_bloom_data_size;
+	const unsigned char *chunk_reachability_index;
+	const unsigned char *chunk_log_metadata;
+	const unsigned char *chunk_idents;
+	size_t chunk_idents_size;
+	const unsigned char *chunk_subjects;
+	size_t chunk_subjects_size;
+	const unsigned char *chunk_changed_path_index;
+	const unsigned char *chunk_changed_path_lists;
+	size_t chunk_changed_path_lists_size;
+	const unsigned char *chunk_changed_path_table;
+	size_t chunk_changed_path_table_size;
 
 	struct topo_level_slab *topo_levels;
 	struct bloom_filter_settings *bloom_filter_settings;
@@ -129,6 +141,12 @@ struct commit_graph *read_commit_graph_one(struct repository *r,
 struct commit_graph *parse_commit_graph(struct repo_settings *s,
 					void *graph_map, size_t graph_size);
 
+/*
+ * Load the commit-graph of the repository, unless that has been tried
+ * already. Return 1 if there is one.
+ */
+int prepare_commit_graph(struct repository *r);
+
 /*
  * Return 1 if and only if the repository has a commit-graph
  * file and generation numbers are computed in that file.
@@ -163,6 +181,12 @@ struct commit_graph_opts {
 	timestamp_t expire_time;
 	enum commit_graph_split_flags split_flags;
 	int max_new_filters;
+
+	/*
+	 * Number of threads computing changed-path Bloom filters; 0 means
+	 * one per CPU.
+	 */
+	int threads;
 };
 
 /*
@@ -204,6 +228,78 @@ struct commit_graph_data {
 timestamp_t commit_graph_generation(const struct commit *);
 uint32_t commit_graph_position(const struct commit *);
 
+/*
+ * Consult the reachability index of the commit-graph to tell whether
+ * "to" can be reached from "from". Returns 1 if it can, 0 if it cannot,
+ * and -1 if the index cannot tell, or if there is no index covering
+ * both commits. Both commits must have been parsed.
+ */
+int commit_graph_can_reach(struct repository *r,
+			   struct commit *from, struct commit *to);
+
+/*
+ * What "git log --format" most often shows of a commit, as stored in the
+ * log metadata of the commit-graph. "author" and "committer" point to
+ * the "Name <email>" part of the ident lines, and "subject" to the
+ * subject paragraph of the message, possibly followed by the blank line
+ * that ends it. All of them are NUL-terminated.
+ */
+struct commit_graph_log_metadata {
+	const char *author, *committer;
+	size_t author_len, committer_len;
+	timestamp_t author_date, committer_date;
+	int author_tz, committer_tz;
+	const char *subject;
+	size_t subject_len;
+};
+
+/*
+ * Fill "meta" from the log metadata of the commit-graph, and return 1, if
+ * it has them for the (parsed) commit "c". Return 0 otherwise, in which
+ * case the caller has to look at the commit object itself.
+ */
+int commit_graph_log_metadata(struct repository *r, const struct commit *c,
+			      struct commit_graph_log_metadata *meta);
+
+/*
+ * The paths a commit changes relative to its first parent (or, for a root
+ * commit, adds), as listed in the changed-path lists of the commit-graph.
+ * Only files, symbolic links and submodules are listed, not the
+ * directories leading to them.
+ */
+struct commit_graph_changed_paths {
+	const unsigned char *ids;
+	uint32_t nr;
+	const char *table;
+	size_t table_size;
+};
+
+/*
+ * Fill "list" from the changed-path lists of the commit-graph, and return
+ * 1, if there is one for the (parsed) commit "c". Return 0 otherwise, e.g.
+ * when "c" changes too many paths for its list to be worth storing.
+ */
+int commit_graph_changed_paths(struct repository *r, const struct commit *c,
+			       struct commit_graph_changed_paths *list);
+
+/*
+ * Return the "i"-th path of "list", or NULL if the commit-graph is
+ * corrupt.
+ */
+const char *commit_graph_changed_path(const struct commit_graph_changed_paths *list,
+				      uint32_t i);
+
+/*
+ * Use the changed-path lists of the commit-graph to tell whether the
+ * (parsed) commit "c" changes anything matched by "pathspec" relative to
+ * its first parent, without diffing any trees. Returns 1 if it does, 0 if
+ * it does not, and -1 if the lists cannot tell, in which case the trees
+ * have to be compared after all. Only pathspecs made of literal paths can
+ * be answered.
+ */
+int commit_graph_changes_pathspec(struct repository *r, const struct commit *c,
+				  const struct pathspec *pathspec);
+
 /*
  * After this method, all commits reachable from those in the given
  * list will have non-zero, non-infinite generation numbers.
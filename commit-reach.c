@@ -470,6 +470,28 @@ int repo_is_descendant_of(struct repository *r,
 	}
 }
 
+/*
+ * Ask the reachability index of the commit-graph whether "commit" can be
+ * reached from one of the "references". Returns 1 or 0 if it knows, and
+ * -1 if it cannot tell for all of them.
+ */
+static int in_merge_bases_by_index(struct repository *r, struct commit *commit,
+				   int nr_reference, struct commit **reference)
+{
+	int i, ret = 0;
+
+	for (i = 0; i < nr_reference; i++) {
+		switch (commit_graph_can_reach(r, reference[i], commit)) {
+		case 1:
+			return 1;
+		case -1:
+			ret = -1;
+			break;
+		}
+	}
+	return ret;
+}
+
 /*
  * Is "commit" an ancestor of one of the "references"?
  */
@@ -495,6 +517,11 @@ int repo_in_merge_bases_many(struct repository *r, struct commit *commit,
 	if (generation > max_generation)
 		return ret;
 
+	ret = in_merge_bases_by_index(r, commit, nr_reference, reference);
+	if (ret >= 0)
+		return ret;
+	ret = 0;
+
 	bases = paint_down_to_common(r, commit,
 				     nr_reference, reference,
 				     generation);
@@ -630,6 +657,7 @@ static enum contains_result contains_test(struct commit *candidate,
 					  timestamp_t cutoff)
 {
 	enum contains_result *cached = contains_cache_at(cache, candidate);
+	enum contains_result result = CONTAINS_NO;
 
 	/* If we already have the answer cached, return that. */
 	if (*cached)
@@ -647,7 +675,20 @@ static enum contains_result contains_test(struct commit *candidate,
 	if (commit_graph_generation(candidate) < cutoff)
 		return CONTAINS_NO;
 
-	return CONTAINS_UNKNOWN;
+	for (; want; want = want->next) {
+		switch (commit_graph_can_reach(the_repository, candidate, want->item)) {
+		case 1:
+			*cached = CONTAINS_YES;
+			return CONTAINS_YES;
+		case -1:
+			result = CONTAINS_UNKNOWN;
+			break;
+		}
+	}
+	if (result == CONTAINS_NO)
+		*cached = CONTAINS_NO;
+
+	return result;
 }
 
 static void push_to_contains_stack(struct commit *candidate, struct contains_stack *contains_stack)
@@ -820,6 +861,36 @@ int can_all_from_reach_with_flag(struct object_array *from,
 	return result;
 }
 
+/*
+ * Ask the reachability index of the commit-graph whether each of "from"
+ * can reach one of "to". Returns 1 or 0 if it knows, and -1 if it cannot
+ * tell.
+ */
+static int can_all_from_reach_by_index(struct commit_list *from,
+				       struct commit_list *to)
+{
+	int unknown = 0;
+
+	for (; from; from = from->next) {
+		struct commit_list *to_iter;
+		int found = 0;
+
+		for (to_iter = to; to_iter && found != 1; to_iter = to_iter->next) {
+			int ret = commit_graph_can_reach(the_repository,
+							 from->item,
+							 to_iter->item);
+			if (ret)
+				found = ret;
+		}
+
+		if (!found)
+			return 0;
+		if (found < 0)
+			unknown = 1;
+	}
+	return unknown ? -1 : 1;
+}
+
 int can_all_from_reach(struct commit_list *from, struct commit_list *to,
 		       int cutoff_by_min_date)
 {
@@ -861,8 +932,11 @@ int can_all_from_reach(struct commit_list *from, struct commit_list *to,
 		to_iter = to_iter->next;
 	}
 
-	result = can_all_from_reach_with_flag(&from_objs, PARENT2, PARENT1,
-					      min_commit_date, min_generation);
+	result = can_all_from_reach_by_index(from, to);
+	if (result < 0)
+		result = can_all_from_reach_with_flag(&from_objs, PARENT2, PARENT1,
+						      min_commit_date,
+						      min_generation);
 
 	while (from) {
 		clear_commit_marks(from->item, PARENT1);
@@ -76,7 +76,7 @@ struct commit *lookup_commit(struct repository *r, const struct object_id *oid)
 {
 	struct object *obj = lookup_object(r, oid);
 	if (!obj)
-		return create_object(r, oid, alloc_commit_node(r));
+		obj = create_object(r, oid, alloc_commit_node(r));
 	return object_as_type(obj, OBJ_COMMIT, 0);
 }
 
@@ -346,18 +346,35 @@ void free_commit_buffer_slab(struct buffer_slab *bs)
 	free(bs);
 }
 
+/*
+ * The slab may be reallocated by another thread looking at a different
+ * commit, but the entry of a commit stays where it is.
+ */
+static struct commit_buffer *peek_commit_buffer(struct parsed_object_pool *pool,
+						const struct commit *commit)
+{
+	struct commit_buffer *v;
+
+	object_state_lock();
+	v = buffer_slab_peek(pool->buffer_slab, commit);
+	object_state_unlock();
+	return v;
+}
+
 void set_commit_buffer(struct repository *r, struct commit *commit, void *buffer, unsigned long size)
 {
-	struct commit_buffer *v = buffer_slab_at(
-		r->parsed_objects->buffer_slab, commit);
+	struct commit_buffer *v;
+
+	object_state_lock();
+	v = buffer_slab_at(r->parsed_objects->buffer_slab, commit);
+	object_state_unlock();
 	v->buffer = buffer;
 	v->size = size;
 }
 
 const void *get_cached_commit_buffer(struct repository *r, const struct commit *commit, unsigned long *sizep)
 {
-	struct commit_buffer *v = buffer_slab_peek(
-		r->parsed_objects->buffer_slab, commit);
+	struct commit_buffer *v = peek_commit_buffer(r->parsed_objects, commit);
 	if (!v) {
 		if (sizep)
 			*sizep = 0;
@@ -393,16 +410,14 @@ void repo_unuse_commit_buffer(struct repository *r,
 			      const struct commit *commit,
 			      const void *buffer)
 {
-	struct commit_buffer *v = buffer_slab_peek(
-		r->parsed_objects->buffer_slab, commit);
+	struct commit_buffer *v = peek_commit_buffer(r->parsed_objects, commit);
 	if (!(v && v->buffer == buffer))
 		free((void *)buffer);
 }
 
 void free_commit_buffer(struct parsed_object_pool *pool, struct commit *commit)
 {
-	struct commit_buffer *v = buffer_slab_peek(
-		pool->buffer_slab, commit);
+	struct commit_buffer *v = peek_commit_buffer(pool, commit);
 	if (v) {
 		FREE_AND_NULL(v->buffer);
 		v->size = 0;
@@ -444,8 +459,8 @@ void release_commit_memory(struct parsed_object_pool *pool, struct commit *c)
 
 const void *detach_commit_buffer(struct commit *commit, unsigned long *sizep)
 {
-	struct commit_buffer *v = buffer_slab_peek(
-		the_repository->parsed_objects->buffer_slab, commit);
+	struct commit_buffer *v = peek_commit_buffer(the_repository->parsed_objects,
+						     commit);
 	void *ret;
 
 	if (!v) {
@@ -462,7 +477,7 @@ const void *detach_commit_buffer(struct commit *commit, unsigned long *sizep)
 	return ret;
 }
 
-int parse_commit_buffer(struct repository *r, struct commit *item, const void *buffer, unsigned long size, int check_graph)
+static int parse_commit_buffer_1(struct repository *r, struct commit *item, const void *buffer, unsigned long size, int check_graph)
 {
 	const char *tail = buffer;
 	const char *bufptr = buffer;
@@ -542,14 +557,24 @@ int parse_commit_buffer(struct repository *r, struct commit *item, const void *b
 	if (check_graph)
 		load_commit_graph_info(r, item);
 
-	item->object.parsed = 1;
+	set_object_parsed(&item->object, 1);
 	return 0;
 }
 
-int repo_parse_commit_internal(struct repository *r,
-			       struct commit *item,
-			       int quiet_on_missing,
-			       int use_commit_graph)
+int parse_commit_buffer(struct repository *r, struct commit *item, const void *buffer, unsigned long size, int check_graph)
+{
+	int ret;
+
+	object_parse_lock(&item->object.oid);
+	ret = parse_commit_buffer_1(r, item, buffer, size, check_graph);
+	object_parse_unlock(&item->object.oid);
+	return ret;
+}
+
+static int repo_parse_commit_internal_1(struct repository *r,
+					struct commit *item,
+					int quiet_on_missing,
+					int use_commit_graph)
 {
 	enum object_type type;
 	void *buffer;
@@ -606,6 +631,22 @@ int repo_parse_commit_internal(struct repository *r,
 	return ret;
 }
 
+int repo_parse_commit_internal(struct repository *r,
+			       struct commit *item,
+			       int quiet_on_missing,
+			       int use_commit_graph)
+{
+	int ret;
+
+	if (!item)
+		return -1;
+	object_parse_lock(&item->object.oid);
+	ret = repo_parse_commit_internal_1(r, item, quiet_on_missing,
+					   use_commit_graph);
+	object_parse_unlock(&item->object.oid);
+	return ret;
+}
+
 int repo_parse_commit_gently(struct repository *r,
 			     struct commit *item, int quiet_on_missing)
 {
@@ -0,0 +1,572 @@
+#include "git-compat-util.h"
+#include "dir.h"
+#include "fsmonitor-ll.h"
+#include "fsm-listen.h"
+#include "fsmonitor--daemon.h"
+#include "fsmonitor-path-utils.h"
+#include "gettext.h"
+#include "hashmap.h"
+#include "simple-ipc.h"
+#include "string-list.h"
+#include "trace.h"
+#include <sys/inotify.h>
+
+/*
+ * inotify watches are not recursive, so we watch every directory in
+ * the working tree individually.  We do not descend into ".git"
+ * directories: for the top-level one we only watch ".git" itself (so
+ * that we notice when it goes away) and the directory holding our
+ * cookie files.  An external <gitdir> is handled the same way.
+ *
+ * When a directory is created or moved into the working tree, we add
+ * watches for it and everything below it and report the directory as
+ * a whole, since things may have been created in it before the new
+ * watches were in place.  When a directory is moved away, we drop the
+ * watches below it; they would otherwise keep reporting events under
+ * the old name.
+ */
+#define WATCH_MASK (IN_ATTRIB | IN_CREATE | IN_DELETE | IN_DELETE_SELF | \
+		    IN_MODIFY | IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO | \
+		    IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK)
+
+struct watch_entry {
+	struct hashmap_entry ent; /* must be first */
+	int wd;
+	char *path; /* absolute path of the watched directory */
+};
+
+struct fsm_listen_data
+{
+	int fd_inotify;
+	int fd_stop[2];
+
+	struct hashmap watches; /* watch descriptor -> watch_entry */
+	int wd_worktree;
+	int wd_gitdir;
+
+	enum shutdown_style {
+		SHUTDOWN_EVENT = 0,
+		FORCE_SHUTDOWN,
+		FORCE_ERROR_STOP,
+	} shutdown_style;
+};
+
+static int watch_entry_cmp(const void *cmp_data UNUSED,
+			   const struct hashmap_entry *eptr,
+			   const struct hashmap_entry *entry_or_key,
+			   const void *keydata UNUSED)
+{
+	const struct watch_entry *a, *b;
+
+	a = container_of(eptr, const struct watch_entry, ent);
+	b = container_of(entry_or_key, const struct watch_entry, ent);
+	return a->wd != b->wd;
+}
+
+static struct watch_entry *find_watch(struct fsm_listen_data *data, int wd)
+{
+	struct watch_entry key;
+
+	hashmap_entry_init(&key.ent, (unsigned int)wd);
+	key.wd = wd;
+	return hashmap_get_entry(&data->watches, &key, ent, NULL);
+}
+
+static void remove_watch(struct fsm_listen_data *data, struct watch_entry *w)
+{
+	hashmap_remove(&data->watches, &w->ent, NULL);
+	free(w->path);
+	free(w);
+}
+
+/*
+ * Returns the watch descriptor, 0 if the directory disappeared or
+ * cannot be watched (which is not an error), and -1 on errors.
+ */
+static int add_watch(struct fsm_listen_data *data, const char *path)
+{
+	struct watch_entry *w;
+	int wd;
+
+	wd = inotify_add_watch(data->fd_inotify, path, WATCH_MASK);
+	if (wd < 0) {
+		switch (errno) {
+		case ENOENT:
+		case ENOTDIR:
+		case EACCES:
+			trace_printf_key(&trace_fsmonitor,
+					 "inotify_add_watch('%s') skipped: %s",
+					 path, strerror(errno));
+			return 0;
+		case ENOSPC:
+			return error(_("inotify watch limit reached while "
+				       "watching '%s' (see "
+				       "/proc/sys/fs/inotify/max_user_watches)"),
+				     path);
+		default:
+			return error_errno(_("inotify_add_watch('%s') failed"),
+					   path);
+		}
+	}
+
+	/*
+	 * We get the same descriptor back when the directory is already
+	 * watched, e.g. after it has been renamed.
+	 */
+	w = find_watch(data, wd);
+	if (w) {
+		free(w->path);
+		w->path = xstrdup(path);
+		return wd;
+	}
+
+	CALLOC_ARRAY(w, 1);
+	hashmap_entry_init(&w->ent, (unsigned int)wd);
+	w->wd = wd;
+	w->path = xstrdup(path);
+	hashmap_add(&data->watches, &w->ent);
+	return wd;
+}
+
+/*
+ * Watch the directory "path" and everything below it.  If "report" is
+ * given, everything found below "path" is added to it, as we may have
+ * missed the events for things created before the watches were added.
+ */
+static int add_watches_recursive(struct fsmonitor_daemon_state *state,
+				 struct strbuf *path,
+				 struct fsmonitor_batch **report)
+{
+	struct fsm_listen_data *data = state->listen_data;
+	DIR *dir;
+	struct dirent *de;
+	size_t len = path->len;
+	int ret;
+
+	ret = add_watch(data, path->buf);
+	if (ret <= 0)
+		return ret;
+
+	dir = opendir(path->buf);
+	if (!dir)
+		return 0; /* removed in the meantime */
+
+	ret = 0;
+	strbuf_addch(path, '/');
+	while ((de = readdir_skip_dot_and_dotdot(dir)) != NULL) {
+		int is_dir;
+
+		if (!strcmp(de->d_name, ".git"))
+			continue;
+		is_dir = get_dtype(de, path, 0) == DT_DIR;
+
+		strbuf_addstr(path, de->d_name);
+		if (report) {
+			if (is_dir)
+				strbuf_addch(path, '/');
+			if (!*report)
+				*report = fsmonitor_batch__new();
+			fsmonitor_batch__add_path(*report, path->buf +
+				state->path_worktree_watch.len + 1);
+			if (is_dir)
+				strbuf_setlen(path, path->len - 1);
+		}
+		if (is_dir && add_watches_recursive(state, path, report) < 0) {
+			ret = -1;
+			break;
+		}
+		strbuf_setlen(path, len + 1);
+	}
+	strbuf_setlen(path, len);
+	closedir(dir);
+	return ret;
+}
+
+/*
+ * Stop watching "path" and everything below it.
+ */
+static void remove_watches_recursive(struct fsm_listen_data *data,
+				     const char *path)
+{
+	struct hashmap_iter iter;
+	struct watch_entry *w;
+	struct watch_entry **to_remove = NULL;
+	size_t nr = 0, alloc = 0, i;
+	size_t len = strlen(path);
+
+	hashmap_for_each_entry(&data->watches, &iter, w, ent) {
+		if (strncmp(w->path, path, len) ||
+		    (w->path[len] && w->path[len] != '/'))
+			continue;
+		ALLOC_GROW(to_remove, nr + 1, alloc);
+		to_remove[nr++] = w;
+	}
+
+	for (i = 0; i < nr; i++) {
+		inotify_rm_watch(data->fd_inotify, to_remove[i]->wd);
+		remove_watch(data, to_remove[i]);
+	}
+	free(to_remove);
+}
+
+/*
+ * (Re)create watches for everything we are interested in.  Watching a
+ * directory that is already watched only refreshes its path, so this
+ * is also used to catch up after the kernel dropped events.
+ */
+static int add_all_watches(struct fsmonitor_daemon_state *state)
+{
+	struct fsm_listen_data *data = state->listen_data;
+	struct strbuf path = STRBUF_INIT;
+	int ret = -1;
+
+	strbuf_addbuf(&path, &state->path_worktree_watch);
+	data->wd_worktree = add_watch(data, path.buf);
+	if (data->wd_worktree <= 0) {
+		error(_("could not watch '%s'"), path.buf);
+		goto done;
+	}
+	if (add_watches_recursive(state, &path, NULL) < 0)
+		goto done;
+
+	data->wd_gitdir = add_watch(data, state->path_gitdir_watch.buf);
+	if (data->wd_gitdir <= 0) {
+		error(_("could not watch '%s'"), state->path_gitdir_watch.buf);
+		goto done;
+	}
+
+	/* path_cookie_prefix has a trailing slash */
+	strbuf_reset(&path);
+	strbuf_addbuf(&path, &state->path_cookie_prefix);
+	strbuf_strip_suffix(&path, "/");
+	if (add_watch(data, path.buf) <= 0) {
+		error(_("could not watch '%s'"), path.buf);
+		goto done;
+	}
+
+	trace_printf_key(&trace_fsmonitor, "inotify: watching %u directories",
+			 hashmap_get_size(&data->watches));
+	ret = 0;
+
+done:
+	strbuf_release(&path);
+	return ret;
+}
+
+static void log_mask_set(const char *path, uint32_t mask)
+{
+	struct strbuf msg = STRBUF_INIT;
+
+	if (mask & IN_ATTRIB)
+		strbuf_addstr(&msg, "IN_ATTRIB|");
+	if (mask & IN_CREATE)
+		strbuf_addstr(&msg, "IN_CREATE|");
+	if (mask & IN_DELETE)
+		strbuf_addstr(&msg, "IN_DELETE|");
+	if (mask & IN_DELETE_SELF)
+		strbuf_addstr(&msg, "IN_DELETE_SELF|");
+	if (mask & IN_MODIFY)
+		strbuf_addstr(&msg, "IN_MODIFY|");
+	if (mask & IN_MOVE_SELF)
+		strbuf_addstr(&msg, "IN_MOVE_SELF|");
+	if (mask & IN_MOVED_FROM)
+		strbuf_addstr(&msg, "IN_MOVED_FROM|");
+	if (mask & IN_MOVED_TO)
+		strbuf_addstr(&msg, "IN_MOVED_TO|");
+	if (mask & IN_IGNORED)
+		strbuf_addstr(&msg, "IN_IGNORED|");
+	if (mask & IN_ISDIR)
+		strbuf_addstr(&msg, "IN_ISDIR|");
+	if (mask & IN_Q_OVERFLOW)
+		strbuf_addstr(&msg, "IN_Q_OVERFLOW|");
+	if (mask & IN_UNMOUNT)
+		strbuf_addstr(&msg, "IN_UNMOUNT|");
+
+	trace_printf_key(&trace_fsmonitor, "inotify: '%s', mask=0x%x %s",
+			 path, mask, msg.buf);
+
+	strbuf_release(&msg);
+}
+
+/*
+ * Handle the events returned by one read() of the inotify descriptor
+ * and publish the resulting batch.  Returns non-zero if the daemon
+ * should shut down.
+ */
+static int process_events(struct fsmonitor_daemon_state *state,
+			  const char *buf, size_t len)
+{
+	struct fsm_listen_data *data = state->listen_data;
+	struct fsmonitor_batch *batch = NULL;
+	struct string_list cookie_list = STRING_LIST_INIT_DUP;
+	struct strbuf path = STRBUF_INIT;
+	struct strbuf tmp = STRBUF_INIT;
+	const char *p;
+
+	for (p = buf; p < buf + len;
+	     p += sizeof(struct inotify_event) +
+		  ((const struct inotify_event *)p)->len) {
+		const struct inotify_event *ev = (const struct inotify_event *)p;
+		struct watch_entry *w;
+		const char *slash;
+
+		if (ev->mask & IN_Q_OVERFLOW) {
+			/*
+			 * The kernel dropped events, so we lost sync with
+			 * the filesystem: flush everything we have, and
+			 * watch directories we did not hear about.
+			 */
+			trace_printf_key(&trace_fsmonitor,
+					 "inotify: event queue overflow");
+			fsmonitor_force_resync(state);
+			fsmonitor_batch__free_list(batch);
+			string_list_clear(&cookie_list, 0);
+			batch = NULL;
+			if (add_all_watches(state))
+				goto force_error_stop;
+			continue;
+		}
+
+		w = find_watch(data, ev->wd);
+		if (!w)
+			continue; /* a watch we already dropped */
+
+		strbuf_reset(&path);
+		strbuf_addstr(&path, w->path);
+		if (ev->len) {
+			strbuf_addch(&path, '/');
+			strbuf_addstr(&path, ev->name);
+		}
+
+		if (trace_pass_fl(&trace_fsmonitor))
+			log_mask_set(path.buf, ev->mask);
+
+		if (ev->mask & IN_IGNORED) {
+			remove_watch(data, w);
+			continue;
+		}
+
+		if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT)) {
+			if (ev->wd == data->wd_worktree) {
+				trace_printf_key(&trace_fsmonitor,
+						 "event: worktree root moved or removed");
+				goto force_shutdown;
+			}
+			if (ev->wd == data->wd_gitdir) {
+				trace_printf_key(&trace_fsmonitor,
+						 "event: gitdir moved or removed");
+				goto force_shutdown;
+			}
+			/* the parent directory reports it too */
+			continue;
+		}
+
+		if (!ev->len)
+			continue; /* e.g. IN_ATTRIB on the directory itself */
+
+		switch (fsmonitor_classify_path_absolute(state, path.buf)) {
+
+		case IS_INSIDE_DOT_GIT_WITH_COOKIE_PREFIX:
+		case IS_INSIDE_GITDIR_WITH_COOKIE_PREFIX:
+			/* special case cookie files within .git or gitdir */
+
+			/* Use just the filename of the cookie file. */
+			slash = find_last_dir_sep(path.buf);
+			string_list_append(&cookie_list,
+					   slash ? slash + 1 : path.buf);
+			break;
+
+		case IS_INSIDE_DOT_GIT:
+		case IS_INSIDE_GITDIR:
+			/* ignore all other paths inside of .git or gitdir */
+			break;
+
+		case IS_DOT_GIT:
+		case IS_GITDIR:
+			/*
+			 * If .git directory is deleted or renamed away,
+			 * we have to quit.
+			 */
+			if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+				trace_printf_key(&trace_fsmonitor,
+						 "event: gitdir removed");
+				goto force_shutdown;
+			}
+			break;
+
+		case IS_WORKDIR_PATH:
+			/* try to queue normal pathnames */
+
+			if (!batch)
+				batch = fsmonitor_batch__new();
+
+			if (!(ev->mask & IN_ISDIR)) {
+				fsmonitor_batch__add_path(batch, path.buf +
+					state->path_worktree_watch.len + 1);
+				break;
+			}
+
+			strbuf_reset(&tmp);
+			strbuf_addstr(&tmp, path.buf +
+				      state->path_worktree_watch.len + 1);
+			strbuf_addch(&tmp, '/');
+			fsmonitor_batch__add_path(batch, tmp.buf);
+
+			if (ev->mask & IN_MOVED_FROM)
+				remove_watches_recursive(data, path.buf);
+			if ((ev->mask & (IN_CREATE | IN_MOVED_TO)) &&
+			    strcmp(ev->name, ".git") &&
+			    add_watches_recursive(state, &path, &batch) < 0)
+				goto force_error_stop;
+			break;
+
+		case IS_OUTSIDE_CONE:
+		default:
+			trace_printf_key(&trace_fsmonitor,
+					 "ignoring '%s'", path.buf);
+			break;
+		}
+	}
+
+	fsmonitor_publish(state, batch, &cookie_list);
+	string_list_clear(&cookie_list, 0);
+	strbuf_release(&path);
+	strbuf_release(&tmp);
+	return 0;
+
+force_error_stop:
+	data->shutdown_style = FORCE_ERROR_STOP;
+	goto cleanup;
+force_shutdown:
+	data->shutdown_style = FORCE_SHUTDOWN;
+cleanup:
+	fsmonitor_batch__free_list(batch);
+	string_list_clear(&cookie_list, 0);
+	strbuf_release(&path);
+	strbuf_release(&tmp);
+	return -1;
+}
+
+int fsm_listen__ctor(struct fsmonitor_daemon_state *state)
+{
+	struct fsm_listen_data *data;
+
+	CALLOC_ARRAY(data, 1);
+	state->listen_data = data;
+	data->fd_stop[0] = data->fd_stop[1] = -1;
+	hashmap_init(&data->watches, watch_entry_cmp, NULL, 0);
+
+	data->fd_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (data->fd_inotify < 0) {
+		error_errno(_("inotify_init1() failed"));
+		goto failed;
+	}
+
+	if (pipe(data->fd_stop) < 0) {
+		error_errno(_("could not create pipe"));
+		goto failed;
+	}
+
+	if (add_all_watches(state))
+		goto failed;
+
+	return 0;
+
+failed:
+	error(_("Unable to watch '%s' with inotify."),
+	      state->path_worktree_watch.buf);
+	fsm_listen__dtor(state);
+	return -1;
+}
+
+void fsm_listen__dtor(struct fsmonitor_daemon_state *state)
+{
+	struct fsm_listen_data *data;
+	struct hashmap_iter iter;
+	struct watch_entry *w;
+
+	if (!state || !state->listen_data)
+		return;
+
+	data = state->listen_data;
+
+	hashmap_for_each_entry(&data->watches, &iter, w, ent)
+		free(w->path);
+	hashmap_clear_and_free(&data->watches, struct watch_entry, ent);
+
+	if (data->fd_inotify >= 0)
+		close(data->fd_inotify);
+	if (data->fd_stop[0] >= 0)
+		close(data->fd_stop[0]);
+	if (data->fd_stop[1] >= 0)
+		close(data->fd_stop[1]);
+
+	FREE_AND_NULL(state->listen_data);
+}
+
+void fsm_listen__stop_async(struct fsmonitor_daemon_state *state)
+{
+	struct fsm_listen_data *data = state->listen_data;
+
+	if (write(data->fd_stop[1], "q", 1) < 0)
+		warning_errno(_("could not stop the inotify listener"));
+}
+
+void fsm_listen__loop(struct fsmonitor_daemon_state *state)
+{
+	struct fsm_listen_data *data = state->listen_data;
+	union {
+		struct inotify_event ev; /* for alignment */
+		char buf[64 * 1024];
+	} u;
+	struct pollfd pfd[2];
+
+	data->shutdown_style = SHUTDOWN_EVENT;
+
+	pfd[0].fd = data->fd_inotify;
+	pfd[0].events = POLLIN;
+	pfd[1].fd = data->fd_stop[0];
+	pfd[1].events = POLLIN;
+
+	for (;;) {
+		ssize_t len;
+
+		if (poll(pfd, ARRAY_SIZE(pfd), -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			error_errno(_("poll() on inotify descriptor failed"));
+			data->shutdown_style = FORCE_ERROR_STOP;
+			break;
+		}
+
+		if (pfd[1].revents)
+			break; /* fsm_listen__stop_async() */
+
+		if (!(pfd[0].revents & POLLIN))
+			continue;
+
+		len = read(data->fd_inotify, u.buf, sizeof(u.buf));
+		if (len < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			error_errno(_("could not read inotify events"));
+			data->shutdown_style = FORCE_ERROR_STOP;
+			break;
+		}
+
+		if (process_events(state, u.buf, len))
+			break;
+	}
+
+	switch (data->shutdown_style) {
+	case FORCE_ERROR_STOP:
+		state->listen_error_code = -1;
+		/* fall thru */
+	case FORCE_SHUTDOWN:
+		ipc_server_stop_async(state->ipc_server_data);
+		/* fall thru */
+	case SHUTDOWN_EVENT:
+	default:
+		break;
+	}
+}
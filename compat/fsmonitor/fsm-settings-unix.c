@@ -5,24 +5,17 @@
 #include "fsmonitor-settings.h"
 #include "fsmonitor-path-utils.h"
 
- /*
+/*
  * For the builtin FSMonitor, we create the Unix domain socket for the
- * IPC in the .git directory.  If the working directory is remote,
- * then the socket will be created on the remote file system.  This
- * can fail if the remote file system does not support UDS file types
- * (e.g. smbfs to a Windows server) or if the remote kernel does not
- * allow a non-local process to bind() the socket.  (These problems
- * could be fixed by moving the UDS out of the .git directory and to a
- * well-known local directory on the client machine, but care should
- * be taken to ensure that $HOME is actually local and not a managed
- * file share.)
- *
- * FAT32 and NTFS working directories are problematic too.
- *
- * The builtin FSMonitor uses a Unix domain socket in the .git
- * directory for IPC.  These Windows drive formats do not support
- * Unix domain sockets, so mark them as incompatible for the daemon.
+ * IPC in the .git directory, or in $HOME or `fsmonitor.socketDir` if
+ * the .git directory is on a remote file system (see
+ * fsm-ipc-unix.c).  Creating the socket fails if the file system
+ * does not support UDS file types or if the remote server does not
+ * allow a non-local process to bind() the socket.
  *
+ * FAT and NTFS volumes do not support Unix domain sockets either, so
+ * mark them as incompatible for the daemon.  The names are those that
+ * fsmonitor__get_fs_info() reports for them on macOS and Linux.
  */
 static enum fsmonitor_reason check_uds_volume(struct repository *r)
 {
@@ -40,7 +33,9 @@ static enum fsmonitor_reason check_uds_volume(struct repository *r)
 
 	if (fs.is_remote ||
 		!strcmp(fs.typename, "msdos") ||
-		!strcmp(fs.typename, "ntfs")) {
+		!strcmp(fs.typename, "exfat") ||
+		!strcmp(fs.typename, "ntfs") ||
+		!strcmp(fs.typename, "ntfs3")) {
 		free(fs.typename);
 		return FSMONITOR_REASON_NOSOCKETS;
 	}
@@ -0,0 +1,216 @@
+#include "git-compat-util.h"
+#include "stat-batch.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+
+/*
+ * A bare-bones io_uring, set up with the raw system calls so as not to
+ * depend on liburing: every batch fills the submission queue with statx()
+ * requests, submits them with a single io_uring_enter(), and reaps their
+ * completions.
+ */
+struct stat_batch {
+	int fd;
+	unsigned int size, nr;
+
+	/*
+	 * Set when io_uring_enter() failed on us. The kernel may still hold
+	 * on to requests (and their statx buffers) then, so the rings are
+	 * left alone and the paths are lstat()ed the old-fashioned way.
+	 */
+	int broken;
+
+	/* submission queue */
+	void *sq_ring;
+	size_t sq_ring_size;
+	unsigned int *sq_tail, *sq_mask, *sq_array;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	/* completion queue */
+	void *cq_ring;
+	size_t cq_ring_size;
+	unsigned int *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	/* one of each per queued path, indexed by the "user_data" */
+	const char **path;
+	void **item;
+	struct statx *stx;
+	char *done;
+};
+
+static void *map_ring(int fd, size_t size, off_t offset)
+{
+	void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, fd, offset);
+	return p == MAP_FAILED ? NULL : p;
+}
+
+struct stat_batch *stat_batch_new(unsigned int size)
+{
+	struct io_uring_params params;
+	struct stat_batch *b;
+	int fd;
+
+	memset(&params, 0, sizeof(params));
+	fd = syscall(__NR_io_uring_setup, size, &params);
+	if (fd < 0)
+		return NULL; /* no io_uring, or not allowed to use it */
+
+	CALLOC_ARRAY(b, 1);
+	b->fd = fd;
+	b->size = params.sq_entries < size ? params.sq_entries : size;
+
+	b->sq_ring_size = params.sq_off.array +
+		params.sq_entries * sizeof(unsigned int);
+	b->cq_ring_size = params.cq_off.cqes +
+		params.cq_entries * sizeof(struct io_uring_cqe);
+	b->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+	b->sq_ring = map_ring(fd, b->sq_ring_size, IORING_OFF_SQ_RING);
+	b->cq_ring = map_ring(fd, b->cq_ring_size, IORING_OFF_CQ_RING);
+	b->sqes = map_ring(fd, b->sqes_size, IORING_OFF_SQES);
+	if (!b->sq_ring || !b->cq_ring || !b->sqes) {
+		stat_batch_free(b);
+		return NULL;
+	}
+
+	b->sq_tail = (unsigned int *)((char *)b->sq_ring + params.sq_off.tail);
+	b->sq_mask = (unsigned int *)((char *)b->sq_ring + params.sq_off.ring_mask);
+	b->sq_array = (unsigned int *)((char *)b->sq_ring + params.sq_off.array);
+	b->cq_head = (unsigned int *)((char *)b->cq_ring + params.cq_off.head);
+	b->cq_tail = (unsigned int *)((char *)b->cq_ring + params.cq_off.tail);
+	b->cq_mask = (unsigned int *)((char *)b->cq_ring + params.cq_off.ring_mask);
+	b->cqes = (struct io_uring_cqe *)((char *)b->cq_ring + params.cq_off.cqes);
+
+	ALLOC_ARRAY(b->path, b->size);
+	ALLOC_ARRAY(b->item, b->size);
+	ALLOC_ARRAY(b->stx, b->size);
+	ALLOC_ARRAY(b->done, b->size);
+	return b;
+}
+
+int stat_batch_add(struct stat_batch *b, const char *path, void *item)
+{
+	unsigned int tail = *b->sq_tail;
+	unsigned int slot = tail & *b->sq_mask;
+	struct io_uring_sqe *sqe = &b->sqes[slot];
+
+	if (b->nr >= b->size)
+		BUG("stat_batch_add() on a full batch");
+
+	b->path[b->nr] = path;
+	b->item[b->nr] = item;
+	b->done[b->nr] = 0;
+	if (b->broken)
+		return ++b->nr == b->size;
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_STATX;
+	sqe->fd = AT_FDCWD;
+	sqe->addr = (uintptr_t)path;
+	sqe->len = STATX_BASIC_STATS;
+	sqe->off = (uintptr_t)&b->stx[b->nr];
+	sqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+	sqe->user_data = b->nr;
+	b->sq_array[slot] = slot;
+
+	/* make the entry visible to the kernel before the new tail */
+	__atomic_store_n(b->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	return ++b->nr == b->size;
+}
+
+static void statx_to_stat(const struct statx *stx, struct stat *st)
+{
+	memset(st, 0, sizeof(*st));
+	st->st_dev = makedev(stx->stx_dev_major, stx->stx_dev_minor);
+	st->st_ino = stx->stx_ino;
+	st->st_mode = stx->stx_mode;
+	st->st_nlink = stx->stx_nlink;
+	st->st_uid = stx->stx_uid;
+	st->st_gid = stx->stx_gid;
+	st->st_size = stx->stx_size;
+	st->st_atim.tv_sec = stx->stx_atime.tv_sec;
+	st->st_atim.tv_nsec = stx->stx_atime.tv_nsec;
+	st->st_mtim.tv_sec = stx->stx_mtime.tv_sec;
+	st->st_mtim.tv_nsec = stx->stx_mtime.tv_nsec;
+	st->st_ctim.tv_sec = stx->stx_ctime.tv_sec;
+	st->st_ctim.tv_nsec = stx->stx_ctime.tv_nsec;
+}
+
+static void complete(struct stat_batch *b, unsigned int i, int res,
+		     stat_batch_fn fn, void *cb_data)
+{
+	struct stat st;
+
+	if (res == -EINVAL || res == -EOPNOTSUPP) {
+		/* a kernel that predates IORING_OP_STATX, or a broken ring */
+		if (lstat(b->path[i], &st))
+			return;
+	} else if (res < 0) {
+		return;
+	} else {
+		statx_to_stat(&b->stx[i], &st);
+	}
+	fn(b->item[i], &st, cb_data);
+}
+
+void stat_batch_run(struct stat_batch *b, stat_batch_fn fn, void *cb_data)
+{
+	unsigned int submitted = 0, reaped = 0, i;
+
+	while (!b->broken && reaped < b->nr) {
+		unsigned int head, tail;
+		int ret;
+
+		ret = syscall(__NR_io_uring_enter, b->fd, b->nr - submitted,
+			      b->nr - reaped, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (ret < 0) {
+			if (errno != EINTR && errno != EAGAIN)
+				b->broken = 1;
+			continue;
+		}
+		submitted += ret;
+
+		head = *b->cq_head;
+		tail = __atomic_load_n(b->cq_tail, __ATOMIC_ACQUIRE);
+		for (; head != tail; head++) {
+			struct io_uring_cqe *cqe = &b->cqes[head & *b->cq_mask];
+
+			i = cqe->user_data;
+			complete(b, i, cqe->res, fn, cb_data);
+			b->done[i] = 1;
+			reaped++;
+		}
+		__atomic_store_n(b->cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	for (i = 0; reaped < b->nr && i < b->nr; i++)
+		if (!b->done[i])
+			complete(b, i, -EINVAL, fn, cb_data);
+
+	b->nr = 0;
+}
+
+void stat_batch_free(struct stat_batch *b)
+{
+	if (!b)
+		return;
+	if (b->sq_ring)
+		munmap(b->sq_ring, b->sq_ring_size);
+	if (b->cq_ring)
+		munmap(b->cq_ring, b->cq_ring_size);
+	if (b->sqes)
+		munmap(b->sqes, b->sqes_size);
+	close(b->fd);
+	free(b->path);
+	free(b->item);
+	free(b->stx);
+	free(b->done);
+	free(b);
+}
@@ -8,9 +8,146 @@
  * able to verify hasn't been messed with afterwards.
  */
 #include "git-compat-util.h"
+#include "environment.h"
+#include "gettext.h"
 #include "progress.h"
 #include "csum-file.h"
 #include "hash.h"
+#include "parse.h"
+#include "thread-utils.h"
+#include "trace2.h"
+
+/*
+ * With core.checksumThread, hashflush() hands the full buffer to a
+ * thread of its own for hashing, and continues filling a second one in
+ * the meantime. The buffers are only ever read while being hashed (and
+ * written out), so the sole synchronization needed is to wait for the
+ * thread to be done with a buffer before reusing it, or before looking
+ * at the hash context.
+ */
+struct hashfile_thread {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	git_hash_ctx *ctx;
+
+	/* The buffer not currently being filled. */
+	unsigned char *spare;
+
+	/* The data to hash next, if "busy". */
+	const unsigned char *buf;
+	size_t len;
+	int busy;
+	int stop;
+};
+
+static void *run_hash_thread(void *data)
+{
+	struct hashfile_thread *t = data;
+
+	trace2_thread_start("hashfile");
+
+	pthread_mutex_lock(&t->mutex);
+	for (;;) {
+		while (!t->busy && !t->stop)
+			pthread_cond_wait(&t->cond, &t->mutex);
+		if (!t->busy)
+			break;
+		pthread_mutex_unlock(&t->mutex);
+
+		the_hash_algo->update_fn(t->ctx, t->buf, t->len);
+
+		pthread_mutex_lock(&t->mutex);
+		t->busy = 0;
+		pthread_cond_broadcast(&t->cond);
+	}
+	pthread_mutex_unlock(&t->mutex);
+
+	trace2_thread_exit();
+	return NULL;
+}
+
+static void start_hash_thread(struct hashfile *f)
+{
+	struct hashfile_thread *t;
+	int err;
+
+	CALLOC_ARRAY(t, 1);
+	t->ctx = &f->ctx;
+	t->spare = xmalloc(f->buffer_len);
+	pthread_mutex_init(&t->mutex, NULL);
+	pthread_cond_init(&t->cond, NULL);
+
+	err = pthread_create(&t->thread, NULL, run_hash_thread, t);
+	if (err) {
+		/* Not fatal; we just hash inline after all. */
+		warning(_("unable to create hashing thread: %s"), strerror(err));
+		pthread_mutex_destroy(&t->mutex);
+		pthread_cond_destroy(&t->cond);
+		free(t->spare);
+		free(t);
+		return;
+	}
+	f->thread = t;
+}
+
+/* Wait until the hashing thread is idle; the hash context is ours again. */
+static void wait_hash_thread(struct hashfile *f)
+{
+	struct hashfile_thread *t = f->thread;
+
+	if (!t)
+		return;
+	pthread_mutex_lock(&t->mutex);
+	while (t->busy)
+		pthread_cond_wait(&t->cond, &t->mutex);
+	pthread_mutex_unlock(&t->mutex);
+}
+
+static void stop_hash_thread(struct hashfile *f)
+{
+	struct hashfile_thread *t = f->thread;
+
+	if (!t)
+		return;
+	pthread_mutex_lock(&t->mutex);
+	t->stop = 1;
+	pthread_cond_broadcast(&t->cond);
+	pthread_mutex_unlock(&t->mutex);
+	pthread_join(t->thread, NULL);
+
+	pthread_mutex_destroy(&t->mutex);
+	pthread_cond_destroy(&t->cond);
+	free(t->spare);
+	FREE_AND_NULL(f->thread);
+}
+
+/*
+ * Queue the "len" bytes at "buf" for hashing, once the thread is done
+ * with what it was given before.
+ */
+static void queue_hash(struct hashfile *f, const unsigned char *buf,
+		       size_t len)
+{
+	struct hashfile_thread *t = f->thread;
+
+	pthread_mutex_lock(&t->mutex);
+	while (t->busy)
+		pthread_cond_wait(&t->cond, &t->mutex);
+	t->buf = buf;
+	t->len = len;
+	t->busy = 1;
+	pthread_cond_broadcast(&t->cond);
+	pthread_mutex_unlock(&t->mutex);
+}
+
+static int want_hash_thread(struct hashfile *f)
+{
+	if (!HAVE_THREADS || f->skip_hash || f->thread)
+		return 0;
+	return core_checksum_thread ||
+		git_env_bool("GIT_TEST_CHECKSUM_THREAD", 0);
+}
 
 static void verify_buffer_or_die(struct hashfile *f,
 				 const void *buf,
@@ -46,9 +183,24 @@ void hashflush(struct hashfile *f)
 	unsigned offset = f->offset;
 
 	if (offset) {
-		if (!f->skip_hash)
-			the_hash_algo->update_fn(&f->ctx, f->buffer, offset);
-		flush(f, f->buffer, offset);
+		if (f->thread) {
+			unsigned char *full = f->buffer;
+
+			/*
+			 * Once queued, the previous buffer has been hashed
+			 * and can be filled again while this one is written
+			 * out and hashed.
+			 */
+			queue_hash(f, full, offset);
+			flush(f, full, offset);
+			f->buffer = f->thread->spare;
+			f->thread->spare = full;
+		} else {
+			if (!f->skip_hash)
+				the_hash_algo->update_fn(&f->ctx, f->buffer,
+							 offset);
+			flush(f, f->buffer, offset);
+		}
 		f->offset = 0;
 	}
 }
@@ -66,6 +218,7 @@ int finalize_hashfile(struct hashfile *f, unsigned char *result,
 	int fd;
 
 	hashflush(f);
+	stop_hash_thread(f);
 
 	if (f->skip_hash)
 		hashclr(f->buffer);
@@ -101,6 +254,13 @@ int finalize_hashfile(struct hashfile *f, unsigned char *result,
 
 void hashwrite(struct hashfile *f, const void *buf, unsigned int count)
 {
+	/*
+	 * Only bother with a thread for files that fill at least one
+	 * buffer.
+	 */
+	if (f->offset + count >= f->buffer_len && want_hash_thread(f))
+		start_hash_thread(f);
+
 	while (count) {
 		unsigned left = f->buffer_len - f->offset;
 		unsigned nr = count > left ? left : count;
@@ -108,12 +268,15 @@ void hashwrite(struct hashfile *f, const void *buf, unsigned int count)
 		if (f->do_crc)
 			f->crc32 = crc32(f->crc32, buf, nr);
 
-		if (nr == f->buffer_len) {
+		if (nr == f->buffer_len && !f->thread) {
 			/*
 			 * Flush a full batch worth of data directly
 			 * from the input, skipping the memcpy() to
 			 * the hashfile's buffer. In this block,
 			 * f->offset is necessarily zero.
+			 *
+			 * Not so with a hashing thread, which may
+			 * still be reading the data after we return.
 			 */
 			if (!f->skip_hash)
 				the_hash_algo->update_fn(&f->ctx, buf, nr);
@@ -162,6 +325,7 @@ static struct hashfile *hashfd_internal(int fd, const char *name,
 	f->name = name;
 	f->do_crc = 0;
 	f->skip_hash = 0;
+	f->thread = NULL;
 	the_hash_algo->init_fn(&f->ctx);
 
 	f->buffer_len = buffer_len;
@@ -195,6 +359,7 @@ struct hashfile *hashfd_throughput(int fd, const char *name, struct progress *tp
 void hashfile_checkpoint(struct hashfile *f, struct hashfile_checkpoint *checkpoint)
 {
 	hashflush(f);
+	wait_hash_thread(f);
 	checkpoint->offset = f->total;
 	the_hash_algo->clone_fn(&checkpoint->ctx, &f->ctx);
 }
@@ -206,6 +371,7 @@ int hashfile_truncate(struct hashfile *f, struct hashfile_checkpoint *checkpoint
 	if (ftruncate(f->fd, offset) ||
 	    lseek(f->fd, offset, SEEK_SET) != offset)
 		return -1;
+	wait_hash_thread(f);
 	f->total = offset;
 	the_hash_algo->clone_fn(&f->ctx, &checkpoint->ctx);
 	f->offset = 0; /* hashflush() was called in checkpoint */
@@ -5,6 +5,7 @@
 #include "write-or-die.h"
 
 struct progress;
+struct hashfile_thread;
 
 /* A SHA1-protected file */
 struct hashfile {
@@ -27,6 +28,12 @@ struct hashfile {
 	 * instead only use it as a buffered write.
 	 */
 	int skip_hash;
+
+	/*
+	 * With core.checksumThread, the hashing thread of this file,
+	 * which works through full buffers while the next one is filled.
+	 */
+	struct hashfile_thread *thread;
 };
 
 /* Checkpoint */
@@ -145,6 +145,7 @@ int get_shared_repository(void);
 void reset_shared_repository(void);
 
 extern int core_preload_index;
+extern int core_checksum_thread;
 extern int precomposed_unicode;
 extern int protect_hfs;
 extern int protect_ntfs;
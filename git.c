@@ -1,4 +1,5 @@
 #include "builtin.h"
+#include "bulk-checkin.h"
 #include "config.h"
 #include "environment.h"
 #include "exec-cmd.h"
@@ -466,7 +467,10 @@ static int run_builtin(struct cmd_struct *p, int argc, const char **argv)
 	trace2_cmd_list_env_vars();
 
 	validate_cache_entries(the_repository->index);
+	if (run_setup && startup_info->have_repository)
+		begin_command_odb_transaction();
 	status = p->fn(argc, argv, prefix);
+	end_command_odb_transaction();
 	validate_cache_entries(the_repository->index);
 
 	if (status)
@@ -53,6 +53,11 @@
 #define git_SHA1_Clone	platform_SHA1_Clone
 #endif
 
+#ifdef platform_SHA1_Update_multi
+#define git_SHA1_Update_multi	platform_SHA1_Update_multi
+#define git_SHA1_Final_multi	platform_SHA1_Final_multi
+#endif
+
 #ifndef platform_SHA256_CTX
 #define platform_SHA256_CTX	SHA256_CTX
 #define platform_SHA256_Init	SHA256_Init
@@ -69,6 +74,11 @@
 #define git_SHA256_Clone	platform_SHA256_Clone
 #endif
 
+#ifdef platform_SHA256_Update_multi
+#define git_SHA256_Update_multi	platform_SHA256_Update_multi
+#define git_SHA256_Final_multi	platform_SHA256_Final_multi
+#endif
+
 #ifdef SHA1_MAX_BLOCK_SIZE
 #include "compat/sha1-chunked.h"
 #undef git_SHA1_Update
@@ -181,6 +191,10 @@ typedef void (*git_hash_clone_fn)(git_hash_ctx *dst, const git_hash_ctx *src);
 typedef void (*git_hash_update_fn)(git_hash_ctx *ctx, const void *in, size_t len);
 typedef void (*git_hash_final_fn)(unsigned char *hash, git_hash_ctx *ctx);
 typedef void (*git_hash_final_oid_fn)(struct object_id *oid, git_hash_ctx *ctx);
+typedef void (*git_hash_update_multi_fn)(git_hash_ctx **ctx, const void **in,
+					 const size_t *len, size_t nr);
+typedef void (*git_hash_final_multi_fn)(unsigned char **hash,
+					git_hash_ctx **ctx, size_t nr);
 
 struct git_hash_algo {
 	/*
@@ -216,6 +230,17 @@ struct git_hash_algo {
 	/* The hash finalization function for object IDs. */
 	git_hash_final_oid_fn final_oid_fn;
 
+	/*
+	 * Update "nr" independent contexts, "ctx[i]" with the "len[i]"
+	 * bytes at "in[i]". Implementations that can compress the blocks
+	 * of several messages in parallel do so; for the others this is
+	 * the same as calling update_fn() on each in turn.
+	 */
+	git_hash_update_multi_fn update_multi_fn;
+
+	/* The finalization function for "nr" contexts at once. */
+	git_hash_final_multi_fn final_multi_fn;
+
 	/* The OID of the empty tree. */
 	const struct object_id *empty_tree;
 
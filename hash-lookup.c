@@ -102,14 +102,10 @@ int oid_pos(const struct object_id *oid, const void *table, size_t nr,
 	return index_pos_to_insert_pos(lo);
 }
 
-int bsearch_hash(const unsigned char *hash, const uint32_t *fanout_nbo,
-		 const unsigned char *table, size_t stride, uint32_t *result)
+static int bsearch_hash_range(const unsigned char *hash,
+			      const unsigned char *table, size_t stride,
+			      uint32_t lo, uint32_t hi, uint32_t *result)
 {
-	uint32_t hi, lo;
-
-	hi = ntohl(fanout_nbo[*hash]);
-	lo = ((*hash == 0x0) ? 0 : ntohl(fanout_nbo[*hash - 1]));
-
 	while (lo < hi) {
 		unsigned mi = lo + (hi - lo) / 2;
 		int cmp = hashcmp(table + mi * stride, hash);
@@ -129,3 +125,42 @@ int bsearch_hash(const unsigned char *hash, const uint32_t *fanout_nbo,
 		*result = lo;
 	return 0;
 }
+
+int bsearch_hash(const unsigned char *hash, const uint32_t *fanout_nbo,
+		 const unsigned char *table, size_t stride, uint32_t *result)
+{
+	uint32_t hi, lo;
+
+	hi = ntohl(fanout_nbo[*hash]);
+	lo = ((*hash == 0x0) ? 0 : ntohl(fanout_nbo[*hash - 1]));
+
+	return bsearch_hash_range(hash, table, stride, lo, hi, result);
+}
+
+int bsearch_hash_fanout16(const unsigned char *hash,
+			  const uint32_t *fanout_nbo,
+			  const uint32_t *fanout16_nbo,
+			  const unsigned char *table, size_t stride,
+			  uint32_t *result)
+{
+	unsigned int i = (hash[0] << 8) | hash[1];
+	uint32_t hi8, lo8, hi, lo;
+
+	hi8 = ntohl(fanout_nbo[*hash]);
+	lo8 = ((*hash == 0x0) ? 0 : ntohl(fanout_nbo[*hash - 1]));
+
+	hi = ntohl(fanout16_nbo[i]);
+	lo = (!i ? 0 : ntohl(fanout16_nbo[i - 1]));
+
+	/*
+	 * The finer table is only trusted as far as it agrees with the
+	 * coarse one; a bogus entry must not make us look outside of the
+	 * objects starting with the right byte.
+	 */
+	if (lo > hi || lo < lo8 || hi > hi8) {
+		lo = lo8;
+		hi = hi8;
+	}
+
+	return bsearch_hash_range(hash, table, stride, lo, hi, result);
+}
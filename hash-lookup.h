@@ -29,4 +29,20 @@ int oid_pos(const struct object_id *oid,
  */
 int bsearch_hash(const unsigned char *hash, const uint32_t *fanout_nbo,
 		 const unsigned char *table, size_t stride, uint32_t *result);
+
+/*
+ * Like bsearch_hash(), but narrows down the interval with a finer,
+ * 65536-element fanout table "fanout16_nbo", indexed by the first two bytes
+ * of the hash, before searching. This touches a handful of cache lines of
+ * "table" instead of the dozen or so needed to bisect a large 256-way
+ * bucket.
+ *
+ * "fanout_nbo" is still needed; entries of "fanout16_nbo" that disagree
+ * with it are ignored.
+ */
+int bsearch_hash_fanout16(const unsigned char *hash,
+			  const uint32_t *fanout_nbo,
+			  const uint32_t *fanout16_nbo,
+			  const unsigned char *table, size_t stride,
+			  uint32_t *result);
 #endif
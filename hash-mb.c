@@ -0,0 +1,106 @@
+#include "git-compat-util.h"
+#include "hash-mb.h"
+
+/*
+ * With fewer busy lanes than this, compressing the remaining blocks one
+ * at a time is cheaper than running the (mostly idle) vector code.
+ */
+#define HASH_MB_MIN_LANES 2
+
+/* The largest chaining value, in 32-bit words (SHA-256). */
+#define HASH_MB_MAX_STATE 8
+
+static int job_done(const struct hash_mb_job *job)
+{
+	return !job->first && !job->blocks;
+}
+
+static const unsigned char *next_block(struct hash_mb_job *job)
+{
+	const unsigned char *block;
+
+	if (job->first) {
+		block = job->first;
+		job->first = NULL;
+	} else {
+		block = job->data;
+		job->data += 64;
+		job->blocks--;
+	}
+	return block;
+}
+
+static void run_serially(struct hash_mb_job *job, hash_mb_block_fn block)
+{
+	while (!job_done(job))
+		block(job->state, next_block(job));
+}
+
+void hash_mb_run(struct hash_mb_job *jobs, size_t nr, size_t state_words,
+		 hash_mb_lanes_fn lanes, hash_mb_block_fn block)
+{
+	struct hash_mb_job *lane[HASH_MB_LANES] = { NULL };
+	uint32_t scratch[HASH_MB_LANES][HASH_MB_MAX_STATE];
+	size_t next = 0;
+	int i;
+
+	if (state_words > HASH_MB_MAX_STATE)
+		BUG("chaining value of %"PRIuMAX" words is too large",
+		    (uintmax_t)state_words);
+
+	if (!lanes) {
+		for (next = 0; next < nr; next++)
+			run_serially(&jobs[next], block);
+		return;
+	}
+
+	memset(scratch, 0, sizeof(scratch));
+
+	for (;;) {
+		uint32_t *state[HASH_MB_LANES];
+		const unsigned char *in[HASH_MB_LANES];
+		int busy = 0, first_busy = -1;
+
+		for (i = 0; i < HASH_MB_LANES; i++) {
+			if (lane[i] && job_done(lane[i]))
+				lane[i] = NULL;
+			while (!lane[i] && next < nr) {
+				if (!job_done(&jobs[next]))
+					lane[i] = &jobs[next];
+				next++;
+			}
+			if (lane[i]) {
+				busy++;
+				if (first_busy < 0)
+					first_busy = i;
+			}
+		}
+
+		/*
+		 * The lanes are refilled as long as there are jobs left, so
+		 * this only happens at the tail end.
+		 */
+		if (busy < HASH_MB_MIN_LANES) {
+			for (i = 0; i < HASH_MB_LANES; i++)
+				if (lane[i])
+					run_serially(lane[i], block);
+			return;
+		}
+
+		for (i = 0; i < HASH_MB_LANES; i++) {
+			if (lane[i]) {
+				state[i] = lane[i]->state;
+				in[i] = next_block(lane[i]);
+			} else {
+				state[i] = scratch[i];
+				in[i] = NULL;
+			}
+		}
+		/* Idle lanes chew on some valid block into their scratch state. */
+		for (i = 0; i < HASH_MB_LANES; i++)
+			if (!in[i])
+				in[i] = in[first_busy];
+
+		lanes(state, in);
+	}
+}
@@ -0,0 +1,75 @@
+#ifndef HASH_MB_H
+#define HASH_MB_H
+
+/*
+ * Helpers for "multi-buffer" hashing: the block functions of SHA-1 and
+ * SHA-256 are a long chain of dependent 32-bit operations, so a single
+ * message cannot make use of vector units. Independent messages can,
+ * though, by putting one message in each lane of a vector register and
+ * compressing a block of every message with the same instructions.
+ *
+ * A hash implementation provides a function compressing one block of
+ * up to HASH_MB_LANES messages at once, and hash_mb_run() schedules
+ * the blocks of an arbitrary number of messages onto those lanes.
+ */
+
+#define HASH_MB_LANES 8
+
+/*
+ * Compress "block[i]" into the chaining value "state[i]", for each lane
+ * "i" of HASH_MB_LANES.
+ */
+typedef void (*hash_mb_lanes_fn)(uint32_t *state[HASH_MB_LANES],
+				 const unsigned char *block[HASH_MB_LANES]);
+
+/* Compress a single "block" into "state". */
+typedef void (*hash_mb_block_fn)(uint32_t *state, const unsigned char *block);
+
+struct hash_mb_job {
+	/* The chaining value of the message. */
+	uint32_t *state;
+
+	/*
+	 * An optional block that has to be compressed before "data", e.g.
+	 * the one buffered in the context by an earlier update.
+	 */
+	const unsigned char *first;
+
+	/* "blocks" whole blocks of the message. */
+	const unsigned char *data;
+	size_t blocks;
+};
+
+/*
+ * Compress the blocks of each of the "nr" jobs into their states.
+ *
+ * "lanes" may be NULL when the platform has no multi-lane code, in which
+ * case (and whenever there are too few messages left to fill the lanes)
+ * the blocks are compressed one at a time with "block". "state_words" is
+ * the size of the chaining value, which is used for scratch space of the
+ * unused lanes.
+ */
+void hash_mb_run(struct hash_mb_job *jobs, size_t nr, size_t state_words,
+		 hash_mb_lanes_fn lanes, hash_mb_block_fn block);
+
+/*
+ * GCC and clang can express the multi-lane block functions with their
+ * vector extensions, which gives SSE2/AVX2 code on x86 and NEON on ARM.
+ * On x86 the functions are compiled a second time for AVX2, which is
+ * picked at runtime when the CPU supports it.
+ */
+#if defined(__GNUC__) && !defined(NO_HASH_MB)
+#define HASH_MB_VECTORS
+#if defined(__x86_64__) || defined(__i386__)
+#define HASH_MB_AVX2
+#endif
+#endif
+
+#ifdef HASH_MB_AVX2
+static inline int hash_mb_have_avx2(void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+#endif
+
+#endif
@@ -1,6 +1,7 @@
 #include "git-compat-util.h"
 #include "abspath.h"
 #include "advice.h"
+#include "bulk-checkin.h"
 #include "gettext.h"
 #include "hook.h"
 #include "path.h"
@@ -154,6 +155,7 @@ int run_hooks_opt(const char *hook_name, struct run_hooks_opt *options)
 	}
 
 	cb_data.hook_path = hook_path;
+	flush_odb_transaction();
 	if (options->dir) {
 		strbuf_add_absolute_path(&abs_path, hook_path);
 		cb_data.hook_path = abs_path.buf;
@@ -16,6 +16,7 @@
 #include "setup.h"
 #include "strvec.h"
 #include "bloom.h"
+#include "commit-graph.h"
 #include "tree-walk.h"
 
 static void range_set_grow(struct range_set *rs, size_t extra)
@@ -1177,6 +1178,30 @@ static int bloom_filter_check(struct rev_info *rev,
 	return result;
 }
 
+static int changed_path_list_check(struct rev_info *rev,
+				   struct commit *commit,
+				   struct line_log_data *range)
+{
+	struct pathspec pathspec;
+	int result;
+
+	/*
+	 * The lists only describe the change against the first parent;
+	 * merges need process_ranges_merge_commit() to rewrite their
+	 * parents even when they are TREESAME to the first one.
+	 */
+	if (commit->parents && commit->parents->next)
+		return 1;
+	if (commit_graph_position(commit) == COMMIT_NOT_FROM_GRAPH)
+		return 1;
+
+	parse_pathspec_from_ranges(&pathspec, range);
+	result = commit_graph_changes_pathspec(rev->repo, commit, &pathspec);
+	clear_pathspec(&pathspec);
+
+	return result != 0;
+}
+
 static int process_ranges_ordinary_commit(struct rev_info *rev, struct commit *commit,
 					  struct line_log_data *range)
 {
@@ -1266,7 +1291,9 @@ int line_log_process_ranges_arbitrary_commit(struct rev_info *rev, struct commit
 	int changed = 0;
 
 	if (range) {
-		if (commit->parents && !bloom_filter_check(rev, commit, range)) {
+		if (commit->parents &&
+		    (!bloom_filter_check(rev, commit, range) ||
+		     !changed_path_list_check(rev, commit, range))) {
 			struct line_log_data *prange = line_log_data_copy(range);
 			add_line_range(rev, commit->parents->item, prange);
 			clear_commit_line_range(rev, commit);
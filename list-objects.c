@@ -13,8 +13,11 @@
 #include "list-objects-filter-options.h"
 #include "packfile.h"
 #include "object-store-ll.h"
+#include "promisor-remote.h"
 #include "trace.h"
+#include "trace2.h"
 #include "environment.h"
+#include "thread-utils.h"
 
 struct traversal_context {
 	struct rev_info *revs;
@@ -373,6 +376,252 @@ static void traverse_non_commits(struct traversal_context *ctx,
 	object_array_clear(&ctx->revs->pending);
 }
 
+/*
+ * Walking trees with several threads: the trees still to be walked are
+ * kept on a stack shared by the threads, each of which pops a tree, shows
+ * it and its blobs, and pushes its subtrees. Objects are claimed by setting
+ * SEEN with set_object_flags_unless(), so that each of them is shown once,
+ * and the callbacks are called one at a time, under obj_read_lock().
+ */
+struct tree_work {
+	struct tree *tree;
+	char *path;
+	int depth;
+};
+
+struct tree_walk_threads {
+	struct traversal_context *ctx;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	struct tree_work *stack;
+	size_t nr, alloc;
+	int nr_threads;
+	int idle;
+	int done;
+};
+
+static int can_walk_trees_threaded(struct traversal_context *ctx)
+{
+	struct rev_info *revs = ctx->revs;
+
+	/*
+	 * Filters keep state across the trees they are shown, and the other
+	 * options either call back into code that is not thread-safe, or
+	 * need the trees to be walked in order.
+	 */
+	return HAVE_THREADS && revs->traverse_threads > 1 &&
+		revs->tree_objects && !ctx->filter &&
+		!revs->diffopt.pathspec.nr &&
+		!revs->tree_blobs_in_commit_order &&
+		!revs->include_check_obj &&
+		!revs->exclude_promisor_objects &&
+		!revs->ignore_missing_links &&
+		!revs->do_not_die_on_missing_objects &&
+		!revs->verify_objects &&
+		!repo_has_promisor_remote(revs->repo);
+}
+
+static void push_tree_work(struct tree_walk_threads *w, struct tree *tree,
+			   char *path, int depth)
+{
+	pthread_mutex_lock(&w->mutex);
+	ALLOC_GROW(w->stack, w->nr + 1, w->alloc);
+	w->stack[w->nr].tree = tree;
+	w->stack[w->nr].path = path;
+	w->stack[w->nr].depth = depth;
+	w->nr++;
+	if (w->idle)
+		pthread_cond_signal(&w->cond);
+	pthread_mutex_unlock(&w->mutex);
+}
+
+/*
+ * NOT_USER_GIVEN only matters to filters, but is set with SEEN all the
+ * same. Setting it separately would write to the flags of trees that
+ * other threads are parsing.
+ */
+static int claim_object(struct object *obj)
+{
+	return !(set_object_flags_unless(obj, SEEN | NOT_USER_GIVEN,
+					 UNINTERESTING | SEEN) &
+		 (UNINTERESTING | SEEN));
+}
+
+static void show_object_locked(struct traversal_context *ctx,
+			       struct object *obj, const char *name)
+{
+	obj_read_lock();
+	show_object(ctx, obj, name);
+	obj_read_unlock();
+}
+
+static void walk_tree_threaded(struct tree_walk_threads *w,
+			       struct tree_work *work, struct strbuf *base)
+{
+	struct traversal_context *ctx = w->ctx;
+	struct tree *tree = work->tree;
+	struct tree_desc desc;
+	struct name_entry entry;
+
+	if (work->depth > max_allowed_tree_depth)
+		die("exceeded maximum allowed tree depth");
+	if (parse_tree_gently(tree, 1))
+		die("bad tree object %s", oid_to_hex(&tree->object.oid));
+
+	strbuf_reset(base);
+	strbuf_addstr(base, work->path);
+	show_object_locked(ctx, &tree->object, base->buf);
+	if (base->len)
+		strbuf_addch(base, '/');
+
+	init_tree_desc(&desc, tree->buffer, tree->size);
+	while (tree_entry(&desc, &entry)) {
+		if (S_ISDIR(entry.mode)) {
+			struct tree *t = lookup_tree(ctx->revs->repo, &entry.oid);
+			if (!t) {
+				die(_("entry '%s' in tree %s has tree mode, "
+				      "but is not a tree"),
+				    entry.path, oid_to_hex(&tree->object.oid));
+			}
+			if (claim_object(&t->object))
+				push_tree_work(w, t,
+					       xstrfmt("%s%s", base->buf, entry.path),
+					       work->depth + 1);
+		}
+		else if (S_ISGITLINK(entry.mode))
+			; /* ignore gitlink */
+		else {
+			struct blob *b = lookup_blob(ctx->revs->repo, &entry.oid);
+			size_t baselen = base->len;
+
+			if (!b) {
+				die(_("entry '%s' in tree %s has blob mode, "
+				      "but is not a blob"),
+				    entry.path, oid_to_hex(&tree->object.oid));
+			}
+			if (!ctx->revs->blob_objects || !claim_object(&b->object))
+				continue;
+
+			strbuf_addstr(base, entry.path);
+			show_object_locked(ctx, &b->object, base->buf);
+			strbuf_setlen(base, baselen);
+		}
+	}
+
+	free_tree_buffer(tree);
+}
+
+static void *tree_walk_thread(void *data)
+{
+	struct tree_walk_threads *w = data;
+	struct strbuf base = STRBUF_INIT;
+
+	pthread_mutex_lock(&w->mutex);
+	for (;;) {
+		struct tree_work work;
+
+		if (w->nr) {
+			work = w->stack[--w->nr];
+			pthread_mutex_unlock(&w->mutex);
+			walk_tree_threaded(w, &work, &base);
+			free(work.path);
+			pthread_mutex_lock(&w->mutex);
+			continue;
+		}
+		if (w->done)
+			break;
+		if (w->idle + 1 == w->nr_threads) {
+			/* nobody is left to push more trees */
+			w->done = 1;
+			pthread_cond_broadcast(&w->cond);
+			break;
+		}
+		w->idle++;
+		pthread_cond_wait(&w->cond, &w->mutex);
+		w->idle--;
+	}
+	pthread_mutex_unlock(&w->mutex);
+
+	strbuf_release(&base);
+	return NULL;
+}
+
+static void traverse_non_commits_threaded(struct traversal_context *ctx,
+					  struct strbuf *base)
+{
+	struct tree_walk_threads w = {
+		.ctx = ctx,
+		.nr_threads = ctx->revs->traverse_threads,
+	};
+	pthread_t *threads;
+	int i;
+
+	assert(base->len == 0);
+
+	pthread_mutex_init(&w.mutex, NULL);
+	pthread_cond_init(&w.cond, NULL);
+
+	/* Tags and blobs are handled before the threads are started. */
+	for (i = 0; i < ctx->revs->pending.nr; i++) {
+		struct object_array_entry *pending = ctx->revs->pending.objects + i;
+		struct object *obj = pending->item;
+		const char *name = pending->name;
+		const char *path = pending->path;
+		if (obj->flags & (UNINTERESTING | SEEN))
+			continue;
+		if (obj->type == OBJ_TAG) {
+			process_tag(ctx, (struct tag *)obj, name);
+			continue;
+		}
+		if (!path)
+			path = "";
+		if (obj->type == OBJ_TREE) {
+			obj->flags |= SEEN;
+			push_tree_work(&w, (struct tree *)obj, xstrdup(path), 0);
+			continue;
+		}
+		if (obj->type == OBJ_BLOB) {
+			process_blob(ctx, (struct blob *)obj, base, path);
+			continue;
+		}
+		die("unknown pending object %s (%s)",
+		    oid_to_hex(&obj->oid), name);
+	}
+	object_array_clear(&ctx->revs->pending);
+
+	if (w.nr) {
+		trace2_region_enter("list-objects", "walk-trees-threaded",
+				    ctx->revs->repo);
+		trace2_data_intmax("list-objects", ctx->revs->repo,
+				   "threads", w.nr_threads);
+
+		enable_object_table_lock(ctx->revs->repo);
+		enable_obj_read_lock();
+
+		CALLOC_ARRAY(threads, w.nr_threads);
+		for (i = 0; i < w.nr_threads; i++) {
+			int err = pthread_create(&threads[i], NULL,
+						 tree_walk_thread, &w);
+			if (err)
+				die(_("unable to create thread: %s"),
+				    strerror(err));
+		}
+		for (i = 0; i < w.nr_threads; i++)
+			pthread_join(threads[i], NULL);
+		free(threads);
+
+		disable_obj_read_lock();
+		disable_object_table_lock(ctx->revs->repo);
+
+		trace2_region_leave("list-objects", "walk-trees-threaded",
+				    ctx->revs->repo);
+	}
+
+	free(w.stack);
+	pthread_cond_destroy(&w.cond);
+	pthread_mutex_destroy(&w.mutex);
+}
+
 static void do_traverse(struct traversal_context *ctx)
 {
 	struct commit *commit;
@@ -418,7 +667,10 @@ static void do_traverse(struct traversal_context *ctx)
 			 */
 			traverse_non_commits(ctx, &csp);
 	}
-	traverse_non_commits(ctx, &csp);
+	if (can_walk_trees_threaded(ctx))
+		traverse_non_commits_threaded(ctx, &csp);
+	else
+		traverse_non_commits(ctx, &csp);
 	strbuf_release(&csp);
 }
 
@@ -16,6 +16,15 @@ void mark_edges_uninteresting(struct rev_info *revs,
 struct oidset;
 struct list_objects_filter_options;
 
+/*
+ * Walk the commits of "revs", and the objects reachable from them.
+ *
+ * When "revs->traverse_threads" is more than one, the trees and blobs may
+ * be walked by that many threads once all commits have been shown (unless
+ * the traversal needs them in order, or is filtered). "show_object" is then
+ * called from those threads, in no particular order, but one call at a time
+ * and with obj_read_lock() held; it must not parse objects.
+ */
 void traverse_commit_list_filtered(
 	struct rev_info *revs,
 	show_commit_fn show_commit,
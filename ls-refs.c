@@ -10,6 +10,13 @@
 #include "pkt-line.h"
 #include "config.h"
 #include "string-list.h"
+#include "dir.h"
+#include "object-file.h"
+#include "path.h"
+#include "statinfo.h"
+#include "tempfile.h"
+#include "trace2.h"
+#include "write-or-die.h"
 
 static enum {
 	UNBORN_IGNORE = 0,
@@ -73,8 +80,31 @@ struct ls_refs_data {
 	struct strbuf buf;
 	struct strvec hidden_refs;
 	unsigned unborn : 1;
+	unsigned use_cache : 1;
+
+	/*
+	 * When the response is being recorded for the cache, the packets
+	 * are collected in "cache_buf" and written out to "cache" as they
+	 * accumulate.
+	 */
+	struct tempfile *cache;
+	struct strbuf cache_buf;
 };
 
+static void cache_flush(struct ls_refs_data *data)
+{
+	if (!data->cache)
+		return;
+	/*
+	 * Failing to write the cache is no reason to fail the request;
+	 * just go on without it.
+	 */
+	if (write_in_full(get_tempfile_fd(data->cache), data->cache_buf.buf,
+			  data->cache_buf.len) < 0)
+		delete_tempfile(&data->cache);
+	strbuf_reset(&data->cache_buf);
+}
+
 static int send_ref(const char *refname, const struct object_id *oid,
 		    int flag, void *cb_data)
 {
@@ -115,6 +145,12 @@ static int send_ref(const char *refname, const struct object_id *oid,
 	strbuf_addch(&data->buf, '\n');
 	packet_fwrite(stdout, data->buf.buf, data->buf.len);
 
+	if (data->cache) {
+		packet_buf_write(&data->cache_buf, "%s", data->buf.buf);
+		if (data->cache_buf.len >= LARGE_PACKET_MAX * 16)
+			cache_flush(data);
+	}
+
 	return 0;
 }
 
@@ -140,6 +176,11 @@ static int ls_refs_config(const char *var, const char *value,
 			  void *cb_data)
 {
 	struct ls_refs_data *data = cb_data;
+
+	if (!strcmp(var, "lsrefs.cache")) {
+		data->use_cache = git_config_bool(var, value);
+		return 0;
+	}
 	/*
 	 * We only serve fetches over v2 for now, so respect only "uploadpack"
 	 * config. This may need to eventually be expanded to "receive", but we
@@ -148,14 +189,281 @@ static int ls_refs_config(const char *var, const char *value,
 	return parse_hide_refs_config(var, value, "uploadpack", &data->hidden_refs);
 }
 
+/*
+ * With "lsrefs.cache", responses are kept in "$GIT_COMMON_DIR/ls-refs-cache"
+ * in files named "<state>-<request>", so that repeating a request is a
+ * matter of copying a file for as long as the refs do not change.
+ *
+ * <request> is a hash of everything apart from the refs that goes into the
+ * response. <state> is a hash of the stat data of the files the "files"
+ * backend stores refs in: HEAD, packed-refs, packed-refs.delta, and all
+ * directories below "refs/". Loose refs are updated by renaming a lock file
+ * into place next to them, which changes the mtime of their directory, so
+ * the loose refs themselves need not be looked at.
+ */
+#define LS_REFS_CACHE_DIR "ls-refs-cache"
+
+/*
+ * Clients choose the ref prefixes, which are part of <request>, so they
+ * could make us store a response for every set of prefixes they can come
+ * up with. Stop adding responses for a state of the refs once there are
+ * this many, which is plenty for the handful of distinct requests that
+ * ls-remote, fetch and clone make. Concurrent requests can each still
+ * add one more.
+ */
+#define LS_REFS_CACHE_MAX_ENTRIES 16
+
+struct ref_state {
+	git_hash_ctx ctx;
+	/* the most recent mtime seen */
+	struct cache_time newest;
+};
+
+static int cache_time_cmp(const struct cache_time *a,
+			  const struct cache_time *b)
+{
+	if (a->sec != b->sec)
+		return a->sec < b->sec ? -1 : 1;
+	if (a->nsec != b->nsec)
+		return a->nsec < b->nsec ? -1 : 1;
+	return 0;
+}
+
+static void update_newest(struct cache_time *newest, const struct cache_time *t)
+{
+	if (cache_time_cmp(t, newest) > 0)
+		*newest = *t;
+}
+
+static void ref_state_add(struct ref_state *state, const char *path,
+			  struct stat *st)
+{
+	struct stat_data sd = { 0 };
+
+	if (st) {
+		fill_stat_data(&sd, st);
+		update_newest(&state->newest, &sd.sd_mtime);
+	}
+	the_hash_algo->update_fn(&state->ctx, path, strlen(path) + 1);
+	the_hash_algo->update_fn(&state->ctx, &sd, sizeof(sd));
+}
+
+static void ref_state_add_file(struct ref_state *state, const char *path)
+{
+	struct stat st;
+
+	ref_state_add(state, path, lstat(path, &st) ? NULL : &st);
+}
+
+static void ref_state_add_dir(struct ref_state *state, struct strbuf *path)
+{
+	size_t len = path->len;
+	struct dirent *e;
+	struct stat st;
+	DIR *dir;
+
+	if (lstat(path->buf, &st)) {
+		ref_state_add(state, path->buf, NULL);
+		return;
+	}
+	ref_state_add(state, path->buf, &st);
+
+	dir = opendir(path->buf);
+	if (!dir)
+		return;
+	strbuf_addch(path, '/');
+	while ((e = readdir_skip_dot_and_dotdot(dir))) {
+		if (get_dtype(e, path, 0) != DT_DIR)
+			continue;
+		strbuf_addstr(path, e->d_name);
+		ref_state_add_dir(state, path);
+		strbuf_setlen(path, len + 1);
+	}
+	strbuf_setlen(path, len);
+	closedir(dir);
+}
+
+static void compute_ref_state(struct repository *r, struct strbuf *out,
+			      struct cache_time *newest)
+{
+	struct ref_state state = { 0 };
+	struct strbuf path = STRBUF_INIT;
+	unsigned char hash[GIT_MAX_RAWSZ];
+
+	the_hash_algo->init_fn(&state.ctx);
+
+	strbuf_addf(&path, "%s/HEAD", r->gitdir);
+	ref_state_add_file(&state, path.buf);
+	strbuf_reset(&path);
+	strbuf_addf(&path, "%s/packed-refs", r->commondir);
+	ref_state_add_file(&state, path.buf);
+	strbuf_addstr(&path, ".delta");
+	ref_state_add_file(&state, path.buf);
+	strbuf_reset(&path);
+	strbuf_addf(&path, "%s/refs", r->commondir);
+	ref_state_add_dir(&state, &path);
+
+	the_hash_algo->final_fn(hash, &state.ctx);
+	strbuf_addstr(out, hash_to_hex(hash));
+	if (newest)
+		*newest = state.newest;
+	strbuf_release(&path);
+}
+
+static void compute_request_hash(struct ls_refs_data *data, struct strbuf *out)
+{
+	struct strbuf buf = STRBUF_INIT;
+	unsigned char hash[GIT_MAX_RAWSZ];
+	git_hash_ctx ctx;
+	int i;
+
+	strbuf_addf(&buf, "peel %u", data->peel);
+	strbuf_addch(&buf, '\0');
+	strbuf_addf(&buf, "symrefs %u", data->symrefs);
+	strbuf_addch(&buf, '\0');
+	strbuf_addf(&buf, "unborn %u", data->unborn);
+	strbuf_addch(&buf, '\0');
+	strbuf_addf(&buf, "namespace %s", get_git_namespace());
+	strbuf_addch(&buf, '\0');
+	for (i = 0; i < data->hidden_refs.nr; i++) {
+		strbuf_addf(&buf, "hide %s", data->hidden_refs.v[i]);
+		strbuf_addch(&buf, '\0');
+	}
+	for (i = 0; i < data->prefixes.nr; i++) {
+		strbuf_addf(&buf, "prefix %s", data->prefixes.v[i]);
+		strbuf_addch(&buf, '\0');
+	}
+
+	the_hash_algo->init_fn(&ctx);
+	the_hash_algo->update_fn(&ctx, buf.buf, buf.len);
+	the_hash_algo->final_fn(hash, &ctx);
+	strbuf_addstr(out, hash_to_hex(hash));
+	strbuf_release(&buf);
+}
+
+static int ls_refs_cache_send(const char *path)
+{
+	struct stat st;
+	int fd = git_open(path);
+
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &st)) {
+		close(fd);
+		return -1;
+	}
+	if (st.st_size) {
+		size_t size = xsize_t(st.st_size);
+		void *map = xmmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		fwrite_or_die(stdout, map, size);
+		munmap(map, size);
+	}
+	close(fd);
+	return 0;
+}
+
+/*
+ * Remove the responses for any other state of the refs, which are of no
+ * use anymore, and return the number of those for "state".
+ */
+static int prune_cache(struct repository *r, const char *state)
+{
+	struct strbuf path = STRBUF_INIT;
+	struct dirent *e;
+	int nr = 0;
+	size_t len;
+	DIR *dir;
+
+	strbuf_git_common_path(&path, r, LS_REFS_CACHE_DIR "/");
+	len = path.len;
+	dir = opendir(path.buf);
+	if (dir) {
+		while ((e = readdir_skip_dot_and_dotdot(dir))) {
+			if (starts_with(e->d_name, "tmp_"))
+				continue;
+			if (starts_with(e->d_name, state)) {
+				nr++;
+				continue;
+			}
+			strbuf_addstr(&path, e->d_name);
+			unlink(path.buf);
+			strbuf_setlen(&path, len);
+		}
+		closedir(dir);
+	}
+	strbuf_release(&path);
+	return nr;
+}
+
+/*
+ * Start recording the response. "state" is recomputed, as the response
+ * may only be cached under a state that was taken after the cache file
+ * was created: a ref that changes within the same tick of the filesystem
+ * clock as it was last looked at may not change its stat data, but this
+ * way such a ref must have a timestamp no older than that of the cache
+ * file, and we refuse to cache those.
+ */
+static void ls_refs_cache_start(struct repository *r,
+				struct ls_refs_data *data,
+				struct strbuf *state)
+{
+	struct strbuf path = STRBUF_INIT;
+	struct cache_time newest;
+	struct stat_data sd;
+	struct stat st;
+
+	strbuf_git_common_path(&path, r, LS_REFS_CACHE_DIR "/tmp_XXXXXX");
+	if (safe_create_leading_directories(path.buf) != SCLD_OK)
+		goto out;
+	data->cache = mks_tempfile_m(path.buf, 0444);
+	if (!data->cache)
+		goto out;
+	if (fstat(get_tempfile_fd(data->cache), &st)) {
+		delete_tempfile(&data->cache);
+		goto out;
+	}
+	fill_stat_data(&sd, &st);
+
+	strbuf_reset(state);
+	compute_ref_state(r, state, &newest);
+	if (cache_time_cmp(&newest, &sd.sd_mtime) >= 0 ||
+	    prune_cache(r, state->buf) >= LS_REFS_CACHE_MAX_ENTRIES)
+		delete_tempfile(&data->cache);
+
+out:
+	strbuf_release(&path);
+}
+
+static void ls_refs_cache_finish(struct repository *r,
+				 struct ls_refs_data *data,
+				 const char *state, const char *request)
+{
+	struct strbuf path = STRBUF_INIT;
+
+	cache_flush(data);
+	if (!data->cache)
+		return;
+
+	strbuf_git_common_path(&path, r, LS_REFS_CACHE_DIR "/%s-%s",
+			       state, request);
+	if (adjust_shared_perm(get_tempfile_path(data->cache)) ||
+	    rename_tempfile(&data->cache, path.buf))
+		delete_tempfile(&data->cache);
+	strbuf_release(&path);
+}
+
 int ls_refs(struct repository *r, struct packet_reader *request)
 {
 	struct ls_refs_data data;
+	struct strbuf state = STRBUF_INIT;
+	struct strbuf request_hash = STRBUF_INIT;
 
 	memset(&data, 0, sizeof(data));
 	strvec_init(&data.prefixes);
 	strbuf_init(&data.buf, 0);
 	strvec_init(&data.hidden_refs);
+	strbuf_init(&data.cache_buf, 0);
 
 	git_config(ls_refs_config, &data);
 
@@ -188,6 +496,24 @@ int ls_refs(struct repository *r, struct packet_reader *request)
 	if (data.prefixes.nr >= TOO_MANY_PREFIXES)
 		strvec_clear(&data.prefixes);
 
+	if (data.use_cache && r->ref_storage_format == REF_STORAGE_FORMAT_FILES) {
+		struct strbuf path = STRBUF_INIT;
+		int hit;
+
+		compute_request_hash(&data, &request_hash);
+		compute_ref_state(r, &state, NULL);
+		strbuf_git_common_path(&path, r, LS_REFS_CACHE_DIR "/%s-%s",
+				       state.buf, request_hash.buf);
+		hit = !ls_refs_cache_send(path.buf);
+		strbuf_release(&path);
+		trace2_data_string("ls-refs", r, "cache", hit ? "hit" : "miss");
+		if (hit) {
+			packet_fflush(stdout);
+			goto out;
+		}
+		ls_refs_cache_start(r, &data, &state);
+	}
+
 	send_possibly_unborn_head(&data);
 	if (!data.prefixes.nr)
 		strvec_push(&data.prefixes, "");
@@ -196,9 +522,16 @@ int ls_refs(struct repository *r, struct packet_reader *request)
 					  hidden_refs_to_excludes(&data.hidden_refs),
 					  send_ref, &data);
 	packet_fflush(stdout);
+	if (data.cache)
+		ls_refs_cache_finish(r, &data, state.buf, request_hash.buf);
+
+out:
 	strvec_clear(&data.prefixes);
 	strbuf_release(&data.buf);
 	strvec_clear(&data.hidden_refs);
+	strbuf_release(&data.cache_buf);
+	strbuf_release(&state);
+	strbuf_release(&request_hash);
 	return 0;
 }
 
@@ -28,6 +28,7 @@
 #define MIDX_BYTE_FILE_VERSION 4
 #define MIDX_BYTE_HASH_VERSION 5
 #define MIDX_BYTE_NUM_CHUNKS 6
+#define MIDX_BYTE_NUM_BASES 7
 #define MIDX_BYTE_NUM_PACKS 8
 #define MIDX_HEADER_SIZE 12
 #define MIDX_MIN_SIZE (MIDX_HEADER_SIZE + the_hash_algo->rawsz)
@@ -36,18 +37,41 @@
 #define MIDX_CHUNKID_PACKNAMES 0x504e414d /* "PNAM" */
 #define MIDX_CHUNKID_BITMAPPEDPACKS 0x42544d50 /* "BTMP" */
 #define MIDX_CHUNKID_OIDFANOUT 0x4f494446 /* "OIDF" */
+#define MIDX_CHUNKID_OIDFANOUT16 0x4f463136 /* "OF16" */
 #define MIDX_CHUNKID_OIDLOOKUP 0x4f49444c /* "OIDL" */
 #define MIDX_CHUNKID_OBJECTOFFSETS 0x4f4f4646 /* "OOFF" */
 #define MIDX_CHUNKID_LARGEOFFSETS 0x4c4f4646 /* "LOFF" */
 #define MIDX_CHUNKID_REVINDEX 0x52494458 /* "RIDX" */
+#define MIDX_CHUNKID_BASE 0x42415345 /* "BASE" */
+#define MIDX_CHUNKID_OBJECTFILTER 0x4f42464c /* "OBFL" */
 #define MIDX_CHUNK_FANOUT_SIZE (sizeof(uint32_t) * 256)
+#define MIDX_CHUNK_FANOUT16_SIZE (sizeof(uint32_t) * 65536)
 #define MIDX_CHUNK_OFFSET_WIDTH (2 * sizeof(uint32_t))
 #define MIDX_CHUNK_LARGE_OFFSET_WIDTH (sizeof(uint64_t))
 #define MIDX_CHUNK_BITMAPPED_PACKS_WIDTH (2 * sizeof(uint32_t))
 #define MIDX_LARGE_OFFSET_NEEDED 0x80000000
 
+/*
+ * The object filter is a "blocked" Bloom filter: each object sets
+ * MIDX_OBJECT_FILTER_HASHES bits within a single 512-bit block, so that a
+ * query touches one cache line. Object IDs are already uniformly
+ * distributed, so their bytes are used as the hash values directly: bytes
+ * 4-7 pick the block, and each following pair of bytes a bit within it.
+ * About MIDX_OBJECT_FILTER_BITS bits are spent per object, which gives a
+ * false positive rate of around 1-2%.
+ */
+#define MIDX_OBJECT_FILTER_BLOCK_SIZE 64
+#define MIDX_OBJECT_FILTER_HASHES 6
+#define MIDX_OBJECT_FILTER_BITS 10
+
 #define PACK_EXPIRED UINT_MAX
 
+/*
+ * Below this many objects, the 256-way fanout leaves few enough objects
+ * per bucket that the finer fanout is not worth its 256KiB.
+ */
+#define MIDX_FANOUT16_MIN_OBJECTS (1 << 18)
+
 const unsigned char *get_midx_checksum(struct multi_pack_index *m)
 {
 	return m->data + m->data_len - the_hash_algo->rawsz;
@@ -60,10 +84,33 @@ void get_midx_filename(struct strbuf *out, const char *object_dir)
 
 void get_midx_rev_filename(struct strbuf *out, struct multi_pack_index *m)
 {
+	if (m->has_chain) {
+		get_split_midx_filename_ext(out, m->object_dir,
+					    get_midx_checksum(m), MIDX_EXT_REV);
+		return;
+	}
 	get_midx_filename(out, m->object_dir);
 	strbuf_addf(out, "-%s.rev", hash_to_hex(get_midx_checksum(m)));
 }
 
+void get_midx_chain_dirname(struct strbuf *out, const char *object_dir)
+{
+	strbuf_addf(out, "%s/pack/multi-pack-index.d", object_dir);
+}
+
+void get_midx_chain_filename(struct strbuf *out, const char *object_dir)
+{
+	get_midx_chain_dirname(out, object_dir);
+	strbuf_addstr(out, "/multi-pack-index-chain");
+}
+
+void get_split_midx_filename_ext(struct strbuf *out, const char *object_dir,
+				 const unsigned char *hash, const char *ext)
+{
+	get_midx_chain_dirname(out, object_dir);
+	strbuf_addf(out, "/multi-pack-index-%s.%s", hash_to_hex(hash), ext);
+}
+
 static int midx_read_oid_fanout(const unsigned char *chunk_start,
 				size_t chunk_size, void *data)
 {
@@ -89,6 +136,65 @@ static int midx_read_oid_fanout(const unsigned char *chunk_start,
 	return 0;
 }
 
+static int midx_read_oid_fanout16(const unsigned char *chunk_start,
+				  size_t chunk_size, void *data)
+{
+	struct multi_pack_index *m = data;
+	const uint32_t *fanout16 = (const uint32_t *)chunk_start;
+	int i;
+
+	if (chunk_size != MIDX_CHUNK_FANOUT16_SIZE) {
+		warning(_("multi-pack-index OID fanout16 is of the wrong size; ignoring it"));
+		return -1;
+	}
+	/*
+	 * Only check that the table agrees with the 256-way fanout at the
+	 * end of each of its buckets, as checking the entries in between
+	 * would take a pass over all object IDs. Bogus entries there cannot
+	 * make bsearch_hash_fanout16() look outside of the right 256-way
+	 * bucket, but they can make it miss objects that are present;
+	 * "git multi-pack-index verify" catches those.
+	 */
+	for (i = 0; i < 256; i++) {
+		if (ntohl(fanout16[(i << 8) | 0xff]) !=
+		    ntohl(m->chunk_oid_fanout[i])) {
+			warning(_("multi-pack-index OID fanout16 disagrees with OID fanout at %d; ignoring it"), i);
+			return -1;
+		}
+	}
+
+	m->chunk_oid_fanout16 = fanout16;
+	return 0;
+}
+
+static int midx_read_object_filter(const unsigned char *chunk_start,
+				   size_t chunk_size, void *data)
+{
+	struct multi_pack_index *m = data;
+	size_t blocks;
+
+	if (chunk_size < sizeof(uint32_t) + MIDX_OBJECT_FILTER_BLOCK_SIZE ||
+	    (chunk_size - sizeof(uint32_t)) % MIDX_OBJECT_FILTER_BLOCK_SIZE) {
+		warning(_("multi-pack-index object filter is of the wrong size; ignoring it"));
+		return -1;
+	}
+	if (get_be32(chunk_start) != MIDX_OBJECT_FILTER_HASHES) {
+		warning(_("multi-pack-index object filter uses %"PRIu32" hashes; ignoring it"),
+			get_be32(chunk_start));
+		return -1;
+	}
+
+	blocks = (chunk_size - sizeof(uint32_t)) / MIDX_OBJECT_FILTER_BLOCK_SIZE;
+	if (blocks > UINT32_MAX) {
+		warning(_("multi-pack-index object filter is too large; ignoring it"));
+		return -1;
+	}
+
+	m->chunk_object_filter = chunk_start + sizeof(uint32_t);
+	m->object_filter_blocks = blocks;
+	return 0;
+}
+
 static int midx_read_oid_lookup(const unsigned char *chunk_start,
 				size_t chunk_size, void *data)
 {
@@ -115,7 +221,9 @@ static int midx_read_object_offsets(const unsigned char *chunk_start,
 	return 0;
 }
 
-struct multi_pack_index *load_multi_pack_index(const char *object_dir, int local)
+static struct multi_pack_index *load_multi_pack_index_one(const char *object_dir,
+							  const char *midx_name,
+							  int local)
 {
 	struct multi_pack_index *m = NULL;
 	int fd;
@@ -123,31 +231,26 @@ struct multi_pack_index *load_multi_pack_index(const char *object_dir, int local
 	size_t midx_size;
 	void *midx_map = NULL;
 	uint32_t hash_version;
-	struct strbuf midx_name = STRBUF_INIT;
 	uint32_t i;
 	const char *cur_pack_name;
 	struct chunkfile *cf = NULL;
 
-	get_midx_filename(&midx_name, object_dir);
-
-	fd = git_open(midx_name.buf);
+	fd = git_open(midx_name);
 
 	if (fd < 0)
 		goto cleanup_fail;
 	if (fstat(fd, &st)) {
-		error_errno(_("failed to read %s"), midx_name.buf);
+		error_errno(_("failed to read %s"), midx_name);
 		goto cleanup_fail;
 	}
 
 	midx_size = xsize_t(st.st_size);
 
 	if (midx_size < MIDX_MIN_SIZE) {
-		error(_("multi-pack-index file %s is too small"), midx_name.buf);
+		error(_("multi-pack-index file %s is too small"), midx_name);
 		goto cleanup_fail;
 	}
 
-	strbuf_release(&midx_name);
-
 	midx_map = xmmap(NULL, midx_size, PROT_READ, MAP_PRIVATE, fd, 0);
 	close(fd);
 
@@ -193,6 +296,12 @@ struct multi_pack_index *load_multi_pack_index(const char *object_dir, int local
 		die(_("multi-pack-index required OID fanout chunk missing or corrupted"));
 	if (read_chunk(cf, MIDX_CHUNKID_OIDLOOKUP, midx_read_oid_lookup, m))
 		die(_("multi-pack-index required OID lookup chunk missing or corrupted"));
+	if (git_env_bool("GIT_TEST_MIDX_READ_OBJECT_FILTER", 1))
+		read_chunk(cf, MIDX_CHUNKID_OBJECTFILTER,
+			   midx_read_object_filter, m);
+	if (git_env_bool("GIT_TEST_MIDX_READ_FANOUT16", 1))
+		read_chunk(cf, MIDX_CHUNKID_OIDFANOUT16,
+			   midx_read_oid_fanout16, m);
 	if (read_chunk(cf, MIDX_CHUNKID_OBJECTOFFSETS, midx_read_object_offsets, m))
 		die(_("multi-pack-index required object offsets chunk missing or corrupted"));
 
@@ -202,6 +311,9 @@ struct multi_pack_index *load_multi_pack_index(const char *object_dir, int local
 		   (const unsigned char **)&m->chunk_bitmapped_packs,
 		   &m->chunk_bitmapped_packs_len);
 
+	pair_chunk(cf, MIDX_CHUNKID_BASE, &m->chunk_base_midxs,
+		   &m->chunk_base_midxs_len);
+
 	if (git_env_bool("GIT_TEST_MIDX_READ_RIDX", 1))
 		pair_chunk(cf, MIDX_CHUNKID_REVINDEX, &m->chunk_revindex,
 			   &m->chunk_revindex_len);
@@ -236,7 +348,6 @@ struct multi_pack_index *load_multi_pack_index(const char *object_dir, int local
 
 cleanup_fail:
 	free(m);
-	strbuf_release(&midx_name);
 	free_chunkfile(cf);
 	if (midx_map)
 		munmap(midx_map, midx_size);
@@ -245,6 +356,123 @@ struct multi_pack_index *load_multi_pack_index(const char *object_dir, int local
 	return NULL;
 }
 
+static int add_midx_to_chain(struct multi_pack_index *midx,
+			     struct multi_pack_index *midx_chain,
+			     struct object_id *oids, int n)
+{
+	struct multi_pack_index *cur = midx_chain;
+
+	if (!hasheq(oids[n].hash, get_midx_checksum(midx))) {
+		warning(_("multi-pack-index checksum does not match its name"));
+		return 0;
+	}
+
+	if (midx->chunk_base_midxs_len != st_mult(midx->hash_len, n)) {
+		warning(_("multi-pack-index base chunk is the wrong size"));
+		return 0;
+	}
+
+	while (n) {
+		n--;
+
+		if (!cur ||
+		    !hasheq(oids[n].hash, get_midx_checksum(cur)) ||
+		    !hasheq(oids[n].hash,
+			    midx->chunk_base_midxs + st_mult(midx->hash_len, n))) {
+			warning(_("multi-pack-index chain does not match"));
+			return 0;
+		}
+
+		cur = cur->base_midx;
+	}
+
+	if (midx_chain) {
+		if (unsigned_add_overflows(midx_chain->num_objects,
+					   midx_chain->num_objects_in_base) ||
+		    unsigned_add_overflows(midx_chain->num_packs,
+					   midx_chain->num_packs_in_base)) {
+			warning(_("multi-pack-index chain is too large"));
+			return 0;
+		}
+		midx->num_objects_in_base = midx_chain->num_objects +
+			midx_chain->num_objects_in_base;
+		midx->num_packs_in_base = midx_chain->num_packs +
+			midx_chain->num_packs_in_base;
+	}
+
+	midx->base_midx = midx_chain;
+	midx->has_chain = 1;
+
+	return 1;
+}
+
+static struct multi_pack_index *load_multi_pack_index_chain(const char *object_dir,
+							    int local)
+{
+	struct multi_pack_index *midx_chain = NULL;
+	struct strbuf chain_name = STRBUF_INIT;
+	struct strbuf line = STRBUF_INIT;
+	struct object_id *oids = NULL;
+	size_t nr = 0, alloc = 0;
+	FILE *fp;
+
+	get_midx_chain_filename(&chain_name, object_dir);
+	fp = fopen_or_warn(chain_name.buf, "r");
+	if (!fp)
+		goto out;
+
+	while (strbuf_getline_lf(&line, fp) != EOF) {
+		struct strbuf midx_name = STRBUF_INIT;
+		struct multi_pack_index *m;
+
+		ALLOC_GROW(oids, nr + 1, alloc);
+		if (get_oid_hex(line.buf, &oids[nr])) {
+			warning(_("invalid multi-pack-index chain: line '%s' not a hash"),
+				line.buf);
+			break;
+		}
+
+		get_split_midx_filename_ext(&midx_name, object_dir,
+					    oids[nr].hash, MIDX_EXT_MIDX);
+		m = load_multi_pack_index_one(object_dir, midx_name.buf, local);
+		strbuf_release(&midx_name);
+
+		if (!m) {
+			warning(_("unable to find all multi-pack-index files"));
+			break;
+		}
+		if (!add_midx_to_chain(m, midx_chain, oids, nr)) {
+			close_midx(m);
+			break;
+		}
+
+		midx_chain = m;
+		nr++;
+	}
+
+	fclose(fp);
+out:
+	free(oids);
+	strbuf_release(&line);
+	strbuf_release(&chain_name);
+	return midx_chain;
+}
+
+struct multi_pack_index *load_multi_pack_index(const char *object_dir, int local)
+{
+	struct strbuf midx_name = STRBUF_INIT;
+	struct multi_pack_index *m;
+
+	get_midx_filename(&midx_name, object_dir);
+	m = load_multi_pack_index_one(object_dir, midx_name.buf, local);
+	strbuf_release(&midx_name);
+
+	if (!m)
+		m = load_multi_pack_index_chain(object_dir, local);
+
+	return m;
+}
+
 void close_midx(struct multi_pack_index *m)
 {
 	uint32_t i;
@@ -253,6 +481,7 @@ void close_midx(struct multi_pack_index *m)
 		return;
 
 	close_midx(m->next);
+	close_midx(m->base_midx);
 
 	munmap((unsigned char *)m->data, m->data_len);
 
@@ -265,14 +494,55 @@ void close_midx(struct multi_pack_index *m)
 	free(m);
 }
 
+/*
+ * Find the layer of the chain "*_m" holding the pack with the given
+ * (chain-wide) pack-int-id, and return its position within that layer.
+ */
+static uint32_t midx_for_pack(struct multi_pack_index **_m,
+			      uint32_t pack_int_id)
+{
+	struct multi_pack_index *m = *_m;
+
+	while (m && pack_int_id < m->num_packs_in_base)
+		m = m->base_midx;
+
+	if (!m)
+		BUG("NULL multi-pack-index for pack ID: %"PRIu32, pack_int_id);
+
+	if (pack_int_id >= m->num_packs + m->num_packs_in_base)
+		die(_("bad pack-int-id: %u (%u total packs)"),
+		    pack_int_id, m->num_packs + m->num_packs_in_base);
+
+	*_m = m;
+
+	return pack_int_id - m->num_packs_in_base;
+}
+
+/* Likewise, for a (chain-wide) object position. */
+static uint32_t midx_for_object(struct multi_pack_index **_m, uint32_t pos)
+{
+	struct multi_pack_index *m = *_m;
+
+	while (m && pos < m->num_objects_in_base)
+		m = m->base_midx;
+
+	if (!m)
+		BUG("NULL multi-pack-index for object position: %"PRIu32, pos);
+
+	if (pos >= m->num_objects + m->num_objects_in_base)
+		die(_("invalid MIDX object position, MIDX is likely corrupt"));
+
+	*_m = m;
+
+	return pos - m->num_objects_in_base;
+}
+
 int prepare_midx_pack(struct repository *r, struct multi_pack_index *m, uint32_t pack_int_id)
 {
 	struct strbuf pack_name = STRBUF_INIT;
 	struct packed_git *p;
 
-	if (pack_int_id >= m->num_packs)
-		die(_("bad pack-int-id: %u (%u total packs)"),
-		    pack_int_id, m->num_packs);
+	pack_int_id = midx_for_pack(&m, pack_int_id);
 
 	if (m->packs[pack_int_id])
 		return 0;
@@ -294,39 +564,106 @@ int prepare_midx_pack(struct repository *r, struct multi_pack_index *m, uint32_t
 	return 0;
 }
 
+struct packed_git *nth_midxed_pack(struct multi_pack_index *m,
+				   uint32_t pack_int_id)
+{
+	uint32_t local_pack_int_id = midx_for_pack(&m, pack_int_id);
+	return m->packs[local_pack_int_id];
+}
+
 int nth_bitmapped_pack(struct repository *r, struct multi_pack_index *m,
 		       struct bitmapped_pack *bp, uint32_t pack_int_id)
 {
-	if (!m->chunk_bitmapped_packs)
+	struct multi_pack_index *layer = m;
+	uint32_t local_pack_int_id = midx_for_pack(&layer, pack_int_id);
+
+	if (!layer->chunk_bitmapped_packs)
 		return error(_("MIDX does not contain the BTMP chunk"));
 
 	if (prepare_midx_pack(r, m, pack_int_id))
 		return error(_("could not load bitmapped pack %"PRIu32), pack_int_id);
 
-	bp->p = m->packs[pack_int_id];
-	bp->bitmap_pos = get_be32((char *)m->chunk_bitmapped_packs +
-				  MIDX_CHUNK_BITMAPPED_PACKS_WIDTH * pack_int_id);
-	bp->bitmap_nr = get_be32((char *)m->chunk_bitmapped_packs +
-				 MIDX_CHUNK_BITMAPPED_PACKS_WIDTH * pack_int_id +
+	bp->p = layer->packs[local_pack_int_id];
+	bp->bitmap_pos = get_be32((char *)layer->chunk_bitmapped_packs +
+				  MIDX_CHUNK_BITMAPPED_PACKS_WIDTH * local_pack_int_id) +
+		layer->num_objects_in_base;
+	bp->bitmap_nr = get_be32((char *)layer->chunk_bitmapped_packs +
+				 MIDX_CHUNK_BITMAPPED_PACKS_WIDTH * local_pack_int_id +
 				 sizeof(uint32_t));
 	bp->pack_int_id = pack_int_id;
 
 	return 0;
 }
 
-int bsearch_midx(const struct object_id *oid, struct multi_pack_index *m, uint32_t *result)
+int bsearch_one_midx(const struct object_id *oid, struct multi_pack_index *m,
+		     uint32_t *result)
 {
+	if (m->chunk_oid_fanout16)
+		return bsearch_hash_fanout16(oid->hash, m->chunk_oid_fanout,
+					     m->chunk_oid_fanout16,
+					     m->chunk_oid_lookup,
+					     the_hash_algo->rawsz, result);
 	return bsearch_hash(oid->hash, m->chunk_oid_fanout, m->chunk_oid_lookup,
 			    the_hash_algo->rawsz, result);
 }
 
+static uint32_t object_filter_block(const unsigned char *hash,
+				    uint32_t nr_blocks)
+{
+	return ((uint64_t)get_be32(hash + 4) * nr_blocks) >> 32;
+}
+
+static unsigned object_filter_bit(const unsigned char *hash, int i)
+{
+	return get_be16(hash + 8 + 2 * i) % (MIDX_OBJECT_FILTER_BLOCK_SIZE * 8);
+}
+
+/*
+ * Returns 0 if "oid" is definitely not in "m" (not counting its base
+ * layers), and 1 if it might be.
+ */
+static int midx_may_contain(const struct object_id *oid,
+			    struct multi_pack_index *m)
+{
+	const unsigned char *block;
+	int i;
+
+	if (!m->chunk_object_filter)
+		return 1;
+
+	block = m->chunk_object_filter + MIDX_OBJECT_FILTER_BLOCK_SIZE *
+		(size_t)object_filter_block(oid->hash, m->object_filter_blocks);
+	for (i = 0; i < MIDX_OBJECT_FILTER_HASHES; i++) {
+		unsigned bit = object_filter_bit(oid->hash, i);
+
+		if (!(block[bit / 8] & (1 << (bit % 8))))
+			return 0;
+	}
+	return 1;
+}
+
+int bsearch_midx(const struct object_id *oid, struct multi_pack_index *m, uint32_t *result)
+{
+	for (; m; m = m->base_midx) {
+		if (midx_may_contain(oid, m) &&
+		    bsearch_one_midx(oid, m, result)) {
+			if (result)
+				*result += m->num_objects_in_base;
+			return 1;
+		}
+	}
+	return 0;
+}
+
 struct object_id *nth_midxed_object_oid(struct object_id *oid,
 					struct multi_pack_index *m,
 					uint32_t n)
 {
-	if (n >= m->num_objects)
+	if (n >= m->num_objects + m->num_objects_in_base)
 		return NULL;
 
+	n = midx_for_object(&m, n);
+
 	oidread(oid, m->chunk_oid_lookup + st_mult(m->hash_len, n));
 	return oid;
 }
@@ -336,6 +673,8 @@ off_t nth_midxed_offset(struct multi_pack_index *m, uint32_t pos)
 	const unsigned char *offset_data;
 	uint32_t offset32;
 
+	pos = midx_for_object(&m, pos);
+
 	offset_data = m->chunk_object_offsets + (off_t)pos * MIDX_CHUNK_OFFSET_WIDTH;
 	offset32 = get_be32(offset_data + sizeof(uint32_t));
 
@@ -354,8 +693,10 @@ off_t nth_midxed_offset(struct multi_pack_index *m, uint32_t pos)
 
 uint32_t nth_midxed_pack_int_id(struct multi_pack_index *m, uint32_t pos)
 {
-	return get_be32(m->chunk_object_offsets +
-			(off_t)pos * MIDX_CHUNK_OFFSET_WIDTH);
+	pos = midx_for_object(&m, pos);
+
+	return m->num_packs_in_base + get_be32(m->chunk_object_offsets +
+					       (off_t)pos * MIDX_CHUNK_OFFSET_WIDTH);
 }
 
 int fill_midx_entry(struct repository *r,
@@ -370,14 +711,14 @@ int fill_midx_entry(struct repository *r,
 	if (!bsearch_midx(oid, m, &pos))
 		return 0;
 
-	if (pos >= m->num_objects)
+	if (pos >= m->num_objects + m->num_objects_in_base)
 		return 0;
 
 	pack_int_id = nth_midxed_pack_int_id(m, pos);
 
 	if (prepare_midx_pack(r, m, pack_int_id))
 		return 0;
-	p = m->packs[pack_int_id];
+	p = nth_midxed_pack(m, pack_int_id);
 
 	/*
 	* We are about to tell the caller where they can locate the
@@ -431,8 +772,9 @@ static int cmp_idx_or_pack_name(const char *idx_or_pack_name,
 	return strcmp(idx_or_pack_name, idx_name);
 }
 
-int midx_locate_pack(struct multi_pack_index *m, const char *idx_or_pack_name,
-		     uint32_t *pos)
+static int midx_locate_pack_one(struct multi_pack_index *m,
+				const char *idx_or_pack_name,
+				uint32_t *pos)
 {
 	uint32_t first = 0, last = m->num_packs;
 
@@ -458,6 +800,19 @@ int midx_locate_pack(struct multi_pack_index *m, const char *idx_or_pack_name,
 	return 0;
 }
 
+int midx_locate_pack(struct multi_pack_index *m, const char *idx_or_pack_name,
+		     uint32_t *pos)
+{
+	for (; m; m = m->base_midx) {
+		if (midx_locate_pack_one(m, idx_or_pack_name, pos)) {
+			if (pos)
+				*pos += m->num_packs_in_base;
+			return 1;
+		}
+	}
+	return 0;
+}
+
 int midx_contains_pack(struct multi_pack_index *m, const char *idx_or_pack_name)
 {
 	return midx_locate_pack(m, idx_or_pack_name, NULL);
@@ -471,8 +826,13 @@ int midx_preferred_pack(struct multi_pack_index *m, uint32_t *pack_int_id)
 			return -1;
 		}
 
+		/*
+		 * Each layer of an incremental MIDX chain has its own
+		 * preferred pack, whose objects come first among that
+		 * layer's objects in pseudo-pack order.
+		 */
 		m->preferred_pack_idx =
-			nth_midxed_pack_int_id(m, pack_pos_to_midx(m, 0));
+			nth_midxed_pack_int_id(m, pack_pos_to_midx(m, m->num_objects_in_base));
 	} else if (m->preferred_pack_idx == -2)
 		return -1; /* no revindex */
 
@@ -510,13 +870,14 @@ int prepare_multi_pack_index_one(struct repository *r, const char *object_dir, i
 
 static size_t write_midx_header(struct hashfile *f,
 				unsigned char num_chunks,
+				unsigned char num_bases,
 				uint32_t num_packs)
 {
 	hashwrite_be32(f, MIDX_SIGNATURE);
 	hashwrite_u8(f, MIDX_VERSION);
 	hashwrite_u8(f, oid_version(the_hash_algo));
 	hashwrite_u8(f, num_chunks);
-	hashwrite_u8(f, 0); /* unused */
+	hashwrite_u8(f, num_bases);
 	hashwrite_be32(f, num_packs);
 
 	return MIDX_HEADER_SIZE;
@@ -580,14 +941,47 @@ struct write_midx_context {
 
 	int preferred_pack_idx;
 
+	/*
+	 * When writing an incremental MIDX, the layers of the existing
+	 * chain that the new layer is written on top of.
+	 */
+	struct multi_pack_index *base_midx;
+	uint32_t num_bases;
+
 	struct string_list *to_include;
 };
 
+static void add_pack_to_midx_1(struct write_midx_context *ctx,
+			       const char *full_path, size_t full_path_len,
+			       const char *file_name)
+{
+	struct packed_git *p;
+
+	ALLOC_GROW(ctx->info, ctx->nr + 1, ctx->alloc);
+
+	p = add_packed_git(full_path, full_path_len, 0);
+	if (!p) {
+		warning(_("failed to add packfile '%s'"),
+			full_path);
+		return;
+	}
+
+	if (open_pack_index(p)) {
+		warning(_("failed to open pack-index '%s'"),
+			full_path);
+		close_pack(p);
+		free(p);
+		return;
+	}
+
+	fill_pack_info(&ctx->info[ctx->nr], p, file_name, ctx->nr);
+	ctx->nr++;
+}
+
 static void add_pack_to_midx(const char *full_path, size_t full_path_len,
 			     const char *file_name, void *data)
 {
 	struct write_midx_context *ctx = data;
-	struct packed_git *p;
 
 	if (ends_with(file_name, ".idx")) {
 		display_progress(ctx->progress, ++ctx->pack_paths_checked);
@@ -608,30 +1002,41 @@ static void add_pack_to_midx(const char *full_path, size_t full_path_len,
 		 */
 		if (ctx->m && midx_contains_pack(ctx->m, file_name))
 			return;
+		else if (ctx->base_midx &&
+			 midx_contains_pack(ctx->base_midx, file_name))
+			return;
 		else if (ctx->to_include &&
 			 !string_list_has_string(ctx->to_include, file_name))
 			return;
 
-		ALLOC_GROW(ctx->info, ctx->nr + 1, ctx->alloc);
+		add_pack_to_midx_1(ctx, full_path, full_path_len, file_name);
+	}
+}
 
-		p = add_packed_git(full_path, full_path_len, 0);
-		if (!p) {
-			warning(_("failed to add packfile '%s'"),
-				full_path);
-			return;
-		}
+/*
+ * Add the packs of the top-most layer of "ctx->base_midx" to the new
+ * layer, and drop that layer from the base.
+ */
+static void absorb_base_midx(struct write_midx_context *ctx)
+{
+	struct multi_pack_index *m = ctx->base_midx;
+	struct strbuf pack_name = STRBUF_INIT;
+	size_t base_len;
+	uint32_t i;
 
-		if (open_pack_index(p)) {
-			warning(_("failed to open pack-index '%s'"),
-				full_path);
-			close_pack(p);
-			free(p);
-			return;
-		}
+	strbuf_addf(&pack_name, "%s/pack/", m->object_dir);
+	base_len = pack_name.len;
 
-		fill_pack_info(&ctx->info[ctx->nr], p, file_name, ctx->nr);
-		ctx->nr++;
+	for (i = 0; i < m->num_packs; i++) {
+		strbuf_setlen(&pack_name, base_len);
+		strbuf_addstr(&pack_name, m->pack_names[i]);
+		add_pack_to_midx_1(ctx, pack_name.buf, pack_name.len,
+				   m->pack_names[i]);
 	}
+
+	strbuf_release(&pack_name);
+
+	ctx->base_midx = m->base_midx;
 }
 
 struct pack_midx_entry {
@@ -852,6 +1257,24 @@ static struct pack_midx_entry *get_sorted_entries(struct multi_pack_index *m,
 	return deduplicated_entries;
 }
 
+static int write_midx_base_midxs(struct hashfile *f, void *data)
+{
+	struct write_midx_context *ctx = data;
+	uint32_t i, j;
+
+	/* Layers are listed base-most first, as in the chain file. */
+	for (i = 0; i < ctx->num_bases; i++) {
+		struct multi_pack_index *m = ctx->base_midx;
+
+		for (j = i + 1; j < ctx->num_bases; j++)
+			m = m->base_midx;
+
+		hashwrite(f, get_midx_checksum(m), the_hash_algo->rawsz);
+	}
+
+	return 0;
+}
+
 static int write_midx_pack_names(struct hashfile *f, void *data)
 {
 	struct write_midx_context *ctx = data;
@@ -934,6 +1357,73 @@ static int write_midx_oid_fanout(struct hashfile *f,
 	return 0;
 }
 
+static int write_midx_oid_fanout16(struct hashfile *f,
+				   void *data)
+{
+	struct write_midx_context *ctx = data;
+	struct pack_midx_entry *list = ctx->entries;
+	struct pack_midx_entry *last = ctx->entries + ctx->entries_nr;
+	uint32_t count = 0;
+	uint32_t i;
+
+	/*
+	 * Like the first-level table, but keyed on the first two bytes,
+	 * which saves another eight binary search iterations (and with
+	 * them, most of the cache misses) in large indexes.
+	 */
+	for (i = 0; i < 65536; i++) {
+		struct pack_midx_entry *next = list;
+
+		while (next < last &&
+		       ((next->oid.hash[0] << 8) | next->oid.hash[1]) == i) {
+			count++;
+			next++;
+		}
+
+		hashwrite_be32(f, count);
+		list = next;
+	}
+
+	return 0;
+}
+
+static size_t midx_object_filter_blocks(size_t nr)
+{
+	size_t bits = st_mult(nr, MIDX_OBJECT_FILTER_BITS);
+
+	return DIV_ROUND_UP(bits, MIDX_OBJECT_FILTER_BLOCK_SIZE * 8);
+}
+
+static int write_midx_object_filter(struct hashfile *f,
+				    void *data)
+{
+	struct write_midx_context *ctx = data;
+	size_t nr_blocks = midx_object_filter_blocks(ctx->entries_nr);
+	unsigned char *filter;
+	size_t i;
+	int j;
+
+	if (nr_blocks > UINT32_MAX)
+		BUG("too many blocks for a multi-pack-index object filter");
+
+	filter = xcalloc(nr_blocks, MIDX_OBJECT_FILTER_BLOCK_SIZE);
+	for (i = 0; i < ctx->entries_nr; i++) {
+		const unsigned char *hash = ctx->entries[i].oid.hash;
+		unsigned char *block = filter + MIDX_OBJECT_FILTER_BLOCK_SIZE *
+			(size_t)object_filter_block(hash, nr_blocks);
+
+		for (j = 0; j < MIDX_OBJECT_FILTER_HASHES; j++) {
+			unsigned bit = object_filter_bit(hash, j);
+			block[bit / 8] |= 1 << (bit % 8);
+		}
+	}
+
+	hashwrite_be32(f, MIDX_OBJECT_FILTER_HASHES);
+	hashwrite(f, filter, st_mult(nr_blocks, MIDX_OBJECT_FILTER_BLOCK_SIZE));
+	free(filter);
+	return 0;
+}
+
 static int write_midx_oid_lookup(struct hashfile *f,
 				 void *data)
 {
@@ -1121,6 +1611,15 @@ static int midx_checksum_valid(struct multi_pack_index *m)
 	return hashfile_checksum_valid(m->data, m->data_len);
 }
 
+static int midx_has_bitmap(struct multi_pack_index *m)
+{
+	struct bitmap_index *bitmap_git = prepare_midx_bitmap_git(m);
+	int ret = !!bitmap_git;
+
+	free_bitmap_index(bitmap_git);
+	return ret;
+}
+
 static void prepare_midx_packing_data(struct packing_data *pdata,
 				      struct write_midx_context *ctx)
 {
@@ -1280,22 +1779,29 @@ static struct commit **find_commits_for_midx_bitmap(uint32_t *indexed_commits_nr
 	return cb.commits;
 }
 
-static int write_midx_bitmap(const char *midx_name,
+static int write_midx_bitmap(struct write_midx_context *ctx,
+			     const char *object_dir,
 			     const unsigned char *midx_hash,
 			     struct packing_data *pdata,
 			     struct commit **commits,
 			     uint32_t commits_nr,
-			     uint32_t *pack_order,
 			     unsigned flags)
 {
 	int ret, i;
 	uint16_t options = 0;
 	struct pack_idx_entry **index;
-	char *bitmap_name = xstrfmt("%s-%s.bitmap", midx_name,
-					hash_to_hex(midx_hash));
+	struct strbuf bitmap_name = STRBUF_INIT;
 
 	trace2_region_enter("midx", "write_midx_bitmap", the_repository);
 
+	if (flags & MIDX_WRITE_INCREMENTAL) {
+		get_split_midx_filename_ext(&bitmap_name, object_dir, midx_hash,
+					    MIDX_EXT_BITMAP);
+	} else {
+		get_midx_filename(&bitmap_name, object_dir);
+		strbuf_addf(&bitmap_name, "-%s.bitmap", hash_to_hex(midx_hash));
+	}
+
 	if (flags & MIDX_WRITE_BITMAP_HASH_CACHE)
 		options |= BITMAP_OPT_HASH_CACHE;
 
@@ -1312,6 +1818,7 @@ static int write_midx_bitmap(const char *midx_name,
 		index[i] = &pdata->objects[i].idx;
 
 	bitmap_writer_show_progress(flags & MIDX_PROGRESS);
+	bitmap_writer_set_midx_base(ctx->base_midx);
 	bitmap_writer_build_type_index(pdata, index, pdata->nr_objects);
 
 	/*
@@ -1328,7 +1835,7 @@ static int write_midx_bitmap(const char *midx_name,
 	 * bitmap_writer_finish().
 	 */
 	for (i = 0; i < pdata->nr_objects; i++)
-		index[pack_order[i]] = &pdata->objects[i].idx;
+		index[ctx->pack_order[i]] = &pdata->objects[i].idx;
 
 	bitmap_writer_select_commits(commits, commits_nr, -1);
 	ret = bitmap_writer_build(pdata);
@@ -1336,11 +1843,11 @@ static int write_midx_bitmap(const char *midx_name,
 		goto cleanup;
 
 	bitmap_writer_set_checksum(midx_hash);
-	bitmap_writer_finish(index, pdata->nr_objects, bitmap_name, options);
+	bitmap_writer_finish(index, pdata->nr_objects, bitmap_name.buf, options);
 
 cleanup:
 	free(index);
-	free(bitmap_name);
+	strbuf_release(&bitmap_name);
 
 	trace2_region_leave("midx", "write_midx_bitmap", the_repository);
 
@@ -1372,6 +1879,71 @@ static struct multi_pack_index *lookup_multi_pack_index(struct repository *r,
 	return result;
 }
 
+/*
+ * Remove the files in the incremental MIDX directory that do not belong
+ * to one of the layers whose (hex) checksums are listed in "keep". When
+ * "keep" is NULL, remove the chain file and the directory, too.
+ */
+static void clear_incremental_midx_files(const char *object_dir,
+					 struct string_list *keep)
+{
+	struct strbuf path = STRBUF_INIT;
+	DIR *dir;
+	struct dirent *de;
+	size_t dirnamelen;
+
+	if (!keep) {
+		get_midx_chain_filename(&path, object_dir);
+		unlink_or_warn(path.buf);
+		strbuf_reset(&path);
+	}
+
+	get_midx_chain_dirname(&path, object_dir);
+	dir = opendir(path.buf);
+	if (!dir)
+		goto out;
+
+	strbuf_addch(&path, '/');
+	dirnamelen = path.len;
+	while ((de = readdir(dir)) != NULL) {
+		const char *hex;
+		size_t hex_len;
+
+		if (!skip_prefix(de->d_name, "multi-pack-index-", &hex) ||
+		    !strcmp(hex, "chain"))
+			continue;
+
+		if (keep) {
+			struct string_list_item *item;
+			int found = 0;
+
+			hex_len = strcspn(hex, ".");
+			for_each_string_list_item(item, keep) {
+				if (strlen(item->string) == hex_len &&
+				    !strncmp(item->string, hex, hex_len)) {
+					found = 1;
+					break;
+				}
+			}
+			if (found)
+				continue;
+		}
+
+		strbuf_setlen(&path, dirnamelen);
+		strbuf_addstr(&path, de->d_name);
+		unlink_or_warn(path.buf);
+	}
+	closedir(dir);
+
+	if (!keep) {
+		strbuf_setlen(&path, dirnamelen - 1);
+		rmdir(path.buf);
+	}
+
+out:
+	strbuf_release(&path);
+}
+
 static int write_midx_internal(const char *object_dir,
 			       struct string_list *packs_to_include,
 			       struct string_list *packs_to_drop,
@@ -1389,11 +1961,25 @@ static int write_midx_internal(const char *object_dir,
 	int pack_name_concat_len = 0;
 	int dropped_packs = 0;
 	int result = 0;
+	int incremental = !!(flags & MIDX_WRITE_INCREMENTAL);
+	int write_object_filter = 0;
+	struct multi_pack_index *existing = NULL;
+	struct tempfile *incr = NULL;
 	struct chunkfile *cf;
 
 	trace2_region_enter("midx", "write_midx_internal", the_repository);
 
-	get_midx_filename(&midx_name, object_dir);
+	repo_config_get_bool(the_repository, "pack.writemidxobjectfilter",
+			     &write_object_filter);
+
+	if (incremental) {
+		if (packs_to_include || packs_to_drop)
+			BUG("cannot select packs for an incremental multi-pack-index");
+
+		get_midx_chain_filename(&midx_name, object_dir);
+	} else {
+		get_midx_filename(&midx_name, object_dir);
+	}
 	if (safe_create_leading_directories(midx_name.buf))
 		die_errno(_("unable to create leading directories of %s"),
 			  midx_name.buf);
@@ -1404,12 +1990,32 @@ static int write_midx_internal(const char *object_dir,
 		 * packs to include, since all packs and objects are copied
 		 * blindly from an existing MIDX if one is present.
 		 */
-		ctx.m = lookup_multi_pack_index(the_repository, object_dir);
+		existing = lookup_multi_pack_index(the_repository, object_dir);
 	}
 
-	if (ctx.m && !midx_checksum_valid(ctx.m)) {
-		warning(_("ignoring existing multi-pack-index; checksum mismatch"));
-		ctx.m = NULL;
+	if (incremental) {
+		struct multi_pack_index *m;
+
+		/*
+		 * Start out on top of the whole existing chain; some of
+		 * its layers may be merged into the new one below.
+		 */
+		ctx.base_midx = existing;
+
+		for (m = existing; m; m = m->base_midx) {
+			if (!midx_checksum_valid(m)) {
+				warning(_("ignoring existing multi-pack-index; checksum mismatch"));
+				ctx.base_midx = NULL;
+				break;
+			}
+		}
+	} else if (existing && !existing->has_chain) {
+		ctx.m = existing;
+
+		if (!midx_checksum_valid(ctx.m)) {
+			warning(_("ignoring existing multi-pack-index; checksum mismatch"));
+			ctx.m = NULL;
+		}
 	}
 
 	ctx.nr = 0;
@@ -1454,6 +2060,45 @@ static int write_midx_internal(const char *object_dir,
 	for_each_file_in_pack_dir(object_dir, add_pack_to_midx, &ctx);
 	stop_progress(&ctx.progress);
 
+	if (incremental) {
+		struct multi_pack_index *m;
+		uint64_t new_objects = 0;
+
+		if (!ctx.nr)
+			goto cleanup; /* nothing new to add */
+
+		for (i = 0; i < ctx.nr; i++)
+			new_objects += ctx.info[i].p->num_objects;
+
+		/*
+		 * Merge the new packs with the layers at the top of the
+		 * chain until each layer has more than twice as many objects
+		 * as the one above it, so that the chain stays short. A
+		 * non-incremental MIDX cannot be part of a chain and is
+		 * always merged into the new layer.
+		 *
+		 * The bitmap of a layer builds on the bitmaps of the layers
+		 * below it, so when writing one, also merge any layers that
+		 * do not have a bitmap (or sit on top of one that does not).
+		 */
+		while (ctx.base_midx &&
+		       (!ctx.base_midx->has_chain ||
+			ctx.base_midx->num_objects <= 2 * new_objects ||
+			((flags & MIDX_WRITE_BITMAP) &&
+			 !midx_has_bitmap(ctx.base_midx)))) {
+			new_objects += ctx.base_midx->num_objects;
+			absorb_base_midx(&ctx);
+		}
+
+		for (m = ctx.base_midx; m; m = m->base_midx)
+			ctx.num_bases++;
+		if (ctx.num_bases > UINT8_MAX) {
+			error(_("too many layers in the multi-pack-index chain"));
+			result = 1;
+			goto cleanup;
+		}
+	}
+
 	if ((ctx.m && ctx.nr == ctx.m->num_packs) &&
 	    !(packs_to_include || packs_to_drop)) {
 		struct bitmap_index *bitmap_git;
@@ -1543,6 +2188,18 @@ static int write_midx_internal(const char *object_dir,
 	ctx.entries = get_sorted_entries(ctx.m, ctx.info, ctx.nr, &ctx.entries_nr,
 					 ctx.preferred_pack_idx);
 
+	if (ctx.base_midx) {
+		size_t nr = 0;
+
+		/* Objects already in the base layers stay there. */
+		for (i = 0; i < ctx.entries_nr; i++) {
+			if (bsearch_midx(&ctx.entries[i].oid, ctx.base_midx, NULL))
+				continue;
+			ctx.entries[nr++] = ctx.entries[i];
+		}
+		ctx.entries_nr = nr;
+	}
+
 	ctx.large_offsets_needed = 0;
 	for (i = 0; i < ctx.entries_nr; i++) {
 		if (ctx.entries[i].offset > 0x7fffffff)
@@ -1623,7 +2280,27 @@ static int write_midx_internal(const char *object_dir,
 					(pack_name_concat_len % MIDX_CHUNK_ALIGNMENT);
 
 	hold_lock_file_for_update(&lk, midx_name.buf, LOCK_DIE_ON_ERROR);
-	f = hashfd(get_lock_file_fd(&lk), get_lock_file_path(&lk));
+
+	if (incremental) {
+		struct strbuf tmp = STRBUF_INIT;
+
+		get_midx_chain_dirname(&tmp, object_dir);
+		strbuf_addstr(&tmp, "/tmp_midx_XXXXXX");
+
+		incr = mks_tempfile_m(tmp.buf, 0444);
+		if (!incr) {
+			error_errno(_("unable to create temporary MIDX layer"));
+			result = 1;
+			strbuf_release(&tmp);
+			rollback_lock_file(&lk);
+			goto cleanup;
+		}
+		strbuf_release(&tmp);
+
+		f = hashfd(get_tempfile_fd(incr), get_tempfile_path(incr));
+	} else {
+		f = hashfd(get_lock_file_fd(&lk), get_lock_file_path(&lk));
+	}
 
 	if (ctx.nr - dropped_packs == 0) {
 		error(_("no pack files to index."));
@@ -1643,6 +2320,10 @@ static int write_midx_internal(const char *object_dir,
 		  write_midx_pack_names);
 	add_chunk(cf, MIDX_CHUNKID_OIDFANOUT, MIDX_CHUNK_FANOUT_SIZE,
 		  write_midx_oid_fanout);
+	if (ctx.entries_nr >= MIDX_FANOUT16_MIN_OBJECTS ||
+	    git_env_bool("GIT_TEST_MIDX_WRITE_FANOUT16", 0))
+		add_chunk(cf, MIDX_CHUNKID_OIDFANOUT16, MIDX_CHUNK_FANOUT16_SIZE,
+			  write_midx_oid_fanout16);
 	add_chunk(cf, MIDX_CHUNKID_OIDLOOKUP,
 		  st_mult(ctx.entries_nr, the_hash_algo->rawsz),
 		  write_midx_oid_lookup);
@@ -1666,14 +2347,27 @@ static int write_midx_internal(const char *object_dir,
 			  write_midx_bitmapped_packs);
 	}
 
-	write_midx_header(f, get_num_chunks(cf), ctx.nr - dropped_packs);
+	if (ctx.entries_nr && write_object_filter)
+		add_chunk(cf, MIDX_CHUNKID_OBJECTFILTER,
+			  st_add(sizeof(uint32_t),
+				 st_mult(midx_object_filter_blocks(ctx.entries_nr),
+					 MIDX_OBJECT_FILTER_BLOCK_SIZE)),
+			  write_midx_object_filter);
+
+	if (ctx.num_bases)
+		add_chunk(cf, MIDX_CHUNKID_BASE,
+			  st_mult(ctx.num_bases, the_hash_algo->rawsz),
+			  write_midx_base_midxs);
+
+	write_midx_header(f, get_num_chunks(cf), ctx.num_bases,
+			  ctx.nr - dropped_packs);
 	write_chunkfile(cf, &ctx);
 
 	finalize_hashfile(f, midx_hash, FSYNC_COMPONENT_PACK_METADATA,
 			  CSUM_FSYNC | CSUM_HASH_IN_STREAM);
 	free_chunkfile(cf);
 
-	if (flags & MIDX_WRITE_REV_INDEX &&
+	if (flags & MIDX_WRITE_REV_INDEX && !incremental &&
 	    git_env_bool("GIT_TEST_MIDX_WRITE_REV", 0))
 		write_midx_reverse_index(midx_name.buf, midx_hash, &ctx);
 
@@ -1698,9 +2392,8 @@ static int write_midx_internal(const char *object_dir,
 		FREE_AND_NULL(ctx.entries);
 		ctx.entries_nr = 0;
 
-		if (write_midx_bitmap(midx_name.buf, midx_hash, &pdata,
-				      commits, commits_nr, ctx.pack_order,
-				      flags) < 0) {
+		if (write_midx_bitmap(&ctx, object_dir, midx_hash, &pdata,
+				      commits, commits_nr, flags) < 0) {
 			error(_("could not write multi-pack bitmap"));
 			result = 1;
 			clear_packing_data(&pdata);
@@ -1716,14 +2409,68 @@ static int write_midx_internal(const char *object_dir,
 	 * have been freed in the previous if block.
 	 */
 
-	if (ctx.m)
-		close_object_store(the_repository->objects);
+	if (incremental) {
+		struct string_list keep = STRING_LIST_INIT_DUP;
+		struct strbuf final_name = STRBUF_INIT;
+		struct multi_pack_index *m;
+		FILE *chain;
 
-	if (commit_lock_file(&lk) < 0)
-		die_errno(_("could not write multi-pack-index"));
+		get_split_midx_filename_ext(&final_name, object_dir, midx_hash,
+					    MIDX_EXT_MIDX);
+		if (rename_tempfile(&incr, final_name.buf) < 0) {
+			error_errno(_("unable to rename new multi-pack-index layer"));
+			result = 1;
+			strbuf_release(&final_name);
+			rollback_lock_file(&lk);
+			goto cleanup;
+		}
+		strbuf_release(&final_name);
+
+		for (m = ctx.base_midx; m; m = m->base_midx)
+			string_list_append(&keep, hash_to_hex(get_midx_checksum(m)));
+		string_list_append(&keep, hash_to_hex(midx_hash));
+
+		/* The chain file lists the base-most layer first. */
+		chain = fdopen_lock_file(&lk, "w");
+		if (!chain)
+			die_errno(_("unable to open multi-pack-index chain file"));
+		for (i = keep.nr; i > 1; i--) {
+			struct string_list_item *item = &keep.items[i - 2];
+			fprintf(chain, "%s\n", item->string);
+		}
+		fprintf(chain, "%s\n", keep.items[keep.nr - 1].string);
+
+		if (existing)
+			close_object_store(the_repository->objects);
+		ctx.base_midx = NULL;
+
+		if (commit_lock_file(&lk) < 0)
+			die_errno(_("could not write multi-pack-index"));
+
+		/*
+		 * A non-incremental MIDX would take precedence over the
+		 * chain; any such MIDX has been merged into the new layer.
+		 */
+		get_midx_filename(&final_name, object_dir);
+		unlink_or_warn(final_name.buf);
+		strbuf_release(&final_name);
 
-	clear_midx_files_ext(object_dir, ".bitmap", midx_hash);
-	clear_midx_files_ext(object_dir, ".rev", midx_hash);
+		clear_midx_files_ext(object_dir, ".bitmap", NULL);
+		clear_midx_files_ext(object_dir, ".rev", NULL);
+		clear_incremental_midx_files(object_dir, &keep);
+
+		string_list_clear(&keep, 0);
+	} else {
+		if (existing)
+			close_object_store(the_repository->objects);
+
+		if (commit_lock_file(&lk) < 0)
+			die_errno(_("could not write multi-pack-index"));
+
+		clear_midx_files_ext(object_dir, ".bitmap", midx_hash);
+		clear_midx_files_ext(object_dir, ".rev", midx_hash);
+		clear_incremental_midx_files(object_dir, NULL);
+	}
 
 cleanup:
 	for (i = 0; i < ctx.nr; i++) {
@@ -1818,6 +2565,7 @@ void clear_midx_file(struct repository *r)
 
 	clear_midx_files_ext(r->objects->odb->path, ".bitmap", NULL);
 	clear_midx_files_ext(r->objects->odb->path, ".rev", NULL);
+	clear_incremental_midx_files(r->objects->odb->path, NULL);
 
 	strbuf_release(&midx);
 }
@@ -1864,9 +2612,10 @@ static int compare_pair_pos_vs_id(const void *_a, const void *_b)
 int verify_midx_file(struct repository *r, const char *object_dir, unsigned flags)
 {
 	struct pair_pos_vs_id *pairs = NULL;
-	uint32_t i;
+	uint32_t i, num_packs, num_objects, checked;
 	struct progress *progress = NULL;
 	struct multi_pack_index *m = load_multi_pack_index(object_dir, 1);
+	struct multi_pack_index *cur;
 	verify_midx_error = 0;
 
 	if (!m) {
@@ -1880,17 +2629,29 @@ int verify_midx_file(struct repository *r, const char *object_dir, unsigned flag
 			error(_("multi-pack-index file exists, but failed to parse"));
 			result = 1;
 		}
+
+		strbuf_reset(&filename);
+		get_midx_chain_filename(&filename, object_dir);
+
+		if (!stat(filename.buf, &sb)) {
+			error(_("multi-pack-index chain exists, but failed to parse"));
+			result = 1;
+		}
 		strbuf_release(&filename);
 		return result;
 	}
 
-	if (!midx_checksum_valid(m))
-		midx_report(_("incorrect checksum"));
+	for (cur = m; cur; cur = cur->base_midx)
+		if (!midx_checksum_valid(cur))
+			midx_report(_("incorrect checksum"));
+
+	num_packs = m->num_packs + m->num_packs_in_base;
+	num_objects = m->num_objects + m->num_objects_in_base;
 
 	if (flags & MIDX_PROGRESS)
 		progress = start_delayed_progress(_("Looking for referenced packfiles"),
-					  m->num_packs);
-	for (i = 0; i < m->num_packs; i++) {
+					  num_packs);
+	for (i = 0; i < num_packs; i++) {
 		if (prepare_midx_pack(r, m, i))
 			midx_report("failed to load pack in position %d", i);
 
@@ -1898,7 +2659,7 @@ int verify_midx_file(struct repository *r, const char *object_dir, unsigned flag
 	}
 	stop_progress(&progress);
 
-	if (m->num_objects == 0) {
+	if (num_objects == 0) {
 		midx_report(_("the midx contains no oid"));
 		/*
 		 * Remaining tests assume that we have objects, so we can
@@ -1909,20 +2670,46 @@ int verify_midx_file(struct repository *r, const char *object_dir, unsigned flag
 
 	if (flags & MIDX_PROGRESS)
 		progress = start_sparse_progress(_("Verifying OID order in multi-pack-index"),
-						 m->num_objects - 1);
-	for (i = 0; i < m->num_objects - 1; i++) {
-		struct object_id oid1, oid2;
-
-		nth_midxed_object_oid(&oid1, m, i);
-		nth_midxed_object_oid(&oid2, m, i + 1);
+						 num_objects - 1);
+	checked = 0;
+	/* Objects are only sorted within each layer of a chain. */
+	for (cur = m; cur; cur = cur->base_midx) {
+		for (i = cur->num_objects_in_base;
+		     i + 1 < cur->num_objects_in_base + cur->num_objects; i++) {
+			struct object_id oid1, oid2;
+
+			nth_midxed_object_oid(&oid1, m, i);
+			nth_midxed_object_oid(&oid2, m, i + 1);
+
+			if (oidcmp(&oid1, &oid2) >= 0)
+				midx_report(_("oid lookup out of order: oid[%d] = %s >= %s = oid[%d]"),
+					    i, oid_to_hex(&oid1), oid_to_hex(&oid2), i + 1);
+
+			midx_display_sparse_progress(progress, ++checked);
+		}
+	}
+	stop_progress(&progress);
 
-		if (oidcmp(&oid1, &oid2) >= 0)
-			midx_report(_("oid lookup out of order: oid[%d] = %s >= %s = oid[%d]"),
-				    i, oid_to_hex(&oid1), oid_to_hex(&oid2), i + 1);
+	for (cur = m; cur; cur = cur->base_midx) {
+		uint32_t j;
 
-		midx_display_sparse_progress(progress, i + 1);
+		if (!cur->chunk_oid_fanout16)
+			continue;
+		/* i counts the objects whose first two bytes are at most j. */
+		for (i = 0, j = 0; j < 1 << 16; j++) {
+			while (i < cur->num_objects) {
+				const unsigned char *hash = cur->chunk_oid_lookup +
+					st_mult(cur->hash_len, i);
+
+				if (((hash[0] << 8) | hash[1]) != j)
+					break;
+				i++;
+			}
+			if (ntohl(cur->chunk_oid_fanout16[j]) != i)
+				midx_report(_("oid fanout16 disagrees with oid lookup: fanout16[%"PRIu32"] = %"PRIx32" != %"PRIx32),
+					    j, ntohl(cur->chunk_oid_fanout16[j]), i);
+		}
 	}
-	stop_progress(&progress);
 
 	/*
 	 * Create an array mapping each object to its packfile id.  Sort it
@@ -1930,31 +2717,31 @@ int verify_midx_file(struct repository *r, const char *object_dir, unsigned flag
 	 * each of the objects and only require 1 packfile to be open at a
 	 * time.
 	 */
-	ALLOC_ARRAY(pairs, m->num_objects);
-	for (i = 0; i < m->num_objects; i++) {
+	ALLOC_ARRAY(pairs, num_objects);
+	for (i = 0; i < num_objects; i++) {
 		pairs[i].pos = i;
 		pairs[i].pack_int_id = nth_midxed_pack_int_id(m, i);
 	}
 
 	if (flags & MIDX_PROGRESS)
 		progress = start_sparse_progress(_("Sorting objects by packfile"),
-						 m->num_objects);
+						 num_objects);
 	display_progress(progress, 0); /* TODO: Measure QSORT() progress */
-	QSORT(pairs, m->num_objects, compare_pair_pos_vs_id);
+	QSORT(pairs, num_objects, compare_pair_pos_vs_id);
 	stop_progress(&progress);
 
 	if (flags & MIDX_PROGRESS)
-		progress = start_sparse_progress(_("Verifying object offsets"), m->num_objects);
-	for (i = 0; i < m->num_objects; i++) {
+		progress = start_sparse_progress(_("Verifying object offsets"), num_objects);
+	for (i = 0; i < num_objects; i++) {
 		struct object_id oid;
 		struct pack_entry e;
 		off_t m_offset, p_offset;
 
 		if (i > 0 && pairs[i-1].pack_int_id != pairs[i].pack_int_id &&
-		    m->packs[pairs[i-1].pack_int_id])
+		    nth_midxed_pack(m, pairs[i-1].pack_int_id))
 		{
-			close_pack_fd(m->packs[pairs[i-1].pack_int_id]);
-			close_pack_index(m->packs[pairs[i-1].pack_int_id]);
+			close_pack_fd(nth_midxed_pack(m, pairs[i-1].pack_int_id));
+			close_pack_index(nth_midxed_pack(m, pairs[i-1].pack_int_id));
 		}
 
 		nth_midxed_object_oid(&oid, m, pairs[i].pos);
@@ -1999,6 +2786,9 @@ int expire_midx_packs(struct repository *r, const char *object_dir, unsigned fla
 	if (!m)
 		return 0;
 
+	if (m->has_chain)
+		return error(_("cannot expire packs from an incremental multi-pack-index"));
+
 	CALLOC_ARRAY(count, m->num_packs);
 
 	if (flags & MIDX_PROGRESS)
@@ -2177,6 +2967,9 @@ int midx_repack(struct repository *r, const char *object_dir, size_t batch_size,
 	if (!m)
 		return 0;
 
+	if (m->has_chain)
+		return error(_("cannot repack an incremental multi-pack-index"));
+
 	CALLOC_ARRAY(include_pack, m->num_packs);
 
 	if (batch_size) {
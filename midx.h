@@ -12,9 +12,24 @@ struct bitmapped_pack;
 #define GIT_TEST_MULTI_PACK_INDEX_WRITE_BITMAP \
 	"GIT_TEST_MULTI_PACK_INDEX_WRITE_BITMAP"
 
+#define MIDX_EXT_MIDX "midx"
+#define MIDX_EXT_REV "rev"
+#define MIDX_EXT_BITMAP "bitmap"
+
 struct multi_pack_index {
 	struct multi_pack_index *next;
 
+	/*
+	 * In an incremental MIDX chain, each layer points at the layer
+	 * written before it. Object positions and pack-int-ids are
+	 * numbered across the whole chain, starting with the base-most
+	 * layer, so each layer's own entries are offset by the number of
+	 * objects and packs in the layers below it.
+	 */
+	struct multi_pack_index *base_midx;
+	uint32_t num_objects_in_base;
+	uint32_t num_packs_in_base;
+
 	const unsigned char *data;
 	size_t data_len;
 
@@ -31,18 +46,24 @@ struct multi_pack_index {
 	int preferred_pack_idx;
 
 	int local;
+	int has_chain;
 
 	const unsigned char *chunk_pack_names;
 	size_t chunk_pack_names_len;
 	const uint32_t *chunk_bitmapped_packs;
 	size_t chunk_bitmapped_packs_len;
 	const uint32_t *chunk_oid_fanout;
+	const uint32_t *chunk_oid_fanout16;
 	const unsigned char *chunk_oid_lookup;
 	const unsigned char *chunk_object_offsets;
 	const unsigned char *chunk_large_offsets;
 	size_t chunk_large_offsets_len;
 	const unsigned char *chunk_revindex;
 	size_t chunk_revindex_len;
+	const unsigned char *chunk_base_midxs;
+	size_t chunk_base_midxs_len;
+	const unsigned char *chunk_object_filter;
+	uint32_t object_filter_blocks;
 
 	const char **pack_names;
 	struct packed_git **packs;
@@ -54,15 +75,24 @@ struct multi_pack_index {
 #define MIDX_WRITE_BITMAP (1 << 2)
 #define MIDX_WRITE_BITMAP_HASH_CACHE (1 << 3)
 #define MIDX_WRITE_BITMAP_LOOKUP_TABLE (1 << 4)
+#define MIDX_WRITE_INCREMENTAL (1 << 5)
 
 const unsigned char *get_midx_checksum(struct multi_pack_index *m);
 void get_midx_filename(struct strbuf *out, const char *object_dir);
 void get_midx_rev_filename(struct strbuf *out, struct multi_pack_index *m);
+void get_midx_chain_dirname(struct strbuf *out, const char *object_dir);
+void get_midx_chain_filename(struct strbuf *out, const char *object_dir);
+void get_split_midx_filename_ext(struct strbuf *out, const char *object_dir,
+				 const unsigned char *hash, const char *ext);
 
 struct multi_pack_index *load_multi_pack_index(const char *object_dir, int local);
 int prepare_midx_pack(struct repository *r, struct multi_pack_index *m, uint32_t pack_int_id);
 int nth_bitmapped_pack(struct repository *r, struct multi_pack_index *m,
 		       struct bitmapped_pack *bp, uint32_t pack_int_id);
+struct packed_git *nth_midxed_pack(struct multi_pack_index *m,
+				   uint32_t pack_int_id);
+int bsearch_one_midx(const struct object_id *oid, struct multi_pack_index *m,
+		     uint32_t *result);
 int bsearch_midx(const struct object_id *oid, struct multi_pack_index *m, uint32_t *result);
 off_t nth_midxed_offset(struct multi_pack_index *m, uint32_t pos);
 uint32_t nth_midxed_pack_int_id(struct multi_pack_index *m, uint32_t pos);
@@ -110,6 +110,46 @@ static void git_hash_sha1_final_oid(struct object_id *oid, git_hash_ctx *ctx)
 	oid->algo = GIT_HASH_SHA1;
 }
 
+static void git_hash_sha1_update_multi(git_hash_ctx **ctx, const void **data,
+				       const size_t *len, size_t nr)
+{
+#ifdef git_SHA1_Update_multi
+	git_SHA_CTX **c;
+	size_t i;
+
+	ALLOC_ARRAY(c, nr);
+	for (i = 0; i < nr; i++)
+		c[i] = &ctx[i]->sha1;
+	git_SHA1_Update_multi(c, data, len, nr);
+	free(c);
+#else
+	size_t i;
+
+	for (i = 0; i < nr; i++)
+		git_SHA1_Update(&ctx[i]->sha1, data[i], len[i]);
+#endif
+}
+
+static void git_hash_sha1_final_multi(unsigned char **hash, git_hash_ctx **ctx,
+				      size_t nr)
+{
+#ifdef git_SHA1_Final_multi
+	git_SHA_CTX **c;
+	size_t i;
+
+	ALLOC_ARRAY(c, nr);
+	for (i = 0; i < nr; i++)
+		c[i] = &ctx[i]->sha1;
+	git_SHA1_Final_multi(hash, c, nr);
+	free(c);
+#else
+	size_t i;
+
+	for (i = 0; i < nr; i++)
+		git_SHA1_Final(hash[i], &ctx[i]->sha1);
+#endif
+}
+
 
 static void git_hash_sha256_init(git_hash_ctx *ctx)
 {
@@ -142,6 +182,46 @@ static void git_hash_sha256_final_oid(struct object_id *oid, git_hash_ctx *ctx)
 	oid->algo = GIT_HASH_SHA256;
 }
 
+static void git_hash_sha256_update_multi(git_hash_ctx **ctx, const void **data,
+					 const size_t *len, size_t nr)
+{
+#ifdef git_SHA256_Update_multi
+	git_SHA256_CTX **c;
+	size_t i;
+
+	ALLOC_ARRAY(c, nr);
+	for (i = 0; i < nr; i++)
+		c[i] = &ctx[i]->sha256;
+	git_SHA256_Update_multi(c, data, len, nr);
+	free(c);
+#else
+	size_t i;
+
+	for (i = 0; i < nr; i++)
+		git_SHA256_Update(&ctx[i]->sha256, data[i], len[i]);
+#endif
+}
+
+static void git_hash_sha256_final_multi(unsigned char **hash,
+					git_hash_ctx **ctx, size_t nr)
+{
+#ifdef git_SHA256_Final_multi
+	git_SHA256_CTX **c;
+	size_t i;
+
+	ALLOC_ARRAY(c, nr);
+	for (i = 0; i < nr; i++)
+		c[i] = &ctx[i]->sha256;
+	git_SHA256_Final_multi(hash, c, nr);
+	free(c);
+#else
+	size_t i;
+
+	for (i = 0; i < nr; i++)
+		git_SHA256_Final(hash[i], &ctx[i]->sha256);
+#endif
+}
+
 static void git_hash_unknown_init(git_hash_ctx *ctx UNUSED)
 {
 	BUG("trying to init unknown hash");
@@ -172,6 +252,21 @@ static void git_hash_unknown_final_oid(struct object_id *oid UNUSED,
 	BUG("trying to finalize unknown hash");
 }
 
+static void git_hash_unknown_update_multi(git_hash_ctx **ctx UNUSED,
+					  const void **data UNUSED,
+					  const size_t *len UNUSED,
+					  size_t nr UNUSED)
+{
+	BUG("trying to update unknown hash");
+}
+
+static void git_hash_unknown_final_multi(unsigned char **hash UNUSED,
+					 git_hash_ctx **ctx UNUSED,
+					 size_t nr UNUSED)
+{
+	BUG("trying to finalize unknown hash");
+}
+
 const struct git_hash_algo hash_algos[GIT_HASH_NALGOS] = {
 	{
 		.name = NULL,
@@ -184,6 +279,8 @@ const struct git_hash_algo hash_algos[GIT_HASH_NALGOS] = {
 		.update_fn = git_hash_unknown_update,
 		.final_fn = git_hash_unknown_final,
 		.final_oid_fn = git_hash_unknown_final_oid,
+		.update_multi_fn = git_hash_unknown_update_multi,
+		.final_multi_fn = git_hash_unknown_final_multi,
 		.empty_tree = NULL,
 		.empty_blob = NULL,
 		.null_oid = NULL,
@@ -199,6 +296,8 @@ const struct git_hash_algo hash_algos[GIT_HASH_NALGOS] = {
 		.update_fn = git_hash_sha1_update,
 		.final_fn = git_hash_sha1_final,
 		.final_oid_fn = git_hash_sha1_final_oid,
+		.update_multi_fn = git_hash_sha1_update_multi,
+		.final_multi_fn = git_hash_sha1_final_multi,
 		.empty_tree = &empty_tree_oid,
 		.empty_blob = &empty_blob_oid,
 		.null_oid = &null_oid_sha1,
@@ -214,6 +313,8 @@ const struct git_hash_algo hash_algos[GIT_HASH_NALGOS] = {
 		.update_fn = git_hash_sha256_update,
 		.final_fn = git_hash_sha256_final,
 		.final_oid_fn = git_hash_sha256_final_oid,
+		.update_multi_fn = git_hash_sha256_update_multi,
+		.final_multi_fn = git_hash_sha256_final_multi,
 		.empty_tree = &empty_tree_oid_sha256,
 		.empty_blob = &empty_blob_oid_sha256,
 		.null_oid = &null_oid_sha256,
@@ -1533,6 +1634,7 @@ void enable_obj_read_lock(void)
 
 	obj_read_use_lock = 1;
 	init_recursive_mutex(&obj_read_mutex);
+	init_pack_read_locks();
 }
 
 void disable_obj_read_lock(void)
@@ -1542,6 +1644,7 @@ void disable_obj_read_lock(void)
 
 	obj_read_use_lock = 0;
 	pthread_mutex_destroy(&obj_read_mutex);
+	destroy_pack_read_locks();
 }
 
 int fetch_if_missing = 1;
@@ -1585,6 +1688,9 @@ static int do_oid_object_info_extended(struct repository *r,
 		return 0;
 	}
 
+	if (r == the_repository && !bulk_checkin_object_info(real, oi))
+		return 0;
+
 	while (1) {
 		if (find_pack_entry(r, real, &e))
 			break;
@@ -1865,6 +1971,54 @@ void hash_object_file(const struct git_hash_algo *algo, const void *buf,
 	hash_object_file_literally(algo, buf, len, type_name(type), oid);
 }
 
+void hash_object_file_batch(const struct git_hash_algo *algo,
+			    struct hash_object_job *jobs, size_t nr)
+{
+	git_hash_ctx *c, **ctx;
+	char (*hdr)[MAX_HEADER_LEN];
+	const void **in;
+	size_t *len;
+	unsigned char **hash;
+	size_t i;
+
+	ALLOC_ARRAY(c, nr);
+	ALLOC_ARRAY(ctx, nr);
+	ALLOC_ARRAY(hdr, nr);
+	ALLOC_ARRAY(in, nr);
+	ALLOC_ARRAY(len, nr);
+	ALLOC_ARRAY(hash, nr);
+
+	for (i = 0; i < nr; i++) {
+		ctx[i] = &c[i];
+		algo->init_fn(ctx[i]);
+		in[i] = hdr[i];
+		len[i] = format_object_header(hdr[i], sizeof(hdr[i]),
+					      jobs[i].type, jobs[i].len);
+	}
+	algo->update_multi_fn(ctx, in, len, nr);
+
+	for (i = 0; i < nr; i++) {
+		in[i] = jobs[i].buf;
+		len[i] = jobs[i].len;
+		hash[i] = jobs[i].oid->hash;
+	}
+	algo->update_multi_fn(ctx, in, len, nr);
+	algo->final_multi_fn(hash, ctx, nr);
+
+	for (i = 0; i < nr; i++) {
+		memset(jobs[i].oid->hash + algo->rawsz, 0,
+		       GIT_MAX_RAWSZ - algo->rawsz);
+		jobs[i].oid->algo = hash_algo_by_ptr(algo);
+	}
+
+	free(c);
+	free(ctx);
+	free(hdr);
+	free(in);
+	free(len);
+	free(hash);
+}
+
 /* Finalize a file on disk, and close it. */
 static void close_loose_object(int fd, const char *filename)
 {
@@ -2215,6 +2369,8 @@ int write_object_file_flags(const void *buf, unsigned long len,
 				  &hdrlen);
 	if (freshen_packed_object(oid) || freshen_loose_object(oid))
 		return 0;
+	if (odb_transaction_packs_objects())
+		return write_object_bulk_checkin(buf, len, type, oid);
 	return write_loose_object(oid, hdr, hdrlen, buf, len, 0, flags);
 }
 
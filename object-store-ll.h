@@ -250,6 +250,21 @@ void hash_object_file(const struct git_hash_algo *algo, const void *buf,
 		      unsigned long len, enum object_type type,
 		      struct object_id *oid);
 
+struct hash_object_job {
+	const void *buf;
+	unsigned long len;
+	enum object_type type;
+	struct object_id *oid;
+};
+
+/*
+ * Like calling hash_object_file() for each of the "nr" jobs, but lets
+ * the hash implementation compress the blocks of several objects in
+ * parallel, which pays off for many small objects.
+ */
+void hash_object_file_batch(const struct git_hash_algo *algo,
+			    struct hash_object_job *jobs, size_t nr);
+
 int write_object_file_flags(const void *buf, unsigned long len,
 			    enum object_type type, struct object_id *oid,
 			    unsigned flags);
@@ -292,7 +307,8 @@ struct object_info {
 		OI_CACHED,
 		OI_LOOSE,
 		OI_PACKED,
-		OI_DBCACHED
+		OI_DBCACHED,
+		OI_PENDING
 	} whence;
 	union {
 		/*
@@ -406,11 +422,18 @@ void assert_oid_type(const struct object_id *oid, enum object_type expect);
  * following functions in parallel: repo_read_object_file(),
  * read_object_with_reference(), oid_object_info() and oid_object_info_extended().
  *
+ * Only the lookup of an object and the bookkeeping around it run under the
+ * lock: loose objects are inflated, and packed objects are inflated and have
+ * their deltas applied, with the lock released. Pack windows and the delta
+ * base cache are protected by finer-grained locks of their own (see
+ * packfile.c), so concurrent readers of the same packs scale with the number
+ * of threads.
+ *
  * obj_read_lock() and obj_read_unlock() may also be used to protect other
  * section which cannot execute in parallel with object reading. Since the used
  * lock is a recursive mutex, these sections can even contain calls to object
- * reading functions. However, beware that in these cases zlib inflation won't
- * be performed in parallel, losing performance.
+ * reading functions. However, beware that in these cases zlib inflation and
+ * delta application won't be performed in parallel, losing performance.
  *
  * TODO: oid_object_info_extended()'s call stack has a recursive behavior. If
  * any of its callees end up calling it, this recursive call won't benefit from
@@ -13,6 +13,7 @@
 #include "alloc.h"
 #include "packfile.h"
 #include "commit-graph.h"
+#include "repository.h"
 
 unsigned int get_max_object_index(void)
 {
@@ -67,6 +68,45 @@ static unsigned int hash_obj(const struct object_id *oid, unsigned int n)
 	return oidhash(oid) & (n - 1);
 }
 
+/*
+ * While the object table is locked, it is split into this many shards,
+ * each covering an equal part of obj_hash, and with a mutex of its own.
+ * An object goes into the shard picked by the top bits of its hash (the
+ * bottom ones pick its bucket), and collisions overflow to the next
+ * empty bucket within that shard only. Without the lock, the whole table
+ * is a single shard.
+ */
+#define OBJECT_TABLE_SHARD_BITS 6
+#define OBJECT_TABLE_SHARDS (1 << OBJECT_TABLE_SHARD_BITS)
+
+struct object_table_lock {
+	struct parsed_object_pool *pool;
+	pthread_mutex_t shard[OBJECT_TABLE_SHARDS];
+	int shard_nr[OBJECT_TABLE_SHARDS];
+	pthread_mutex_t parse[OBJECT_TABLE_SHARDS];
+};
+
+int object_table_use_lock;
+pthread_mutex_t object_state_mutex;
+static struct object_table_lock *object_table_lock;
+
+static unsigned int shard_obj(const struct object_id *oid, unsigned int bits)
+{
+	return bits ? oidhash(oid) >> (32 - bits) : 0;
+}
+
+static struct object_table_lock *table_lock(struct parsed_object_pool *o)
+{
+	if (object_table_lock && object_table_lock->pool == o)
+		return object_table_lock;
+	return NULL;
+}
+
+pthread_mutex_t *object_parse_mutex(const struct object_id *oid)
+{
+	return &object_table_lock->parse[shard_obj(oid, OBJECT_TABLE_SHARD_BITS)];
+}
+
 /*
  * Insert obj into the hash table hash, which has length size (which
  * must be a power of 2).  On collisions, simply overflow to the next
@@ -84,24 +124,33 @@ static void insert_obj_hash(struct object *obj, struct object **hash, unsigned i
 	hash[j] = obj;
 }
 
-/*
- * Look up the record for the given sha1 in the hash map stored in
- * obj_hash.  Return NULL if it was not found.
- */
-struct object *lookup_object(struct repository *r, const struct object_id *oid)
+/* Insert obj into its shard of a table of "size" buckets. */
+static void insert_obj_shard(struct object *obj, struct object **hash,
+			     unsigned int size, unsigned int bits)
 {
-	unsigned int i, first;
+	unsigned int shard_size = size >> bits;
+
+	insert_obj_hash(obj, hash + shard_obj(&obj->oid, bits) * shard_size,
+			shard_size);
+}
+
+static struct object *lookup_object_1(struct parsed_object_pool *o,
+				      const struct object_id *oid)
+{
+	unsigned int i, first, size = o->obj_hash_size >> o->obj_hash_shard_bits;
+	struct object **hash;
 	struct object *obj;
 
-	if (!r->parsed_objects->obj_hash)
+	if (!o->obj_hash)
 		return NULL;
 
-	first = i = hash_obj(oid, r->parsed_objects->obj_hash_size);
-	while ((obj = r->parsed_objects->obj_hash[i]) != NULL) {
+	hash = o->obj_hash + shard_obj(oid, o->obj_hash_shard_bits) * size;
+	first = i = hash_obj(oid, size);
+	while ((obj = hash[i]) != NULL) {
 		if (oideq(oid, &obj->oid))
 			break;
 		i++;
-		if (i == r->parsed_objects->obj_hash_size)
+		if (i == size)
 			i = 0;
 	}
 	if (obj && i != first) {
@@ -110,50 +159,142 @@ struct object *lookup_object(struct repository *r, const struct object_id *oid)
 		 * that we do not need to walk the hash table the next
 		 * time we look for it.
 		 */
-		SWAP(r->parsed_objects->obj_hash[i],
-		     r->parsed_objects->obj_hash[first]);
+		SWAP(hash[i], hash[first]);
 	}
 	return obj;
 }
 
 /*
- * Increase the size of the hash map stored in obj_hash to the next
- * power of 2 (but at least 32).  Copy the existing values to the new
- * hash map.
+ * Look up the record for the given sha1 in the hash map stored in
+ * obj_hash.  Return NULL if it was not found.
  */
-static void grow_object_hash(struct repository *r)
+struct object *lookup_object(struct repository *r, const struct object_id *oid)
 {
+	struct object_table_lock *lock = table_lock(r->parsed_objects);
+	struct object *obj;
+	unsigned int shard;
+
+	if (!lock)
+		return lookup_object_1(r->parsed_objects, oid);
+
+	shard = shard_obj(oid, OBJECT_TABLE_SHARD_BITS);
+	pthread_mutex_lock(&lock->shard[shard]);
+	obj = lookup_object_1(r->parsed_objects, oid);
+	pthread_mutex_unlock(&lock->shard[shard]);
+	return obj;
+}
+
+/*
+ * Rehash the objects of obj_hash into a new table of "size" buckets in
+ * "1 << bits" shards, counting the objects of each shard in "shard_nr"
+ * if it is not NULL.
+ */
+static void rehash_object_table(struct parsed_object_pool *o,
+				unsigned int size, unsigned int bits,
+				int *shard_nr)
+{
+	struct object **new_hash;
 	int i;
+
+	CALLOC_ARRAY(new_hash, size);
+	for (i = 0; i < o->obj_hash_size; i++) {
+		struct object *obj = o->obj_hash[i];
+
+		if (!obj)
+			continue;
+		insert_obj_shard(obj, new_hash, size, bits);
+		if (shard_nr)
+			shard_nr[shard_obj(&obj->oid, bits)]++;
+	}
+	free(o->obj_hash);
+	o->obj_hash = new_hash;
+	o->obj_hash_size = size;
+	o->obj_hash_shard_bits = bits;
+}
+
+/*
+ * Increase the size of the hash map stored in obj_hash to the next
+ * power of 2 (but at least 32 buckets per shard).  Copy the existing
+ * values to the new hash map.
+ */
+static void grow_object_hash(struct parsed_object_pool *o)
+{
 	/*
 	 * Note that this size must always be power-of-2 to match hash_obj
 	 * above.
 	 */
-	int new_hash_size = r->parsed_objects->obj_hash_size < 32 ? 32 : 2 * r->parsed_objects->obj_hash_size;
-	struct object **new_hash;
+	int min_size = 32 << o->obj_hash_shard_bits;
+	int new_hash_size = o->obj_hash_size < min_size ? min_size : 2 * o->obj_hash_size;
 
-	CALLOC_ARRAY(new_hash, new_hash_size);
-	for (i = 0; i < r->parsed_objects->obj_hash_size; i++) {
-		struct object *obj = r->parsed_objects->obj_hash[i];
+	rehash_object_table(o, new_hash_size, o->obj_hash_shard_bits, NULL);
+}
 
-		if (!obj)
-			continue;
-		insert_obj_hash(obj, new_hash, new_hash_size);
+/*
+ * Grow the table of a locked pool because "shard", of "shard_size"
+ * buckets, is full. Every shard is locked for that, and the table may
+ * have grown already by the time we got hold of them all.
+ */
+static void grow_object_hash_locked(struct object_table_lock *lock,
+				    unsigned int shard_size)
+{
+	struct parsed_object_pool *o = lock->pool;
+	int i;
+
+	for (i = 0; i < OBJECT_TABLE_SHARDS; i++)
+		pthread_mutex_lock(&lock->shard[i]);
+	if (o->obj_hash_size >> o->obj_hash_shard_bits == shard_size)
+		grow_object_hash(o);
+	for (i = OBJECT_TABLE_SHARDS - 1; i >= 0; i--)
+		pthread_mutex_unlock(&lock->shard[i]);
+}
+
+static struct object *create_object_locked(struct object_table_lock *lock,
+					   struct object *obj)
+{
+	struct parsed_object_pool *o = lock->pool;
+	unsigned int shard = shard_obj(&obj->oid, OBJECT_TABLE_SHARD_BITS);
+
+	for (;;) {
+		unsigned int shard_size;
+		struct object *old;
+
+		pthread_mutex_lock(&lock->shard[shard]);
+		shard_size = o->obj_hash_size >> OBJECT_TABLE_SHARD_BITS;
+
+		/* Someone else may have created it since we looked. */
+		old = lookup_object_1(o, &obj->oid);
+		if (old) {
+			pthread_mutex_unlock(&lock->shard[shard]);
+			return old;
+		}
+
+		if (shard_size - 1 > lock->shard_nr[shard] * 2) {
+			insert_obj_hash(obj, o->obj_hash + shard * shard_size,
+					shard_size);
+			lock->shard_nr[shard]++;
+			pthread_mutex_unlock(&lock->shard[shard]);
+			return obj;
+		}
+
+		pthread_mutex_unlock(&lock->shard[shard]);
+		grow_object_hash_locked(lock, shard_size);
 	}
-	free(r->parsed_objects->obj_hash);
-	r->parsed_objects->obj_hash = new_hash;
-	r->parsed_objects->obj_hash_size = new_hash_size;
 }
 
 void *create_object(struct repository *r, const struct object_id *oid, void *o)
 {
+	struct object_table_lock *lock = table_lock(r->parsed_objects);
 	struct object *obj = o;
 
 	obj->parsed = 0;
 	obj->flags = 0;
 	oidcpy(&obj->oid, oid);
 
+	if (lock)
+		return create_object_locked(lock, obj);
+
 	if (r->parsed_objects->obj_hash_size - 1 <= r->parsed_objects->nr_objs * 2)
-		grow_object_hash(r);
+		grow_object_hash(r->parsed_objects);
 
 	insert_obj_hash(obj, r->parsed_objects->obj_hash,
 			r->parsed_objects->obj_hash_size);
@@ -161,7 +302,74 @@ void *create_object(struct repository *r, const struct object_id *oid, void *o)
 	return obj;
 }
 
-void *object_as_type(struct object *obj, enum object_type type, int quiet)
+void enable_object_table_lock(struct repository *r)
+{
+	struct parsed_object_pool *o = r->parsed_objects;
+	unsigned int size;
+	int i;
+
+	if (object_table_lock) {
+		if (object_table_lock->pool != o)
+			BUG("the object table of another repository is locked");
+		return;
+	}
+
+	/*
+	 * Set up the state that parsing initializes lazily, so that
+	 * threads do not race to do so.
+	 */
+	prepare_repo_settings(r);
+	prepare_replace_object(r);
+	prepare_commit_graft(r);
+	prepare_commit_graph(r);
+
+	CALLOC_ARRAY(object_table_lock, 1);
+	object_table_lock->pool = o;
+	for (i = 0; i < OBJECT_TABLE_SHARDS; i++) {
+		pthread_mutex_init(&object_table_lock->shard[i], NULL);
+		init_recursive_mutex(&object_table_lock->parse[i]);
+	}
+	pthread_mutex_init(&object_state_mutex, NULL);
+
+	size = 32 << OBJECT_TABLE_SHARD_BITS;
+	while (size < o->obj_hash_size)
+		size *= 2;
+	rehash_object_table(o, size, OBJECT_TABLE_SHARD_BITS,
+			    object_table_lock->shard_nr);
+	/* rehashing may have unevenly filled some of the shards */
+	for (i = 0; i < OBJECT_TABLE_SHARDS; i++)
+		while ((o->obj_hash_size >> OBJECT_TABLE_SHARD_BITS) - 1 <=
+		       object_table_lock->shard_nr[i] * 2)
+			grow_object_hash(o);
+
+	object_table_use_lock = 1;
+}
+
+void disable_object_table_lock(struct repository *r)
+{
+	struct parsed_object_pool *o = r->parsed_objects;
+	int i;
+
+	if (!object_table_lock)
+		return;
+	if (object_table_lock->pool != o)
+		BUG("the object table of another repository is locked");
+
+	object_table_use_lock = 0;
+
+	o->nr_objs = 0;
+	for (i = 0; i < OBJECT_TABLE_SHARDS; i++) {
+		o->nr_objs += object_table_lock->shard_nr[i];
+		pthread_mutex_destroy(&object_table_lock->shard[i]);
+		pthread_mutex_destroy(&object_table_lock->parse[i]);
+	}
+	pthread_mutex_destroy(&object_state_mutex);
+	FREE_AND_NULL(object_table_lock);
+
+	rehash_object_table(o, o->obj_hash_size, 0, NULL);
+}
+
+static void *object_as_type_1(struct object *obj, enum object_type type, int quiet)
 {
 	if (obj->type == type)
 		return obj;
@@ -181,6 +389,59 @@ void *object_as_type(struct object *obj, enum object_type type, int quiet)
 	}
 }
 
+void *object_as_type(struct object *obj, enum object_type type, int quiet)
+{
+	unsigned int shard;
+	void *ret;
+
+	if (!object_table_use_lock)
+		return object_as_type_1(obj, type, quiet);
+
+	/* Another thread may be setting the type of an OBJ_NONE object. */
+	shard = shard_obj(&obj->oid, OBJECT_TABLE_SHARD_BITS);
+	pthread_mutex_lock(&object_table_lock->shard[shard]);
+	ret = object_as_type_1(obj, type, quiet);
+	pthread_mutex_unlock(&object_table_lock->shard[shard]);
+	return ret;
+}
+
+void set_object_parsed(struct object *obj, unsigned parsed)
+{
+	unsigned int shard;
+
+	if (!object_table_use_lock) {
+		obj->parsed = parsed;
+		return;
+	}
+
+	shard = shard_obj(&obj->oid, OBJECT_TABLE_SHARD_BITS);
+	pthread_mutex_lock(&object_table_lock->shard[shard]);
+	obj->parsed = parsed;
+	pthread_mutex_unlock(&object_table_lock->shard[shard]);
+}
+
+unsigned set_object_flags_unless(struct object *obj, unsigned flags,
+				 unsigned unless)
+{
+	unsigned int shard;
+	unsigned old;
+
+	if (!object_table_use_lock) {
+		old = obj->flags;
+		if (!(old & unless))
+			obj->flags |= flags;
+		return old;
+	}
+
+	shard = shard_obj(&obj->oid, OBJECT_TABLE_SHARD_BITS);
+	pthread_mutex_lock(&object_table_lock->shard[shard]);
+	old = obj->flags;
+	if (!(old & unless))
+		obj->flags |= flags;
+	pthread_mutex_unlock(&object_table_lock->shard[shard]);
+	return old;
+}
+
 struct object *lookup_unknown_object(struct repository *r, const struct object_id *oid)
 {
 	struct object *obj = lookup_object(r, oid);
@@ -207,7 +468,7 @@ struct object *lookup_object_by_type(struct repository *r,
 	}
 }
 
-struct object *parse_object_buffer(struct repository *r, const struct object_id *oid, enum object_type type, unsigned long size, void *buffer, int *eaten_p)
+static struct object *parse_object_buffer_1(struct repository *r, const struct object_id *oid, enum object_type type, unsigned long size, void *buffer, int *eaten_p)
 {
 	struct object *obj;
 	*eaten_p = 0;
@@ -224,7 +485,7 @@ struct object *parse_object_buffer(struct repository *r, const struct object_id
 		if (tree) {
 			obj = &tree->object;
 			if (!tree->buffer)
-				tree->object.parsed = 0;
+				set_object_parsed(&tree->object, 0);
 			if (!tree->object.parsed) {
 				if (parse_tree_buffer(tree, buffer, size))
 					return NULL;
@@ -257,6 +518,16 @@ struct object *parse_object_buffer(struct repository *r, const struct object_id
 	return obj;
 }
 
+struct object *parse_object_buffer(struct repository *r, const struct object_id *oid, enum object_type type, unsigned long size, void *buffer, int *eaten_p)
+{
+	struct object *obj;
+
+	object_parse_lock(oid);
+	obj = parse_object_buffer_1(r, oid, type, size, buffer, eaten_p);
+	object_parse_unlock(oid);
+	return obj;
+}
+
 struct object *parse_object_or_die(const struct object_id *oid,
 				   const char *name)
 {
@@ -267,9 +538,9 @@ struct object *parse_object_or_die(const struct object_id *oid,
 	die(_("unable to parse object: %s"), name ? name : oid_to_hex(oid));
 }
 
-struct object *parse_object_with_flags(struct repository *r,
-				       const struct object_id *oid,
-				       enum parse_object_flags flags)
+static struct object *parse_object_with_flags_1(struct repository *r,
+						const struct object_id *oid,
+						enum parse_object_flags flags)
 {
 	int skip_hash = !!(flags & PARSE_OBJECT_SKIP_HASH_CHECK);
 	unsigned long size;
@@ -317,6 +588,18 @@ struct object *parse_object_with_flags(struct repository *r,
 	return NULL;
 }
 
+struct object *parse_object_with_flags(struct repository *r,
+				       const struct object_id *oid,
+				       enum parse_object_flags flags)
+{
+	struct object *obj;
+
+	object_parse_lock(oid);
+	obj = parse_object_with_flags_1(r, oid, flags);
+	object_parse_unlock(oid);
+	return obj;
+}
+
 struct object *parse_object(struct repository *r, const struct object_id *oid)
 {
 	return parse_object_with_flags(r, oid, 0);
@@ -2,6 +2,7 @@
 #define OBJECT_H
 
 #include "hash-ll.h"
+#include "thread-utils.h"
 
 struct buffer_slab;
 struct repository;
@@ -10,6 +11,12 @@ struct parsed_object_pool {
 	struct object **obj_hash;
 	int nr_objs, obj_hash_size;
 
+	/*
+	 * While the object table is locked, obj_hash is split into
+	 * 1 << obj_hash_shard_bits equally sized shards; see object.c.
+	 */
+	unsigned int obj_hash_shard_bits;
+
 	/* TODO: migrate alloc_states to mem-pool? */
 	struct alloc_state *blob_state;
 	struct alloc_state *tree_state;
@@ -186,10 +193,88 @@ struct object *get_indexed_object(unsigned int);
  */
 struct object *lookup_object(struct repository *r, const struct object_id *oid);
 
+/*
+ * Add "obj", a freshly allocated node, to the object table as "oid".
+ * When the object table is locked, another thread may have added "oid"
+ * first, in which case its object is returned instead (and it may not be
+ * of the type of "obj").
+ */
 void *create_object(struct repository *r, const struct object_id *oid, void *obj);
 
 void *object_as_type(struct object *obj, enum object_type type, int quiet);
 
+/*
+ * Mark "obj" as (un)parsed. The "parsed" bit shares a word with the type
+ * and flags of the object, so while the object table is locked it may
+ * only be changed through this function.
+ */
+void set_object_parsed(struct object *obj, unsigned parsed);
+
+/*
+ * Set "flags" on "obj", unless it already has any of the "unless" flags,
+ * and return the flags it had before. This is how threads can claim an
+ * object while the object table is locked, e.g. by setting SEEN unless
+ * the object has SEEN.
+ */
+unsigned set_object_flags_unless(struct object *obj, unsigned flags,
+				 unsigned unless);
+
+/*
+ * Locking the object table allows multiple threads to safely look up,
+ * create and parse objects of "r" at the same time, i.e. to call
+ * lookup_object(), the lookup_<type>() functions, parse_object(),
+ * repo_parse_commit(), parse_tree() and parse_tag() (and their variants)
+ * in parallel. Object reading has to be made thread-safe as well, with
+ * enable_obj_read_lock().
+ *
+ * The table is split into shards with a mutex each, so that threads
+ * looking up different objects rarely wait on each other. Parsing an
+ * object holds a lock (shared with other objects, also split by object
+ * ID), so that each object is parsed once, and no thread sees it half
+ * parsed. Object allocation, the commit buffer cache and the commit-graph
+ * data of commits are serialized by a single mutex.
+ *
+ * Only one repository may have its object table locked at a time.
+ * Iterating over the table with get_indexed_object(), or clearing object
+ * flags, is not safe while other threads look up objects.
+ */
+void enable_object_table_lock(struct repository *r);
+void disable_object_table_lock(struct repository *r);
+
+extern int object_table_use_lock;
+extern pthread_mutex_t object_state_mutex;
+
+pthread_mutex_t *object_parse_mutex(const struct object_id *oid);
+
+/* Serialize parsing "oid" with other threads. The lock is recursive. */
+static inline void object_parse_lock(const struct object_id *oid)
+{
+	if (object_table_use_lock)
+		pthread_mutex_lock(object_parse_mutex(oid));
+}
+
+static inline void object_parse_unlock(const struct object_id *oid)
+{
+	if (object_table_use_lock)
+		pthread_mutex_unlock(object_parse_mutex(oid));
+}
+
+/*
+ * Protects object allocation and the per-commit data kept in commit
+ * slabs by the object layer. Not recursive.
+ */
+static inline void object_state_lock(void)
+{
+	if (object_table_use_lock)
+		pthread_mutex_lock(&object_state_mutex);
+}
+
+static inline void object_state_unlock(void)
+{
+	if (object_table_use_lock)
+		pthread_mutex_unlock(&object_state_mutex);
+}
+
 /*
  * Returns the object, having parsed it to find out what it is.
  *
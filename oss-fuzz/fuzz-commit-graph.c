@@ -20,6 +20,9 @@ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
 	 */
 	the_repository->settings.commit_graph_generation_version = 2;
 	the_repository->settings.commit_graph_read_changed_paths = 1;
+	the_repository->settings.commit_graph_read_reachability_index = 1;
+	the_repository->settings.commit_graph_read_log_metadata = 1;
+	the_repository->settings.commit_graph_read_changed_path_lists = 1;
 	g = parse_commit_graph(&the_repository->settings, (void *)data, size);
 	repo_clear(the_repository);
 	free_commit_graph(g);
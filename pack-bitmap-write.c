@@ -10,10 +10,13 @@
 #include "pack.h"
 #include "pack-bitmap.h"
 #include "hash-lookup.h"
+#include "midx.h"
 #include "pack-objects.h"
+#include "pack-revindex.h"
 #include "path.h"
 #include "commit-reach.h"
 #include "prio-queue.h"
+#include "pseudo-merge.h"
 #include "trace2.h"
 #include "tree.h"
 #include "tree-walk.h"
@@ -36,9 +39,28 @@ struct bitmap_writer {
 	kh_oid_map_t *bitmaps;
 	struct packing_data *to_pack;
 
+	/*
+	 * When writing the bitmap for a new layer of an incremental MIDX
+	 * chain, "midx_base" is the layer below it, and "base_nr" is the
+	 * number of objects in the whole base. The objects in "to_pack"
+	 * then take up the bit positions starting at "base_nr".
+	 */
+	struct multi_pack_index *midx_base;
+	uint32_t base_nr;
+
 	struct bitmapped_commit *selected;
 	unsigned int selected_nr, selected_alloc;
 
+	/*
+	 * For each pseudo-merge, the bit positions of the commits in it,
+	 * and the union of their reachability.
+	 */
+	struct pseudo_merge_bitmap {
+		struct ewah_bitmap *commits;
+		struct ewah_bitmap *objects;
+	} *pseudo_merges;
+	size_t pseudo_merges_nr;
+
 	struct progress *progress;
 	int show_progress;
 	unsigned char pack_checksum[GIT_MAX_RAWSZ];
@@ -51,6 +73,12 @@ void bitmap_writer_show_progress(int show)
 	writer.show_progress = show;
 }
 
+void bitmap_writer_set_midx_base(struct multi_pack_index *base)
+{
+	writer.midx_base = base;
+	writer.base_nr = base ? base->num_objects + base->num_objects_in_base : 0;
+}
+
 /**
  * Build the initial type index for the packfile or multi-pack-index
  */
@@ -88,19 +116,19 @@ void bitmap_writer_build_type_index(struct packing_data *to_pack,
 
 		switch (real_type) {
 		case OBJ_COMMIT:
-			ewah_set(writer.commits, i);
+			ewah_set(writer.commits, writer.base_nr + i);
 			break;
 
 		case OBJ_TREE:
-			ewah_set(writer.trees, i);
+			ewah_set(writer.trees, writer.base_nr + i);
 			break;
 
 		case OBJ_BLOB:
-			ewah_set(writer.blobs, i);
+			ewah_set(writer.blobs, writer.base_nr + i);
 			break;
 
 		case OBJ_TAG:
-			ewah_set(writer.tags, i);
+			ewah_set(writer.tags, writer.base_nr + i);
 			break;
 
 		default:
@@ -129,11 +157,31 @@ static inline void push_bitmapped_commit(struct commit *commit)
 	writer.selected_nr++;
 }
 
-static uint32_t find_object_pos(const struct object_id *oid, int *found)
+static int lookup_object_pos(const struct object_id *oid, uint32_t *pos)
 {
 	struct object_entry *entry = packlist_find(writer.to_pack, oid);
 
-	if (!entry) {
+	if (entry) {
+		*pos = writer.base_nr + oe_in_pack_pos(writer.to_pack, entry);
+		return 0;
+	}
+
+	if (writer.midx_base) {
+		uint32_t at;
+
+		if (bsearch_midx(oid, writer.midx_base, &at) &&
+		    !midx_to_pack_pos(writer.midx_base, at, pos))
+			return 0;
+	}
+
+	return -1;
+}
+
+static uint32_t find_object_pos(const struct object_id *oid, int *found)
+{
+	uint32_t pos;
+
+	if (lookup_object_pos(oid, &pos) < 0) {
 		if (found)
 			*found = 0;
 		warning("Failed to write bitmap index. Packfile doesn't have full closure "
@@ -143,7 +191,7 @@ static uint32_t find_object_pos(const struct object_id *oid, int *found)
 
 	if (found)
 		*found = 1;
-	return oe_in_pack_pos(writer.to_pack, entry);
+	return pos;
 }
 
 static void compute_xor_offsets(void)
@@ -415,7 +463,18 @@ static int fill_bitmap_commit(struct bb_commit *ent,
 		struct commit_list *p;
 		struct commit *c = prio_queue_get(queue);
 
-		if (old_bitmap && mapping) {
+		if (old_bitmap && !mapping) {
+			struct ewah_bitmap *old = bitmap_for_commit(old_bitmap, c);
+			/*
+			 * The old bitmap belongs to the base of the MIDX layer
+			 * we are writing, so its bits need no translation.
+			 */
+			if (old) {
+				bitmap_or_ewah(ent->bitmap, old);
+				reused_bitmaps_nr++;
+				continue;
+			}
+		} else if (old_bitmap) {
 			struct ewah_bitmap *old = bitmap_for_commit(old_bitmap, c);
 			struct bitmap *remapped = bitmap_new();
 			/*
@@ -462,6 +521,135 @@ static int fill_bitmap_commit(struct bb_commit *ent,
 	return 0;
 }
 
+static int fill_pseudo_merge_bitmap(struct bitmap *bitmap,
+				    struct pseudo_merge_commits *merge,
+				    struct prio_queue *queue,
+				    struct prio_queue *tree_queue,
+				    struct bitmap_index *old_bitmap,
+				    const uint32_t *mapping)
+{
+	size_t i;
+
+	for (i = 0; i < merge->nr; i++)
+		prio_queue_put(queue, merge->commits[i]);
+
+	while (queue->nr) {
+		struct commit *c = prio_queue_get(queue);
+		struct commit_list *p;
+		khiter_t hash_pos;
+		uint32_t pos;
+		int found;
+
+		pos = find_object_pos(&c->object.oid, &found);
+		if (!found)
+			return -1;
+		if (bitmap_get(bitmap, pos))
+			continue;
+
+		/*
+		 * The selected commits (and those with a bitmap in the base
+		 * of a MIDX layer) already have their whole reachability at
+		 * hand, so there is no need to walk past them.
+		 */
+		hash_pos = kh_get_oid_map(writer.bitmaps, c->object.oid);
+		if (hash_pos != kh_end(writer.bitmaps)) {
+			struct bitmapped_commit *stored = kh_value(writer.bitmaps, hash_pos);
+			bitmap_or_ewah(bitmap, stored->bitmap);
+			continue;
+		}
+		if (old_bitmap && !mapping) {
+			struct ewah_bitmap *old = bitmap_for_commit(old_bitmap, c);
+			if (old) {
+				bitmap_or_ewah(bitmap, old);
+				continue;
+			}
+		}
+
+		parse_commit_or_die(c);
+		bitmap_set(bitmap, pos);
+		prio_queue_put(tree_queue,
+			       repo_get_commit_tree(the_repository, c));
+
+		for (p = c->parents; p; p = p->next) {
+			pos = find_object_pos(&p->item->object.oid, &found);
+			if (!found)
+				return -1;
+			if (!bitmap_get(bitmap, pos))
+				prio_queue_put(queue, p->item);
+		}
+	}
+
+	while (tree_queue->nr) {
+		if (fill_bitmap_tree(bitmap, prio_queue_get(tree_queue)) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+static int pseudo_merge_include(struct commit *commit, void *data UNUSED)
+{
+	uint32_t pos;
+	return !lookup_object_pos(&commit->object.oid, &pos);
+}
+
+static int build_pseudo_merges(struct bitmap_index *old_bitmap,
+			       const uint32_t *mapping)
+{
+	struct pseudo_merge_commits *merges;
+	struct prio_queue queue = { compare_commits_by_gen_then_commit_date };
+	struct prio_queue tree_queue = { NULL };
+	size_t merges_nr, i, j;
+	int ret = 0;
+
+	select_pseudo_merges(writer.to_pack->repo, pseudo_merge_include, NULL,
+			     &merges, &merges_nr);
+	if (!merges_nr)
+		return 0;
+
+	trace2_region_enter("pack-bitmap-write", "building_pseudo_merges",
+			    the_repository);
+
+	CALLOC_ARRAY(writer.pseudo_merges, merges_nr);
+	for (i = 0; i < merges_nr; i++) {
+		struct bitmap *commits = bitmap_new();
+		struct bitmap *objects = bitmap_new();
+
+		for (j = 0; j < merges[i].nr; j++) {
+			uint32_t pos;
+			if (lookup_object_pos(&merges[i].commits[j]->object.oid, &pos) < 0)
+				BUG("pseudo-merge commit %s has no bit position",
+				    oid_to_hex(&merges[i].commits[j]->object.oid));
+			bitmap_set(commits, pos);
+		}
+
+		if (fill_pseudo_merge_bitmap(objects, &merges[i], &queue,
+					     &tree_queue, old_bitmap,
+					     mapping) < 0) {
+			bitmap_free(commits);
+			bitmap_free(objects);
+			ret = -1;
+			break;
+		}
+
+		writer.pseudo_merges[i].commits = bitmap_to_ewah(commits);
+		writer.pseudo_merges[i].objects = bitmap_to_ewah(objects);
+		writer.pseudo_merges_nr++;
+
+		bitmap_free(commits);
+		bitmap_free(objects);
+	}
+
+	trace2_data_intmax("pack-bitmap-write", the_repository,
+			   "num_pseudo_merges", writer.pseudo_merges_nr);
+	trace2_region_leave("pack-bitmap-write", "building_pseudo_merges",
+			    the_repository);
+
+	clear_prio_queue(&queue);
+	clear_prio_queue(&tree_queue);
+	free_pseudo_merges(merges, merges_nr);
+	return ret;
+}
+
 static void store_selected(struct bb_commit *ent, struct commit *commit)
 {
 	struct bitmapped_commit *stored = &writer.selected[ent->idx];
@@ -488,6 +676,23 @@ int bitmap_writer_build(struct packing_data *to_pack)
 	uint32_t *mapping;
 	int closed = 1; /* until proven otherwise */
 
+	if (writer.midx_base) {
+		/*
+		 * The bitmaps of a new MIDX layer build on those of its
+		 * base, which must therefore exist.
+		 */
+		old_bitmap = prepare_midx_bitmap_git(writer.midx_base);
+		if (!old_bitmap)
+			return error(_("could not open the bitmap of the base multi-pack-index"));
+		mapping = NULL;
+	} else {
+		old_bitmap = prepare_bitmap_git(to_pack->repo);
+		if (old_bitmap)
+			mapping = create_bitmap_mapping(old_bitmap, to_pack);
+		else
+			mapping = NULL;
+	}
+
 	writer.bitmaps = kh_init_oid_map();
 	writer.to_pack = to_pack;
 
@@ -496,12 +701,6 @@ int bitmap_writer_build(struct packing_data *to_pack)
 	trace2_region_enter("pack-bitmap-write", "building_bitmaps_total",
 			    the_repository);
 
-	old_bitmap = prepare_bitmap_git(to_pack->repo);
-	if (old_bitmap)
-		mapping = create_bitmap_mapping(old_bitmap, to_pack);
-	else
-		mapping = NULL;
-
 	bitmap_builder_init(&bb, &writer, old_bitmap);
 	for (i = bb.commits_nr; i > 0; i--) {
 		struct commit *commit = bb.commits[i-1];
@@ -541,6 +740,10 @@ int bitmap_writer_build(struct packing_data *to_pack)
 	clear_prio_queue(&queue);
 	clear_prio_queue(&tree_queue);
 	bitmap_builder_clear(&bb);
+
+	if (closed && build_pseudo_merges(old_bitmap, mapping) < 0)
+		closed = 0;
+
 	free_bitmap_index(old_bitmap);
 	free(mapping);
 
@@ -775,6 +978,44 @@ static void write_hash_cache(struct hashfile *f,
 	}
 }
 
+/*
+ * Write each pseudo-merge's pair of bitmaps, followed by a table of their
+ * offsets, their number, and the size of the whole extension, so that a
+ * reader can find it by working backwards from the end of the file.
+ */
+static void write_pseudo_merges(struct hashfile *f)
+{
+	off_t start = hashfile_total(f);
+	uint64_t *offsets;
+	size_t i;
+
+	ALLOC_ARRAY(offsets, writer.pseudo_merges_nr);
+	for (i = 0; i < writer.pseudo_merges_nr; i++) {
+		offsets[i] = hashfile_total(f);
+		dump_bitmap(f, writer.pseudo_merges[i].commits);
+		dump_bitmap(f, writer.pseudo_merges[i].objects);
+	}
+
+	for (i = 0; i < writer.pseudo_merges_nr; i++)
+		hashwrite_be64(f, offsets[i]);
+	hashwrite_be32(f, writer.pseudo_merges_nr);
+	hashwrite_be64(f, hashfile_total(f) - start + sizeof(uint64_t));
+
+	free(offsets);
+}
+
+static void free_pseudo_merge_bitmaps(void)
+{
+	size_t i;
+
+	for (i = 0; i < writer.pseudo_merges_nr; i++) {
+		ewah_free(writer.pseudo_merges[i].commits);
+		ewah_free(writer.pseudo_merges[i].objects);
+	}
+	FREE_AND_NULL(writer.pseudo_merges);
+	writer.pseudo_merges_nr = 0;
+}
+
 void bitmap_writer_set_checksum(const unsigned char *sha1)
 {
 	hashcpy(writer.pack_checksum, sha1);
@@ -801,6 +1042,8 @@ void bitmap_writer_finish(struct pack_idx_entry **index,
 
 	memcpy(header.magic, BITMAP_IDX_SIGNATURE, sizeof(BITMAP_IDX_SIGNATURE));
 	header.version = htons(default_version);
+	if (writer.pseudo_merges_nr)
+		options |= BITMAP_OPT_PSEUDO_MERGES;
 	header.options = htons(flags | options);
 	header.entry_count = htonl(writer.selected_nr);
 	hashcpy(header.checksum, writer.pack_checksum);
@@ -831,6 +1074,9 @@ void bitmap_writer_finish(struct pack_idx_entry **index,
 	if (options & BITMAP_OPT_LOOKUP_TABLE)
 		write_lookup_table(f, commit_positions, offsets);
 
+	if (options & BITMAP_OPT_PSEUDO_MERGES)
+		write_pseudo_merges(f);
+
 	if (options & BITMAP_OPT_HASH_CACHE)
 		write_hash_cache(f, index, index_nr);
 
@@ -846,4 +1092,5 @@ void bitmap_writer_finish(struct pack_idx_entry **index,
 	strbuf_release(&tmp_file);
 	free(commit_positions);
 	free(offsets);
+	free_pseudo_merge_bitmaps();
 }
@@ -51,6 +51,17 @@ struct bitmap_index {
 	struct packed_git *pack;
 	struct multi_pack_index *midx;
 
+	/*
+	 * If "midx" is a layer of an incremental MIDX chain, this is the
+	 * bitmap of the layer below it.
+	 *
+	 * Each layer's bitmap file only stores the commits (and type
+	 * information) for the objects in that layer, but its bit
+	 * positions are numbered across the whole chain, so a bitmap
+	 * from any layer can be combined with those of its bases.
+	 */
+	struct bitmap_index *base;
+
 	/* mmapped buffer of the whole bitmap index */
 	unsigned char *map;
 	size_t map_size; /* size of the mmaped buffer */
@@ -86,6 +97,20 @@ struct bitmap_index {
 	 */
 	unsigned char *table_lookup;
 
+	/*
+	 * Pseudo-merges: groups of commits (usually ref tips) along with
+	 * the union of their reachability. Their bitmaps are read from
+	 * "map" the first time a traversal looks at them.
+	 */
+	struct pseudo_merge {
+		size_t offset;
+		struct bitmap *commits;
+		struct ewah_bitmap *objects;
+		unsigned loaded : 1,
+			 satisfied : 1;
+	} *pseudo_merges;
+	uint32_t pseudo_merges_nr;
+
 	/*
 	 * Extended index.
 	 *
@@ -154,10 +179,21 @@ static struct ewah_bitmap *read_bitmap_1(struct bitmap_index *index)
 static uint32_t bitmap_num_objects(struct bitmap_index *index)
 {
 	if (index->midx)
-		return index->midx->num_objects;
+		return index->midx->num_objects + index->midx->num_objects_in_base;
 	return index->pack->num_objects;
 }
 
+/*
+ * Commits are stored by their position within the bitmap's own MIDX layer;
+ * this is what to add to such a position to get one in the whole chain.
+ */
+static uint32_t bitmap_objects_in_base(struct bitmap_index *index)
+{
+	if (index->midx)
+		return index->midx->num_objects_in_base;
+	return 0;
+}
+
 static int load_bitmap_header(struct bitmap_index *index)
 {
 	struct bitmap_disk_header *header = (void *)index->map;
@@ -176,7 +212,9 @@ static int load_bitmap_header(struct bitmap_index *index)
 	/* Parse known bitmap format options */
 	{
 		uint32_t flags = ntohs(header->options);
-		size_t cache_size = st_mult(bitmap_num_objects(index), sizeof(uint32_t));
+		size_t cache_size = st_mult(bitmap_num_objects(index) -
+					    bitmap_objects_in_base(index),
+					    sizeof(uint32_t));
 		unsigned char *index_end = index->map + index->map_size - the_hash_algo->rawsz;
 
 		if ((flags & BITMAP_OPT_FULL_DAG) == 0)
@@ -190,6 +228,42 @@ static int load_bitmap_header(struct bitmap_index *index)
 			index_end -= cache_size;
 		}
 
+		if (flags & BITMAP_OPT_PSEUDO_MERGES) {
+			size_t ext_size, table_size, ext_start;
+			uint32_t i, nr;
+
+			if (index_end - index->map - header_size <
+			    sizeof(uint64_t) + sizeof(uint32_t))
+				return error(_("corrupted bitmap index file (too short to fit pseudo-merges)"));
+
+			ext_size = get_be64(index_end - sizeof(uint64_t));
+			nr = get_be32(index_end - sizeof(uint64_t) - sizeof(uint32_t));
+			table_size = st_mult(nr, sizeof(uint64_t));
+
+			if (ext_size > index_end - index->map - header_size ||
+			    table_size + sizeof(uint64_t) + sizeof(uint32_t) > ext_size)
+				return error(_("corrupted bitmap index file (too short to fit pseudo-merges)"));
+
+			index_end -= ext_size;
+			ext_start = index_end - index->map;
+
+			if (git_env_bool("GIT_TEST_USE_PSEUDO_MERGES", 1)) {
+				const unsigned char *table = index_end + ext_size -
+					sizeof(uint64_t) - sizeof(uint32_t) - table_size;
+
+				CALLOC_ARRAY(index->pseudo_merges, nr);
+				for (i = 0; i < nr; i++) {
+					uint64_t offset = get_be64(table + st_mult(i, sizeof(uint64_t)));
+					if (offset < ext_start || offset >= ext_start + ext_size) {
+						FREE_AND_NULL(index->pseudo_merges);
+						return error(_("corrupted bitmap index file (pseudo-merge %"PRIu32" out of bounds)"), i);
+					}
+					index->pseudo_merges[i].offset = offset;
+				}
+				index->pseudo_merges_nr = nr;
+			}
+		}
+
 		if (flags & BITMAP_OPT_LOOKUP_TABLE) {
 			size_t table_size = st_mult(ntohl(header->entry_count),
 						    BITMAP_LOOKUP_TABLE_TRIPLET_WIDTH);
@@ -253,6 +327,23 @@ static inline uint8_t read_u8(const unsigned char *buffer, size_t *pos)
 
 #define MAX_XOR_OFFSET 160
 
+/*
+ * Return the name-hash of the object at "index_pos" (a position in the
+ * pack's .idx, or in the whole MIDX chain), or zero if there is no
+ * name-hash cache for it.
+ */
+static uint32_t bitmap_name_hash(struct bitmap_index *bitmap_git,
+				 uint32_t index_pos)
+{
+	while (bitmap_git->base && index_pos < bitmap_objects_in_base(bitmap_git))
+		bitmap_git = bitmap_git->base;
+
+	if (!bitmap_git->hashes)
+		return 0;
+	return get_be32(bitmap_git->hashes + index_pos -
+			bitmap_objects_in_base(bitmap_git));
+}
+
 static int nth_bitmap_object_oid(struct bitmap_index *index,
 				 struct object_id *oid,
 				 uint32_t n)
@@ -281,7 +372,8 @@ static int load_bitmap_entries_v1(struct bitmap_index *index)
 		xor_offset = read_u8(index->map, &index->map_pos);
 		flags = read_u8(index->map, &index->map_pos);
 
-		if (nth_bitmap_object_oid(index, &oid, commit_idx_pos) < 0)
+		if (nth_bitmap_object_oid(index, &oid, commit_idx_pos +
+					  bitmap_objects_in_base(index)) < 0)
 			return error(_("corrupt ewah bitmap: commit index %u out of range"),
 				     (unsigned)commit_idx_pos);
 
@@ -310,6 +402,13 @@ char *midx_bitmap_filename(struct multi_pack_index *midx)
 {
 	struct strbuf buf = STRBUF_INIT;
 
+	if (midx->has_chain) {
+		get_split_midx_filename_ext(&buf, midx->object_dir,
+					    get_midx_checksum(midx),
+					    MIDX_EXT_BITMAP);
+		return strbuf_detach(&buf, NULL);
+	}
+
 	get_midx_filename(&buf, midx->object_dir);
 	strbuf_addf(&buf, "-%s.bitmap", hash_to_hex(get_midx_checksum(midx)));
 
@@ -378,10 +477,19 @@ static int open_midx_bitmap_1(struct bitmap_index *bitmap_git,
 		goto cleanup;
 	}
 
-	for (i = 0; i < bitmap_git->midx->num_packs; i++) {
-		if (prepare_midx_pack(the_repository, bitmap_git->midx, i)) {
+	if (midx->base_midx) {
+		bitmap_git->base = prepare_midx_bitmap_git(midx->base_midx);
+		if (!bitmap_git->base) {
+			warning(_("could not open bitmap for the base of an incremental multi-pack-index"));
+			goto cleanup;
+		}
+	}
+
+	for (i = 0; i < midx->num_packs; i++) {
+		if (prepare_midx_pack(the_repository, midx,
+				      i + midx->num_packs_in_base)) {
 			warning(_("could not open pack %s"),
-				bitmap_git->midx->pack_names[i]);
+				midx->pack_names[i]);
 			goto cleanup;
 		}
 	}
@@ -391,7 +499,7 @@ static int open_midx_bitmap_1(struct bitmap_index *bitmap_git,
 		goto cleanup;
 	}
 
-	preferred = bitmap_git->midx->packs[preferred_pack];
+	preferred = nth_midxed_pack(bitmap_git->midx, preferred_pack);
 	if (!is_pack_valid(preferred)) {
 		warning(_("preferred pack (%s) is invalid"),
 			preferred->pack_name);
@@ -406,6 +514,8 @@ static int open_midx_bitmap_1(struct bitmap_index *bitmap_git,
 	bitmap_git->map_pos = 0;
 	bitmap_git->map = NULL;
 	bitmap_git->midx = NULL;
+	free_bitmap_index(bitmap_git->base);
+	bitmap_git->base = NULL;
 	return -1;
 }
 
@@ -477,8 +587,9 @@ static int load_reverse_index(struct repository *r, struct bitmap_index *bitmap_
 		 * But we still need to open the individual pack .rev files,
 		 * since we will need to make use of them in pack-objects.
 		 */
-		for (i = 0; i < bitmap_git->midx->num_packs; i++) {
-			ret = load_pack_revindex(r, bitmap_git->midx->packs[i]);
+		for (i = 0; i < bitmap_git->midx->num_packs_in_base +
+			     bitmap_git->midx->num_packs; i++) {
+			ret = load_pack_revindex(r, nth_midxed_pack(bitmap_git->midx, i));
 			if (ret)
 				return ret;
 		}
@@ -487,6 +598,17 @@ static int load_reverse_index(struct repository *r, struct bitmap_index *bitmap_
 	return load_pack_revindex(r, bitmap_git->pack);
 }
 
+static void merge_base_type_bitmap(struct ewah_bitmap **ours,
+				   struct ewah_bitmap *base)
+{
+	struct ewah_bitmap *merged = ewah_pool_new();
+
+	/* The two bitmaps never share a bit, so XOR-ing them is an OR. */
+	ewah_xor(*ours, base, merged);
+	ewah_pool_free(*ours);
+	*ours = merged;
+}
+
 static int load_bitmap(struct repository *r, struct bitmap_index *bitmap_git)
 {
 	assert(bitmap_git->map);
@@ -503,6 +625,17 @@ static int load_bitmap(struct repository *r, struct bitmap_index *bitmap_git)
 		!(bitmap_git->tags = read_bitmap_1(bitmap_git)))
 		goto failed;
 
+	if (bitmap_git->base) {
+		/*
+		 * The type bitmaps in a layer's file only cover the objects
+		 * in that layer; fold in those of the layers below it.
+		 */
+		merge_base_type_bitmap(&bitmap_git->commits, bitmap_git->base->commits);
+		merge_base_type_bitmap(&bitmap_git->trees, bitmap_git->base->trees);
+		merge_base_type_bitmap(&bitmap_git->blobs, bitmap_git->base->blobs);
+		merge_base_type_bitmap(&bitmap_git->tags, bitmap_git->base->tags);
+	}
+
 	if (!bitmap_git->table_lookup && load_bitmap_entries_v1(bitmap_git) < 0)
 		goto failed;
 
@@ -680,7 +813,7 @@ static uint32_t bitmap_bsearch_pos(struct bitmap_index *bitmap_git,
 	int found;
 
 	if (bitmap_is_midx(bitmap_git))
-		found = bsearch_midx(oid, bitmap_git->midx, result);
+		found = bsearch_one_midx(oid, bitmap_git->midx, result);
 	else
 		found = bsearch_pack(oid, bitmap_git->pack, result);
 
@@ -751,7 +884,9 @@ static struct stored_bitmap *lazy_bitmap_for_commit(struct bitmap_index *bitmap_
 		xor_item = &xor_items[xor_items_nr];
 		xor_item->offset = triplet.offset;
 
-		if (nth_bitmap_object_oid(bitmap_git, &xor_item->oid, triplet.commit_pos) < 0) {
+		if (nth_bitmap_object_oid(bitmap_git, &xor_item->oid,
+					  triplet.commit_pos +
+					  bitmap_objects_in_base(bitmap_git)) < 0) {
 			error(_("corrupt bitmap lookup table: commit index %u out of range"),
 				triplet.commit_pos);
 			goto corrupt;
@@ -845,14 +980,16 @@ struct ewah_bitmap *bitmap_for_commit(struct bitmap_index *bitmap_git,
 					   commit->object.oid);
 	if (hash_pos >= kh_end(bitmap_git->bitmaps)) {
 		struct stored_bitmap *bitmap = NULL;
-		if (!bitmap_git->table_lookup)
-			return NULL;
 
 		/* this is a fairly hot codepath - no trace2_region please */
 		/* NEEDSWORK: cache misses aren't recorded */
-		bitmap = lazy_bitmap_for_commit(bitmap_git, commit);
-		if (!bitmap)
+		if (bitmap_git->table_lookup)
+			bitmap = lazy_bitmap_for_commit(bitmap_git, commit);
+		if (!bitmap) {
+			if (bitmap_git->base)
+				return bitmap_for_commit(bitmap_git->base, commit);
 			return NULL;
+		}
 		return lookup_stored_bitmap(bitmap);
 	}
 	return lookup_stored_bitmap(kh_value(bitmap_git->bitmaps, hash_pos));
@@ -1076,6 +1213,101 @@ static struct bitmap *fill_in_bitmap(struct bitmap_index *bitmap_git,
 	return base;
 }
 
+static int load_pseudo_merge(struct bitmap_index *bitmap_git,
+			     struct pseudo_merge *merge)
+{
+	struct ewah_bitmap *commits;
+	size_t pos = merge->offset;
+	ssize_t ret;
+
+	if (merge->loaded)
+		return merge->commits ? 0 : -1;
+	merge->loaded = 1;
+
+	commits = ewah_new();
+	ret = ewah_read_mmap(commits, bitmap_git->map + pos,
+			     bitmap_git->map_size - pos);
+	if (ret < 0)
+		goto corrupt;
+	pos += ret;
+
+	merge->objects = ewah_new();
+	ret = ewah_read_mmap(merge->objects, bitmap_git->map + pos,
+			     bitmap_git->map_size - pos);
+	if (ret < 0)
+		goto corrupt;
+
+	merge->commits = ewah_to_bitmap(commits);
+	ewah_free(commits);
+	return 0;
+
+corrupt:
+	ewah_free(commits);
+	ewah_free(merge->objects);
+	merge->objects = NULL;
+	return error(_("failed to load pseudo-merge bitmap (corrupted?)"));
+}
+
+/*
+ * OR into "*base" the objects of every pseudo-merge (from any layer) whose
+ * commits are all either reachable from "*base", or among the "roots"
+ * themselves. Satisfying one pseudo-merge can make others reachable, so
+ * keep going until nothing changes.
+ */
+static void apply_pseudo_merges(struct bitmap_index *bitmap_git,
+				struct bitmap **base,
+				struct object_list *roots)
+{
+	struct bitmap_index *b;
+	struct bitmap *reached;
+	intmax_t satisfied = 0;
+	int changed, any = 0;
+
+	for (b = bitmap_git; b; b = b->base) {
+		uint32_t i;
+		for (i = 0; i < b->pseudo_merges_nr; i++)
+			b->pseudo_merges[i].satisfied = 0;
+		any |= !!b->pseudo_merges_nr;
+	}
+	if (!any)
+		return;
+
+	reached = *base ? bitmap_dup(*base) : bitmap_new();
+	for (; roots; roots = roots->next) {
+		int pos = bitmap_position(bitmap_git, &roots->item->oid);
+		if (pos >= 0)
+			bitmap_set(reached, pos);
+	}
+
+	do {
+		changed = 0;
+		for (b = bitmap_git; b; b = b->base) {
+			uint32_t i;
+
+			for (i = 0; i < b->pseudo_merges_nr; i++) {
+				struct pseudo_merge *merge = &b->pseudo_merges[i];
+
+				if (merge->satisfied ||
+				    load_pseudo_merge(b, merge) < 0 ||
+				    bitmap_is_subset(merge->commits, reached))
+					continue;
+
+				if (!*base)
+					*base = bitmap_new();
+				bitmap_or_ewah(*base, merge->objects);
+				bitmap_or_ewah(reached, merge->objects);
+				merge->satisfied = 1;
+				satisfied++;
+				changed = 1;
+			}
+		}
+	} while (changed);
+
+	bitmap_free(reached);
+	trace2_data_intmax("bitmap", the_repository,
+			   "pseudo_merges_satisfied", satisfied);
+}
+
 struct bitmap_boundary_cb {
 	struct bitmap_index *bitmap_git;
 	struct bitmap *base;
@@ -1139,6 +1371,24 @@ static struct bitmap *find_boundary_objects(struct bitmap_index *bitmap_git,
 		any_missing = 1;
 	}
 
+	if (any_missing) {
+		/*
+		 * See whether any pseudo-merges cover the roots which are
+		 * left before falling back to a traversal.
+		 */
+		apply_pseudo_merges(bitmap_git, &cb.base, roots);
+
+		any_missing = 0;
+		for (root = roots; root; root = root->next) {
+			struct object *object = root->item;
+			if (object->type == OBJ_COMMIT &&
+			    !bitmap_walk_contains(bitmap_git, cb.base, &object->oid)) {
+				any_missing = 1;
+				break;
+			}
+		}
+	}
+
 	if (!any_missing)
 		goto cleanup;
 
@@ -1235,6 +1485,14 @@ static struct bitmap *find_objects(struct bitmap_index *bitmap_git,
 	if (!not_mapped)
 		return base;
 
+	/*
+	 * Before walking from the roots without a bitmap, see whether
+	 * any pseudo-merges cover them; this is what saves us from
+	 * walking to each of a large number of (mostly unchanging) ref
+	 * tips.
+	 */
+	apply_pseudo_merges(bitmap_git, &base, not_mapped);
+
 	roots = not_mapped;
 
 	/*
@@ -1360,7 +1618,7 @@ static void show_objects_for_type(
 		for (offset = 0; offset < BITS_IN_EWORD; ++offset) {
 			struct packed_git *pack;
 			struct object_id oid;
-			uint32_t hash = 0, index_pos;
+			uint32_t hash, index_pos;
 			off_t ofs;
 
 			if ((word >> offset) == 0)
@@ -1377,7 +1635,7 @@ static void show_objects_for_type(
 				nth_midxed_object_oid(&oid, m, index_pos);
 
 				pack_id = nth_midxed_pack_int_id(m, index_pos);
-				pack = bitmap_git->midx->packs[pack_id];
+				pack = nth_midxed_pack(bitmap_git->midx, pack_id);
 			} else {
 				index_pos = pack_pos_to_index(bitmap_git->pack, pos + offset);
 				ofs = pack_pos_to_offset(bitmap_git->pack, pos + offset);
@@ -1386,8 +1644,7 @@ static void show_objects_for_type(
 				pack = bitmap_git->pack;
 			}
 
-			if (bitmap_git->hashes)
-				hash = get_be32(bitmap_git->hashes + index_pos);
+			hash = bitmap_name_hash(bitmap_git, index_pos);
 
 			show_reach(&oid, object_type, 0, hash, pack, ofs);
 		}
@@ -1507,7 +1764,7 @@ static unsigned long get_size_by_pos(struct bitmap_index *bitmap_git,
 			uint32_t midx_pos = pack_pos_to_midx(bitmap_git->midx, pos);
 			uint32_t pack_id = nth_midxed_pack_int_id(bitmap_git->midx, midx_pos);
 
-			pack = bitmap_git->midx->packs[pack_id];
+			pack = nth_midxed_pack(bitmap_git->midx, pack_id);
 			ofs = nth_midxed_offset(bitmap_git->midx, midx_pos);
 		} else {
 			pack = bitmap_git->pack;
@@ -2047,6 +2304,14 @@ void reuse_partial_packfile_from_bitmap(struct bitmap_index *bitmap_git,
 
 	assert(result);
 
+	if (bitmap_is_midx(bitmap_git) && bitmap_git->midx->base_midx) {
+		/*
+		 * NEEDSWORK: verbatim pack reuse does not know about the
+		 * layers of an incremental MIDX chain yet.
+		 */
+		return;
+	}
+
 	load_reverse_index(r, bitmap_git);
 
 	if (bitmap_is_midx(bitmap_git)) {
@@ -2348,22 +2613,25 @@ int test_bitmap_commits(struct repository *r)
 	struct object_id oid;
 	MAYBE_UNUSED void *value;
 	struct bitmap_index *bitmap_git = prepare_bitmap_git(r);
+	struct bitmap_index *layer;
 
 	if (!bitmap_git)
 		die(_("failed to load bitmap indexes"));
 
-	/*
-	 * As this function is only used to print bitmap selected
-	 * commits, we don't have to read the commit table.
-	 */
-	if (bitmap_git->table_lookup) {
-		if (load_bitmap_entries_v1(bitmap_git) < 0)
-			die(_("failed to load bitmap indexes"));
-	}
+	for (layer = bitmap_git; layer; layer = layer->base) {
+		/*
+		 * As this function is only used to print bitmap selected
+		 * commits, we don't have to read the commit table.
+		 */
+		if (layer->table_lookup) {
+			if (load_bitmap_entries_v1(layer) < 0)
+				die(_("failed to load bitmap indexes"));
+		}
 
-	kh_foreach(bitmap_git->bitmaps, oid, value, {
-		printf_ln("%s", oid_to_hex(&oid));
-	});
+		kh_foreach(layer->bitmaps, oid, value, {
+			printf_ln("%s", oid_to_hex(&oid));
+		});
+	}
 
 	free_bitmap_index(bitmap_git);
 
@@ -2388,7 +2656,7 @@ int test_bitmap_hashes(struct repository *r)
 		nth_bitmap_object_oid(bitmap_git, &oid, index_pos);
 
 		printf_ln("%s %"PRIu32"",
-		       oid_to_hex(&oid), get_be32(bitmap_git->hashes + index_pos));
+		       oid_to_hex(&oid), bitmap_name_hash(bitmap_git, index_pos));
 	}
 
 cleanup:
@@ -2458,8 +2726,8 @@ uint32_t *create_bitmap_mapping(struct bitmap_index *bitmap_git,
 
 		if (oe) {
 			reposition[i] = oe_in_pack_pos(mapping, oe) + 1;
-			if (bitmap_git->hashes && !oe->hash)
-				oe->hash = get_be32(bitmap_git->hashes + index_pos);
+			if (!oe->hash)
+				oe->hash = bitmap_name_hash(bitmap_git, index_pos);
 		}
 	}
 
@@ -2468,6 +2736,8 @@ uint32_t *create_bitmap_mapping(struct bitmap_index *bitmap_git,
 
 void free_bitmap_index(struct bitmap_index *b)
 {
+	uint32_t i;
+
 	if (!b)
 		return;
 
@@ -2485,6 +2755,11 @@ void free_bitmap_index(struct bitmap_index *b)
 		});
 	}
 	kh_destroy_oid_map(b->bitmaps);
+	for (i = 0; i < b->pseudo_merges_nr; i++) {
+		bitmap_free(b->pseudo_merges[i].commits);
+		ewah_free(b->pseudo_merges[i].objects);
+	}
+	free(b->pseudo_merges);
 	free(b->ext_index.objects);
 	free(b->ext_index.hashes);
 	kh_destroy_oid_pos(b->ext_index.positions);
@@ -2503,6 +2778,7 @@ void free_bitmap_index(struct bitmap_index *b)
 		 */
 		close_midx_revindex(b->midx);
 	}
+	free_bitmap_index(b->base);
 	free(b);
 }
 
@@ -2544,7 +2820,7 @@ static off_t get_disk_usage_for_type(struct bitmap_index *bitmap_git,
 				off_t offset = nth_midxed_offset(bitmap_git->midx, midx_pos);
 
 				uint32_t pack_id = nth_midxed_pack_int_id(bitmap_git->midx, midx_pos);
-				struct packed_git *pack = bitmap_git->midx->packs[pack_id];
+				struct packed_git *pack = nth_midxed_pack(bitmap_git->midx, pack_id);
 
 				if (offset_to_pack_pos(pack, offset, &pack_pos) < 0) {
 					struct object_id oid;
@@ -362,6 +362,14 @@ int load_midx_revindex(struct multi_pack_index *m)
 	if (m->revindex_data)
 		return 0;
 
+	/*
+	 * Positions in an incremental MIDX chain are numbered across all
+	 * of its layers, so each layer needs its base's reverse index,
+	 * too.
+	 */
+	if (m->base_midx && load_midx_revindex(m->base_midx) < 0)
+		return -1;
+
 	if (can_use_midx_ridx_chunk(m)) {
 		/*
 		 * If the MIDX `m` has a `RIDX` chunk, then use its contents for
@@ -468,11 +476,17 @@ off_t pack_pos_to_offset(struct packed_git *p, uint32_t pos)
 
 uint32_t pack_pos_to_midx(struct multi_pack_index *m, uint32_t pos)
 {
+	while (m && pos < m->num_objects_in_base)
+		m = m->base_midx;
+
+	if (!m)
+		BUG("pack_pos_to_midx: NULL multi-pack-index for position %"PRIu32, pos);
 	if (!m->revindex_data)
 		BUG("pack_pos_to_midx: reverse index not yet loaded");
-	if (m->num_objects <= pos)
+	if (m->num_objects + m->num_objects_in_base <= pos)
 		BUG("pack_pos_to_midx: out-of-bounds object at %"PRIu32, pos);
-	return get_be32(m->revindex_data + pos);
+	return get_be32(m->revindex_data + pos - m->num_objects_in_base) +
+		m->num_objects_in_base;
 }
 
 struct midx_pack_key {
@@ -488,7 +502,8 @@ static int midx_pack_order_cmp(const void *va, const void *vb)
 	const struct midx_pack_key *key = va;
 	struct multi_pack_index *midx = key->midx;
 
-	uint32_t versus = pack_pos_to_midx(midx, (uint32_t*)vb - (const uint32_t *)midx->revindex_data);
+	uint32_t versus = pack_pos_to_midx(midx, (uint32_t*)vb - (const uint32_t *)midx->revindex_data +
+					   midx->num_objects_in_base);
 	uint32_t versus_pack = nth_midxed_pack_int_id(midx, versus);
 	off_t versus_offset;
 
@@ -545,7 +560,7 @@ static int midx_key_to_pack_pos(struct multi_pack_index *m,
 	if (!found)
 		return -1;
 
-	*pos = found - m->revindex_data;
+	*pos = found - m->revindex_data + m->num_objects_in_base;
 	return 0;
 }
 
@@ -553,9 +568,14 @@ int midx_to_pack_pos(struct multi_pack_index *m, uint32_t at, uint32_t *pos)
 {
 	struct midx_pack_key key;
 
+	while (m && at < m->num_objects_in_base)
+		m = m->base_midx;
+
+	if (!m)
+		BUG("midx_to_pack_pos: NULL multi-pack-index for object %"PRIu32, at);
 	if (!m->revindex_data)
 		BUG("midx_to_pack_pos: reverse index not yet loaded");
-	if (m->num_objects <= at)
+	if (m->num_objects + m->num_objects_in_base <= at)
 		BUG("midx_to_pack_pos: out-of-bounds object at %"PRIu32, at);
 
 	key.pack = nth_midxed_pack_int_id(m, at);
@@ -568,10 +588,17 @@ int midx_to_pack_pos(struct multi_pack_index *m, uint32_t at, uint32_t *pos)
 int midx_pair_to_pack_pos(struct multi_pack_index *m, uint32_t pack_int_id,
 			  off_t ofs, uint32_t *pos)
 {
-	struct midx_pack_key key = {
-		.pack = pack_int_id,
-		.offset = ofs,
-		.midx = m,
-	};
+	struct midx_pack_key key;
+
+	while (m && pack_int_id < m->num_packs_in_base)
+		m = m->base_midx;
+
+	if (!m)
+		BUG("midx_pair_to_pack_pos: NULL multi-pack-index for pack %"PRIu32, pack_int_id);
+
+	key.pack = pack_int_id;
+	key.offset = ofs;
+	key.midx = m;
+
 	return midx_key_to_pack_pos(m, &key, pos);
 }
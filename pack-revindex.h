@@ -124,6 +124,10 @@ off_t pack_pos_to_offset(struct packed_git *p, uint32_t pos);
  * pack_pos_to_midx converts the object at position "pos" within the MIDX
  * pseudo-pack into a MIDX position.
  *
+ * In an incremental MIDX chain, both kinds of position are numbered across
+ * the whole chain, and the pseudo-pack lists the objects of each layer after
+ * those of the layers below it.
+ *
  * If the reverse index has not yet been loaded, or the position is out of
  * bounds, this function aborts.
  *
@@ -54,6 +54,52 @@ static unsigned int pack_max_fds;
 static size_t peak_pack_mapped;
 static size_t pack_mapped;
 
+/*
+ * When obj_read_use_lock is set, unpack_entry() runs without holding
+ * obj_read_mutex, so the state it shares with other readers has locks
+ * of its own: pack_window_mutex covers the windows and file descriptors
+ * of every packed_git (and the counters above), while
+ * delta_base_cache_mutex covers the delta base cache.
+ */
+static pthread_mutex_t pack_window_mutex;
+static pthread_mutex_t delta_base_cache_mutex;
+
+static inline void pack_window_lock(void)
+{
+	if (obj_read_use_lock)
+		pthread_mutex_lock(&pack_window_mutex);
+}
+
+static inline void pack_window_unlock(void)
+{
+	if (obj_read_use_lock)
+		pthread_mutex_unlock(&pack_window_mutex);
+}
+
+static inline void delta_base_cache_lock(void)
+{
+	if (obj_read_use_lock)
+		pthread_mutex_lock(&delta_base_cache_mutex);
+}
+
+static inline void delta_base_cache_unlock(void)
+{
+	if (obj_read_use_lock)
+		pthread_mutex_unlock(&delta_base_cache_mutex);
+}
+
+void init_pack_read_locks(void)
+{
+	init_recursive_mutex(&pack_window_mutex);
+	pthread_mutex_init(&delta_base_cache_mutex, NULL);
+}
+
+void destroy_pack_read_locks(void)
+{
+	pthread_mutex_destroy(&pack_window_mutex);
+	pthread_mutex_destroy(&delta_base_cache_mutex);
+}
+
 #define SZ_FMT PRIuMAX
 static inline uintmax_t sz_fmt(size_t s) { return s; }
 
@@ -295,6 +341,7 @@ static int unuse_one_window(struct packed_git *current)
 
 void close_pack_windows(struct packed_git *p)
 {
+	pack_window_lock();
 	while (p->windows) {
 		struct pack_window *w = p->windows;
 
@@ -307,18 +354,23 @@ void close_pack_windows(struct packed_git *p)
 		p->windows = w->next;
 		free(w);
 	}
+	pack_window_unlock();
 }
 
 int close_pack_fd(struct packed_git *p)
 {
-	if (p->pack_fd < 0)
-		return 0;
+	int ret = 0;
 
-	close(p->pack_fd);
-	pack_open_fds--;
-	p->pack_fd = -1;
+	pack_window_lock();
+	if (p->pack_fd >= 0) {
+		close(p->pack_fd);
+		pack_open_fds--;
+		p->pack_fd = -1;
+		ret = 1;
+	}
+	pack_window_unlock();
 
-	return 1;
+	return ret;
 }
 
 void close_pack_index(struct packed_git *p)
@@ -634,6 +686,7 @@ unsigned char *use_pack(struct packed_git *p,
 	 * hash, and the in_window function above wouldn't match
 	 * don't allow an offset too close to the end of the file.
 	 */
+	pack_window_lock();
 	if (!p->pack_size && p->pack_fd == -1 && open_packed_git(p))
 		die("packfile %s cannot be accessed", p->pack_name);
 	if (offset > (p->pack_size - the_hash_algo->rawsz))
@@ -689,6 +742,7 @@ unsigned char *use_pack(struct packed_git *p,
 		win->inuse_cnt++;
 		*w_cursor = win;
 	}
+	pack_window_unlock();
 	offset -= win->offset;
 	if (left)
 		*left = win->len - xsize_t(offset);
@@ -699,7 +753,9 @@ void unuse_pack(struct pack_window **w_cursor)
 {
 	struct pack_window *w = *w_cursor;
 	if (w) {
+		pack_window_lock();
 		w->inuse_cnt--;
+		pack_window_unlock();
 		*w_cursor = NULL;
 	}
 }
@@ -878,7 +934,8 @@ static void prepare_pack(const char *full_name, size_t full_name_len,
 	if (!report_garbage)
 		return;
 
-	if (!strcmp(file_name, "multi-pack-index"))
+	if (!strcmp(file_name, "multi-pack-index") ||
+	    !strcmp(file_name, "multi-pack-index.d"))
 		return;
 	if (starts_with(file_name, "multi-pack-index") &&
 	    (ends_with(file_name, ".bitmap") || ends_with(file_name, ".rev")))
@@ -934,7 +991,7 @@ unsigned long repo_approximate_object_count(struct repository *r)
 		prepare_packed_git(r);
 		count = 0;
 		for (m = get_multi_pack_index(r); m; m = m->next)
-			count += m->num_objects;
+			count += m->num_objects + m->num_objects_in_base;
 		for (p = r->objects->packed_git; p; p = p->next) {
 			if (open_pack_index(p))
 				continue;
@@ -1062,7 +1119,7 @@ struct packed_git *get_all_packs(struct repository *r)
 	prepare_packed_git(r);
 	for (m = r->objects->multi_pack_index; m; m = m->next) {
 		uint32_t i;
-		for (i = 0; i < m->num_packs; i++)
+		for (i = 0; i < m->num_packs + m->num_packs_in_base; i++)
 			prepare_midx_pack(r, m, i);
 	}
 
@@ -1228,8 +1285,14 @@ off_t get_delta_base(struct packed_git *p,
 			return 0;  /* out of bound */
 		*curpos += used;
 	} else if (type == OBJ_REF_DELTA) {
-		/* The base entry _must_ be in the same pack */
+		/*
+		 * The base entry _must_ be in the same pack. Looking it up
+		 * may need to open the pack index, which unpack_entry()
+		 * callers do not otherwise hold obj_read_lock() for.
+		 */
+		obj_read_lock();
 		base_offset = find_pack_entry_one(base_info, p);
+		obj_read_unlock();
 		*curpos += the_hash_algo->rawsz;
 	} else
 		die("I am totally screwed");
@@ -1447,16 +1510,22 @@ static void *cache_or_unpack_entry(struct repository *r, struct packed_git *p,
 				   enum object_type *type)
 {
 	struct delta_base_cache_entry *ent;
+	void *data;
 
+	delta_base_cache_lock();
 	ent = get_delta_base_cache_entry(p, base_offset);
-	if (!ent)
+	if (!ent) {
+		delta_base_cache_unlock();
 		return unpack_entry(r, p, base_offset, type, base_size);
+	}
 
 	if (type)
 		*type = ent->type;
 	if (base_size)
 		*base_size = ent->size;
-	return xmemdupz(ent->data, ent->size);
+	data = xmemdupz(ent->data, ent->size);
+	delta_base_cache_unlock();
+	return data;
 }
 
 static inline void release_delta_base_cache(struct delta_base_cache_entry *ent)
@@ -1468,11 +1537,14 @@ static inline void release_delta_base_cache(struct delta_base_cache_entry *ent)
 void clear_delta_base_cache(void)
 {
 	struct list_head *lru, *tmp;
+
+	delta_base_cache_lock();
 	list_for_each_safe(lru, tmp, &delta_base_cache_lru) {
 		struct delta_base_cache_entry *entry =
 			list_entry(lru, struct delta_base_cache_entry, lru);
 		release_delta_base_cache(entry);
 	}
+	delta_base_cache_unlock();
 }
 
 static void add_delta_base_cache(struct packed_git *p, off_t base_offset,
@@ -1481,12 +1553,15 @@ static void add_delta_base_cache(struct packed_git *p, off_t base_offset,
 	struct delta_base_cache_entry *ent;
 	struct list_head *lru, *tmp;
 
+	delta_base_cache_lock();
+
 	/*
 	 * Check required to avoid redundant entries when more than one thread
 	 * is unpacking the same object, in unpack_entry() (since its phases I
 	 * and III might run concurrently across multiple threads).
 	 */
 	if (in_delta_base_cache(p, base_offset)) {
+		delta_base_cache_unlock();
 		free(base);
 		return;
 	}
@@ -1513,6 +1588,7 @@ static void add_delta_base_cache(struct packed_git *p, off_t base_offset,
 		hashmap_init(&delta_base_cache, delta_base_cache_hash_cmp, NULL, 0);
 	hashmap_entry_init(&ent->ent, pack_entry_hash(p, base_offset));
 	hashmap_add(&delta_base_cache, &ent->ent);
+	delta_base_cache_unlock();
 }
 
 int packed_object_info(struct repository *r, struct packed_git *p,
@@ -1625,14 +1701,13 @@ static void *unpack_compressed_entry(struct packed_git *p,
 		in = use_pack(p, w_curs, curpos, &stream.avail_in);
 		stream.next_in = in;
 		/*
-		 * Note: we must ensure the window section returned by
-		 * use_pack() will be available throughout git_inflate()'s
-		 * unlocked execution. Please refer to the comment at
-		 * get_size_from_delta() to see how this is done.
+		 * Note: this runs without obj_read_lock() held (see
+		 * unpack_entry()), so we rely on the window's inuse_cnt to
+		 * keep the section returned by use_pack() mapped while we
+		 * inflate it. Please refer to the comment at
+		 * get_size_from_delta() for details.
 		 */
-		obj_read_unlock();
 		st = git_inflate(&stream, Z_FINISH);
-		obj_read_lock();
 		if (!stream.avail_out)
 			break; /* the payload is larger than it should be */
 		curpos += stream.next_in - in;
@@ -1680,12 +1755,22 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 
 	write_pack_access_log(p, obj_offset);
 
+	/*
+	 * Inflating and applying deltas only touches our own buffers, the
+	 * pack windows and the delta base cache, all of which have locks
+	 * of their own. Let other threads look up and read objects in the
+	 * meantime; the few spots below which need other parts of the
+	 * object store retake obj_read_lock() themselves.
+	 */
+	obj_read_unlock();
+
 	/* PHASE 1: drill down to the innermost base object */
 	for (;;) {
 		off_t base_offset;
 		int i;
 		struct delta_base_cache_entry *ent;
 
+		delta_base_cache_lock();
 		ent = get_delta_base_cache_entry(p, curpos);
 		if (ent) {
 			type = ent->type;
@@ -1693,16 +1778,20 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 			size = ent->size;
 			detach_delta_base_cache_entry(ent);
 			base_from_cache = 1;
-			break;
 		}
+		delta_base_cache_unlock();
+		if (base_from_cache)
+			break;
 
 		if (do_check_packed_object_crc && p->index_version > 1) {
 			uint32_t pack_pos, index_pos;
 			off_t len;
 
+			obj_read_lock();
 			if (offset_to_pack_pos(p, obj_offset, &pack_pos) < 0) {
 				error("could not find object at offset %"PRIuMAX" in pack %s",
 				      (uintmax_t)obj_offset, p->pack_name);
+				obj_read_unlock();
 				data = NULL;
 				goto out;
 			}
@@ -1715,9 +1804,11 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 				error("bad packed object CRC for %s",
 				      oid_to_hex(&oid));
 				mark_bad_packed_object(p, &oid);
+				obj_read_unlock();
 				data = NULL;
 				goto out;
 			}
+			obj_read_unlock();
 		}
 
 		type = unpack_object_header(p, &w_curs, &curpos, &size);
@@ -1796,6 +1887,8 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 			 */
 			uint32_t pos;
 			struct object_id base_oid;
+
+			obj_read_lock();
 			if (!(offset_to_pack_pos(p, obj_offset, &pos))) {
 				struct object_info oi = OBJECT_INFO_INIT;
 
@@ -1815,6 +1908,7 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 
 				external_base = base;
 			}
+			obj_read_unlock();
 		}
 
 		i = --delta_stack_nr;
@@ -1851,9 +1945,8 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 
 		/*
 		 * We delay adding `base` to the cache until the end of the loop
-		 * because unpack_compressed_entry() momentarily releases the
-		 * obj_read_mutex, giving another thread the chance to access
-		 * the cache. Therefore, if `base` was already there, this other
+		 * because other threads may access the cache while we are
+		 * working on it. Therefore, if `base` was already there, another
 		 * thread could free() it (e.g. to make space for another entry)
 		 * before we are done using it.
 		 */
@@ -1871,6 +1964,7 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 
 out:
 	unuse_pack(&w_curs);
+	obj_read_lock();
 
 	if (delta_stack != small_delta_stack)
 		free(delta_stack);
@@ -1977,7 +2071,7 @@ off_t find_pack_entry_one(const unsigned char *sha1,
 	return 0;
 }
 
-int is_pack_valid(struct packed_git *p)
+static int is_pack_valid_1(struct packed_git *p)
 {
 	/* An already open pack is known to be valid. */
 	if (p->pack_fd != -1)
@@ -1998,6 +2092,17 @@ int is_pack_valid(struct packed_git *p)
 	return !open_packed_git(p);
 }
 
+int is_pack_valid(struct packed_git *p)
+{
+	int ret;
+
+	pack_window_lock();
+	ret = is_pack_valid_1(p);
+	pack_window_unlock();
+
+	return ret;
+}
+
 struct packed_git *find_sha1_pack(const unsigned char *sha1,
 				  struct packed_git *packs)
 {
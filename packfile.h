@@ -107,6 +107,13 @@ void close_pack(struct packed_git *);
 void close_object_store(struct raw_object_store *o);
 void unuse_pack(struct pack_window **);
 void clear_delta_base_cache(void);
+
+/*
+ * Set up (or tear down) the locks protecting pack windows and the delta
+ * base cache; see enable_obj_read_lock().
+ */
+void init_pack_read_locks(void);
+void destroy_pack_read_locks(void);
 struct packed_git *add_packed_git(const char *path, size_t path_len, int local);
 
 /*
@@ -154,6 +161,15 @@ off_t nth_packed_object_offset(const struct packed_git *, uint32_t n);
 off_t find_pack_entry_one(const unsigned char *sha1, struct packed_git *);
 
 int is_pack_valid(struct packed_git *);
+
+/*
+ * Read the object at "offset" in pack "p", resolving deltas.
+ *
+ * If obj_read_use_lock is set, the caller must hold obj_read_lock():
+ * unpack_entry() drops it while inflating and applying deltas and takes
+ * it again before returning. Callers that only run while the lock is
+ * disabled, such as fast-import, need not care.
+ */
 void *unpack_entry(struct repository *r, struct packed_git *, off_t, enum object_type *, unsigned long *);
 unsigned long unpack_object_header_buffer(const unsigned char *buf, unsigned long len, enum object_type *type, unsigned long *sizep);
 unsigned long get_size_from_delta(struct packed_git *, struct pack_window **, off_t);
@@ -13,6 +13,7 @@
 #include "read-cache.h"
 #include "thread-utils.h"
 #include "repository.h"
+#include "stat-batch.h"
 #include "symlinks.h"
 #include "trace2.h"
 
@@ -25,6 +26,12 @@
 #define MAX_PARALLEL (20)
 #define THREAD_COST (500)
 
+/*
+ * How many lstat's each thread keeps in flight at once, where the
+ * platform lets us batch them (see stat-batch.h).
+ */
+#define STAT_BATCH_SIZE (64)
+
 struct progress_data {
 	unsigned long n;
 	struct progress *progress;
@@ -38,8 +45,23 @@ struct thread_data {
 	struct progress_data *progress;
 	int offset, nr;
 	int t2_nr_lstat;
+	int t2_nr_batched;
 };
 
+static void preload_entry(struct index_state *index, struct cache_entry *ce,
+			  struct stat *st)
+{
+	if (ie_match_stat(index, ce, st, CE_MATCH_RACY_IS_DIRTY|CE_MATCH_IGNORE_FSMONITOR))
+		return;
+	ce_mark_uptodate(ce);
+	mark_fsmonitor_valid(index, ce);
+}
+
+static void preload_batched_entry(void *item, struct stat *st, void *cb_data)
+{
+	preload_entry(cb_data, item, st);
+}
+
 static void *preload_thread(void *_data)
 {
 	int nr, last_nr;
@@ -47,6 +69,7 @@ static void *preload_thread(void *_data)
 	struct index_state *index = p->index;
 	struct cache_entry **cep = index->cache + p->offset;
 	struct cache_def cache = CACHE_DEF_INIT;
+	struct stat_batch *batch = stat_batch_new(STAT_BATCH_SIZE);
 
 	nr = p->nr;
 	if (nr + p->offset > index->cache_nr)
@@ -81,13 +104,21 @@ static void *preload_thread(void *_data)
 		if (threaded_has_symlink_leading_path(&cache, ce->name, ce_namelen(ce)))
 			continue;
 		p->t2_nr_lstat++;
-		if (lstat(ce->name, &st))
+		if (batch) {
+			p->t2_nr_batched++;
+			if (stat_batch_add(batch, ce->name, ce))
+				stat_batch_run(batch, preload_batched_entry,
+					       index);
 			continue;
-		if (ie_match_stat(index, ce, &st, CE_MATCH_RACY_IS_DIRTY|CE_MATCH_IGNORE_FSMONITOR))
+		}
+		if (lstat(ce->name, &st))
 			continue;
-		ce_mark_uptodate(ce);
-		mark_fsmonitor_valid(index, ce);
+		preload_entry(index, ce, &st);
 	} while (--nr > 0);
+	if (batch) {
+		stat_batch_run(batch, preload_batched_entry, index);
+		stat_batch_free(batch);
+	}
 	if (p->progress) {
 		struct progress_data *pd = p->progress;
 
@@ -107,6 +138,7 @@ void preload_index(struct index_state *index,
 	struct thread_data data[MAX_PARALLEL];
 	struct progress_data pd;
 	int t2_sum_lstat = 0;
+	int t2_sum_batched = 0;
 
 	if (!HAVE_THREADS || !core_preload_index)
 		return;
@@ -154,6 +186,7 @@ void preload_index(struct index_state *index,
 		if (pthread_join(p->pthread, NULL))
 			die("unable to join threaded lstat");
 		t2_sum_lstat += p->t2_nr_lstat;
+		t2_sum_batched += p->t2_nr_batched;
 	}
 	stop_progress(&pd.progress);
 
@@ -166,6 +199,9 @@ void preload_index(struct index_state *index,
 	trace_performance_leave("preload index");
 
 	trace2_data_intmax("index", NULL, "preload/sum_lstat", t2_sum_lstat);
+	if (t2_sum_batched)
+		trace2_data_intmax("index", NULL, "preload/sum_batched_lstat",
+				   t2_sum_batched);
 	trace2_region_leave("index", "preload", NULL);
 }
 
@@ -1,6 +1,7 @@
 #include "git-compat-util.h"
 #include "config.h"
 #include "commit.h"
+#include "commit-graph.h"
 #include "environment.h"
 #include "gettext.h"
 #include "hash.h"
@@ -880,6 +881,9 @@ struct format_commit_context {
 	const struct pretty_print_context *pretty_ctx;
 	unsigned commit_header_parsed:1;
 	unsigned commit_message_parsed:1;
+	unsigned graph_metadata_looked_up:1;
+	unsigned graph_metadata_found:1;
+	struct commit_graph_log_metadata graph_metadata;
 	struct signature_check signature_check;
 	enum flush_type flush_type;
 	enum trunc_type truncate;
@@ -1422,6 +1426,61 @@ static void free_decoration_options(const struct decoration_options *opts)
 	free(opts->tag);
 }
 
+/*
+ * Serve the idents and the subject from the commit-graph, if it has them,
+ * so that we do not have to read the commit object for them.
+ */
+static size_t format_commit_from_graph(struct strbuf *sb, /* in UTF-8 */
+				       const char *placeholder,
+				       struct format_commit_context *c)
+{
+	struct commit_graph_log_metadata *meta = &c->graph_metadata;
+	struct strbuf person = STRBUF_INIT;
+	const char *eol;
+	size_t res;
+
+	switch (placeholder[0]) {
+	case 'a':
+	case 'c':
+	case 's':
+	case 'f':
+		break;
+	default:
+		return 0;
+	}
+
+	if (!c->graph_metadata_looked_up) {
+		c->graph_metadata_looked_up = 1;
+		c->graph_metadata_found =
+			commit_graph_log_metadata(c->repository, c->commit, meta);
+	}
+	if (!c->graph_metadata_found)
+		return 0;
+
+	switch (placeholder[0]) {
+	case 'a':	/* author ... */
+		strbuf_addf(&person, "%s %"PRItime" %+05d", meta->author,
+			    meta->author_date, meta->author_tz);
+		break;
+	case 'c':	/* committer ... */
+		strbuf_addf(&person, "%s %"PRItime" %+05d", meta->committer,
+			    meta->committer_date, meta->committer_tz);
+		break;
+	case 's':	/* subject */
+		format_subject(sb, meta->subject, " ");
+		return 1;
+	case 'f':	/* sanitized subject */
+		eol = strchrnul(meta->subject, '\n');
+		format_sanitized_subject(sb, meta->subject, eol - meta->subject);
+		return 1;
+	}
+
+	res = format_person_part(sb, placeholder[1], person.buf, person.len,
+				 &c->pretty_ctx->date_mode);
+	strbuf_release(&person);
+	return res;
+}
+
 static size_t format_commit_one(struct strbuf *sb, /* in UTF-8 */
 				const char *placeholder,
 				void *context)
@@ -1700,6 +1759,12 @@ static size_t format_commit_one(struct strbuf *sb, /* in UTF-8 */
 		return ret;
 	}
 
+	if (!c->commit_header_parsed) {
+		res = format_commit_from_graph(sb, placeholder, c);
+		if (res)
+			return res;
+	}
+
 	/* For the rest we have to parse the commit header. */
 	if (!c->commit_header_parsed) {
 		msg = c->message =
@@ -0,0 +1,286 @@
+#include "git-compat-util.h"
+#include "commit.h"
+#include "config.h"
+#include "date.h"
+#include "gettext.h"
+#include "hash.h"
+#include "pseudo-merge.h"
+#include "refs.h"
+#include "repository.h"
+#include "strbuf.h"
+#include "string-list.h"
+#include "strmap.h"
+
+#define DEFAULT_PSEUDO_MERGE_THRESHOLD "1.week.ago"
+#define DEFAULT_PSEUDO_MERGE_MAX_MERGES 64
+
+struct pseudo_merge_group {
+	char *name;
+	regex_t *pattern;
+	timestamp_t threshold;
+	int max_merges;
+};
+
+struct pseudo_merge_data {
+	struct repository *repo;
+
+	struct pseudo_merge_group *groups;
+	size_t groups_nr, groups_alloc;
+
+	/* Maps "<group>\n<captures>" to a "struct pseudo_merge_commits". */
+	struct strmap matches;
+
+	int (*include)(struct commit *, void *);
+	void *include_data;
+};
+
+static struct pseudo_merge_group *find_group(struct pseudo_merge_data *data,
+					     const char *name, size_t len)
+{
+	struct pseudo_merge_group *group;
+	size_t i;
+
+	for (i = 0; i < data->groups_nr; i++) {
+		group = &data->groups[i];
+		if (!strncmp(group->name, name, len) && !group->name[len])
+			return group;
+	}
+
+	ALLOC_GROW(data->groups, data->groups_nr + 1, data->groups_alloc);
+	group = &data->groups[data->groups_nr++];
+	memset(group, 0, sizeof(*group));
+	group->name = xmemdupz(name, len);
+	group->threshold = approxidate(DEFAULT_PSEUDO_MERGE_THRESHOLD);
+	group->max_merges = DEFAULT_PSEUDO_MERGE_MAX_MERGES;
+	return group;
+}
+
+static int pseudo_merge_config(const char *var, const char *value,
+			       const struct config_context *ctx, void *cb)
+{
+	struct pseudo_merge_data *data = cb;
+	struct pseudo_merge_group *group;
+	const char *name, *key;
+	size_t name_len;
+
+	if (parse_config_key(var, "bitmappseudomerge", &name, &name_len, &key) ||
+	    !name)
+		return 0;
+
+	group = find_group(data, name, name_len);
+
+	if (!strcmp(key, "pattern")) {
+		struct strbuf re = STRBUF_INIT;
+
+		if (!value)
+			return config_error_nonbool(var);
+
+		if (group->pattern) {
+			regfree(group->pattern);
+			FREE_AND_NULL(group->pattern);
+		}
+
+		if (*value != '^')
+			strbuf_addch(&re, '^');
+		strbuf_addstr(&re, value);
+
+		group->pattern = xmalloc(sizeof(*group->pattern));
+		if (regcomp(group->pattern, re.buf, REG_EXTENDED))
+			die(_("failed to load pseudo-merge regex for '%s': %s"),
+			    var, re.buf);
+		strbuf_release(&re);
+	} else if (!strcmp(key, "threshold")) {
+		int errors = 0;
+
+		if (!value)
+			return config_error_nonbool(var);
+		group->threshold = approxidate_careful(value, &errors);
+		if (errors)
+			return error(_("invalid date for '%s': %s"), var, value);
+	} else if (!strcmp(key, "maxmerges")) {
+		group->max_merges = git_config_int(var, value, ctx->kvi);
+		if (group->max_merges <= 0)
+			return error(_("'%s' must be positive"), var);
+	}
+
+	return 0;
+}
+
+static int find_pseudo_merge_for_ref(const char *refname,
+				     const struct object_id *oid,
+				     int flags UNUSED, void *cb)
+{
+	struct pseudo_merge_data *data = cb;
+	struct pseudo_merge_group *group = NULL;
+	struct pseudo_merge_commits *merge;
+	struct strbuf key = STRBUF_INIT;
+	struct commit *tip;
+	regmatch_t matches[16];
+	size_t i;
+	int m;
+
+	for (i = 0; i < data->groups_nr; i++) {
+		if (!data->groups[i].pattern)
+			continue;
+		if (!regexec(data->groups[i].pattern, refname,
+			     ARRAY_SIZE(matches), matches, 0)) {
+			group = &data->groups[i];
+			break;
+		}
+	}
+
+	if (!group)
+		return 0;
+
+	tip = lookup_commit_reference_gently(data->repo, oid, 1);
+	if (!tip || repo_parse_commit(data->repo, tip))
+		return 0;
+
+	/*
+	 * Recent tips are likely to move again soon, which would leave the
+	 * pseudo-merges containing them stale; leave those to the regular
+	 * per-commit bitmaps.
+	 */
+	if (tip->date > group->threshold)
+		return 0;
+
+	if (data->include && !data->include(tip, data->include_data))
+		return 0;
+
+	/*
+	 * Refs that match the same pattern but differ in what its capture
+	 * groups matched go into different pseudo-merges.
+	 */
+	strbuf_addf(&key, "%s\n", group->name);
+	for (m = 1; m < ARRAY_SIZE(matches); m++) {
+		regmatch_t *match = &matches[m];
+
+		if (match->rm_so == -1)
+			continue;
+
+		strbuf_addch(&key, '-');
+		strbuf_add(&key, refname + match->rm_so,
+			   match->rm_eo - match->rm_so);
+	}
+
+	merge = strmap_get(&data->matches, key.buf);
+	if (!merge) {
+		CALLOC_ARRAY(merge, 1);
+		strmap_put(&data->matches, key.buf, merge);
+	}
+
+	ALLOC_GROW(merge->commits, merge->nr + 1, merge->alloc);
+	merge->commits[merge->nr++] = tip;
+
+	strbuf_release(&key);
+	return 0;
+}
+
+static int commit_date_cmp(const void *va, const void *vb)
+{
+	const struct commit *a = *(const struct commit **)va;
+	const struct commit *b = *(const struct commit **)vb;
+
+	if (a->date < b->date)
+		return -1;
+	if (a->date > b->date)
+		return 1;
+	return oidcmp(&a->object.oid, &b->object.oid);
+}
+
+void select_pseudo_merges(struct repository *r,
+			  int (*include)(struct commit *, void *),
+			  void *include_data,
+			  struct pseudo_merge_commits **out, size_t *out_nr)
+{
+	struct pseudo_merge_data data = {
+		.repo = r,
+		.include = include,
+		.include_data = include_data,
+	};
+	struct string_list keys = STRING_LIST_INIT_NODUP;
+	struct pseudo_merge_commits *merges = NULL;
+	size_t merges_nr = 0, merges_alloc = 0;
+	struct hashmap_iter iter;
+	struct strmap_entry *e;
+	struct string_list_item *item;
+	size_t i;
+
+	*out = NULL;
+	*out_nr = 0;
+
+	repo_config(r, pseudo_merge_config, &data);
+	if (!data.groups_nr)
+		return;
+
+	strmap_init(&data.matches);
+	refs_for_each_ref(get_main_ref_store(r), find_pseudo_merge_for_ref,
+			  &data);
+
+	strmap_for_each_entry(&data.matches, &iter, e)
+		string_list_append(&keys, e->key)->util = e->value;
+	string_list_sort(&keys);
+
+	for_each_string_list_item(item, &keys) {
+		struct pseudo_merge_commits *matched = item->util;
+		struct pseudo_merge_group *group;
+		size_t nr = 0, per_merge, j;
+
+		group = find_group(&data, item->string,
+				   strchrnul(item->string, '\n') - item->string);
+
+		/*
+		 * Group the tips by age, so that the older (and hence more
+		 * stable) ones end up in the same pseudo-merges.
+		 */
+		QSORT(matched->commits, matched->nr, commit_date_cmp);
+		for (j = 0; j < matched->nr; j++) {
+			if (nr && matched->commits[nr - 1] == matched->commits[j])
+				continue;
+			matched->commits[nr++] = matched->commits[j];
+		}
+		matched->nr = nr;
+
+		per_merge = DIV_ROUND_UP(matched->nr, group->max_merges);
+		for (j = 0; j < matched->nr; j += per_merge) {
+			struct pseudo_merge_commits *merge;
+			size_t n = matched->nr - j;
+
+			if (n > per_merge)
+				n = per_merge;
+
+			ALLOC_GROW(merges, merges_nr + 1, merges_alloc);
+			merge = &merges[merges_nr++];
+			memset(merge, 0, sizeof(*merge));
+			ALLOC_ARRAY(merge->commits, n);
+			COPY_ARRAY(merge->commits, matched->commits + j, n);
+			merge->nr = merge->alloc = n;
+		}
+
+		free(matched->commits);
+		free(matched);
+	}
+
+	string_list_clear(&keys, 0);
+	strmap_clear(&data.matches, 0);
+	for (i = 0; i < data.groups_nr; i++) {
+		if (data.groups[i].pattern) {
+			regfree(data.groups[i].pattern);
+			free(data.groups[i].pattern);
+		}
+		free(data.groups[i].name);
+	}
+	free(data.groups);
+
+	*out = merges;
+	*out_nr = merges_nr;
+}
+
+void free_pseudo_merges(struct pseudo_merge_commits *merges, size_t nr)
+{
+	size_t i;
+
+	for (i = 0; i < nr; i++)
+		free(merges[i].commits);
+	free(merges);
+}
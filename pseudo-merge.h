@@ -0,0 +1,37 @@
+#ifndef PSEUDO_MERGE_H
+#define PSEUDO_MERGE_H
+
+struct commit;
+struct repository;
+
+/*
+ * A pseudo-merge is a group of commits (usually ref tips) that the bitmap
+ * writer treats as the parents of an imaginary merge commit. Its bitmap
+ * holds the union of their reachability, so that a traversal which wants
+ * all of them can OR in a single bitmap instead of walking to (or
+ * combining the bitmaps of) each one.
+ *
+ * The groups are configured with "bitmapPseudoMerge.<name>.*"; see
+ * Documentation/config/bitmap-pseudo-merge.txt.
+ */
+struct pseudo_merge_commits {
+	struct commit **commits;
+	size_t nr, alloc;
+};
+
+/*
+ * Select the pseudo-merges to write from the refs of "r". Only ref tips
+ * for which "include" returns non-zero are considered, which lets the
+ * caller restrict them to the commits in the pack being bitmapped.
+ *
+ * The pseudo-merges are returned in "*out" (which the caller frees with
+ * free_pseudo_merges()), and their number in "*out_nr".
+ */
+void select_pseudo_merges(struct repository *r,
+			  int (*include)(struct commit *, void *),
+			  void *include_data,
+			  struct pseudo_merge_commits **out, size_t *out_nr);
+
+void free_pseudo_merges(struct pseudo_merge_commits *merges, size_t nr);
+
+#endif
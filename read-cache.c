@@ -3343,6 +3343,9 @@ int write_locked_index(struct index_state *istate, struct lock_file *lock,
 		return 0;
 	}
 
+	/* Make the objects the index refers to visible first. */
+	flush_odb_transaction();
+
 	if (istate->fsmonitor_last_update)
 		fill_fsmonitor_bitmap(istate);
 
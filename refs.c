@@ -4,12 +4,14 @@
 
 #include "git-compat-util.h"
 #include "advice.h"
+#include "bulk-checkin.h"
 #include "config.h"
 #include "environment.h"
 #include "hashmap.h"
 #include "gettext.h"
 #include "hex.h"
 #include "lockfile.h"
+#include "tempfile.h"
 #include "iterator.h"
 #include "refs.h"
 #include "refs/refs-internal.h"
@@ -29,6 +31,7 @@
 #include "date.h"
 #include "commit.h"
 #include "wildmatch.h"
+#include "write-or-die.h"
 
 /*
  * List of all available backends
@@ -2248,6 +2251,51 @@ int create_symref(const char *ref_target, const char *refs_heads_master,
 				  refs_heads_master, logmsg);
 }
 
+/* Whether fsync_ref_file() left data waiting for a flush. */
+static int ref_fsync_batch_pending;
+
+int fsync_ref_file(int fd)
+{
+	int ret = fsync_component_deferred(FSYNC_COMPONENT_REFERENCE, fd);
+
+	if (ret > 0) {
+		ref_fsync_batch_pending = 1;
+		ret = 0;
+	}
+	return ret;
+}
+
+int flush_ref_fsync_batch(const char *dir)
+{
+	struct strbuf path = STRBUF_INIT;
+	struct tempfile *temp;
+	int ret = 0;
+
+	if (!ref_fsync_batch_pending)
+		return 0;
+
+	/*
+	 * The files themselves have only been written out to the disk,
+	 * which may still hold them in its cache. A single full fsync()
+	 * of a dummy file flushes that cache, making all of them durable
+	 * before the caller renames any into place.
+	 */
+	strbuf_addf(&path, "%s/ref_fsync_XXXXXX", dir);
+	temp = mks_tempfile(path.buf);
+	if (!temp ||
+	    fsync_component(FSYNC_COMPONENT_REFERENCE, get_tempfile_fd(temp)) < 0)
+		ret = -1;
+	else
+		ref_fsync_batch_pending = 0;
+	if (temp) {
+		int save_errno = errno;
+		delete_tempfile(&temp);
+		errno = save_errno;
+	}
+	strbuf_release(&path);
+	return ret;
+}
+
 int ref_update_reject_duplicates(struct string_list *refnames,
 				 struct strbuf *err)
 {
@@ -2348,6 +2396,9 @@ int ref_transaction_prepare(struct ref_transaction *transaction,
 		return -1;
 	}
 
+	/* The objects we are about to point at must be visible first. */
+	flush_odb_transaction();
+
 	ret = refs->be->transaction_prepare(refs, transaction, err);
 	if (ret)
 		return ret;
@@ -1697,6 +1697,13 @@ static int files_log_ref_write(struct files_ref_store *refs,
 		return 0;
 	result = log_ref_write_fd(logfd, old_oid, new_oid,
 				  git_committer_info(0), msg);
+	/*
+	 * Reflogs are only appended to, and are not hardened on their own.
+	 * When the reference itself is about to be flushed in a batch,
+	 * though, the new entry may as well come along.
+	 */
+	if (!result && batch_fsync_enabled(FSYNC_COMPONENT_REFERENCE))
+		result = fsync_ref_file(logfd);
 	if (result) {
 		struct strbuf sb = STRBUF_INIT;
 		int save_errno = errno;
@@ -1755,7 +1762,7 @@ static int write_ref_to_lockfile(struct ref_lock *lock,
 	fd = get_lock_file_fd(&lock->lk);
 	if (write_in_full(fd, oid_to_hex(oid), the_hash_algo->hexsz) < 0 ||
 	    write_in_full(fd, &term, 1) < 0 ||
-	    fsync_component(FSYNC_COMPONENT_REFERENCE, get_lock_file_fd(&lock->lk)) < 0 ||
+	    fsync_ref_file(fd) < 0 ||
 	    close_ref_gently(lock) < 0) {
 		strbuf_addf(err,
 			    "couldn't write '%s'", get_lock_file_path(&lock->lk));
@@ -1820,6 +1827,13 @@ static int commit_ref_update(struct files_ref_store *refs,
 		}
 	}
 
+	if (flush_ref_fsync_batch(refs->gitcommondir)) {
+		strbuf_addf(err, "couldn't flush '%s': %s", lock->ref_name,
+			    strerror(errno));
+		unlock_ref(lock);
+		return -1;
+	}
+
 	if (commit_ref(lock)) {
 		strbuf_addf(err, "couldn't set '%s'", lock->ref_name);
 		unlock_ref(lock);
@@ -2800,6 +2814,26 @@ static int files_transaction_prepare(struct ref_store *ref_store,
 	return ret;
 }
 
+/* Move the new value of a reference into place, if there is one. */
+static int files_transaction_commit_update(struct files_ref_store *refs,
+					   struct ref_update *update,
+					   struct strbuf *err)
+{
+	struct ref_lock *lock = update->backend_data;
+
+	if (!(update->flags & REF_NEEDS_COMMIT))
+		return 0;
+
+	clear_loose_ref_cache(refs);
+	if (commit_ref(lock)) {
+		strbuf_addf(err, "couldn't set '%s'", lock->ref_name);
+		unlock_ref(lock);
+		update->backend_data = NULL;
+		return -1;
+	}
+	return 0;
+}
+
 static int files_transaction_finish(struct ref_store *ref_store,
 				    struct ref_transaction *transaction,
 				    struct strbuf *err)
@@ -2811,6 +2845,7 @@ static int files_transaction_finish(struct ref_store *ref_store,
 	struct strbuf sb = STRBUF_INIT;
 	struct files_transaction_backend_data *backend_data;
 	struct ref_transaction *packed_transaction;
+	int batch = batch_fsync_enabled(FSYNC_COMPONENT_REFERENCE);
 
 
 	assert(err);
@@ -2823,7 +2858,13 @@ static int files_transaction_finish(struct ref_store *ref_store,
 	backend_data = transaction->backend_data;
 	packed_transaction = backend_data->packed_transaction;
 
-	/* Perform updates first so live commits remain referenced */
+	/*
+	 * Perform updates first so live commits remain referenced.
+	 * Each reflog entry is written right before its reference is
+	 * moved into place, unless fsyncs are batched: then all the
+	 * entries are written first, so that one flush covers them
+	 * and the references.
+	 */
 	for (i = 0; i < transaction->nr; i++) {
 		struct ref_update *update = transaction->updates[i];
 		struct ref_lock *lock = update->backend_data;
@@ -2847,12 +2888,23 @@ static int files_transaction_finish(struct ref_store *ref_store,
 				goto cleanup;
 			}
 		}
-		if (update->flags & REF_NEEDS_COMMIT) {
-			clear_loose_ref_cache(refs);
-			if (commit_ref(lock)) {
-				strbuf_addf(err, "couldn't set '%s'", lock->ref_name);
-				unlock_ref(lock);
-				update->backend_data = NULL;
+		if (!batch && files_transaction_commit_update(refs, update, err)) {
+			ret = TRANSACTION_GENERIC_ERROR;
+			goto cleanup;
+		}
+	}
+
+	if (batch) {
+		if (flush_ref_fsync_batch(refs->gitcommondir)) {
+			strbuf_addf(err, "couldn't flush references: %s",
+				    strerror(errno));
+			ret = TRANSACTION_GENERIC_ERROR;
+			goto cleanup;
+		}
+		for (i = 0; i < transaction->nr; i++) {
+			if (files_transaction_commit_update(refs,
+							    transaction->updates[i],
+							    err)) {
 				ret = TRANSACTION_GENERIC_ERROR;
 				goto cleanup;
 			}
@@ -64,6 +64,11 @@ struct packed_ref_store;
  * `packed_ref_store`. Its freshness is checked whenever
  * `get_snapshot()` is called; if the existing snapshot is obsolete, a
  * new snapshot is taken.
+ *
+ * If the repository has `extensions.packedRefsDelta` set, the snapshot
+ * of `packed-refs` comes with a snapshot of `packed-refs.delta` (see
+ * `packed_ref_store::delta_path`), whose records take precedence over
+ * those of `packed-refs`.
  */
 struct snapshot {
 	/*
@@ -72,6 +77,16 @@ struct snapshot {
 	 */
 	struct packed_ref_store *refs;
 
+	/* Is this a snapshot of the `packed-refs.delta` file? */
+	int is_delta;
+
+	/*
+	 * The snapshot of `packed-refs.delta` that goes with this
+	 * snapshot of `packed-refs`, owned by it, or NULL if the
+	 * repository does not use one.
+	 */
+	struct snapshot *delta;
+
 	/* Is the `packed-refs` file currently mmapped? */
 	int mmapped;
 
@@ -99,6 +114,15 @@ struct snapshot {
 	 */
 	enum { PEELED_NONE, PEELED_TAGS, PEELED_FULLY } peeled;
 
+	/*
+	 * The "generation" trait of the file's header, or 0 if it has
+	 * none. In repositories with a `packed-refs.delta` file, the
+	 * `packed-refs` file counts up its generation every time it is
+	 * rewritten, and the delta file records the generation of the
+	 * `packed-refs` file it was written against.
+	 */
+	uintmax_t generation;
+
 	/*
 	 * Count of references to this instance, including the pointer
 	 * from `packed_ref_store::snapshot`, if any. The instance
@@ -150,14 +174,37 @@ struct packed_ref_store {
 	 */
 	struct lock_file lock;
 
+	/*
+	 * The path of the "packed-refs.delta" file, if the repository
+	 * has `extensions.packedRefsDelta` set; otherwise, NULL.
+	 *
+	 * The delta file has the same format as "packed-refs", but
+	 * holds only the references that were updated or deleted since
+	 * "packed-refs" was last written. A deleted reference has the
+	 * null object ID. Small transactions only rewrite the delta
+	 * file; once it gets too big compared to "packed-refs", it is
+	 * folded into the latter. The header of the delta file records
+	 * the generation of the "packed-refs" file it goes with, so that
+	 * readers can tell when the two files they read are from
+	 * different states, see create_snapshot().
+	 */
+	char *delta_path;
+
 	/*
 	 * Temporary file used when rewriting new contents to the
-	 * "packed-refs" file. Note that this (and thus the enclosing
-	 * `packed_ref_store`) must not be freed.
+	 * "packed-refs" or "packed-refs.delta" file. Note that this
+	 * (and thus the enclosing `packed_ref_store`) must not be
+	 * freed.
 	 */
 	struct tempfile *tempfile;
 };
 
+static const char *snapshot_path(struct snapshot *snapshot)
+{
+	return snapshot->is_delta ?
+		snapshot->refs->delta_path : snapshot->refs->path;
+}
+
 /*
  * Increment the reference count of `*snapshot`.
  */
@@ -176,7 +223,7 @@ static void clear_snapshot_buffer(struct snapshot *snapshot)
 	if (snapshot->mmapped) {
 		if (munmap(snapshot->buf, snapshot->eof - snapshot->buf))
 			die_errno("error ummapping packed-refs file %s",
-				  snapshot->refs->path);
+				  snapshot_path(snapshot));
 		snapshot->mmapped = 0;
 	} else {
 		free(snapshot->buf);
@@ -191,6 +238,8 @@ static void clear_snapshot_buffer(struct snapshot *snapshot)
 static int release_snapshot(struct snapshot *snapshot)
 {
 	if (!--snapshot->referrers) {
+		if (snapshot->delta)
+			release_snapshot(snapshot->delta);
 		stat_validity_clear(&snapshot->validity);
 		clear_snapshot_buffer(snapshot);
 		free(snapshot);
@@ -214,6 +263,12 @@ struct ref_store *packed_ref_store_create(struct repository *repo,
 	strbuf_addf(&sb, "%s/packed-refs", gitdir);
 	refs->path = strbuf_detach(&sb, NULL);
 	chdir_notify_reparent("packed-refs", &refs->path);
+
+	if (repo->repository_format_packed_refs_delta) {
+		strbuf_addf(&sb, "%s/packed-refs.delta", gitdir);
+		refs->delta_path = strbuf_detach(&sb, NULL);
+		chdir_notify_reparent("packed-refs-delta", &refs->delta_path);
+	}
 	return ref_store;
 }
 
@@ -355,7 +410,7 @@ static void sort_snapshot(struct snapshot *snapshot)
 			/* The safety check should prevent this. */
 			BUG("unterminated line found in packed-refs");
 		if (eol - pos < the_hash_algo->hexsz + 2)
-			die_invalid_line(snapshot->refs->path,
+			die_invalid_line(snapshot_path(snapshot),
 					 pos, eof - pos);
 		eol++;
 		if (eol < eof && *eol == '^') {
@@ -467,7 +522,7 @@ static void verify_buffer_safe(struct snapshot *snapshot)
 
 	last_line = find_start_of_record(start, eof - 1);
 	if (*(eof - 1) != '\n' || eof - last_line < the_hash_algo->hexsz + 2)
-		die_invalid_line(snapshot->refs->path,
+		die_invalid_line(snapshot_path(snapshot),
 				 last_line, eof - last_line);
 }
 
@@ -486,7 +541,7 @@ static int load_contents(struct snapshot *snapshot)
 	size_t size;
 	ssize_t bytes_read;
 
-	fd = open(snapshot->refs->path, O_RDONLY);
+	fd = open(snapshot_path(snapshot), O_RDONLY);
 	if (fd < 0) {
 		if (errno == ENOENT) {
 			/*
@@ -498,14 +553,14 @@ static int load_contents(struct snapshot *snapshot)
 			 */
 			return 0;
 		} else {
-			die_errno("couldn't read %s", snapshot->refs->path);
+			die_errno("couldn't read %s", snapshot_path(snapshot));
 		}
 	}
 
 	stat_validity_update(&snapshot->validity, fd);
 
 	if (fstat(fd, &st) < 0)
-		die_errno("couldn't stat %s", snapshot->refs->path);
+		die_errno("couldn't stat %s", snapshot_path(snapshot));
 	size = xsize_t(st.st_size);
 
 	if (!size) {
@@ -515,7 +570,7 @@ static int load_contents(struct snapshot *snapshot)
 		snapshot->buf = xmalloc(size);
 		bytes_read = read_in_full(fd, snapshot->buf, size);
 		if (bytes_read < 0 || bytes_read != size)
-			die_errno("couldn't read %s", snapshot->refs->path);
+			die_errno("couldn't read %s", snapshot_path(snapshot));
 		snapshot->mmapped = 0;
 	} else {
 		snapshot->buf = xmmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
@@ -613,9 +668,10 @@ static const char *find_reference_location_end(struct snapshot *snapshot,
 }
 
 /*
- * Create a newly-allocated `snapshot` of the `packed-refs` file in
- * its current state and return it. The return value will already have
- * its reference count incremented.
+ * Create a newly-allocated `snapshot` of the `packed-refs` file (or,
+ * if `is_delta` is set, of the `packed-refs.delta` file) in its
+ * current state and return it. The return value will already have its
+ * reference count incremented.
  *
  * A comment line of the form "# pack-refs with: " may contain zero or
  * more traits. We interpret the traits as follows:
@@ -645,12 +701,14 @@ static const char *find_reference_location_end(struct snapshot *snapshot,
  *
  *      The references in this file are known to be sorted by refname.
  */
-static struct snapshot *create_snapshot(struct packed_ref_store *refs)
+static struct snapshot *create_snapshot_1(struct packed_ref_store *refs,
+					  int is_delta)
 {
 	struct snapshot *snapshot = xcalloc(1, sizeof(*snapshot));
 	int sorted = 0;
 
 	snapshot->refs = refs;
+	snapshot->is_delta = is_delta;
 	acquire_snapshot(snapshot);
 	snapshot->peeled = PEELED_NONE;
 
@@ -661,18 +719,19 @@ static struct snapshot *create_snapshot(struct packed_ref_store *refs)
 	if (snapshot->buf < snapshot->eof && *snapshot->buf == '#') {
 		char *tmp, *p, *eol;
 		struct string_list traits = STRING_LIST_INIT_NODUP;
+		struct string_list_item *item;
 
 		eol = memchr(snapshot->buf, '\n',
 			     snapshot->eof - snapshot->buf);
 		if (!eol)
-			die_unterminated_line(refs->path,
+			die_unterminated_line(snapshot_path(snapshot),
 					      snapshot->buf,
 					      snapshot->eof - snapshot->buf);
 
 		tmp = xmemdupz(snapshot->buf, eol - snapshot->buf);
 
 		if (!skip_prefix(tmp, "# pack-refs with:", (const char **)&p))
-			die_invalid_line(refs->path,
+			die_invalid_line(snapshot_path(snapshot),
 					 snapshot->buf,
 					 snapshot->eof - snapshot->buf);
 
@@ -685,6 +744,13 @@ static struct snapshot *create_snapshot(struct packed_ref_store *refs)
 
 		sorted = unsorted_string_list_has_string(&traits, "sorted");
 
+		for_each_string_list_item(item, &traits) {
+			const char *value;
+
+			if (skip_prefix(item->string, "generation=", &value))
+				snapshot->generation = strtoumax(value, NULL, 10);
+		}
+
 		/* perhaps other traits later as well */
 
 		/* The "+ 1" is for the LF character. */
@@ -724,14 +790,60 @@ static struct snapshot *create_snapshot(struct packed_ref_store *refs)
 	return snapshot;
 }
 
+/*
+ * Create a newly-allocated `snapshot` of the `packed-refs` file, along
+ * with one of the `packed-refs.delta` file if the repository uses one,
+ * as described for `create_snapshot_1()`.
+ */
+static struct snapshot *create_snapshot(struct packed_ref_store *refs)
+{
+	struct snapshot *delta, *snapshot;
+
+	if (!refs->delta_path)
+		return create_snapshot_1(refs, 0);
+
+	/*
+	 * The delta file has to be read first: it is removed only after
+	 * it has been folded into `packed-refs`, so this way we never end
+	 * up with a `packed-refs` older than the one the delta file was
+	 * written against, which would lose the updates of all previous
+	 * delta files.
+	 *
+	 * The `packed-refs` file may still be newer, if the delta file
+	 * was folded between the two reads. Its stale records must not
+	 * take precedence over the newer values then. If the delta file
+	 * has changed since we read it, start over. Otherwise it is a
+	 * leftover of the fold, whose records are all in `packed-refs`
+	 * already, so ignore it.
+	 */
+	for (;;) {
+		delta = create_snapshot_1(refs, 1);
+		snapshot = create_snapshot_1(refs, 0);
+		if (delta->generation >= snapshot->generation)
+			break;
+		if (stat_validity_check(&delta->validity, refs->delta_path)) {
+			clear_snapshot_buffer(delta);
+			break;
+		}
+		release_snapshot(delta);
+		release_snapshot(snapshot);
+	}
+	snapshot->delta = delta;
+	return snapshot;
+}
+
 /*
  * Check that `refs->snapshot` (if present) still reflects the
- * contents of the `packed-refs` file. If not, clear the snapshot.
+ * contents of the `packed-refs` file and, if used, of the
+ * `packed-refs.delta` file. If not, clear the snapshot.
  */
 static void validate_snapshot(struct packed_ref_store *refs)
 {
 	if (refs->snapshot &&
-	    !stat_validity_check(&refs->snapshot->validity, refs->path))
+	    (!stat_validity_check(&refs->snapshot->validity, refs->path) ||
+	     (refs->snapshot->delta &&
+	      !stat_validity_check(&refs->snapshot->delta->validity,
+				   refs->delta_path))))
 		clear_snapshot(refs);
 }
 
@@ -755,6 +867,44 @@ static struct snapshot *get_snapshot(struct packed_ref_store *refs)
 	return refs->snapshot;
 }
 
+/*
+ * Does the record at `rec` in a `packed-refs.delta` file record the
+ * deletion of its reference, i.e., have the null object ID?
+ */
+static int is_deletion_record(const char *rec)
+{
+	size_t i;
+
+	for (i = 0; i < the_hash_algo->hexsz; i++)
+		if (rec[i] != '0')
+			return 0;
+	return 1;
+}
+
+/*
+ * Find the record for `refname` in `snapshot` or, taking precedence,
+ * in its delta, and set `*found_in` to the snapshot it was found in.
+ * Return NULL if there is none, or if the delta records the deletion
+ * of the reference.
+ */
+static const char *find_packed_ref(struct snapshot *snapshot,
+				   const char *refname,
+				   struct snapshot **found_in)
+{
+	if (snapshot->delta) {
+		const char *rec = find_reference_location(snapshot->delta,
+							  refname, 1);
+
+		if (rec) {
+			*found_in = snapshot->delta;
+			return is_deletion_record(rec) ? NULL : rec;
+		}
+	}
+
+	*found_in = snapshot;
+	return find_reference_location(snapshot, refname, 1);
+}
+
 static int packed_read_raw_ref(struct ref_store *ref_store, const char *refname,
 			       struct object_id *oid, struct strbuf *referent UNUSED,
 			       unsigned int *type, int *failure_errno)
@@ -766,7 +916,7 @@ static int packed_read_raw_ref(struct ref_store *ref_store, const char *refname,
 
 	*type = 0;
 
-	rec = find_reference_location(snapshot, refname, 1);
+	rec = find_packed_ref(snapshot, refname, &snapshot);
 
 	if (!rec) {
 		/* refname is not a packed reference. */
@@ -775,7 +925,8 @@ static int packed_read_raw_ref(struct ref_store *ref_store, const char *refname,
 	}
 
 	if (get_oid_hex(rec, oid))
-		die_invalid_line(refs->path, rec, snapshot->eof - rec);
+		die_invalid_line(snapshot_path(snapshot), rec,
+				 snapshot->eof - rec);
 
 	*type = REF_ISPACKED;
 	return 0;
@@ -803,6 +954,9 @@ struct packed_ref_iterator {
 	/* The end of the part of the buffer that will be iterated over: */
 	const char *eof;
 
+	/* The same for the buffer of the snapshot's delta, if any: */
+	const char *delta_pos, *delta_eof;
+
 	struct jump_list_entry {
 		const char *start;
 		const char *end;
@@ -827,6 +981,8 @@ struct packed_ref_iterator {
  */
 static int next_record(struct packed_ref_iterator *iter)
 {
+	struct snapshot *snapshot = iter->snapshot;
+	const char **pos = &iter->pos, *eof = iter->eof;
 	const char *p, *eol;
 
 	strbuf_reset(&iter->refname_buf);
@@ -852,22 +1008,53 @@ static int next_record(struct packed_ref_iterator *iter)
 		}
 	}
 
-	if (iter->pos == iter->eof)
+	/*
+	 * Records in the delta take precedence over those for the same
+	 * reference in the `packed-refs` file, and the ones recording
+	 * deletions are not reported.
+	 */
+	while (iter->delta_pos != iter->delta_eof) {
+		int cmp = 1;
+
+		if (iter->pos != iter->eof) {
+			struct snapshot_record rec = { .start = iter->pos };
+			struct snapshot_record delta_rec = {
+				.start = iter->delta_pos,
+			};
+
+			cmp = cmp_packed_ref_records(&rec, &delta_rec);
+		}
+		if (cmp < 0)
+			break;
+		if (!cmp)
+			iter->pos = find_end_of_record(iter->pos, iter->eof);
+
+		if (!is_deletion_record(iter->delta_pos)) {
+			snapshot = snapshot->delta;
+			pos = &iter->delta_pos;
+			eof = iter->delta_eof;
+			break;
+		}
+		iter->delta_pos = find_end_of_record(iter->delta_pos,
+						     iter->delta_eof);
+	}
+
+	if (*pos == eof)
 		return ITER_DONE;
 
 	iter->base.flags = REF_ISPACKED;
-	p = iter->pos;
+	p = *pos;
 
-	if (iter->eof - p < the_hash_algo->hexsz + 2 ||
+	if (eof - p < the_hash_algo->hexsz + 2 ||
 	    parse_oid_hex(p, &iter->oid, &p) ||
 	    !isspace(*p++))
-		die_invalid_line(iter->snapshot->refs->path,
-				 iter->pos, iter->eof - iter->pos);
+		die_invalid_line(snapshot_path(snapshot),
+				 *pos, eof - *pos);
 
-	eol = memchr(p, '\n', iter->eof - p);
+	eol = memchr(p, '\n', eof - p);
 	if (!eol)
-		die_unterminated_line(iter->snapshot->refs->path,
-				      iter->pos, iter->eof - iter->pos);
+		die_unterminated_line(snapshot_path(snapshot),
+				      *pos, eof - *pos);
 
 	strbuf_add(&iter->refname_buf, p, eol - p);
 	iter->base.refname = iter->refname_buf.buf;
@@ -879,21 +1066,21 @@ static int next_record(struct packed_ref_iterator *iter)
 		oidclr(&iter->oid);
 		iter->base.flags |= REF_BAD_NAME | REF_ISBROKEN;
 	}
-	if (iter->snapshot->peeled == PEELED_FULLY ||
-	    (iter->snapshot->peeled == PEELED_TAGS &&
+	if (snapshot->peeled == PEELED_FULLY ||
+	    (snapshot->peeled == PEELED_TAGS &&
 	     starts_with(iter->base.refname, "refs/tags/")))
 		iter->base.flags |= REF_KNOWS_PEELED;
 
-	iter->pos = eol + 1;
+	*pos = eol + 1;
 
-	if (iter->pos < iter->eof && *iter->pos == '^') {
-		p = iter->pos + 1;
-		if (iter->eof - p < the_hash_algo->hexsz + 1 ||
+	if (*pos < eof && **pos == '^') {
+		p = *pos + 1;
+		if (eof - p < the_hash_algo->hexsz + 1 ||
 		    parse_oid_hex(p, &iter->peeled, &p) ||
 		    *p++ != '\n')
-			die_invalid_line(iter->snapshot->refs->path,
-					 iter->pos, iter->eof - iter->pos);
-		iter->pos = p;
+			die_invalid_line(snapshot_path(snapshot),
+					 *pos, eof - *pos);
+		*pos = p;
 
 		/*
 		 * Regardless of what the file header said, we
@@ -1085,7 +1272,7 @@ static struct ref_iterator *packed_ref_iterator_begin(
 {
 	struct packed_ref_store *refs;
 	struct snapshot *snapshot;
-	const char *start;
+	const char *start, *delta_start = NULL, *delta_eof = NULL;
 	struct packed_ref_iterator *iter;
 	struct ref_iterator *ref_iterator;
 	unsigned int required_flags = REF_STORE_READ;
@@ -1106,7 +1293,16 @@ static struct ref_iterator *packed_ref_iterator_begin(
 	else
 		start = snapshot->start;
 
-	if (start == snapshot->eof)
+	if (snapshot->delta) {
+		if (prefix && *prefix)
+			delta_start = find_reference_location(snapshot->delta,
+							      prefix, 0);
+		else
+			delta_start = snapshot->delta->start;
+		delta_eof = snapshot->delta->eof;
+	}
+
+	if (start == snapshot->eof && delta_start == delta_eof)
 		return empty_ref_iterator_begin();
 
 	CALLOC_ARRAY(iter, 1);
@@ -1121,6 +1317,8 @@ static struct ref_iterator *packed_ref_iterator_begin(
 
 	iter->pos = start;
 	iter->eof = snapshot->eof;
+	iter->delta_pos = delta_start;
+	iter->delta_eof = delta_eof;
 	strbuf_init(&iter->refname_buf, 0);
 
 	iter->base.oid = &iter->oid;
@@ -1241,8 +1439,22 @@ int packed_refs_is_locked(struct ref_store *ref_store)
  * looking for " trait " in the line. For this reason, the space after
  * the colon and the trailing space are required.
  */
+#define PACKED_REFS_TRAITS "peeled fully-peeled sorted"
 static const char PACKED_REFS_HEADER[] =
-	"# pack-refs with: peeled fully-peeled sorted \n";
+	"# pack-refs with: " PACKED_REFS_TRAITS " \n";
+
+/*
+ * Write the header line, which in a repository with a delta file also
+ * records the given generation (see `snapshot::generation`).
+ */
+static int write_packed_refs_header(struct packed_ref_store *refs,
+				    FILE *out, uintmax_t generation)
+{
+	if (!refs->delta_path)
+		return fprintf(out, "%s", PACKED_REFS_HEADER);
+	return fprintf(out, "# pack-refs with: " PACKED_REFS_TRAITS
+		       " generation=%"PRIuMAX" \n", generation);
+}
 
 static int packed_init_db(struct ref_store *ref_store UNUSED,
 			  int flags UNUSED,
@@ -1300,7 +1512,8 @@ static int write_with_updates(struct packed_ref_store *refs,
 		goto error;
 	}
 
-	if (fprintf(out, "%s", PACKED_REFS_HEADER) < 0)
+	if (write_packed_refs_header(refs, out,
+				     get_snapshot(refs)->generation + 1) < 0)
 		goto write_error;
 
 	/*
@@ -1431,7 +1644,7 @@ static int write_with_updates(struct packed_ref_store *refs,
 	}
 
 	if (fflush(out) ||
-	    fsync_component(FSYNC_COMPONENT_REFERENCE, get_tempfile_fd(refs->tempfile)) ||
+	    fsync_ref_file(get_tempfile_fd(refs->tempfile)) ||
 	    close_tempfile_gently(refs->tempfile)) {
 		strbuf_addf(err, "error closing file %s: %s",
 			    get_tempfile_path(refs->tempfile),
@@ -1455,6 +1668,182 @@ static int write_with_updates(struct packed_ref_store *refs,
 	return -1;
 }
 
+/*
+ * Only write the `packed-refs.delta` file as long as it stays smaller
+ * than this fraction of the `packed-refs` file; otherwise fold it into
+ * the latter.
+ */
+#define PACKED_REFS_DELTA_RATIO 16
+
+/*
+ * Should the updates in `updates` be written to the `packed-refs.delta`
+ * file rather than to a new `packed-refs` file? Transactions with no
+ * updates at all are run for the side effect of rewriting
+ * `packed-refs`, so they never are.
+ */
+static int want_delta(struct packed_ref_store *refs,
+		      struct string_list *updates)
+{
+	struct snapshot *snapshot;
+	size_t size, i;
+
+	if (!refs->delta_path || !updates->nr)
+		return 0;
+
+	snapshot = get_snapshot(refs);
+	size = snapshot->delta->eof - snapshot->delta->start;
+	for (i = 0; i < updates->nr; i++)
+		/* "<oid> <refname>\n^<peeled>\n" at most */
+		size += 2 * the_hash_algo->hexsz +
+			strlen(updates->items[i].string) + 4;
+
+	return size <= (snapshot->eof - snapshot->start) / PACKED_REFS_DELTA_RATIO;
+}
+
+/*
+ * Like `write_with_updates()`, but write the new `packed-refs.delta`
+ * file to the tempfile instead, leaving `packed-refs` as it is: the
+ * records of the current delta file are passed through, except for
+ * those of references in `updates`, which get new records. Deletions
+ * of references that are in `packed-refs` are recorded with the null
+ * object ID.
+ */
+static int write_delta_with_updates(struct packed_ref_store *refs,
+				    struct string_list *updates,
+				    struct strbuf *err)
+{
+	struct snapshot *snapshot = get_snapshot(refs);
+	const char *pos = snapshot->delta->start, *eof = snapshot->delta->eof;
+	struct strbuf sb = STRBUF_INIT;
+	FILE *out;
+	size_t i;
+
+	if (!is_lock_file_locked(&refs->lock))
+		BUG("write_delta_with_updates() called while unlocked");
+
+	strbuf_addf(&sb, "%s.new", refs->delta_path);
+	refs->tempfile = create_tempfile(sb.buf);
+	if (!refs->tempfile) {
+		strbuf_addf(err, "unable to create file %s: %s",
+			    sb.buf, strerror(errno));
+		strbuf_release(&sb);
+		return -1;
+	}
+	strbuf_release(&sb);
+
+	out = fdopen_tempfile(refs->tempfile, "w");
+	if (!out) {
+		strbuf_addf(err, "unable to fdopen packed-refs tempfile: %s",
+			    strerror(errno));
+		goto error;
+	}
+
+	if (write_packed_refs_header(refs, out, snapshot->generation) < 0)
+		goto write_error;
+
+	for (i = 0; i < updates->nr; i++) {
+		struct ref_update *update = updates->items[i].util;
+		struct snapshot *found_in;
+		struct object_id oid;
+		const char *rec;
+		int cmp = 1;
+
+		/* Pass the records of the references before this one through: */
+		while (pos != eof) {
+			const char *end;
+
+			cmp = cmp_record_to_refname(pos, update->refname, 1);
+			if (cmp >= 0)
+				break;
+			end = find_end_of_record(pos, eof);
+			if (fwrite(pos, 1, end - pos, out) != end - pos)
+				goto write_error;
+			pos = end;
+		}
+		if (pos == eof)
+			cmp = 1;
+
+		rec = find_packed_ref(snapshot, update->refname, &found_in);
+		if (rec && get_oid_hex(rec, &oid))
+			die_invalid_line(snapshot_path(found_in), rec,
+					 found_in->eof - rec);
+
+		if ((update->flags & REF_HAVE_OLD)) {
+			if (is_null_oid(&update->old_oid)) {
+				if (rec) {
+					strbuf_addf(err, "cannot update ref '%s': "
+						    "reference already exists",
+						    update->refname);
+					goto error;
+				}
+			} else if (!rec) {
+				strbuf_addf(err, "cannot update ref '%s': "
+					    "reference is missing but expected %s",
+					    update->refname,
+					    oid_to_hex(&update->old_oid));
+				goto error;
+			} else if (!oideq(&update->old_oid, &oid)) {
+				strbuf_addf(err, "cannot update ref '%s': "
+					    "is at %s but expected %s",
+					    update->refname,
+					    oid_to_hex(&oid),
+					    oid_to_hex(&update->old_oid));
+				goto error;
+			}
+		}
+
+		if (!(update->flags & REF_HAVE_NEW))
+			continue;
+
+		/* The old record of the reference, if any, is superseded: */
+		if (!cmp)
+			pos = find_end_of_record(pos, eof);
+
+		if (is_null_oid(&update->new_oid)) {
+			/*
+			 * Only the deletion of a reference that is in
+			 * `packed-refs` has to be recorded.
+			 */
+			if (find_reference_location(snapshot, update->refname, 1) &&
+			    write_packed_entry(out, update->refname,
+					       null_oid(), NULL))
+				goto write_error;
+		} else {
+			struct object_id peeled;
+			int peel_error = peel_object(&update->new_oid,
+						     &peeled);
+
+			if (write_packed_entry(out, update->refname,
+					       &update->new_oid,
+					       peel_error ? NULL : &peeled))
+				goto write_error;
+		}
+	}
+
+	if (pos != eof && fwrite(pos, 1, eof - pos, out) != eof - pos)
+		goto write_error;
+
+	if (fflush(out) ||
+	    fsync_ref_file(get_tempfile_fd(refs->tempfile)) ||
+	    close_tempfile_gently(refs->tempfile)) {
+		strbuf_addf(err, "error closing file %s: %s",
+			    get_tempfile_path(refs->tempfile),
+			    strerror(errno));
+		delete_tempfile(&refs->tempfile);
+		return -1;
+	}
+
+	return 0;
+
+write_error:
+	strbuf_addf(err, "error writing to %s: %s",
+		    get_tempfile_path(refs->tempfile), strerror(errno));
+
+error:
+	delete_tempfile(&refs->tempfile);
+	return -1;
+}
+
 int is_packed_transaction_needed(struct ref_store *ref_store,
 				 struct ref_transaction *transaction)
 {
@@ -1554,6 +1943,12 @@ struct packed_transaction_backend_data {
 	/* True iff the transaction owns the packed-refs lock. */
 	int own_lock;
 
+	/*
+	 * True iff the transaction writes the packed-refs.delta file
+	 * rather than the packed-refs file.
+	 */
+	int delta;
+
 	struct string_list updates;
 };
 
@@ -1629,8 +2024,13 @@ static int packed_transaction_prepare(struct ref_store *ref_store,
 		data->own_lock = 1;
 	}
 
-	if (write_with_updates(refs, &data->updates, err))
+	data->delta = want_delta(refs, &data->updates);
+	if (data->delta) {
+		if (write_delta_with_updates(refs, &data->updates, err))
+			goto failure;
+	} else if (write_with_updates(refs, &data->updates, err)) {
 		goto failure;
+	}
 
 	transaction->state = REF_TRANSACTION_PREPARED;
 	return 0;
@@ -1661,18 +2061,40 @@ static int packed_transaction_finish(struct ref_store *ref_store,
 			ref_store,
 			REF_STORE_READ | REF_STORE_WRITE | REF_STORE_ODB,
 			"ref_transaction_finish");
+	struct packed_transaction_backend_data *data = transaction->backend_data;
 	int ret = TRANSACTION_GENERIC_ERROR;
-	char *packed_refs_path;
+	char *packed_refs_path = NULL;
 
 	clear_snapshot(refs);
 
-	packed_refs_path = get_locked_file_path(&refs->lock);
-	if (rename_tempfile(&refs->tempfile, packed_refs_path)) {
-		strbuf_addf(err, "error replacing %s: %s",
+	if (flush_ref_fsync_batch(refs->base.gitdir)) {
+		strbuf_addf(err, "error flushing %s: %s",
 			    refs->path, strerror(errno));
 		goto cleanup;
 	}
 
+	if (data->delta) {
+		if (rename_tempfile(&refs->tempfile, refs->delta_path)) {
+			strbuf_addf(err, "error replacing %s: %s",
+				    refs->delta_path, strerror(errno));
+			goto cleanup;
+		}
+	} else {
+		packed_refs_path = get_locked_file_path(&refs->lock);
+		if (rename_tempfile(&refs->tempfile, packed_refs_path)) {
+			strbuf_addf(err, "error replacing %s: %s",
+				    refs->path, strerror(errno));
+			goto cleanup;
+		}
+
+		/*
+		 * The delta file has been folded into the new
+		 * `packed-refs`; it must not go away any earlier.
+		 */
+		if (refs->delta_path)
+			unlink_or_warn(refs->delta_path);
+	}
+
 	ret = 0;
 
 cleanup:
@@ -153,6 +153,25 @@ int refs_read_raw_ref(struct ref_store *ref_store, const char *refname,
 		      struct object_id *oid, struct strbuf *referent,
 		      unsigned int *type, int *failure_errno);
 
+/*
+ * Harden a file about to become part of the references (a lockfile of
+ * a loose reference or of `packed-refs`, or a reflog), as configured
+ * for the "reference" component of `core.fsync`. Returns -1 on error.
+ *
+ * With `core.fsyncMethod=batch`, this only writes the data out, and
+ * flush_ref_fsync_batch() has to be called before the file is renamed
+ * into place. That way a transaction updating many references costs a
+ * single flush of the disk cache rather than one per file.
+ */
+int fsync_ref_file(int fd);
+
+/*
+ * Flush the disk cache if files were passed to fsync_ref_file() since
+ * the last call, by fsync()ing a dummy file created in `dir`. Returns
+ * -1 (with errno set) on error.
+ */
+int flush_ref_fsync_batch(const char *dir);
+
 /*
  * Write an error to `err` and return a nonzero value iff the same
  * refname appears multiple times in `refnames`. `refnames` must be
@@ -24,7 +24,7 @@ license that can be found in the LICENSE file or at
 #include <unistd.h>
 #include <string.h>
 
-static int compact_stack(const char *stackdir)
+static int compact_stack(const char *stackdir, int opt_auto)
 {
 	struct reftable_stack *stack = NULL;
 	struct reftable_write_options cfg = { 0 };
@@ -33,7 +33,10 @@ static int compact_stack(const char *stackdir)
 	if (err < 0)
 		goto done;
 
-	err = reftable_stack_compact_all(stack, NULL);
+	if (opt_auto)
+		err = reftable_stack_auto_compact(stack);
+	else
+		err = reftable_stack_compact_all(stack, NULL);
 	if (err < 0)
 		goto done;
 done:
@@ -45,8 +48,9 @@ static int compact_stack(const char *stackdir)
 
 static void print_help(void)
 {
-	printf("usage: dump [-cst] arg\n\n"
+	printf("usage: dump [-acst] arg\n\n"
 	       "options: \n"
+	       "  -a compact as needed, like after adding a table\n"
 	       "  -c compact\n"
 	       "  -t dump table\n"
 	       "  -s dump stack\n"
@@ -61,6 +65,7 @@ int reftable_dump_main(int argc, char *const *argv)
 	int opt_dump_table = 0;
 	int opt_dump_stack = 0;
 	int opt_compact = 0;
+	int opt_auto_compact = 0;
 	uint32_t opt_hash_id = GIT_SHA1_FORMAT_ID;
 	const char *arg = NULL, *argv0 = argv[0];
 
@@ -75,6 +80,8 @@ int reftable_dump_main(int argc, char *const *argv)
 			opt_dump_stack = 1;
 		else if (!strcmp("-c", argv[1]))
 			opt_compact = 1;
+		else if (!strcmp("-a", argv[1]))
+			opt_auto_compact = 1;
 		else if (!strcmp("-?", argv[1]) || !strcmp("-h", argv[1])) {
 			print_help();
 			return 2;
@@ -92,8 +99,8 @@ int reftable_dump_main(int argc, char *const *argv)
 		err = reftable_reader_print_file(arg);
 	} else if (opt_dump_stack) {
 		err = reftable_stack_print_directory(arg, opt_hash_id);
-	} else if (opt_compact) {
-		err = compact_stack(arg);
+	} else if (opt_compact || opt_auto_compact) {
+		err = compact_stack(arg, opt_auto_compact);
 	}
 
 	if (err < 0) {
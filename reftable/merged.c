@@ -10,34 +10,60 @@ license that can be found in the LICENSE file or at
 
 #include "constants.h"
 #include "iter.h"
-#include "pq.h"
 #include "record.h"
 #include "generic.h"
 #include "reftable-merged.h"
 #include "reftable-error.h"
 #include "system.h"
+#include "tournament.h"
+
+/*
+ * Move the sub-iterator "idx" to its next record, and replay the matches
+ * of its leaf, which has to be the winning one.
+ */
+static int merged_iter_advance_subiter(struct merged_iter *mi, size_t idx)
+{
+	struct tournament_leaf *leaf = &mi->tree.leaves[idx];
+	int err;
+
+	if (iterator_is_null(&mi->stack[idx])) {
+		leaf->done = 1;
+	} else {
+		err = iterator_next(&mi->stack[idx], &leaf->rec);
+		if (err < 0)
+			return err;
+		if (err > 0) {
+			reftable_iterator_destroy(&mi->stack[idx]);
+			leaf->done = 1;
+		} else {
+			merged_iter_tournament_leaf_changed(leaf);
+		}
+	}
+
+	merged_iter_tournament_replay(&mi->tree);
+	return 0;
+}
 
 static int merged_iter_init(struct merged_iter *mi)
 {
+	merged_iter_tournament_init(&mi->tree, mi->stack_len, mi->typ);
+
 	for (size_t i = 0; i < mi->stack_len; i++) {
-		struct pq_entry e = {
-			.index = i,
-		};
+		struct tournament_leaf *leaf = &mi->tree.leaves[i];
 		int err;
 
-		reftable_record_init(&e.rec, mi->typ);
-		err = iterator_next(&mi->stack[i], &e.rec);
+		err = iterator_next(&mi->stack[i], &leaf->rec);
 		if (err < 0)
 			return err;
 		if (err > 0) {
 			reftable_iterator_destroy(&mi->stack[i]);
-			reftable_record_release(&e.rec);
 			continue;
 		}
 
-		merged_iter_pqueue_add(&mi->pq, &e);
+		merged_iter_tournament_leaf_changed(leaf);
 	}
 
+	merged_iter_tournament_build(&mi->tree);
 	return 0;
 }
 
@@ -45,55 +71,38 @@ static void merged_iter_close(void *p)
 {
 	struct merged_iter *mi = p;
 
-	merged_iter_pqueue_release(&mi->pq);
+	merged_iter_tournament_release(&mi->tree);
 	for (size_t i = 0; i < mi->stack_len; i++)
 		reftable_iterator_destroy(&mi->stack[i]);
 	reftable_free(mi->stack);
-	strbuf_release(&mi->key);
 	strbuf_release(&mi->entry_key);
 }
 
-static int merged_iter_advance_nonnull_subiter(struct merged_iter *mi,
-					       size_t idx)
-{
-	struct pq_entry e = {
-		.index = idx,
-	};
-	int err;
-
-	reftable_record_init(&e.rec, mi->typ);
-	err = iterator_next(&mi->stack[idx], &e.rec);
-	if (err < 0)
-		return err;
-
-	if (err > 0) {
-		reftable_iterator_destroy(&mi->stack[idx]);
-		reftable_record_release(&e.rec);
-		return 0;
-	}
-
-	merged_iter_pqueue_add(&mi->pq, &e);
-	return 0;
-}
-
-static int merged_iter_advance_subiter(struct merged_iter *mi, size_t idx)
-{
-	if (iterator_is_null(&mi->stack[idx]))
-		return 0;
-	return merged_iter_advance_nonnull_subiter(mi, idx);
-}
-
 static int merged_iter_next_entry(struct merged_iter *mi,
 				  struct reftable_record *rec)
 {
-	struct pq_entry entry = { 0 };
+	struct tournament_leaf *leaf;
+	size_t idx;
 	int err = 0;
 
-	if (merged_iter_pqueue_is_empty(mi->pq))
+	if (merged_iter_tournament_is_empty(&mi->tree))
 		return 1;
 
-	entry = merged_iter_pqueue_remove(&mi->pq);
-	err = merged_iter_advance_subiter(mi, entry.index);
+	/*
+	 * Hand out the record of the winning leaf by swapping it with the
+	 * one we are given, so that the sub-iterator can decode its next
+	 * record into the latter, reusing its allocations.
+	 */
+	idx = merged_iter_tournament_top(&mi->tree);
+	leaf = &mi->tree.leaves[idx];
+	SWAP(*rec, leaf->rec);
+	if (reftable_record_type(&leaf->rec) != mi->typ) {
+		reftable_record_release(&leaf->rec);
+		reftable_record_init(&leaf->rec, mi->typ);
+	}
+	strbuf_swap(&mi->entry_key, &leaf->key);
+
+	err = merged_iter_advance_subiter(mi, idx);
 	if (err < 0)
 		return err;
 
@@ -105,31 +114,19 @@ static int merged_iter_next_entry(struct merged_iter *mi,
 	  such a deployment, the loop below must be changed to collect all
 	  entries for the same key, and return new the newest one.
 	*/
-	reftable_record_key(&entry.rec, &mi->entry_key);
-	while (!merged_iter_pqueue_is_empty(mi->pq)) {
-		struct pq_entry top = merged_iter_pqueue_top(mi->pq);
-		int cmp = 0;
-
-		reftable_record_key(&top.rec, &mi->key);
+	while (!merged_iter_tournament_is_empty(&mi->tree)) {
+		idx = merged_iter_tournament_top(&mi->tree);
+		leaf = &mi->tree.leaves[idx];
 
-		cmp = strbuf_cmp(&mi->key, &mi->entry_key);
-		if (cmp > 0)
+		if (strbuf_cmp(&leaf->key, &mi->entry_key) > 0)
 			break;
 
-		merged_iter_pqueue_remove(&mi->pq);
-		err = merged_iter_advance_subiter(mi, top.index);
+		err = merged_iter_advance_subiter(mi, idx);
 		if (err < 0)
-			goto done;
-		reftable_record_release(&top.rec);
+			return err;
 	}
 
-	reftable_record_release(rec);
-	*rec = entry.rec;
-
-done:
-	if (err)
-		reftable_record_release(&entry.rec);
-	return err;
+	return 0;
 }
 
 static int merged_iter_next(struct merged_iter *mi, struct reftable_record *rec)
@@ -148,7 +145,7 @@ static int merged_iter_next(struct merged_iter *mi, struct reftable_record *rec)
 static int merged_iter_next_void(void *p, struct reftable_record *rec)
 {
 	struct merged_iter *mi = p;
-	if (merged_iter_pqueue_is_empty(mi->pq))
+	if (merged_iter_tournament_is_empty(&mi->tree))
 		return 1;
 
 	return merged_iter_next(mi, rec);
@@ -243,7 +240,6 @@ static int merged_table_seek_record(struct reftable_merged_table *mt,
 		.typ = reftable_record_type(rec),
 		.hash_id = mt->hash_id,
 		.suppress_deletions = mt->suppress_deletions,
-		.key = STRBUF_INIT,
 		.entry_key = STRBUF_INIT,
 	};
 	struct merged_iter *p;
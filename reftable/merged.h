@@ -9,7 +9,7 @@ license that can be found in the LICENSE file or at
 #ifndef MERGED_H
 #define MERGED_H
 
-#include "pq.h"
+#include "tournament.h"
 
 struct reftable_merged_table {
 	struct reftable_table *stack;
@@ -30,8 +30,7 @@ struct merged_iter {
 	size_t stack_len;
 	uint8_t typ;
 	int suppress_deletions;
-	struct merged_iter_pqueue pq;
-	struct strbuf key;
+	struct merged_iter_tournament tree;
 	struct strbuf entry_key;
 };
 
@@ -22,6 +22,7 @@ license that can be found in the LICENSE file or at
 /* reftable_ref_record holds a ref database entry target_value */
 struct reftable_ref_record {
 	char *refname; /* Name of the ref, malloced. */
+	size_t refname_cap; /* Allocated size of refname, if known. */
 	uint64_t update_index; /* Logical timestamp at which this value is
 				* written */
 
@@ -46,6 +46,13 @@ struct reftable_write_options {
 	 *   is a single line, and add '\n' if missing.
 	 */
 	unsigned exact_log_message : 1;
+
+	/* boolean: do not compact the stack after adding tables to it. This
+	 *   leaves compaction to a separate maintenance step calling
+	 *   reftable_stack_auto_compact(), which does not keep writers from
+	 *   adding tables while it runs.
+	 */
+	unsigned disable_auto_compact : 1;
 };
 
 /* reftable_block_stats holds statistics for a single block type */
@@ -76,6 +76,7 @@ int reftable_new_stack(struct reftable_stack **dest, const char *dir,
 	p->list_fd = -1;
 	p->reftable_dir = xstrdup(dir);
 	p->config = config;
+	p->disable_auto_compact = config.disable_auto_compact;
 
 	err = reftable_stack_reload_maybe_reuse(p, 1);
 	if (err < 0) {
@@ -978,18 +979,93 @@ static int stack_write_compact(struct reftable_stack *st,
 	return err;
 }
 
-/* <  0: error. 0 == OK, > 0 attempt failed; could retry. */
+/*
+ * Take the lock on "tables.list" for swapping in a compacted table. Unlike
+ * the lock taken at the start of compaction, this one is waited for for a
+ * little while: concurrent additions hold it while writing their tables,
+ * and giving up here would throw away all the work of compacting.
+ *
+ * < 0: error. 0 == OK, > 0 lock is still held by somebody else.
+ */
+static int stack_lock_list_for_swap(const char *lock_file_name, int *fdp)
+{
+	struct timeval deadline;
+	int64_t delay = 0;
+	int tries = 0;
+
+	if (gettimeofday(&deadline, NULL) < 0)
+		return REFTABLE_IO_ERROR;
+	deadline.tv_sec += 1;
+
+	while (1) {
+		struct timeval now;
+
+		*fdp = open(lock_file_name, O_EXCL | O_CREAT | O_WRONLY, 0666);
+		if (*fdp >= 0)
+			return 0;
+		if (errno != EEXIST)
+			return REFTABLE_IO_ERROR;
+
+		if (gettimeofday(&now, NULL) < 0)
+			return REFTABLE_IO_ERROR;
+		tries++;
+		if (tries > 3 && tv_cmp(&now, &deadline) >= 0)
+			return 1;
+
+		delay = delay + (delay * rand()) / RAND_MAX + 1;
+		sleep_millisec(delay);
+	}
+}
+
+/*
+ * Find the tables "first" to "last" of our stack in "names", the current
+ * contents of "tables.list". As they are locked against compaction by
+ * others, they are still there and in the same order, unless somebody
+ * broke the locks. Returns the index of the first of them, or -1.
+ */
+static ssize_t stack_find_compacted_tables(struct reftable_stack *st,
+					   char **names,
+					   size_t first, size_t last)
+{
+	size_t i, j;
+
+	for (i = 0; names[i]; i++) {
+		if (strcmp(names[i], reader_name(st->readers[first])))
+			continue;
+		for (j = first + 1; j <= last; j++)
+			if (!names[i + j - first] ||
+			    strcmp(names[i + j - first],
+				   reader_name(st->readers[j])))
+				return -1;
+		return i;
+	}
+	return -1;
+}
+
+/*
+ * Compact the tables "first" to "last". The tables are locked for the
+ * duration, so that nobody else compacts them, but "tables.list" is only
+ * locked for a moment at the start, to check that we are up to date, and
+ * then again for swapping in the result. Tables added (or compacted) in
+ * between by others are kept, as the new list is based on what is in
+ * "tables.list" at the time of the swap rather than on our view of the
+ * stack.
+ *
+ * <  0: error. 0 == OK, > 0 attempt failed; could retry.
+ */
 static int stack_compact_range(struct reftable_stack *st,
 			       size_t first, size_t last,
 			       struct reftable_log_expiry_config *expiry)
 {
 	char **delete_on_success = NULL, **subtable_locks = NULL, **listp = NULL;
+	char **names = NULL;
 	struct strbuf temp_tab_file_name = STRBUF_INIT;
 	struct strbuf new_table_name = STRBUF_INIT;
 	struct strbuf lock_file_name = STRBUF_INIT;
 	struct strbuf ref_list_contents = STRBUF_INIT;
 	struct strbuf new_table_path = STRBUF_INIT;
 	size_t i, j, compact_count;
+	ssize_t pos;
 	int err = 0;
 	int have_lock = 0;
 	int lock_file_fd = -1;
@@ -1077,16 +1153,12 @@ static int stack_compact_range(struct reftable_stack *st,
 	if (err < 0)
 		goto done;
 
-	lock_file_fd =
-		open(lock_file_name.buf, O_EXCL | O_CREAT | O_WRONLY, 0666);
-	if (lock_file_fd < 0) {
-		if (errno == EEXIST) {
-			err = 1;
-		} else {
-			err = REFTABLE_IO_ERROR;
-		}
+	if (st->compact_hook)
+		st->compact_hook(st);
+
+	err = stack_lock_list_for_swap(lock_file_name.buf, &lock_file_fd);
+	if (err)
 		goto done;
-	}
 	have_lock = 1;
 	if (st->config.default_permissions) {
 		if (chmod(lock_file_name.buf, st->config.default_permissions) < 0) {
@@ -1095,6 +1167,15 @@ static int stack_compact_range(struct reftable_stack *st,
 		}
 	}
 
+	err = read_lines(st->list_file, &names);
+	if (err < 0)
+		goto done;
+	pos = stack_find_compacted_tables(st, names, first, last);
+	if (pos < 0) {
+		err = 1;
+		goto done;
+	}
+
 	format_name(&new_table_name, st->readers[first]->min_update_index,
 		    st->readers[last]->max_update_index);
 	strbuf_addstr(&new_table_name, ".ref");
@@ -1110,16 +1191,16 @@ static int stack_compact_range(struct reftable_stack *st,
 		}
 	}
 
-	for (i = 0; i < first; i++) {
-		strbuf_addstr(&ref_list_contents, st->readers[i]->name);
+	for (i = 0; i < pos; i++) {
+		strbuf_addstr(&ref_list_contents, names[i]);
 		strbuf_addstr(&ref_list_contents, "\n");
 	}
 	if (!is_empty_table) {
 		strbuf_addbuf(&ref_list_contents, &new_table_name);
 		strbuf_addstr(&ref_list_contents, "\n");
 	}
-	for (i = last + 1; i < st->merged->stack_len; i++) {
-		strbuf_addstr(&ref_list_contents, st->readers[i]->name);
+	for (i = pos + compact_count; names[i]; i++) {
+		strbuf_addstr(&ref_list_contents, names[i]);
 		strbuf_addstr(&ref_list_contents, "\n");
 	}
 
@@ -1168,6 +1249,9 @@ static int stack_compact_range(struct reftable_stack *st,
 
 done:
 	free_names(delete_on_success);
+	free_names(names);
+	if (temp_tab_file_name.len)
+		unlink(temp_tab_file_name.buf);
 
 	if (subtable_locks) {
 		listp = subtable_locks;
@@ -21,6 +21,12 @@ struct reftable_stack {
 	char *reftable_dir;
 	int disable_auto_compact;
 
+	/*
+	 * For testing: called during compaction after the compacted table
+	 * has been written, and before it is swapped into "tables.list".
+	 */
+	void (*compact_hook)(struct reftable_stack *st);
+
 	struct reftable_write_options config;
 
 	struct reftable_reader **readers;
@@ -1009,6 +1009,125 @@ static void test_reftable_stack_compaction_concurrent(void)
 	clear_dir(dir);
 }
 
+static void test_reftable_stack_write_options_disable_auto_compact(void)
+{
+	struct reftable_write_options cfg = {
+		.disable_auto_compact = 1,
+	};
+	struct reftable_stack *st = NULL;
+	char *dir = get_tmp_dir(__LINE__);
+	int err, i, N = 10;
+
+	err = reftable_new_stack(&st, dir, cfg);
+	EXPECT_ERR(err);
+
+	for (i = 0; i < N; i++) {
+		char name[100];
+		struct reftable_ref_record ref = {
+			.refname = name,
+			.update_index = reftable_stack_next_update_index(st),
+			.value_type = REFTABLE_REF_SYMREF,
+			.value.symref = "master",
+		};
+		snprintf(name, sizeof(name), "branch%04d", i);
+
+		err = reftable_stack_add(st, &write_test_ref, &ref);
+		EXPECT_ERR(err);
+		EXPECT(st->merged->stack_len == i + 1);
+	}
+
+	/* Compaction out of band, e.g. from a maintenance task. */
+	err = reftable_stack_auto_compact(st);
+	EXPECT_ERR(err);
+	EXPECT(st->merged->stack_len < N);
+
+	reftable_stack_destroy(st);
+	clear_dir(dir);
+}
+
+static struct reftable_stack *concurrent_writer;
+
+static void add_ref_during_compaction(struct reftable_stack *st UNUSED)
+{
+	struct reftable_ref_record ref = {
+		.refname = (char *) "refs/heads/concurrent",
+		.update_index = reftable_stack_next_update_index(concurrent_writer),
+		.value_type = REFTABLE_REF_SYMREF,
+		.value.symref = "master",
+	};
+	int err = reftable_stack_add(concurrent_writer, &write_test_ref, &ref);
+	EXPECT_ERR(err);
+}
+
+static void test_reftable_stack_compaction_concurrent_add(void)
+{
+	struct reftable_write_options cfg = {
+		.disable_auto_compact = 1,
+	};
+	struct reftable_stack *st1 = NULL, *st2 = NULL;
+	struct reftable_ref_record dest = { NULL };
+	char *dir = get_tmp_dir(__LINE__);
+	char **names = NULL;
+	struct strbuf list = STRBUF_INIT;
+	int err, i, N = 3;
+
+	err = reftable_new_stack(&st1, dir, cfg);
+	EXPECT_ERR(err);
+
+	for (i = 0; i < N; i++) {
+		char name[100];
+		struct reftable_ref_record ref = {
+			.refname = name,
+			.update_index = reftable_stack_next_update_index(st1),
+			.value_type = REFTABLE_REF_SYMREF,
+			.value.symref = "master",
+		};
+		snprintf(name, sizeof(name), "branch%04d", i);
+
+		err = reftable_stack_add(st1, &write_test_ref, &ref);
+		EXPECT_ERR(err);
+	}
+
+	err = reftable_new_stack(&st2, dir, cfg);
+	EXPECT_ERR(err);
+
+	/*
+	 * Have another writer add a table while the compaction is under
+	 * way. It must not be lost when the compacted table is swapped in.
+	 */
+	concurrent_writer = st2;
+	st1->compact_hook = add_ref_during_compaction;
+	err = reftable_stack_compact_all(st1, NULL);
+	EXPECT_ERR(err);
+	st1->compact_hook = NULL;
+	concurrent_writer = NULL;
+
+	strbuf_addf(&list, "%s/tables.list", dir);
+	err = read_lines(list.buf, &names);
+	EXPECT_ERR(err);
+	EXPECT(names_length(names) == 2);
+	EXPECT(!strcmp(names[1], st2->readers[N]->name));
+
+	EXPECT(st1->merged->stack_len == 2);
+	err = reftable_stack_read_ref(st1, "refs/heads/concurrent", &dest);
+	EXPECT_ERR(err);
+	reftable_ref_record_release(&dest);
+	for (i = 0; i < N; i++) {
+		char name[100];
+		snprintf(name, sizeof(name), "branch%04d", i);
+		err = reftable_stack_read_ref(st1, name, &dest);
+		EXPECT_ERR(err);
+		reftable_ref_record_release(&dest);
+	}
+
+	free_names(names);
+	strbuf_release(&list);
+	reftable_stack_destroy(st1);
+	reftable_stack_destroy(st2);
+	EXPECT(count_dir_entries(dir) == 3);
+	clear_dir(dir);
+}
+
 static void unclean_stack_close(struct reftable_stack *st)
 {
 	/* break abstraction boundary to simulate unclean shutdown. */
@@ -1082,6 +1201,7 @@ int stack_test_main(int argc, const char *argv[])
 	RUN_TEST(test_reftable_stack_auto_compaction);
 	RUN_TEST(test_reftable_stack_add_performs_auto_compaction);
 	RUN_TEST(test_reftable_stack_compaction_concurrent);
+	RUN_TEST(test_reftable_stack_compaction_concurrent_add);
 	RUN_TEST(test_reftable_stack_compaction_concurrent_clean);
 	RUN_TEST(test_reftable_stack_hash_id);
 	RUN_TEST(test_reftable_stack_lock_failure);
@@ -1092,6 +1212,7 @@ int stack_test_main(int argc, const char *argv[])
 	RUN_TEST(test_reftable_stack_update_index_check);
 	RUN_TEST(test_reftable_stack_uptodate);
 	RUN_TEST(test_reftable_stack_validate_refname);
+	RUN_TEST(test_reftable_stack_write_options_disable_auto_compact);
 	RUN_TEST(test_sizes_to_segments);
 	RUN_TEST(test_sizes_to_segments_all_equal);
 	RUN_TEST(test_sizes_to_segments_empty);
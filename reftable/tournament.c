@@ -0,0 +1,125 @@
+/*
+Copyright 2020 Google LLC
+
+Use of this source code is governed by a BSD-style
+license that can be found in the LICENSE file or at
+https://developers.google.com/open-source/licenses/bsd
+*/
+
+#include "tournament.h"
+
+#include "reftable-record.h"
+#include "system.h"
+#include "basics.h"
+
+void merged_iter_tournament_init(struct merged_iter_tournament *t, size_t len,
+				 uint8_t typ)
+{
+	t->len = len;
+	REFTABLE_CALLOC_ARRAY(t->leaves, len);
+	REFTABLE_CALLOC_ARRAY(t->nodes, len ? len : 1);
+	for (size_t i = 0; i < len; i++) {
+		reftable_record_init(&t->leaves[i].rec, typ);
+		strbuf_init(&t->leaves[i].key, 0);
+		t->leaves[i].done = 1;
+	}
+}
+
+void merged_iter_tournament_leaf_changed(struct tournament_leaf *leaf)
+{
+	size_t i;
+
+	reftable_record_key(&leaf->rec, &leaf->key);
+
+	/*
+	 * Padding short keys with zeroes keeps the order: where the padding
+	 * makes a difference, the shorter key is a prefix of the other.
+	 */
+	leaf->prefix = 0;
+	for (i = 0; i < sizeof(leaf->prefix); i++) {
+		leaf->prefix <<= 8;
+		if (i < leaf->key.len)
+			leaf->prefix |= (unsigned char)leaf->key.buf[i];
+	}
+	leaf->done = 0;
+}
+
+int tournament_leaf_less(const struct merged_iter_tournament *t,
+			 size_t a, size_t b)
+{
+	const struct tournament_leaf *la = &t->leaves[a];
+	const struct tournament_leaf *lb = &t->leaves[b];
+	int cmp;
+
+	if (la->done)
+		return 0;
+	if (lb->done)
+		return 1;
+	if (la->prefix != lb->prefix)
+		return la->prefix < lb->prefix;
+
+	cmp = strbuf_cmp(&la->key, &lb->key);
+	if (cmp == 0)
+		return a > b;
+	return cmp < 0;
+}
+
+void merged_iter_tournament_build(struct merged_iter_tournament *t)
+{
+	size_t *winners;
+	size_t i;
+
+	if (t->len < 2) {
+		t->nodes[0] = 0;
+		return;
+	}
+
+	REFTABLE_ALLOC_ARRAY(winners, 2 * t->len);
+	for (i = 0; i < t->len; i++)
+		winners[t->len + i] = i;
+	for (i = t->len - 1; i > 0; i--) {
+		size_t a = winners[2 * i], b = winners[2 * i + 1];
+
+		if (tournament_leaf_less(t, a, b)) {
+			winners[i] = a;
+			t->nodes[i] = b;
+		} else {
+			winners[i] = b;
+			t->nodes[i] = a;
+		}
+	}
+	t->nodes[0] = winners[1];
+	reftable_free(winners);
+}
+
+void merged_iter_tournament_replay(struct merged_iter_tournament *t)
+{
+	size_t winner = t->nodes[0];
+	size_t i;
+
+	for (i = (t->len + winner) / 2; i > 0; i /= 2)
+		if (tournament_leaf_less(t, t->nodes[i], winner))
+			SWAP(t->nodes[i], winner);
+	t->nodes[0] = winner;
+}
+
+size_t merged_iter_tournament_top(struct merged_iter_tournament *t)
+{
+	return t->nodes[0];
+}
+
+int merged_iter_tournament_is_empty(struct merged_iter_tournament *t)
+{
+	return !t->len || t->leaves[t->nodes[0]].done;
+}
+
+void merged_iter_tournament_release(struct merged_iter_tournament *t)
+{
+	for (size_t i = 0; i < t->len; i++) {
+		reftable_record_release(&t->leaves[i].rec);
+		strbuf_release(&t->leaves[i].key);
+	}
+	FREE_AND_NULL(t->leaves);
+	FREE_AND_NULL(t->nodes);
+	t->len = 0;
+}
@@ -0,0 +1,77 @@
+/*
+Copyright 2020 Google LLC
+
+Use of this source code is governed by a BSD-style
+license that can be found in the LICENSE file or at
+https://developers.google.com/open-source/licenses/bsd
+*/
+
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+#include "record.h"
+
+/*
+ * A tournament tree of losers, for merging the records of a number of
+ * sorted sub-iterators.
+ *
+ * Each leaf holds the current record of one sub-iterator, along with its
+ * key, which is computed once when the record changes rather than at every
+ * comparison. The first bytes of the key are also cached as an integer, so
+ * that most comparisons, which are between keys differing early on, do not
+ * have to look at the keys themselves.
+ *
+ * After the record of the winning leaf has been replaced, the tree is
+ * brought up to date by replaying the matches on the path from that leaf
+ * to the root only, which takes log2(len) comparisons, as opposed to up to
+ * twice as many for removing from and adding to a binary heap.
+ */
+struct tournament_leaf {
+	struct reftable_record rec;
+	struct strbuf key;
+	uint64_t prefix;
+	/* set when the sub-iterator is exhausted. Sorts after all others. */
+	int done;
+};
+
+struct merged_iter_tournament {
+	struct tournament_leaf *leaves;
+	/*
+	 * nodes[0] is the index of the winning leaf, nodes[1] to
+	 * nodes[len - 1] are the losers of the matches played at the inner
+	 * nodes, with the children of nodes[i] being nodes[2 * i] and
+	 * nodes[2 * i + 1], and leaf i taking the place of node len + i.
+	 */
+	size_t *nodes;
+	size_t len;
+};
+
+/* Set up for "len" leaves with records of type "typ", all of them done. */
+void merged_iter_tournament_init(struct merged_iter_tournament *t, size_t len,
+				 uint8_t typ);
+
+/* Update the cached key of "leaf" after its record has changed. */
+void merged_iter_tournament_leaf_changed(struct tournament_leaf *leaf);
+
+/* Play all matches, after the leaves have been filled in. */
+void merged_iter_tournament_build(struct merged_iter_tournament *t);
+
+/* Replay the matches of the winning leaf, after it has changed. */
+void merged_iter_tournament_replay(struct merged_iter_tournament *t);
+
+/* The index of the winning leaf, i.e. the one with the smallest key. */
+size_t merged_iter_tournament_top(struct merged_iter_tournament *t);
+
+/* Whether all leaves are done. */
+int merged_iter_tournament_is_empty(struct merged_iter_tournament *t);
+
+/*
+ * Whether leaf "a" sorts before leaf "b". For equal keys, the leaf with the
+ * higher index, i.e. the newer table, wins.
+ */
+int tournament_leaf_less(const struct merged_iter_tournament *t,
+			 size_t a, size_t b);
+
+void merged_iter_tournament_release(struct merged_iter_tournament *t);
+
+#endif
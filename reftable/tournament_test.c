@@ -0,0 +1,118 @@
+/*
+Copyright 2020 Google LLC
+
+Use of this source code is governed by a BSD-style
+license that can be found in the LICENSE file or at
+https://developers.google.com/open-source/licenses/bsd
+*/
+
+#include "system.h"
+
+#include "basics.h"
+#include "constants.h"
+#include "record.h"
+#include "reftable-tests.h"
+#include "test_framework.h"
+#include "tournament.h"
+
+static void tournament_check(struct merged_iter_tournament *t)
+{
+	size_t top = merged_iter_tournament_top(t);
+
+	for (size_t i = 0; i < t->len; i++)
+		EXPECT(i == top || !tournament_leaf_less(t, i, top));
+}
+
+static void set_leaf(struct merged_iter_tournament *t, size_t i, char *name)
+{
+	struct tournament_leaf *leaf = &t->leaves[i];
+
+	if (!name) {
+		leaf->done = 1;
+		return;
+	}
+	/* the names are not ours, so don't let the record free them. */
+	leaf->rec.u.ref.refname = name;
+	merged_iter_tournament_leaf_changed(leaf);
+}
+
+static void test_tournament(void)
+{
+	/*
+	 * Some of these share a prefix of more than 8 bytes, some are
+	 * prefixes of others, and some are duplicates across leaves.
+	 */
+	char *names[] = {
+		"", "a", "aa", "refs/heads/a", "refs/heads/aa",
+		"refs/heads/b", "refs/tags/a", "refs/tags/v1.0", "refs/tags/v1.1",
+		"z",
+	};
+	int N = ARRAY_SIZE(names);
+	size_t len = 7;
+	size_t *pos;
+	struct merged_iter_tournament t = { NULL };
+	const char *last = NULL;
+	size_t last_idx = 0;
+	int seen = 0;
+
+	merged_iter_tournament_init(&t, len, BLOCK_TYPE_REF);
+	REFTABLE_CALLOC_ARRAY(pos, len);
+
+	/* leaf i gets every name whose index is divisible by i + 1. */
+	for (size_t i = 0; i < len; i++)
+		set_leaf(&t, i, names[0]);
+	merged_iter_tournament_build(&t);
+	tournament_check(&t);
+
+	while (!merged_iter_tournament_is_empty(&t)) {
+		size_t idx = merged_iter_tournament_top(&t);
+		const char *name = t.leaves[idx].rec.u.ref.refname;
+
+		if (last) {
+			int cmp = strcmp(last, name);
+			/* newer tables come first for equal keys */
+			EXPECT(cmp < 0 || (cmp == 0 && last_idx > idx));
+		}
+		last = name;
+		last_idx = idx;
+		seen++;
+
+		do {
+			pos[idx]++;
+		} while (pos[idx] < N && pos[idx] % (idx + 1));
+		set_leaf(&t, idx, pos[idx] < N ? names[pos[idx]] : NULL);
+		merged_iter_tournament_replay(&t);
+		tournament_check(&t);
+	}
+
+	for (size_t i = 0; i < len; i++)
+		seen -= (N + i) / (i + 1);
+	EXPECT(seen == 0);
+
+	for (size_t i = 0; i < len; i++)
+		t.leaves[i].rec.u.ref.refname = NULL;
+	merged_iter_tournament_release(&t);
+	reftable_free(pos);
+}
+
+static void test_tournament_empty(void)
+{
+	struct merged_iter_tournament t = { NULL };
+
+	merged_iter_tournament_init(&t, 0, BLOCK_TYPE_REF);
+	merged_iter_tournament_build(&t);
+	EXPECT(merged_iter_tournament_is_empty(&t));
+	merged_iter_tournament_release(&t);
+
+	merged_iter_tournament_init(&t, 3, BLOCK_TYPE_REF);
+	merged_iter_tournament_build(&t);
+	EXPECT(merged_iter_tournament_is_empty(&t));
+	merged_iter_tournament_release(&t);
+}
+
+int tournament_test_main(int argc, const char *argv[])
+{
+	RUN_TEST(test_tournament);
+	RUN_TEST(test_tournament_empty);
+	return 0;
+}
@@ -27,8 +27,9 @@ void prepare_repo_settings(struct repository *r)
 	if (!r->gitdir)
 		BUG("Cannot add settings for uninitialized repository");
 
-	if (r->settings.initialized++)
+	if (r->settings.initialized)
 		return;
+	r->settings.initialized = 1;
 
 	/* Defaults */
 	r->settings.index_version = -1;
@@ -55,6 +56,9 @@ void prepare_repo_settings(struct repository *r)
 	repo_cfg_bool(r, "core.commitgraph", &r->settings.core_commit_graph, 1);
 	repo_cfg_int(r, "commitgraph.generationversion", &r->settings.commit_graph_generation_version, 2);
 	repo_cfg_bool(r, "commitgraph.readchangedpaths", &r->settings.commit_graph_read_changed_paths, 1);
+	repo_cfg_bool(r, "commitgraph.readreachabilityindex", &r->settings.commit_graph_read_reachability_index, 1);
+	repo_cfg_bool(r, "commitgraph.readlogmetadata", &r->settings.commit_graph_read_log_metadata, 1);
+	repo_cfg_bool(r, "commitgraph.readchangedpathlists", &r->settings.commit_graph_read_changed_path_lists, 1);
 	repo_cfg_bool(r, "gc.writecommitgraph", &r->settings.gc_write_commit_graph, 1);
 	repo_cfg_bool(r, "fetch.writecommitgraph", &r->settings.fetch_write_commit_graph, 0);
 
@@ -191,6 +191,7 @@ int repo_init(struct repository *repo,
 	repo_set_hash_algo(repo, format.hash_algo);
 	repo_set_ref_storage_format(repo, format.ref_storage_format);
 	repo->repository_format_worktree_config = format.worktree_config;
+	repo->repository_format_packed_refs_delta = format.packed_refs_delta;
 
 	/* take ownership of format.partial_clone */
 	repo->repository_format_partial_clone = format.partial_clone;
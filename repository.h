@@ -33,6 +33,9 @@ struct repo_settings {
 	int core_commit_graph;
 	int commit_graph_generation_version;
 	int commit_graph_read_changed_paths;
+	int commit_graph_read_reachability_index;
+	int commit_graph_read_log_metadata;
+	int commit_graph_read_changed_path_lists;
 	int gc_write_commit_graph;
 	int fetch_write_commit_graph;
 	int command_requires_full_index;
@@ -177,6 +180,7 @@ struct repository {
 
 	/* Configurations */
 	int repository_format_worktree_config;
+	int repository_format_packed_refs_delta;
 
 	/* Indicate if a repository has a different 'commondir' from 'gitdir' */
 	unsigned different_commondir:1;
@@ -785,6 +785,69 @@ static int check_maybe_different_in_bloom_filter(struct rev_info *revs,
 	return result;
 }
 
+static int changed_path_lists_atexit_registered;
+static unsigned int count_changed_path_list_not_present;
+static unsigned int count_changed_path_list_same;
+static unsigned int count_changed_path_list_different;
+
+static void trace2_changed_path_lists_statistics_atexit(void)
+{
+	struct json_writer jw = JSON_WRITER_INIT;
+
+	jw_object_begin(&jw, 0);
+	jw_object_intmax(&jw, "list_not_present", count_changed_path_list_not_present);
+	jw_object_intmax(&jw, "same", count_changed_path_list_same);
+	jw_object_intmax(&jw, "different", count_changed_path_list_different);
+	jw_end(&jw);
+
+	trace2_data_json("changed-path-lists", the_repository, "statistics", &jw);
+
+	jw_release(&jw);
+}
+
+static void prepare_to_use_changed_path_lists(struct rev_info *revs)
+{
+	if (!revs->commits || !revs->prune_data.nr)
+		return;
+
+	/*
+	 * The lists only tell whether a commit is TREESAME to its first
+	 * parent, not whether it merely adds the paths we are after.
+	 */
+	if (revs->remove_empty_trees)
+		return;
+
+	if (!prepare_commit_graph(revs->repo))
+		return;
+
+	revs->use_changed_path_lists = 1;
+
+	if (trace2_is_enabled() && !changed_path_lists_atexit_registered) {
+		atexit(trace2_changed_path_lists_statistics_atexit);
+		changed_path_lists_atexit_registered = 1;
+	}
+}
+
+static int check_changed_in_path_list(struct rev_info *revs,
+				      struct commit *commit)
+{
+	int result;
+
+	if (commit_graph_position(commit) == COMMIT_NOT_FROM_GRAPH)
+		return -1;
+
+	result = commit_graph_changes_pathspec(revs->repo, commit,
+					       &revs->pruning.pathspec);
+	if (result < 0)
+		count_changed_path_list_not_present++;
+	else if (result)
+		count_changed_path_list_different++;
+	else
+		count_changed_path_list_same++;
+
+	return result;
+}
+
 static int rev_compare_tree(struct rev_info *revs,
 			    struct commit *parent, struct commit *commit, int nth_parent)
 {
@@ -822,6 +885,16 @@ static int rev_compare_tree(struct rev_info *revs,
 			return REV_TREE_SAME;
 	}
 
+	if (revs->use_changed_path_lists && !nth_parent) {
+		switch (check_changed_in_path_list(revs, commit)) {
+		case 0:
+			return REV_TREE_SAME;
+		case 1:
+			/* without remove_empty_trees, any kind of change will do */
+			return REV_TREE_DIFFERENT;
+		}
+	}
+
 	tree_difference = REV_TREE_SAME;
 	revs->pruning.flags.has_changes = 0;
 	diff_tree_oid(&t1->object.oid, &t2->object.oid, "", &revs->pruning);
@@ -3832,8 +3905,10 @@ int prepare_revision_walk(struct rev_info *revs)
 
 	oidset_init(&revs->missing_commits, 0);
 
-	if (!revs->reflog_info)
+	if (!revs->reflog_info) {
 		prepare_to_use_bloom_filter(revs);
+		prepare_to_use_changed_path_lists(revs);
+	}
 	if (!revs->unsorted_input)
 		commit_list_sort_by_date(&revs->commits);
 	if (revs->no_walk)
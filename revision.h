@@ -316,6 +316,12 @@ struct rev_info {
 	int (*include_check_obj)(struct object *obj, void *);
 	void *include_check_data;
 
+	/*
+	 * Number of threads traverse_commit_list() may use to walk trees;
+	 * see list-objects.h.
+	 */
+	int traverse_threads;
+
 	/* diff info for patches and for paths limiting */
 	struct diff_options diffopt;
 	struct diff_options pruning;
@@ -369,6 +375,12 @@ struct rev_info {
 	 */
 	struct bloom_filter_settings *bloom_filter_settings;
 
+	/*
+	 * Whether the changed-path lists of the commit-graph may be used
+	 * instead of comparing a commit's tree to its first parent's.
+	 */
+	unsigned use_changed_path_lists:1;
+
 	/* misc. flags related to '--no-kept-objects' */
 	unsigned keep_pack_cache_flags;
 
@@ -1,5 +1,6 @@
 #include "git-compat-util.h"
 #include "run-command.h"
+#include "bulk-checkin.h"
 #include "environment.h"
 #include "exec-cmd.h"
 #include "gettext.h"
@@ -670,6 +671,10 @@ int start_command(struct child_process *cmd)
 	 * that have been passed in via ->in and ->out.
 	 */
 
+	/* Another Git process may need the objects we wrote. */
+	if (cmd->git_cmd)
+		flush_odb_transaction();
+
 	need_in = !cmd->no_stdin && cmd->in < 0;
 	if (need_in) {
 		if (pipe(fdin) < 0) {
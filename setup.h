@@ -113,6 +113,7 @@ struct repository_format {
 	int precious_objects;
 	char *partial_clone; /* value of extensions.partialclone */
 	int worktree_config;
+	int packed_refs_delta;
 	int is_bare;
 	int hash_algo;
 	unsigned int ref_storage_format;
@@ -1,5 +1,6 @@
 #include "git-compat-util.h"
 #include "./sha256.h"
+#include "hash-mb.h"
 
 #undef RND
 #undef BLKSIZE
@@ -55,15 +56,14 @@ static inline uint32_t gamma1(uint32_t x)
 	return ror(x, 17) ^ ror(x, 19) ^ (x >> 10);
 }
 
-static void blk_SHA256_Transform(blk_SHA256_CTX *ctx, const unsigned char *buf)
+static void blk_SHA256_Transform(uint32_t *state, const unsigned char *buf)
 {
-
 	uint32_t S[8], W[64], t0, t1;
 	int i;
 
 	/* copy state into S */
 	for (i = 0; i < 8; i++)
-		S[i] = ctx->state[i];
+		S[i] = state[i];
 
 	/* copy the state into 512-bits into W[0..15] */
 	for (i = 0; i < 16; i++, buf += sizeof(uint32_t))
@@ -145,7 +145,7 @@ static void blk_SHA256_Transform(blk_SHA256_CTX *ctx, const unsigned char *buf)
 	RND(S[1],S[2],S[3],S[4],S[5],S[6],S[7],S[0],63,0xc67178f2);
 
 	for (i = 0; i < 8; i++)
-		ctx->state[i] += S[i];
+		state[i] += S[i];
 }
 
 void blk_SHA256_Update(blk_SHA256_CTX *ctx, const void *data, size_t len)
@@ -165,10 +165,10 @@ void blk_SHA256_Update(blk_SHA256_CTX *ctx, const void *data, size_t len)
 		data = ((const char *)data + left);
 		if (len_buf)
 			return;
-		blk_SHA256_Transform(ctx, ctx->buf);
+		blk_SHA256_Transform(ctx->state, ctx->buf);
 	}
 	while (len >= 64) {
-		blk_SHA256_Transform(ctx, data);
+		blk_SHA256_Transform(ctx->state, data);
 		data = ((const char *)data + 64);
 		len -= 64;
 	}
@@ -194,3 +194,197 @@ void blk_SHA256_Final(unsigned char *digest, blk_SHA256_CTX *ctx)
 	for (i = 0; i < 8; i++, digest += sizeof(uint32_t))
 		put_be32(digest, ctx->state[i]);
 }
+
+#ifdef HASH_MB_VECTORS
+
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/*
+ * Eight SHA-256 computations side by side, one in each 32-bit lane. These
+ * are macros rather than inline functions, as passing vectors by value
+ * to a function compiled without AVX would change its ABI.
+ */
+typedef uint32_t sha256_vec __attribute__((vector_size(32)));
+
+#define VROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define VCH(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define VMAJ(x, y, z) ((((x) | (y)) & (z)) | ((x) & (y)))
+#define VSIGMA0(x) (VROR(x, 2) ^ VROR(x, 13) ^ VROR(x, 22))
+#define VSIGMA1(x) (VROR(x, 6) ^ VROR(x, 11) ^ VROR(x, 25))
+#define VGAMMA0(x) (VROR(x, 7) ^ VROR(x, 18) ^ ((x) >> 3))
+#define VGAMMA1(x) (VROR(x, 17) ^ VROR(x, 19) ^ ((x) >> 10))
+
+static inline __attribute__((always_inline))
+void sha256_lanes_body(uint32_t *state[HASH_MB_LANES],
+		       const unsigned char *block[HASH_MB_LANES])
+{
+	sha256_vec S[8], a, b, c, d, e, f, g, h, W[16], t0, t1;
+	int i, l;
+
+	for (i = 0; i < 8; i++)
+		for (l = 0; l < HASH_MB_LANES; l++)
+			S[i][l] = state[l][i];
+
+	a = S[0]; b = S[1]; c = S[2]; d = S[3];
+	e = S[4]; f = S[5]; g = S[6]; h = S[7];
+
+	for (i = 0; i < 64; i++) {
+		if (i < 16) {
+			for (l = 0; l < HASH_MB_LANES; l++)
+				W[i][l] = get_be32(block[l] + i * 4);
+		} else {
+			W[i & 15] += VGAMMA1(W[(i - 2) & 15]) + W[(i - 7) & 15] +
+				     VGAMMA0(W[(i - 15) & 15]);
+		}
+
+		t0 = h + VSIGMA1(e) + VCH(e, f, g) + sha256_k[i] + W[i & 15];
+		t1 = VSIGMA0(a) + VMAJ(a, b, c);
+		h = g;
+		g = f;
+		f = e;
+		e = d + t0;
+		d = c;
+		c = b;
+		b = a;
+		a = t0 + t1;
+	}
+
+	S[0] += a; S[1] += b; S[2] += c; S[3] += d;
+	S[4] += e; S[5] += f; S[6] += g; S[7] += h;
+
+	for (i = 0; i < 8; i++)
+		for (l = 0; l < HASH_MB_LANES; l++)
+			state[l][i] = S[i][l];
+}
+
+static void sha256_lanes_generic(uint32_t *state[HASH_MB_LANES],
+				 const unsigned char *block[HASH_MB_LANES])
+{
+	sha256_lanes_body(state, block);
+}
+
+#ifdef HASH_MB_AVX2
+__attribute__((target("avx2")))
+static void sha256_lanes_avx2(uint32_t *state[HASH_MB_LANES],
+			      const unsigned char *block[HASH_MB_LANES])
+{
+	sha256_lanes_body(state, block);
+}
+#endif
+
+static hash_mb_lanes_fn sha256_lanes(void)
+{
+#ifdef HASH_MB_AVX2
+	if (hash_mb_have_avx2())
+		return sha256_lanes_avx2;
+#endif
+	return sha256_lanes_generic;
+}
+
+#else
+
+static hash_mb_lanes_fn sha256_lanes(void)
+{
+	return NULL;
+}
+
+#endif
+
+void blk_SHA256_Update_multi(blk_SHA256_CTX **ctx, const void **data,
+			     const size_t *len, size_t nr)
+{
+	struct hash_mb_job *jobs;
+	size_t i;
+
+	CALLOC_ARRAY(jobs, nr);
+	for (i = 0; i < nr; i++) {
+		const unsigned char *p = data[i];
+		size_t n = len[i];
+		unsigned int len_buf = ctx[i]->size & 63;
+
+		ctx[i]->size += n;
+		jobs[i].state = ctx[i]->state;
+
+		/* Top up a partial block first, just like blk_SHA256_Update(). */
+		if (len_buf) {
+			unsigned int left = 64 - len_buf;
+
+			if (n < left) {
+				memcpy(ctx[i]->buf + len_buf, p, n);
+				continue;
+			}
+			memcpy(ctx[i]->buf + len_buf, p, left);
+			jobs[i].first = ctx[i]->buf;
+			p += left;
+			n -= left;
+		}
+		jobs[i].data = p;
+		jobs[i].blocks = n / 64;
+	}
+
+	hash_mb_run(jobs, nr, 8, sha256_lanes(), blk_SHA256_Transform);
+
+	/*
+	 * Only now buffer what is left of each message, as "buf" may have
+	 * been a block to compress. Each job's "data" has been advanced to
+	 * its tail.
+	 */
+	for (i = 0; i < nr; i++) {
+		unsigned int tail = ctx[i]->size & 63;
+
+		if (jobs[i].data && tail)
+			memcpy(ctx[i]->buf, jobs[i].data, tail);
+	}
+	free(jobs);
+}
+
+void blk_SHA256_Final_multi(unsigned char **digest, blk_SHA256_CTX **ctx,
+			    size_t nr)
+{
+	unsigned char (*pad)[64 + 8];
+	const void **in;
+	size_t *len;
+	size_t i;
+	int j;
+
+	ALLOC_ARRAY(pad, nr);
+	ALLOC_ARRAY(in, nr);
+	ALLOC_ARRAY(len, nr);
+
+	/* Pad with a binary 1 (ie 0x80), then zeroes, then length */
+	for (i = 0; i < nr; i++) {
+		size_t n = 1 + (63 & (55 - (ctx[i]->size & 63)));
+
+		memset(pad[i], 0, n);
+		pad[i][0] = 0x80;
+		put_be64(pad[i] + n, ctx[i]->size << 3);
+		in[i] = pad[i];
+		len[i] = n + 8;
+	}
+	blk_SHA256_Update_multi(ctx, in, len, nr);
+
+	for (i = 0; i < nr; i++)
+		for (j = 0; j < 8; j++)
+			put_be32(digest[i] + j * 4, ctx[i]->state[j]);
+
+	free(pad);
+	free(in);
+	free(len);
+}
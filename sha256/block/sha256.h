@@ -16,9 +16,21 @@ void blk_SHA256_Init(blk_SHA256_CTX *ctx);
 void blk_SHA256_Update(blk_SHA256_CTX *ctx, const void *data, size_t len);
 void blk_SHA256_Final(unsigned char *digest, blk_SHA256_CTX *ctx);
 
+/*
+ * Like blk_SHA256_Update() and blk_SHA256_Final(), but for "nr"
+ * independent contexts at once, whose blocks are compressed in parallel
+ * where the CPU allows.
+ */
+void blk_SHA256_Update_multi(blk_SHA256_CTX **ctx, const void **data,
+			     const size_t *len, size_t nr);
+void blk_SHA256_Final_multi(unsigned char **digest, blk_SHA256_CTX **ctx,
+			    size_t nr);
+
 #define platform_SHA256_CTX blk_SHA256_CTX
 #define platform_SHA256_Init blk_SHA256_Init
 #define platform_SHA256_Update blk_SHA256_Update
 #define platform_SHA256_Final blk_SHA256_Final
+#define platform_SHA256_Update_multi blk_SHA256_Update_multi
+#define platform_SHA256_Final_multi blk_SHA256_Final_multi
 
 #endif
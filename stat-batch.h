@@ -0,0 +1,71 @@
+#ifndef STAT_BATCH_H
+#define STAT_BATCH_H
+
+/*
+ * Batched lstat(): queue up a number of paths, and then have them all
+ * looked at at once. On Linux, when Git is built with HAVE_IO_URING and
+ * the kernel supports it, this submits statx() requests through io_uring,
+ * so that the lookups are in flight together rather than one after the
+ * other. That matters on network filesystems and with cold caches, where
+ * each lstat() is mostly spent waiting.
+ *
+ * stat_batch_new() returns NULL when batching is not available, in which
+ * case the caller is expected to call lstat() itself.
+ */
+
+struct stat_batch;
+
+/*
+ * Called by stat_batch_run() with the result of lstat()ing each queued
+ * path which could be stat'ed, along with the "item" it was queued with.
+ */
+typedef void (*stat_batch_fn)(void *item, struct stat *st, void *cb_data);
+
+#ifdef HAVE_IO_URING
+
+/*
+ * Set up for batches of up to "size" paths. The batch is not thread-safe;
+ * threads should have one each.
+ */
+struct stat_batch *stat_batch_new(unsigned int size);
+
+/*
+ * Queue "path" (which has to stay valid until the next stat_batch_run())
+ * for lstat()ing. Returns non-zero when the batch is full, and needs to
+ * be run before queueing more.
+ */
+int stat_batch_add(struct stat_batch *batch, const char *path, void *item);
+
+/* Look at all queued paths, and empty the batch. */
+void stat_batch_run(struct stat_batch *batch, stat_batch_fn fn,
+		    void *cb_data);
+
+void stat_batch_free(struct stat_batch *batch);
+
+#else
+
+static inline struct stat_batch *stat_batch_new(unsigned int size UNUSED)
+{
+	return NULL;
+}
+
+static inline int stat_batch_add(struct stat_batch *batch UNUSED,
+				 const char *path UNUSED, void *item UNUSED)
+{
+	BUG("stat_batch_add() without batching support");
+}
+
+static inline void stat_batch_run(struct stat_batch *batch UNUSED,
+				  stat_batch_fn fn UNUSED,
+				  void *cb_data UNUSED)
+{
+	BUG("stat_batch_run() without batching support");
+}
+
+static inline void stat_batch_free(struct stat_batch *batch UNUSED)
+{
+}
+
+#endif
+
+#endif
@@ -1,5 +1,6 @@
 #include "test-tool.h"
 #include "hash-ll.h"
+#include "parse.h"
 
 #define NUM_SECONDS 3
 
@@ -10,6 +11,22 @@ static inline void compute_hash(const struct git_hash_algo *algo, git_hash_ctx *
 	algo->final_fn(final, ctx);
 }
 
+/* Hash "nr" buffers of "len" bytes each at once with the batched API. */
+static void compute_hash_batch(const struct git_hash_algo *algo,
+			       git_hash_ctx *c, git_hash_ctx **ctx,
+			       unsigned char **final, const void **p,
+			       const size_t *len, size_t nr)
+{
+	size_t i;
+
+	for (i = 0; i < nr; i++) {
+		ctx[i] = &c[i];
+		algo->init_fn(ctx[i]);
+	}
+	algo->update_multi_fn(ctx, p, len, nr);
+	algo->final_multi_fn(final, ctx, nr);
+}
+
 int cmd__hash_speed(int ac, const char **av)
 {
 	git_hash_ctx ctx;
@@ -19,6 +36,18 @@ int cmd__hash_speed(int ac, const char **av)
 	int i;
 	void *p;
 	const struct git_hash_algo *algo = NULL;
+	unsigned long batch = 0;
+	git_hash_ctx *batch_c = NULL, **batch_ctx = NULL;
+	unsigned char (*batch_hash)[GIT_MAX_RAWSZ] = NULL, **batch_final = NULL;
+	const void **batch_p = NULL;
+	size_t *batch_len = NULL;
+
+	if (ac == 3 && skip_prefix(av[1], "--batch=", &av[1])) {
+		if (!git_parse_ulong(av[1], &batch) || !batch)
+			die("invalid batch size: %s", av[1]);
+		ac--;
+		av++;
+	}
 
 	if (ac == 2) {
 		for (i = 1; i < GIT_HASH_NALGOS; i++) {
@@ -29,26 +58,55 @@ int cmd__hash_speed(int ac, const char **av)
 		}
 	}
 	if (!algo)
-		die("usage: test-tool hash-speed algo_name");
+		die("usage: test-tool hash-speed [--batch=<n>] algo_name");
+
+	if (batch) {
+		ALLOC_ARRAY(batch_c, batch);
+		ALLOC_ARRAY(batch_ctx, batch);
+		ALLOC_ARRAY(batch_hash, batch);
+		ALLOC_ARRAY(batch_final, batch);
+		ALLOC_ARRAY(batch_p, batch);
+		ALLOC_ARRAY(batch_len, batch);
+		for (i = 0; i < batch; i++)
+			batch_final[i] = batch_hash[i];
+	}
 
 	/* Use this as an offset to make overflow less likely. */
 	initial = clock();
 
 	printf("algo: %s\n", algo->name);
+	if (batch)
+		printf("batch: %lu\n", batch);
 
 	for (i = 0; i < ARRAY_SIZE(bufsizes); i++) {
-		unsigned long j, kb;
+		unsigned long j, rounds, kb;
 		double kb_per_sec;
-		p = xcalloc(1, bufsizes[i]);
+		p = xcalloc(batch ? batch : 1, bufsizes[i]);
+		if (batch) {
+			unsigned long b;
+
+			for (b = 0; b < batch; b++) {
+				batch_p[b] = (char *)p + b * bufsizes[i];
+				batch_len[b] = bufsizes[i];
+			}
+		}
 		start = end = clock() - initial;
-		for (j = 0; ((end - start) / CLOCKS_PER_SEC) < NUM_SECONDS; j++) {
-			compute_hash(algo, &ctx, hash, p, bufsizes[i]);
+		for (j = rounds = 0; ((end - start) / CLOCKS_PER_SEC) < NUM_SECONDS; rounds++) {
+			if (batch) {
+				compute_hash_batch(algo, batch_c, batch_ctx,
+						   batch_final, batch_p,
+						   batch_len, batch);
+				j += batch;
+			} else {
+				compute_hash(algo, &ctx, hash, p, bufsizes[i]);
+				j++;
+			}
 
 			/*
 			 * Only check elapsed time every 128 iterations to avoid
 			 * dominating the runtime with system calls.
 			 */
-			if (!(j & 127))
+			if (!(rounds & 127))
 				end = clock() - initial;
 		}
 		kb = j * bufsizes[i];
@@ -57,5 +115,11 @@ int cmd__hash_speed(int ac, const char **av)
 		free(p);
 	}
 
+	free(batch_c);
+	free(batch_ctx);
+	free(batch_hash);
+	free(batch_final);
+	free(batch_p);
+	free(batch_len);
 	return 0;
 }
@@ -1,5 +1,69 @@
 #include "test-tool.h"
 #include "hex.h"
+#include "strbuf.h"
+
+/*
+ * Hash each line of stdin as a message of its own (without the newline)
+ * with the batched API, feeding every message in two halves so that the
+ * second update starts in the middle of a block.
+ */
+static int hash_lines_batched(const struct git_hash_algo *algop)
+{
+	struct strbuf input = STRBUF_INIT;
+	git_hash_ctx *c, **ctx;
+	const void **in;
+	size_t *len, *half;
+	unsigned char (*hash)[GIT_MAX_RAWSZ], **out;
+	size_t nr = 0, alloc = 0, i;
+	char *p, *end;
+
+	if (strbuf_read(&input, 0, 0) < 0)
+		die_errno("test-hash");
+
+	in = NULL;
+	len = NULL;
+	for (p = input.buf; p < input.buf + input.len; p = end + 1) {
+		end = strchrnul(p, '\n');
+		ALLOC_GROW(in, nr + 1, alloc);
+		REALLOC_ARRAY(len, alloc);
+		in[nr] = p;
+		len[nr] = end - p;
+		nr++;
+	}
+
+	CALLOC_ARRAY(c, nr);
+	ALLOC_ARRAY(ctx, nr);
+	ALLOC_ARRAY(half, nr);
+	ALLOC_ARRAY(hash, nr);
+	ALLOC_ARRAY(out, nr);
+	for (i = 0; i < nr; i++) {
+		ctx[i] = &c[i];
+		out[i] = hash[i];
+		algop->init_fn(ctx[i]);
+		half[i] = len[i] / 2;
+	}
+
+	algop->update_multi_fn(ctx, in, half, nr);
+	for (i = 0; i < nr; i++) {
+		in[i] = (const char *)in[i] + half[i];
+		len[i] -= half[i];
+	}
+	algop->update_multi_fn(ctx, in, len, nr);
+	algop->final_multi_fn(out, ctx, nr);
+
+	for (i = 0; i < nr; i++)
+		puts(hash_to_hex_algop(hash[i], algop));
+
+	free(c);
+	free(ctx);
+	free(in);
+	free(len);
+	free(half);
+	free(hash);
+	free(out);
+	strbuf_release(&input);
+	return 0;
+}
 
 int cmd_hash_impl(int ac, const char **av, int algo)
 {
@@ -11,6 +75,8 @@ int cmd_hash_impl(int ac, const char **av, int algo)
 	const struct git_hash_algo *algop = &hash_algos[algo];
 
 	if (ac == 2) {
+		if (!strcmp(av[1], "-m"))
+			return hash_lines_batched(algop);
 		if (!strcmp(av[1], "-b"))
 			binary = 1;
 		else
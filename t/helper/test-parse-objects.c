@@ -0,0 +1,174 @@
+#include "test-tool.h"
+#include "blob.h"
+#include "commit.h"
+#include "hex.h"
+#include "object.h"
+#include "object-store-ll.h"
+#include "oid-array.h"
+#include "parse-options.h"
+#include "repository.h"
+#include "setup.h"
+#include "strbuf.h"
+#include "thread-utils.h"
+#include "tree.h"
+#include "tree-walk.h"
+
+/*
+ * Look up and parse the commits named on stdin, along with their whole
+ * trees, from several threads at once with the object table locked, and
+ * then print what we know about each commit.
+ *
+ * Each thread walks the list starting at a different position, so that
+ * they race on creating, typing and parsing the same objects, and on
+ * growing the object table.
+ */
+
+static const char *parse_objects_usage[] = {
+	"test-tool parse-objects [--threads=<n>] < <commit-list>",
+	NULL
+};
+
+struct parse_objects_data {
+	pthread_t thread;
+	struct oid_array *oids;
+	size_t start;
+	int errors;
+};
+
+static int parse_tree_recursively(struct tree *tree)
+{
+	struct tree_desc desc;
+	struct name_entry entry;
+	int errors = 0;
+
+	if (parse_tree(tree))
+		return error("unable to parse tree %s",
+			     oid_to_hex(&tree->object.oid));
+
+	init_tree_desc(&desc, tree->buffer, tree->size);
+	while (tree_entry(&desc, &entry)) {
+		/* start out untyped, to race on giving the object its type */
+		lookup_unknown_object(the_repository, &entry.oid);
+
+		if (S_ISDIR(entry.mode)) {
+			struct tree *subtree = lookup_tree(the_repository,
+							   &entry.oid);
+			if (!subtree)
+				errors++;
+			else
+				errors += parse_tree_recursively(subtree);
+		} else if (S_ISREG(entry.mode) || S_ISLNK(entry.mode)) {
+			if (!lookup_blob(the_repository, &entry.oid))
+				errors++;
+		}
+	}
+	return errors;
+}
+
+static void *parse_objects_thread(void *data)
+{
+	struct parse_objects_data *d = data;
+	size_t nr = d->oids->nr;
+	size_t i;
+
+	for (i = 0; i < nr; i++) {
+		size_t n = (d->start + i) % nr;
+		const struct object_id *oid = &d->oids->oid[n];
+		struct commit *commit;
+
+		/* go through both ways of parsing a commit */
+		if (n % 2) {
+			struct object *obj = parse_object(the_repository, oid);
+
+			commit = obj ? object_as_type(obj, OBJ_COMMIT, 0) : NULL;
+		} else {
+			commit = lookup_commit(the_repository, oid);
+			if (commit && repo_parse_commit(the_repository, commit))
+				commit = NULL;
+		}
+		if (!commit) {
+			error("unable to parse commit %s", oid_to_hex(oid));
+			d->errors++;
+			continue;
+		}
+
+		d->errors += parse_tree_recursively(
+			repo_get_commit_tree(the_repository, commit));
+	}
+
+	return NULL;
+}
+
+static void print_commit(const struct object_id *oid)
+{
+	struct commit *commit = lookup_commit(the_repository, oid);
+	struct commit_list *p;
+
+	printf("%s %s", oid_to_hex(oid),
+	       oid_to_hex(get_commit_tree_oid(commit)));
+	for (p = commit->parents; p; p = p->next)
+		printf(" %s", oid_to_hex(&p->item->object.oid));
+	putchar('\n');
+}
+
+int cmd__parse_objects(int argc, const char **argv)
+{
+	struct oid_array oids = OID_ARRAY_INIT;
+	struct strbuf line = STRBUF_INIT;
+	struct parse_objects_data *data;
+	int nr_threads = 8;
+	int errors = 0;
+	unsigned int i, nr_objects = 0;
+
+	struct option options[] = {
+		OPT_INTEGER(0, "threads", &nr_threads, "number of threads"),
+		OPT_END(),
+	};
+
+	setup_git_directory();
+	argc = parse_options(argc, argv, NULL, options, parse_objects_usage, 0);
+	if (argc || nr_threads < 1)
+		usage_with_options(parse_objects_usage, options);
+	if (!HAVE_THREADS)
+		nr_threads = 1;
+
+	while (strbuf_getline(&line, stdin) != EOF) {
+		struct object_id oid;
+
+		if (get_oid_hex(line.buf, &oid))
+			die("not an object id: %s", line.buf);
+		oid_array_append(&oids, &oid);
+	}
+	strbuf_release(&line);
+
+	enable_obj_read_lock();
+	enable_object_table_lock(the_repository);
+
+	CALLOC_ARRAY(data, nr_threads);
+	for (i = 0; i < nr_threads; i++) {
+		data[i].oids = &oids;
+		data[i].start = st_mult(oids.nr, i) / nr_threads;
+		if (pthread_create(&data[i].thread, NULL,
+				   parse_objects_thread, &data[i]))
+			die("unable to create thread %d", i);
+	}
+	for (i = 0; i < nr_threads; i++) {
+		if (pthread_join(data[i].thread, NULL))
+			die("unable to join thread %d", i);
+		errors += data[i].errors;
+	}
+
+	disable_object_table_lock(the_repository);
+	disable_obj_read_lock();
+
+	for (i = 0; i < oids.nr; i++)
+		print_commit(&oids.oid[i]);
+	for (i = 0; i < get_max_object_index(); i++)
+		if (get_indexed_object(i))
+			nr_objects++;
+	printf("objects: %u\n", nr_objects);
+
+	free(data);
+	oid_array_clear(&oids);
+	return !!errors;
+}
@@ -44,6 +44,12 @@ int cmd__read_graph(int argc UNUSED, const char **argv UNUSED)
 		printf(" bloom_indexes");
 	if (graph->chunk_bloom_data)
 		printf(" bloom_data");
+	if (graph->chunk_reachability_index)
+		printf(" reachability_index");
+	if (graph->chunk_log_metadata)
+		printf(" log_metadata");
+	if (graph->chunk_changed_path_index)
+		printf(" changed_path_lists");
 	printf("\n");
 
 	printf("options:");
@@ -7,6 +7,7 @@
 #include "packfile.h"
 #include "setup.h"
 #include "gettext.h"
+#include "trace.h"
 
 static int read_midx_file(const char *object_dir, int show_objects)
 {
@@ -38,6 +39,10 @@ static int read_midx_file(const char *object_dir, int show_objects)
 		printf(" object-offsets");
 	if (m->chunk_large_offsets)
 		printf(" large-offsets");
+	if (m->chunk_oid_fanout16)
+		printf(" oid-fanout16");
+	if (m->chunk_object_filter)
+		printf(" object-filter");
 
 	printf("\nnum_objects: %d\n", m->num_objects);
 
@@ -123,10 +128,69 @@ static int read_midx_bitmapped_packs(const char *object_dir)
 	return 0;
 }
 
+/*
+ * Look up "count" objects of the MIDX, either in index order or in a
+ * pseudo-random (but repeatable) one, and report how long that took.
+ * The "missing" order looks up objects in random order, too, but with
+ * the last byte of their ID flipped, so that (barring a collision) none
+ * of them are found.
+ */
+static int read_midx_lookup(const char *order, const char *count_arg,
+			    const char *object_dir)
+{
+	struct multi_pack_index *m;
+	struct object_id *oids;
+	uint32_t count, found = 0, pos, i;
+	uint64_t seed = 1, start, elapsed;
+
+	setup_git_directory();
+	m = load_multi_pack_index(object_dir, 1);
+	if (!m)
+		return 1;
+	if (!m->num_objects)
+		die("multi-pack-index has no objects");
+	if (strtoul_ui(count_arg, 10, &count))
+		die("invalid lookup count: %s", count_arg);
+
+	ALLOC_ARRAY(oids, count);
+	for (i = 0; i < count; i++) {
+		if (!strcmp(order, "sequential")) {
+			pos = i % m->num_objects;
+		} else if (!strcmp(order, "random") ||
+			   !strcmp(order, "missing")) {
+			seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+			pos = (seed >> 33) % m->num_objects;
+		} else {
+			die("unknown lookup order: %s", order);
+		}
+		nth_midxed_object_oid(&oids[i], m, pos);
+		if (!strcmp(order, "missing"))
+			oids[i].hash[the_hash_algo->rawsz - 1] ^= 0xff;
+	}
+
+	start = getnanotime();
+	for (i = 0; i < count; i++)
+		if (bsearch_midx(&oids[i], m, &pos))
+			found++;
+	elapsed = getnanotime() - start;
+
+	printf("lookups: %"PRIu32"\n", count);
+	printf("found: %"PRIu32"\n", found);
+	printf("ns/lookup: %.1f\n", count ? (double)elapsed / count : 0.0);
+
+	free(oids);
+	close_midx(m);
+	return 0;
+}
+
 int cmd__read_midx(int argc, const char **argv)
 {
+	if (argc == 5 && !strcmp(argv[1], "--lookup"))
+		return read_midx_lookup(argv[2], argv[3], argv[4]);
+
 	if (!(argc == 2 || argc == 3))
-		usage("read-midx [--show-objects|--checksum|--preferred-pack|--bitmap] <object-dir>");
+		usage("read-midx [--show-objects|--checksum|--preferred-pack|--bitmap] <object-dir>\n"
+		      "   or: read-midx --lookup (random|sequential|missing) <count> <object-dir>");
 
 	if (!strcmp(argv[1], "--show-objects"))
 		return read_midx_file(argv[2], 1);
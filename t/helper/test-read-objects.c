@@ -0,0 +1,132 @@
+#include "test-tool.h"
+#include "hex.h"
+#include "object-store-ll.h"
+#include "oid-array.h"
+#include "parse-options.h"
+#include "repository.h"
+#include "setup.h"
+#include "strbuf.h"
+#include "thread-utils.h"
+
+/*
+ * Read the objects named on stdin from several threads at once, with the
+ * object read lock enabled the same way "git grep" does, and check that
+ * every thread gets back the right contents for each of them.
+ *
+ * Each thread walks the list starting at a different position, so that
+ * they race on the same packs, windows and delta base cache entries.
+ */
+
+static const char *read_objects_usage[] = {
+	"test-tool read-objects [--threads=<n>] [--rounds=<n>] < <object-list>",
+	NULL
+};
+
+struct read_objects_data {
+	pthread_t thread;
+	struct oid_array *oids;
+	size_t start;
+	int rounds;
+	int errors;
+};
+
+static void *read_objects_thread(void *data)
+{
+	struct read_objects_data *d = data;
+	size_t nr = d->oids->nr;
+	int round;
+	size_t i;
+
+	for (round = 0; round < d->rounds; round++) {
+		for (i = 0; i < nr; i++) {
+			const struct object_id *oid =
+				&d->oids->oid[(d->start + i) % nr];
+			struct object_id actual;
+			enum object_type type;
+			unsigned long size;
+			void *buf;
+
+			buf = repo_read_object_file(the_repository, oid,
+						    &type, &size);
+			if (!buf) {
+				error("unable to read %s", oid_to_hex(oid));
+				d->errors++;
+				continue;
+			}
+
+			hash_object_file(the_hash_algo, buf, size, type, &actual);
+			if (!oideq(oid, &actual)) {
+				error("%s read back as %s", oid_to_hex(oid),
+				      oid_to_hex(&actual));
+				d->errors++;
+			}
+			free(buf);
+		}
+	}
+
+	return NULL;
+}
+
+int cmd__read_objects(int argc, const char **argv)
+{
+	struct oid_array oids = OID_ARRAY_INIT;
+	struct strbuf line = STRBUF_INIT;
+	struct read_objects_data *data;
+	int nr_threads = 8, rounds = 1;
+	int errors = 0;
+	int i;
+
+	struct option options[] = {
+		OPT_INTEGER(0, "threads", &nr_threads, "number of reader threads"),
+		OPT_INTEGER(0, "rounds", &rounds, "times each thread reads every object"),
+		OPT_END(),
+	};
+
+	setup_git_directory();
+	argc = parse_options(argc, argv, NULL, options, read_objects_usage, 0);
+	if (argc || nr_threads < 1 || rounds < 1)
+		usage_with_options(read_objects_usage, options);
+
+	while (strbuf_getline(&line, stdin) != EOF) {
+		struct object_id oid;
+
+		if (get_oid_hex(line.buf, &oid))
+			die("not an object id: %s", line.buf);
+		oid_array_append(&oids, &oid);
+	}
+	strbuf_release(&line);
+
+	if (!oids.nr)
+		return 0;
+
+	if (!HAVE_THREADS) {
+		struct read_objects_data d = { .oids = &oids, .rounds = rounds };
+
+		read_objects_thread(&d);
+		oid_array_clear(&oids);
+		return !!d.errors;
+	}
+
+	enable_obj_read_lock();
+
+	CALLOC_ARRAY(data, nr_threads);
+	for (i = 0; i < nr_threads; i++) {
+		data[i].oids = &oids;
+		data[i].start = st_mult(oids.nr, i) / nr_threads;
+		data[i].rounds = rounds;
+		if (pthread_create(&data[i].thread, NULL,
+				   read_objects_thread, &data[i]))
+			die("unable to create thread %d", i);
+	}
+	for (i = 0; i < nr_threads; i++) {
+		if (pthread_join(data[i].thread, NULL))
+			die("unable to join thread %d", i);
+		errors += data[i].errors;
+	}
+
+	disable_obj_read_lock();
+
+	free(data);
+	oid_array_clear(&oids);
+	return !!errors;
+}
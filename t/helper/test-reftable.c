@@ -1,5 +1,14 @@
 #include "reftable/system.h"
+#include "reftable/constants.h"
+#include "reftable/reftable-error.h"
+#include "reftable/reftable-iterator.h"
+#include "reftable/reftable-merged.h"
+#include "reftable/reftable-record.h"
 #include "reftable/reftable-tests.h"
+#include "reftable/reftable-writer.h"
+#include "reftable/pq.h"
+#include "reftable/stack.h"
+#include "reftable/tournament.h"
 #include "test-tool.h"
 
 int cmd__reftable(int argc, const char **argv)
@@ -10,6 +19,7 @@ int cmd__reftable(int argc, const char **argv)
 	block_test_main(argc, argv);
 	tree_test_main(argc, argv);
 	pq_test_main(argc, argv);
+	tournament_test_main(argc, argv);
 	readwrite_test_main(argc, argv);
 	merged_test_main(argc, argv);
 	stack_test_main(argc, argv);
@@ -21,3 +31,239 @@ int cmd__dump_reftable(int argc, const char **argv)
 {
 	return reftable_dump_main(argc, (char *const *)argv);
 }
+
+struct bench_table_arg {
+	int nr_refs, nr_tables, table;
+	uint64_t update_index;
+};
+
+static void bench_refname(struct strbuf *buf, int i)
+{
+	strbuf_reset(buf);
+	strbuf_addf(buf, "refs/heads/branch-%07d", i);
+}
+
+static int bench_write_table(struct reftable_writer *wr, void *arg)
+{
+	struct bench_table_arg *a = arg;
+	struct strbuf name = STRBUF_INIT;
+	int i, err = 0;
+
+	reftable_writer_set_limits(wr, a->update_index, a->update_index);
+	for (i = a->table; !err && i < a->nr_refs; i += a->nr_tables) {
+		struct reftable_ref_record ref = {
+			.update_index = a->update_index,
+			.value_type = REFTABLE_REF_VAL1,
+		};
+
+		bench_refname(&name, i);
+		ref.refname = name.buf;
+		/* scatter the object IDs like real ones are */
+		put_be32(ref.value.val1, (uint32_t)i * 2654435761U);
+		err = reftable_writer_add_ref(wr, &ref);
+	}
+
+	strbuf_release(&name);
+	return err;
+}
+
+/*
+ * Write <refs> refs into a stack of <tables> tables in <dir>, without
+ * compacting them, so that lookups have to merge all of the tables.
+ */
+static int bench_write(const char *dir, int nr_refs, int nr_tables)
+{
+	struct reftable_write_options opts = { 0 };
+	struct reftable_stack *st;
+	int i, err;
+
+	err = reftable_new_stack(&st, dir, opts);
+	if (err < 0)
+		return err;
+	st->disable_auto_compact = 1;
+
+	for (i = 0; !err && i < nr_tables; i++) {
+		struct bench_table_arg arg = {
+			.nr_refs = nr_refs,
+			.nr_tables = nr_tables,
+			.table = i,
+			.update_index = reftable_stack_next_update_index(st),
+		};
+		err = reftable_stack_add(st, bench_write_table, &arg);
+	}
+
+	reftable_stack_destroy(st);
+	return err;
+}
+
+/* Look up <lookups> refs of the <refs> written by bench_write(). */
+static int bench_read_ref(const char *dir, int nr_refs, int nr_lookups)
+{
+	struct reftable_write_options opts = { 0 };
+	struct reftable_ref_record ref = { 0 };
+	struct reftable_stack *st;
+	struct strbuf name = STRBUF_INIT;
+	uint32_t seed = 1;
+	int i, err;
+
+	err = reftable_new_stack(&st, dir, opts);
+	if (err < 0)
+		return err;
+
+	for (i = 0; i < nr_lookups; i++) {
+		seed = seed * 1103515245 + 12345;
+		bench_refname(&name, (seed >> 8) % nr_refs);
+		err = reftable_stack_read_ref(st, name.buf, &ref);
+		if (err) {
+			if (err > 0)
+				err = REFTABLE_NOT_EXIST_ERROR;
+			break;
+		}
+	}
+
+	reftable_ref_record_release(&ref);
+	strbuf_release(&name);
+	reftable_stack_destroy(st);
+	return err;
+}
+
+/* Iterate over all of the <refs> refs written by bench_write(). */
+static int bench_iterate(const char *dir, int nr_refs)
+{
+	struct reftable_write_options opts = { 0 };
+	struct reftable_ref_record ref = { 0 };
+	struct reftable_iterator it = { NULL };
+	struct reftable_stack *st;
+	int nr = 0, err;
+
+	err = reftable_new_stack(&st, dir, opts);
+	if (err < 0)
+		return err;
+
+	err = reftable_merged_table_seek_ref(reftable_stack_merged_table(st),
+					     &it, "");
+	while (!err) {
+		err = reftable_iterator_next_ref(&it, &ref);
+		if (!err)
+			nr++;
+	}
+	if (err > 0 && nr != nr_refs)
+		die("iterated over %d refs instead of %d", nr, nr_refs);
+
+	reftable_ref_record_release(&ref);
+	reftable_iterator_destroy(&it);
+	reftable_stack_destroy(st);
+	return err < 0 ? err : 0;
+}
+
+/*
+ * Merge <records> ref records spread over <streams> sorted streams, the
+ * way that iterating over a stack of that many tables does, using either
+ * the binary heap of "pq.c" or the tournament tree of "tournament.c".
+ * This leaves out the cost of reading the tables, so as to measure the
+ * merging alone.
+ */
+static void bench_merge(int nr_streams, int nr_records, const char *how)
+{
+	struct strbuf name = STRBUF_INIT;
+	char **names;
+	int *pos;
+	int i, nr = 0;
+
+	if (nr_streams < 1 || nr_records < nr_streams)
+		die("need at least one record per stream");
+
+	ALLOC_ARRAY(names, nr_records);
+	for (i = 0; i < nr_records; i++) {
+		bench_refname(&name, i);
+		names[i] = strbuf_detach(&name, NULL);
+	}
+	CALLOC_ARRAY(pos, nr_streams);
+
+	if (!strcmp(how, "pq")) {
+		struct merged_iter_pqueue pq = { NULL };
+
+		for (i = 0; i < nr_streams; i++) {
+			struct pq_entry e = {
+				.index = i,
+				.rec = {
+					.type = BLOCK_TYPE_REF,
+					.u.ref.refname = names[i],
+				},
+			};
+			pos[i] = i;
+			merged_iter_pqueue_add(&pq, &e);
+		}
+		while (!merged_iter_pqueue_is_empty(pq)) {
+			struct pq_entry e = merged_iter_pqueue_remove(&pq);
+
+			nr++;
+			pos[e.index] += nr_streams;
+			if (pos[e.index] < nr_records) {
+				e.rec.u.ref.refname = names[pos[e.index]];
+				merged_iter_pqueue_add(&pq, &e);
+			}
+		}
+		merged_iter_pqueue_release(&pq);
+	} else if (!strcmp(how, "tournament")) {
+		struct merged_iter_tournament t = { NULL };
+
+		merged_iter_tournament_init(&t, nr_streams, BLOCK_TYPE_REF);
+		for (i = 0; i < nr_streams; i++) {
+			pos[i] = i;
+			t.leaves[i].rec.u.ref.refname = names[i];
+			merged_iter_tournament_leaf_changed(&t.leaves[i]);
+		}
+		merged_iter_tournament_build(&t);
+		while (!merged_iter_tournament_is_empty(&t)) {
+			size_t idx = merged_iter_tournament_top(&t);
+			struct tournament_leaf *leaf = &t.leaves[idx];
+
+			nr++;
+			pos[idx] += nr_streams;
+			if (pos[idx] < nr_records) {
+				leaf->rec.u.ref.refname = names[pos[idx]];
+				merged_iter_tournament_leaf_changed(leaf);
+			} else {
+				leaf->done = 1;
+			}
+			merged_iter_tournament_replay(&t);
+		}
+		/* the names are freed below */
+		for (i = 0; i < nr_streams; i++)
+			t.leaves[i].rec.u.ref.refname = NULL;
+		merged_iter_tournament_release(&t);
+	} else {
+		die("unknown merge '%s'", how);
+	}
+
+	if (nr != nr_records)
+		die("merged %d records instead of %d", nr, nr_records);
+
+	for (i = 0; i < nr_records; i++)
+		free(names[i]);
+	free(names);
+	free(pos);
+}
+
+int cmd__reftable_bench(int argc, const char **argv)
+{
+	int err = 0;
+
+	if (argc == 5 && !strcmp(argv[1], "write"))
+		err = bench_write(argv[2], atoi(argv[3]), atoi(argv[4]));
+	else if (argc == 5 && !strcmp(argv[1], "read-ref"))
+		err = bench_read_ref(argv[2], atoi(argv[3]), atoi(argv[4]));
+	else if (argc == 4 && !strcmp(argv[1], "iterate"))
+		err = bench_iterate(argv[2], atoi(argv[3]));
+	else if (argc == 5 && !strcmp(argv[1], "merge"))
+		bench_merge(atoi(argv[2]), atoi(argv[3]), argv[4]);
+	else
+		die("usage: test-tool reftable-bench "
+		    "(write <dir> <refs> <tables> | read-ref <dir> <refs> <lookups> |\n"
+		    "       iterate <dir> <refs> | merge <streams> <records> (pq | tournament))");
+
+	if (err < 0)
+		die("%s: %s", argv[1], reftable_error_str(err));
+	return 0;
+}
@@ -0,0 +1,28 @@
+#include "test-tool.h"
+#include "git-compat-util.h"
+#include "stat-batch.h"
+
+static void print_stat(void *item, struct stat *st, void *cb_data UNUSED)
+{
+	printf("%s %"PRIuMAX" %s\n", (const char *)item, (uintmax_t)st->st_size,
+	       S_ISDIR(st->st_mode) ? "dir" :
+	       S_ISLNK(st->st_mode) ? "link" : "file");
+}
+
+/*
+ * lstat() the given paths in one batch, and print their size and type.
+ * Exits with 1 if batching is not available.
+ */
+int cmd__stat_batch(int argc, const char **argv)
+{
+	struct stat_batch *batch = stat_batch_new(argc > 1 ? argc - 1 : 1);
+	int i;
+
+	if (!batch)
+		return 1;
+	for (i = 1; i < argc; i++)
+		stat_batch_add(batch, argv[i], (void *)argv[i]);
+	stat_batch_run(batch, print_stat, NULL);
+	stat_batch_free(batch);
+	return 0;
+}
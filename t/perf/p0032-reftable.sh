@@ -0,0 +1,36 @@
+#!/bin/sh
+
+test_description='Tests reftable lookup and iteration performance'
+. ./perf-lib.sh
+
+test_expect_success 'setup' '
+	mkdir one many &&
+	test-tool reftable-bench write one 100000 1 &&
+	test-tool reftable-bench write many 100000 32
+'
+
+test_perf 'read refs from a single table' '
+	test-tool reftable-bench read-ref one 100000 100000
+'
+
+test_perf 'read refs from a stack of 32 tables' '
+	test-tool reftable-bench read-ref many 100000 100000
+'
+
+test_perf 'iterate over a single table' '
+	test-tool reftable-bench iterate one 100000
+'
+
+test_perf 'iterate over a stack of 32 tables' '
+	test-tool reftable-bench iterate many 100000
+'
+
+test_perf 'merge 32 streams with a binary heap' '
+	test-tool reftable-bench merge 32 1000000 pq
+'
+
+test_perf 'merge 32 streams with a tournament tree' '
+	test-tool reftable-bench merge 32 1000000 tournament
+'
+
+test_done
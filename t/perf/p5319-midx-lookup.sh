@@ -0,0 +1,33 @@
+#!/bin/sh
+
+test_description='object lookups in a multi-pack-index'
+. ./perf-lib.sh
+
+test_perf_large_repo
+
+test_expect_success 'write midx with oid fanout16 and object filter chunks' '
+	git repack -ad &&
+	GIT_TEST_MIDX_WRITE_FANOUT16=1 \
+		git -c pack.writeMidxObjectFilter=true multi-pack-index write
+'
+
+for order in random sequential
+do
+	for fanout16 in 0 1
+	do
+		test_perf "$order lookups (fanout16=$fanout16)" "
+			GIT_TEST_MIDX_READ_FANOUT16=$fanout16 \
+				test-tool read-midx --lookup $order 1000000 .git/objects
+		"
+	done
+done
+
+for filter in 0 1
+do
+	test_perf "missing lookups (object filter=$filter)" "
+		GIT_TEST_MIDX_READ_OBJECT_FILTER=$filter \
+			test-tool read-midx --lookup missing 1000000 .git/objects
+	"
+done
+
+test_done
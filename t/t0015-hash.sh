@@ -53,4 +53,23 @@ test_expect_success 'test basic SHA-256 hash values' '
 	grep 6ef19b41225c5369f1c104d45d8d85efa9b057b53b14b4b9b939dd74decc5321 actual
 '
 
+test_expect_success 'setup messages for batched hashing' '
+	for i in $(test_seq 0 150)
+	do
+		line=$(printf "%${i}s" "$i") &&
+		echo "$line" >>messages &&
+		printf "%s" "$line" | test-tool sha1 >>expect.sha1 &&
+		printf "%s" "$line" | test-tool sha256 >>expect.sha256 ||
+		return 1
+	done
+'
+
+for algo in sha1 sha256
+do
+	test_expect_success "batched $algo hashes match one at a time" "
+		test-tool $algo -m <messages >actual &&
+		test_cmp expect.$algo actual
+	"
+done
+
 test_done
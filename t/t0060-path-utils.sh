@@ -377,6 +377,7 @@ test_git_path GIT_COMMON_DIR=bar refs/bisect/foo          .git/refs/bisect/foo
 test_git_path GIT_COMMON_DIR=bar hooks/me                 bar/hooks/me
 test_git_path GIT_COMMON_DIR=bar config                   bar/config
 test_git_path GIT_COMMON_DIR=bar packed-refs              bar/packed-refs
+test_git_path GIT_COMMON_DIR=bar packed-refs.delta        bar/packed-refs.delta
 test_git_path GIT_COMMON_DIR=bar shallow                  bar/shallow
 test_git_path GIT_COMMON_DIR=bar common                   bar/common
 test_git_path GIT_COMMON_DIR=bar common/file              bar/common/file
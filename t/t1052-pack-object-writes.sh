@@ -0,0 +1,156 @@
+#!/bin/sh
+
+test_description='core.packObjectWrites'
+
+. ./test-lib.sh
+
+no_loose_objects () {
+	find .git/objects -type f -path ".git/objects/??/*" >loose &&
+	test_must_be_empty loose
+}
+
+test_expect_success setup '
+	git config core.packObjectWrites true &&
+	mkdir dir &&
+	for i in $(test_seq 100)
+	do
+		echo $i >file-$i &&
+		echo $i >dir/file-$i || return 1
+	done
+'
+
+test_expect_success 'add writes a single pack' '
+	git add . &&
+	no_loose_objects &&
+	ls .git/objects/pack/pack-*.pack >packs &&
+	test_line_count = 1 packs &&
+	git count-objects -v >count &&
+	grep "^in-pack: 100$" count &&
+	ls .git/objects/pack >files &&
+	! grep tmp_ files
+'
+
+test_expect_success 'commit writes no loose objects' '
+	test_commit --no-tag first &&
+	no_loose_objects &&
+	git fsck --strict
+'
+
+test_expect_success 'objects can be read back before they are visible' '
+	echo changed >file-1 &&
+	echo changed >dir/file-2 &&
+	git stash &&
+	no_loose_objects &&
+	git diff --stat stash@{0}^ stash@{0} >actual &&
+	test_grep "2 files changed" actual &&
+	git stash pop &&
+	git diff --name-only >actual &&
+	test_write_lines dir/file-2 file-1 >expect &&
+	test_cmp expect actual &&
+	git fsck --strict
+'
+
+test_expect_success 'objects are visible when references are updated' '
+	test_hook reference-transaction <<-\EOF &&
+	test "$1" = prepared || exit 0
+	while read old new ref
+	do
+		case "$new" in
+		*[!0]*)
+			git cat-file -e $new || exit 1
+		esac
+	done
+	EOF
+	git commit -a -m second &&
+	no_loose_objects
+'
+
+test_expect_success 'merge-tree writes a single pack' '
+	git branch other &&
+	git checkout -b side HEAD~1 &&
+	echo side >dir/file-3 &&
+	git commit -a -m side &&
+	ls .git/objects/pack/pack-*.pack >before &&
+	tree=$(git merge-tree --write-tree other side) &&
+	ls .git/objects/pack/pack-*.pack >after &&
+	test_line_count = $(($(wc -l <before) + 1)) after &&
+	git ls-tree -r $tree >actual &&
+	grep "dir/file-3" actual &&
+	no_loose_objects &&
+	git fsck --strict
+'
+
+test_expect_success 'rebase leaves a single pack behind' '
+	git checkout -b many side &&
+	for i in $(test_seq 20)
+	do
+		echo $i >>dir/file-4 &&
+		git commit -q -a -m "many $i" || return 1
+	done &&
+	ls .git/objects/pack/pack-*.pack >before &&
+	test_hook reference-transaction <<-\EOF &&
+	ls .git/objects/pack/pack-*.pack | wc -l >>pack-counts
+	EOF
+	git rebase other &&
+	ls .git/objects/pack/pack-*.pack >after &&
+	test_line_count = $(($(wc -l <before) + 1)) after &&
+	sort -n pack-counts | tail -n 1 >max &&
+	test $(cat max) -le $(($(wc -l <before) + 8)) &&
+	git log --format=%s other.. >actual &&
+	test_line_count = 21 actual &&
+	no_loose_objects &&
+	git fsck --strict
+'
+
+test_expect_success 'packs listed in a new multi-pack-index are not removed' '
+	test_when_finished "rm -f .git/objects/pack/multi-pack-index* .git/midx-packs .git/packs*" &&
+	test_hook reference-transaction <<-\EOF &&
+	test "$1" = committed || exit 0
+	test ! -f .git/midx-packs || exit 0
+	ls .git/objects/pack/pack-*.pack >.git/packs &&
+	test $(wc -l <.git/packs) -gt $(wc -l <.git/packs-before) || exit 0
+	git multi-pack-index write &&
+	mv .git/packs .git/midx-packs
+	EOF
+	ls .git/objects/pack/pack-*.pack >.git/packs-before &&
+	test_tick &&
+	git rebase -f HEAD~10 &&
+	test_line_count -gt 1 .git/midx-packs &&
+	for p in $(cat .git/midx-packs)
+	do
+		test_path_is_file $p || return 1
+	done &&
+	git multi-pack-index verify &&
+	git fsck --strict
+'
+
+test_expect_success 'kept packs are not removed' '
+	test_when_finished "rm -f .git/objects/pack/*.keep .git/kept-packs .git/packs*" &&
+	test_hook reference-transaction <<-\EOF &&
+	test "$1" = committed || exit 0
+	test ! -f .git/kept-packs || exit 0
+	ls .git/objects/pack/pack-*.pack >.git/packs &&
+	test $(wc -l <.git/packs) -gt $(wc -l <.git/packs-before) || exit 0
+	for p in .git/objects/pack/pack-*.pack
+	do
+		>"${p%.pack}.keep" || exit 1
+	done &&
+	mv .git/packs .git/kept-packs
+	EOF
+	ls .git/objects/pack/pack-*.pack >.git/packs-before &&
+	test_tick &&
+	git rebase -f HEAD~10 &&
+	test_line_count -gt 1 .git/kept-packs &&
+	for p in $(cat .git/kept-packs)
+	do
+		test_path_is_file $p || return 1
+	done &&
+	git fsck --strict
+'
+
+test_expect_success 'without the setting objects are written loose' '
+	echo loose | git -c core.packObjectWrites=false hash-object -w --stdin >oid &&
+	test_path_is_file .git/objects/$(test_oid_to_path $(cat oid))
+'
+
+test_done
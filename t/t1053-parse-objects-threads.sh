@@ -0,0 +1,44 @@
+#!/bin/sh
+
+test_description='looking up and parsing objects from several threads at once'
+
+TEST_PASSES_SANITIZE_LEAK=true
+. ./test-lib.sh
+
+test_expect_success 'setup' '
+	for i in $(test_seq 1 200)
+	do
+		mkdir -p "dir$((i % 7))/sub$((i % 3))" &&
+		echo "$i" >"dir$((i % 7))/sub$((i % 3))/file$((i % 11))" &&
+		echo "$i" >"top$((i % 5))" &&
+		git add . &&
+		git commit -q -m "commit $i" || return 1
+	done &&
+	git checkout -b side HEAD~50 &&
+	test_commit side &&
+	git checkout - &&
+	git merge -q -m merge side &&
+
+	git rev-list --all >commits &&
+	git log --no-walk=unsorted --format="%H %T %P" --stdin <commits |
+	sed "s/ $//" >expect &&
+	echo "objects: $(git rev-list --objects --all | wc -l)" >>expect
+'
+
+test_expect_success 'parse objects from one thread' '
+	test-tool parse-objects --threads=1 <commits >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'parse objects from many threads' '
+	test-tool parse-objects --threads=16 <commits >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'parse objects from many threads with a commit-graph' '
+	git commit-graph write --reachable &&
+	test-tool parse-objects --threads=16 <commits >actual &&
+	test_cmp expect actual
+'
+
+test_done
@@ -1668,6 +1668,45 @@ test_expect_success PIPE 'transaction flushes status updates' '
 	test_cmp expected actual
 '
 
+fsync_count () {
+	sed -n -e "s/.*\"category\":\"fsync\",\"name\":\"$2\",\"count\":\([0-9]*\).*/\1/p" "$1"
+}
+
+test_expect_success REFFILES 'core.fsyncMethod=batch flushes a transaction once' '
+	for i in $(test_seq 10)
+	do
+		echo "create refs/heads/batch-$i $A" || return 1
+	done >stdin &&
+	GIT_TEST_FSYNC=true GIT_TRACE2_EVENT="$(pwd)/trace" \
+		git -c core.fsync=reference -c core.fsyncMethod=batch \
+		update-ref --stdin <stdin 2>err &&
+	if ! grep "core.fsyncMethod = batch is unsupported" err
+	then
+		# ten lockfiles and ten reflogs
+		test 20 = "$(fsync_count trace writeout-only)" &&
+		test 1 = "$(fsync_count trace hardware-flush)"
+	fi &&
+	git rev-parse refs/heads/batch-10 >actual &&
+	echo $A >expect &&
+	test_cmp expect actual &&
+	git reflog exists refs/heads/batch-10
+'
+
+test_expect_success REFFILES 'core.fsyncMethod=batch covers packed-refs' '
+	rm -f trace &&
+	GIT_TEST_FSYNC=true GIT_TRACE2_EVENT="$(pwd)/trace" \
+		git -c core.fsync=reference -c core.fsyncMethod=batch \
+		pack-refs --all 2>err &&
+	if ! grep "core.fsyncMethod = batch is unsupported" err
+	then
+		test 1 = "$(fsync_count trace writeout-only)" &&
+		test 1 = "$(fsync_count trace hardware-flush)"
+	fi &&
+	test_path_is_missing .git/refs/heads/batch-10 &&
+	git rev-parse refs/heads/batch-10 >actual &&
+	test_cmp expect actual
+'
+
 test_expect_success REFFILES 'directory not created deleting packed ref' '
 	git branch d1/d2/r1 HEAD &&
 	git pack-refs --all &&
@@ -0,0 +1,161 @@
+#!/bin/sh
+
+test_description='packed-refs updates through packed-refs.delta'
+
+TEST_PASSES_SANITIZE_LEAK=true
+. ./test-lib.sh
+
+if test_have_prereq !REFFILES
+then
+  skip_all='skipping files-backend specific pack-refs tests'
+  test_done
+fi
+
+test_expect_success 'setup' '
+	git config core.repositoryformatversion 1 &&
+	git config extensions.packedRefsDelta true &&
+	test_commit A &&
+	test_commit B &&
+	git tag -a -m annotated annotated A &&
+	for i in $(test_seq 100)
+	do
+		echo "create refs/heads/branch-$i HEAD" || return 1
+	done >input &&
+	git update-ref --stdin <input &&
+	git pack-refs --all &&
+	test_path_is_missing .git/packed-refs.delta &&
+	cp .git/packed-refs packed-refs.orig
+'
+
+test_expect_success 'deleting a packed ref only writes the delta' '
+	git show-ref >expect &&
+	git update-ref -d refs/heads/branch-50 &&
+	test_cmp packed-refs.orig .git/packed-refs &&
+	grep "^$ZERO_OID refs/heads/branch-50\$" .git/packed-refs.delta &&
+	test_must_fail git rev-parse --verify -q refs/heads/branch-50 &&
+	grep -v refs/heads/branch-50 expect >expect.deleted &&
+	git show-ref >actual &&
+	test_cmp expect.deleted actual &&
+	git for-each-ref --format="%(refname)" refs/heads/branch-5 >actual &&
+	echo refs/heads/branch-5 >expect &&
+	test_cmp expect actual
+'
+
+test_expect_success 'packing a few refs only writes the delta' '
+	git tag -a -m "new tag" new-tag B &&
+	git branch branch-50 A &&
+	git update-ref refs/heads/branch-7 A &&
+	git pack-refs --all &&
+	test_cmp packed-refs.orig .git/packed-refs &&
+	test_path_is_missing .git/refs/heads/branch-7 &&
+	git rev-parse A >expect &&
+	git rev-parse refs/heads/branch-50 refs/heads/branch-7 >actual &&
+	echo $(git rev-parse A) >>expect &&
+	test_cmp expect actual &&
+	git show-ref -d new-tag >actual &&
+	cat >expect <<-EOF &&
+	$(git rev-parse new-tag) refs/tags/new-tag
+	$(git rev-parse B) refs/tags/new-tag^{}
+	EOF
+	test_cmp expect actual
+'
+
+test_expect_success 'transactions check values in the delta' '
+	test_must_fail git update-ref -d refs/heads/branch-7 $(git rev-parse B) 2>err &&
+	test_grep "but expected" err &&
+	git update-ref -d refs/heads/branch-7 $(git rev-parse A) &&
+	test_must_fail git rev-parse --verify -q refs/heads/branch-7 &&
+	test_cmp packed-refs.orig .git/packed-refs
+'
+
+test_expect_success 'iteration merges the delta' '
+	git show-ref >actual &&
+	LC_ALL=C sort -k 2 actual >expect &&
+	test_cmp expect actual &&
+	! grep "refs/heads/branch-7\$" actual &&
+	grep "refs/heads/branch-50\$" actual &&
+	grep "refs/tags/new-tag\$" actual
+'
+
+test_expect_success 'pack-refs with nothing to pack folds the delta' '
+	git show-ref -d >expect &&
+	git pack-refs --all &&
+	test_path_is_missing .git/packed-refs.delta &&
+	! test_cmp packed-refs.orig .git/packed-refs &&
+	! grep $ZERO_OID .git/packed-refs &&
+	git show-ref -d >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'big transactions fold the delta' '
+	cp .git/packed-refs packed-refs.orig &&
+	git update-ref -d refs/heads/branch-1 &&
+	test_path_is_file .git/packed-refs.delta &&
+	for i in $(test_seq 2 40)
+	do
+		echo "delete refs/heads/branch-$i" || return 1
+	done >input &&
+	git update-ref --stdin <input &&
+	test_path_is_missing .git/packed-refs.delta &&
+	git for-each-ref --format="%(refname)" refs/heads/branch-1 \
+		refs/heads/branch-2 refs/heads/branch-40 >actual &&
+	test_must_be_empty actual
+'
+
+test_expect_success 'the delta records the generation of packed-refs' '
+	for i in $(test_seq 300)
+	do
+		echo "create refs/heads/more-$i HEAD" || return 1
+	done >input &&
+	git update-ref --stdin <input &&
+	git pack-refs --all &&
+	test_path_is_missing .git/packed-refs.delta &&
+	head -n 1 .git/packed-refs >header &&
+	generation=$(sed -n "s/.* generation=\([0-9]*\) .*/\1/p" header) &&
+	test -n "$generation" &&
+	git update-ref -d refs/heads/more-1 &&
+	head -n 1 .git/packed-refs.delta >actual &&
+	test_cmp header actual
+'
+
+# A reader that loads packed-refs.delta right before a fold and
+# packed-refs right after it sees the old delta next to the new
+# packed-refs.
+test_expect_success 'a delta file written before a fold is ignored' '
+	git update-ref refs/heads/more-2 A &&
+	git pack-refs --all &&
+	git update-ref -d refs/heads/more-3 &&
+	cp .git/packed-refs.delta delta.old &&
+	git update-ref refs/heads/more-2 B &&
+	git update-ref refs/heads/more-3 B &&
+	git pack-refs --all &&
+	test_path_is_file .git/packed-refs.delta &&
+	git pack-refs --all &&
+	test_path_is_missing .git/packed-refs.delta &&
+	git show-ref >expect &&
+	cp delta.old .git/packed-refs.delta &&
+	git rev-parse B B >expect.rev &&
+	git rev-parse refs/heads/more-2 refs/heads/more-3 >actual.rev &&
+	test_cmp expect.rev actual.rev &&
+	git show-ref >actual &&
+	test_cmp expect actual &&
+	git update-ref -d refs/heads/more-4 &&
+	grep refs/heads/more-4 .git/packed-refs.delta &&
+	! grep -e refs/heads/more-2 -e refs/heads/more-3 .git/packed-refs.delta &&
+	git rev-parse refs/heads/more-2 refs/heads/more-3 >actual.rev &&
+	test_cmp expect.rev actual.rev
+'
+
+test_expect_success 'delta is not written without the extension' '
+	git init no-delta &&
+	(
+		cd no-delta &&
+		test_commit A &&
+		git branch other &&
+		git pack-refs --all &&
+		git update-ref -d refs/heads/other &&
+		test_path_is_missing .git/packed-refs.delta
+	)
+'
+
+test_done
@@ -454,4 +454,44 @@ test_expect_success 'Bloom reader notices out-of-order index offsets' '
 	test_cmp expect.err err
 '
 
+test_expect_success PTHREADS 'Bloom filters do not depend on the number of threads' '
+	git init threads &&
+	(
+		cd threads &&
+		test_commit_bulk --filename="dir%s/sub/file" 30 &&
+		mkdir big &&
+		for i in $(test_seq 1 10)
+		do
+			echo $i >big/$i || return 1
+		done &&
+		git add big &&
+		git commit -m big &&
+		git commit --allow-empty -m empty &&
+
+		for args in "" "--max-new-filters=10"
+		do
+			for threads in 1 4
+			do
+				rm -f .git/objects/info/commit-graph &&
+				GIT_TEST_BLOOM_SETTINGS_MAX_CHANGED_PATHS=3 \
+				GIT_TRACE2_EVENT="$(pwd)/trace.$threads" \
+				git -c commitGraph.threads=$threads commit-graph write \
+					--reachable --changed-paths $args &&
+				mv .git/objects/info/commit-graph graph.$threads ||
+				return 1
+			done &&
+			grep "\"key\":\"filter-threads\",\"value\":\"4\"" trace.4 &&
+			test_cmp_bin graph.1 graph.4 || return 1
+		done &&
+
+		grep "\"key\":\"filter-computed\",\"value\":\"10\"" trace.4 &&
+		rm -f .git/objects/info/commit-graph &&
+		GIT_TEST_BLOOM_SETTINGS_MAX_CHANGED_PATHS=3 \
+		GIT_TRACE2_EVENT="$(pwd)/trace" \
+			git commit-graph write --reachable --changed-paths --threads=4 &&
+		grep "\"key\":\"filter-trunc-large\",\"value\":\"1\"" trace &&
+		grep "\"key\":\"filter-trunc-empty\",\"value\":\"1\"" trace
+	)
+'
+
 test_done
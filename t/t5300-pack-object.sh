@@ -635,4 +635,59 @@ test_expect_success 'negative window clamps to 0' '
 	check_deltas stderr = 0
 '
 
+test_expect_success PTHREADS 'threaded deflate produces the same pack' '
+	git pack-objects --window=0 --no-reuse-object --threads=1 \
+		--stdout <obj-list >deflate-1.pack &&
+	git pack-objects --window=0 --no-reuse-object --threads=4 \
+		--stdout <obj-list >deflate-4.pack &&
+	test_cmp_bin deflate-1.pack deflate-4.pack
+'
+
+test_expect_success PTHREADS 'threaded deflate of deltas to stdout' '
+	GIT_TRACE2_EVENT="$(pwd)/trace" git -c pack.threads=4 \
+		pack-objects --no-reuse-object --stdout <obj-list >deflate.pack &&
+	grep "\"key\":\"write_pack_file/deflate_threads\",\"value\":\"4\"" trace &&
+	git index-pack --strict -o deflate.idx deflate.pack &&
+	git verify-pack -v deflate.pack >verify &&
+	grep "chain length = 1" verify
+'
+
+test_expect_success PTHREADS 'checksum thread writes the same pack and index' '
+	git pack-objects --window=0 --threads=1 --stdout \
+		<obj-list >csum-1.pack &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" git -c core.checksumThread=true \
+		pack-objects --window=0 --threads=1 --stdout \
+		<obj-list >csum-2.pack &&
+	grep "\"thread\":\"th[0-9]*:hashfile\"" trace &&
+	test_cmp_bin csum-1.pack csum-2.pack &&
+
+	git index-pack -o csum-1.idx csum-1.pack &&
+	git -c core.checksumThread=true index-pack -o csum-2.idx csum-2.pack &&
+	test_cmp_bin csum-1.idx csum-2.idx
+'
+
+test_expect_success PTHREADS 'pack-objects --threads walks trees with threads' '
+	git init tree-walk &&
+	(
+		cd tree-walk &&
+		mkdir -p a/b/c &&
+		for i in $(test_seq 1 5)
+		do
+			echo $i >a/$i &&
+			echo $i >a/b/$i &&
+			echo $i >a/b/c/$i &&
+			git add a &&
+			git commit -m $i || return 1
+		done &&
+		echo HEAD >in &&
+		one=$(git pack-objects --revs --threads=1 one <in) &&
+		four=$(GIT_TRACE2_EVENT="$(pwd)/trace" \
+			git pack-objects --revs --threads=4 four <in) &&
+		grep "\"category\":\"list-objects\",\"key\":\"threads\",\"value\":\"4\"" trace &&
+		git show-index <one-$one.idx | cut -d" " -f2 | sort >expect &&
+		git show-index <four-$four.idx | cut -d" " -f2 | sort >actual &&
+		test_cmp expect actual
+	)
+'
+
 test_done
@@ -286,6 +286,21 @@ test_expect_success 'index-pack -v --stdin produces progress for both phases' '
 	test_grep "Resolving deltas" err
 '
 
+test_expect_success 'index-pack resolves deltas while receiving the pack' '
+	pack=$(git pack-objects --all --delta-base-offset pack </dev/null) &&
+	for threads in 1 4
+	do
+		rm -f stream.idx trace &&
+		GIT_TRACE2_EVENT="$(pwd)/trace" git -c pack.threads=$threads \
+			-c pack.indexStreamDeltas=true \
+			index-pack --strict --stdin -o stream.idx \
+			<pack-$pack.pack >/dev/null &&
+		cmp pack-$pack.idx stream.idx &&
+		grep "\"key\":\"deltas_resolved_while_receiving\",\"value\":\"[1-9]" trace ||
+		return 1
+	done
+'
+
 test_expect_success 'too-large packs report the breach' '
 	pack=$(git pack-objects --all pack </dev/null) &&
 	sz="$(test_file_size pack-$pack.pack)" &&
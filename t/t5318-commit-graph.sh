@@ -897,6 +897,251 @@ test_expect_success 'reader notices too-small generations chunk' '
 	test_cmp expect.err err
 '
 
+test_expect_success 'reachability index is written on request' '
+	graph=full/.git/objects/info/commit-graph &&
+	test_when_finished "rm -f $graph" &&
+	git -C full commit-graph write --reachable &&
+	test-tool -C full read-graph >out &&
+	! grep reachability_index out &&
+	git -C full -c commitGraph.writeReachabilityIndex=true \
+		commit-graph write --reachable &&
+	test-tool -C full read-graph >out &&
+	grep "^chunks:.* reachability_index" out &&
+	git -C full commit-graph verify &&
+	git -C full -c commitGraph.readReachabilityIndex=false \
+		tag --contains commits/3 >expect &&
+	git -C full tag --contains commits/3 >actual &&
+	test_cmp expect actual &&
+	git -C full merge-base --is-ancestor commits/2 merge/1 &&
+	test_must_fail git -C full merge-base --is-ancestor commits/3 merge/1
+'
+
+test_expect_success 'reachability index is not written on top of a base graph' '
+	test_when_finished "rm -rf split" &&
+	git init split &&
+	test_commit -C split A &&
+	git -C split -c commitGraph.writeReachabilityIndex=true \
+		commit-graph write --reachable --split &&
+	test-tool -C split read-graph >out &&
+	grep "^chunks:.* reachability_index" out &&
+	test_commit -C split B &&
+	git -C split -c commitGraph.writeReachabilityIndex=true \
+		commit-graph write --reachable --split=no-merge &&
+	test_line_count = 2 split/.git/objects/info/commit-graphs/commit-graph-chain &&
+	test-tool -C split read-graph >out &&
+	! grep reachability_index out &&
+	git -C split commit-graph verify &&
+	git -C split merge-base --is-ancestor A B
+'
+
+test_expect_success 'reader notices wrong-size reachability index chunk' '
+	test_config -C full commitGraph.writeReachabilityIndex true &&
+	check_corrupt_chunk RIDX clear 00000000 &&
+	cat >expect.err <<-\EOF &&
+	warning: commit-graph reachability index chunk is wrong size
+	EOF
+	test_cmp expect.err err
+'
+
+test_expect_success 'verify notices inconsistent reachability index' '
+	test_config -C full commitGraph.writeReachabilityIndex true &&
+	nr=$(git -C full rev-list --all | wc -l) &&
+	corrupt_chunk RIDX clear $(printf "%024d" $(test_seq $nr)) &&
+	test_must_fail git -C full commit-graph verify 2>err &&
+	test_grep "reachability index for commit .* is inconsistent" err
+'
+
+test_expect_success 'setup repo with log metadata' '
+	git init logmeta &&
+	(
+		cd logmeta &&
+		test_commit one &&
+		test_commit --author "Other <other@example.com>" two &&
+		git commit --allow-empty -F - <<-\EOF &&
+		a subject
+		spanning two lines
+
+		and a body
+		EOF
+		tree=$(git write-tree) &&
+		printf "tree %s\nparent %s\nauthor %s\ncommitter %s\n\n%s\n" \
+			$tree $(git rev-parse HEAD) \
+			"Zero <zero@example.com> 1234567890 -0000" \
+			"Odd <odd@example.com> 1234567890 +0530" \
+			"odd time zones" >raw &&
+		commit=$(git hash-object -t commit -w raw) &&
+		printf "tree %s\nparent %s\nauthor %s\ncommitter %s\nencoding %s\n\n%s\n" \
+			$tree $commit \
+			"$(printf "\311mile <e@example.com> 1234567890 +0100")" \
+			"$(printf "\311mile <e@example.com> 1234567890 +0100")" \
+			ISO-8859-1 "$(printf "l\351tin")" >raw &&
+		commit=$(git hash-object -t commit -w raw) &&
+		git reset --hard $commit &&
+		git -c commitGraph.writeLogMetadata=true \
+			commit-graph write --reachable &&
+		test-tool read-graph >out &&
+		grep "^chunks:.* log_metadata" out &&
+		git commit-graph verify
+	)
+'
+
+test_expect_success 'log --format uses log metadata' '
+	for fmt in "%an %ae %aN %al %ad %at %aI %as" \
+		   "%cn %ce %cL %cd %ct %cr %cD" \
+		   "%s | %f | %e" "%s%n%b" "%H %an %B"
+	do
+		git -C logmeta -c commitGraph.readLogMetadata=false \
+			log --format="$fmt" >expect &&
+		git -C logmeta log --format="$fmt" >actual &&
+		test_cmp expect actual &&
+		git -C logmeta -c commitGraph.readLogMetadata=false \
+			log --date=iso-strict --format="$fmt" >expect &&
+		git -C logmeta log --date=iso-strict --format="$fmt" >actual &&
+		test_cmp expect actual || return 1
+	done
+'
+
+test_expect_success 'log --format does not read commits for log metadata' '
+	test_when_finished "rm -rf logmeta-copy" &&
+	cp -R logmeta logmeta-copy &&
+	oid=$(git -C logmeta-copy rev-parse two) &&
+	rm logmeta-copy/.git/objects/$(test_oid_to_path $oid) &&
+	echo "Other other@example.com two" >expect &&
+	git -C logmeta-copy log -1 --format="%an %ae %s" $oid >actual &&
+	test_cmp expect actual &&
+	test_must_fail git -C logmeta-copy log -1 --format=%b $oid
+'
+
+test_expect_success 'reader notices broken log metadata' '
+	test_config -C full commitGraph.writeLogMetadata true &&
+	check_corrupt_chunk LOGM clear 00000000 &&
+	cat >expect.err <<-\EOF &&
+	warning: commit-graph log metadata chunk is wrong size
+	EOF
+	test_cmp expect.err err &&
+	check_corrupt_chunk IDNT clear 01 &&
+	cat >expect.err <<-\EOF &&
+	warning: ignoring commit-graph log metadata without proper string tables
+	EOF
+	test_cmp expect.err err
+'
+
+test_expect_success 'verify notices wrong log metadata' '
+	test_config -C full commitGraph.writeLogMetadata true &&
+	corrupt_chunk SUBJ 1 21 &&
+	test_must_fail git -C full commit-graph verify 2>err &&
+	test_grep "log metadata for commit .* does not match" err
+'
+
+test_expect_success 'setup repo with changed-path lists' '
+	git init paths &&
+	(
+		cd paths &&
+		mkdir -p a/b c &&
+		test_commit one a/b/file &&
+		test_commit two c/file &&
+		test_commit three a/file &&
+		git checkout -b side HEAD~1 &&
+		test_commit four c/other &&
+		git checkout - &&
+		git merge side &&
+		git rm -r a/b &&
+		echo file >a/b &&
+		git add a/b &&
+		git commit -m "a/b becomes a file" &&
+		git mv c d &&
+		git commit -m "rename c to d" &&
+		git update-index --add --cacheinfo 160000,$(git rev-parse HEAD),sub &&
+		git commit -m "add submodule" &&
+		test_commit --no-tag "ab" ab &&
+		for i in 1 2 3 4 5
+		do
+			echo $i >many$i || return 1
+		done &&
+		git add many* &&
+		git commit -m "many files" &&
+		GIT_TEST_BLOOM_SETTINGS_MAX_CHANGED_PATHS=4 \
+			git -c commitGraph.writeChangedPathLists=true \
+			commit-graph write --reachable &&
+		test-tool read-graph >out &&
+		grep "^chunks:.* changed_path_lists" out &&
+		git commit-graph verify
+	)
+'
+
+test_expect_success 'path-limited log uses changed-path lists' '
+	for path in a a/ a/b a/b/ a/b/file c d/file sub sub/ ab many3 \
+		    ":(literal)d" "a c" "a/b ab" .
+	do
+		for opts in "" --full-history --simplify-merges --first-parent
+		do
+			git -C paths -c commitGraph.readChangedPathLists=false \
+				log --format="%H %P" $opts -- $path >expect &&
+			git -C paths log --format="%H %P" $opts -- $path >actual &&
+			test_cmp expect actual || return 1
+		done
+	done &&
+	GIT_TRACE2_EVENT="$(pwd)/trace.event" git -C paths log -- a/b &&
+	test_grep "\"same\":[1-9]" trace.event
+'
+
+test_expect_success 'blame and log -L use changed-path lists' '
+	git -C paths -c commitGraph.readChangedPathLists=false \
+		blame d/file >expect &&
+	git -C paths blame d/file >actual &&
+	test_cmp expect actual &&
+	git -C paths -c commitGraph.readChangedPathLists=false \
+		log -L1,1:d/other >expect &&
+	git -C paths log -L1,1:d/other >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'log -L simplifies merges with changed-path lists' '
+	git init line-merge &&
+	(
+		cd line-merge &&
+		test_write_lines 1 2 3 4 5 >f &&
+		git add f &&
+		git commit -m base &&
+		git checkout -b side &&
+		test_write_lines 1 2 side 4 5 >f &&
+		git commit -am side &&
+		git checkout - &&
+		test_write_lines main 2 3 4 5 >f &&
+		git commit -am main &&
+		git merge -s ours -m merge side &&
+		test_write_lines main two 3 4 5 >f &&
+		git commit -am after &&
+		git -c commitGraph.writeChangedPathLists=true \
+			commit-graph write --reachable &&
+		git -c commitGraph.readChangedPathLists=false \
+			log -L1,3:f --graph --format="%h %p" >expect &&
+		git log -L1,3:f --graph --format="%h %p" >actual &&
+		test_cmp expect actual
+	)
+'
+
+test_expect_success 'reader notices broken changed-path lists' '
+	test_config -C full commitGraph.writeChangedPathLists true &&
+	check_corrupt_chunk CPIX clear 00000000 &&
+	cat >expect.err <<-\EOF &&
+	warning: commit-graph changed-path list index chunk is wrong size
+	EOF
+	test_cmp expect.err err &&
+	check_corrupt_chunk CPTB clear 01 &&
+	cat >expect.err <<-\EOF &&
+	warning: ignoring commit-graph changed-path lists without proper path table
+	EOF
+	test_cmp expect.err err
+'
+
+test_expect_success 'verify notices wrong changed-path lists' '
+	test_config -C full commitGraph.writeChangedPathLists true &&
+	corrupt_chunk CPLS 0 00000000 &&
+	test_must_fail git -C full commit-graph verify 2>err &&
+	test_grep "changed-path list for commit .* does not match" err
+'
+
 test_expect_success 'stale commit cannot be parsed when given directly' '
 	test_when_finished "rm -rf repo" &&
 	git init repo &&
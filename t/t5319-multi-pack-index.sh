@@ -1171,6 +1171,138 @@ test_expect_success 'reader notices out-of-bounds fanout' '
 	test_cmp expect err
 '
 
+corrupt_fanout16 () {
+	midx=.git/objects/pack/multi-pack-index &&
+	test_when_finished "rm -rf $midx" &&
+	GIT_TEST_MIDX_WRITE_FANOUT16=1 git repack -ad --write-midx &&
+	corrupt_chunk_file $midx OF16 "$@"
+}
+
+test_expect_success 'reader ignores too-small oid fanout16 chunk' '
+	git rev-list --objects --all >expect &&
+	corrupt_fanout16 clear 00000000 &&
+	git rev-list --objects --all >actual 2>err &&
+	test_cmp expect actual &&
+	cat >expect <<-\EOF &&
+	warning: multi-pack-index OID fanout16 is of the wrong size; ignoring it
+	EOF
+	test_cmp expect err
+'
+
+test_expect_success 'reader ignores oid fanout16 disagreeing with oid fanout' '
+	git rev-list --objects --all >expect &&
+	corrupt_fanout16 1020 ffffffff &&
+	git rev-list --objects --all >actual 2>err &&
+	test_cmp expect actual &&
+	cat >expect <<-\EOF &&
+	warning: multi-pack-index OID fanout16 disagrees with OID fanout at 0; ignoring it
+	EOF
+	test_cmp expect err
+'
+
+test_expect_success 'verify catches oid fanout16 entries inside a bucket' '
+	corrupt_fanout16 0 ffffffff &&
+	git rev-list --objects --all >/dev/null 2>err &&
+	test_must_be_empty err &&
+	test_must_fail git multi-pack-index verify 2>err &&
+	test_grep "oid fanout16 disagrees with oid lookup: fanout16\[0\]" err
+'
+
+test_expect_success 'lookups through the oid fanout16 chunk' '
+	test_when_finished "rm -fr repo" &&
+	git init repo &&
+	(
+		cd repo &&
+
+		for i in 1 2 3 4 5
+		do
+			test_commit "$i" &&
+			git repack -d || return 1
+		done &&
+
+		GIT_TEST_MIDX_WRITE_FANOUT16=1 git multi-pack-index write &&
+		test-tool read-midx $objdir >midx &&
+		grep "^chunks: .* oid-fanout16$" midx &&
+		git multi-pack-index verify &&
+
+		for order in random sequential
+		do
+			test-tool read-midx --lookup $order 1000 $objdir >out &&
+			grep "^found: 1000$" out || return 1
+		done &&
+
+		git cat-file --batch-all-objects --batch-check >expect &&
+		cut -d" " -f1 expect >oids &&
+		git cat-file --batch-check <oids >actual &&
+		test_cmp expect actual &&
+		GIT_TEST_MIDX_READ_FANOUT16=0 \
+			git cat-file --batch-check <oids >actual &&
+		test_cmp expect actual &&
+
+		test_must_fail git cat-file -e $(test_oid deadbeef)
+	)
+'
+
+test_expect_success 'lookups through the object filter chunk' '
+	test_when_finished "rm -fr repo" &&
+	git init repo &&
+	(
+		cd repo &&
+
+		for i in 1 2 3 4 5
+		do
+			test_commit "$i" &&
+			git repack -d || return 1
+		done &&
+
+		git -c pack.writeMidxObjectFilter=true multi-pack-index write &&
+		test-tool read-midx $objdir >midx &&
+		grep "^chunks: .* object-filter$" midx &&
+		nr=$(sed -n "s/^num_objects: //p" midx) &&
+
+		test-tool read-midx --lookup sequential $nr $objdir >out &&
+		grep "^found: $nr$" out &&
+		test-tool read-midx --lookup missing 1000 $objdir >out &&
+		grep "^found: 0$" out &&
+
+		git cat-file --batch-all-objects --batch-check >expect &&
+		cut -d" " -f1 expect >oids &&
+		git cat-file --batch-check <oids >actual &&
+		test_cmp expect actual &&
+
+		test_must_fail git cat-file -e $(test_oid deadbeef)
+	)
+'
+
+corrupt_object_filter () {
+	midx=.git/objects/pack/multi-pack-index &&
+	test_when_finished "rm -rf $midx" &&
+	git -c pack.writeMidxObjectFilter=true repack -ad --write-midx &&
+	corrupt_chunk_file $midx OBFL "$@"
+}
+
+test_expect_success 'reader ignores too-small object filter chunk' '
+	git rev-list --objects --all >expect &&
+	corrupt_object_filter clear 00000006 &&
+	git rev-list --objects --all >actual 2>err &&
+	test_cmp expect actual &&
+	cat >expect <<-\EOF &&
+	warning: multi-pack-index object filter is of the wrong size; ignoring it
+	EOF
+	test_cmp expect err
+'
+
+test_expect_success 'reader ignores object filter with unknown parameters' '
+	git rev-list --objects --all >expect &&
+	corrupt_object_filter 0 00000007 &&
+	git rev-list --objects --all >actual 2>err &&
+	test_cmp expect actual &&
+	cat >expect <<-\EOF &&
+	warning: multi-pack-index object filter uses 7 hashes; ignoring it
+	EOF
+	test_cmp expect err
+'
+
 test_expect_success 'bitmapped packs are stored via the BTMP chunk' '
 	test_when_finished "rm -fr repo" &&
 	git init repo &&
@@ -0,0 +1,64 @@
+#!/bin/sh
+
+test_description='reading packed objects from several threads at once'
+
+TEST_PASSES_SANITIZE_LEAK=true
+. ./test-lib.sh
+
+test_expect_success 'setup' '
+	test-tool genrandom base 65536 >base &&
+	for i in $(test_seq 1 8)
+	do
+		test-tool genrandom "seed-$i" 4096 >"file$i" || return 1
+	done &&
+	git add . &&
+	git commit -m initial &&
+	for i in $(test_seq 1 40)
+	do
+		for f in base file1 file2 file3
+		do
+			# overwrite a different block each time, so that each
+			# version deltas best against its neighbour
+			test-tool genrandom "$f-$i" 256 |
+			dd of="$f" bs=256 seek=$((i % 16)) conv=notrunc 2>/dev/null &&
+			echo "change $i" >>"$f" || return 1
+		done &&
+		git commit -q -am "change $i" || return 1
+	done &&
+	git repack -adf --window=2 --depth=50 &&
+	for i in $(test_seq 41 50)
+	do
+		echo "change $i" >>base &&
+		git commit -q -am "change $i" || return 1
+	done &&
+	git cat-file --batch-all-objects --batch-check="%(objectname)" >objects &&
+	git verify-pack -v .git/objects/pack/pack-*.idx >verify &&
+	grep "chain length = [1-9][0-9]:" verify
+'
+
+test_expect_success 'read objects from many threads' '
+	test-tool read-objects --threads=8 --rounds=3 <objects
+'
+
+test_expect_success 'read objects with a tiny delta base cache' '
+	test_config core.deltaBaseCacheLimit 1k &&
+	test-tool read-objects --threads=8 --rounds=3 <objects
+'
+
+test_expect_success 'read objects while pack windows come and go' '
+	test_config core.packedGitWindowSize 1k &&
+	test_config core.packedGitLimit 16k &&
+	test_config core.deltaBaseCacheLimit 16k &&
+	test-tool read-objects --threads=8 --rounds=3 <objects
+'
+
+test_expect_success 'grep gives the same results with many threads' '
+	git grep --threads=1 --cached -c "change" >expect &&
+	git grep --threads=8 --cached -c "change" >actual &&
+	test_cmp expect actual &&
+	git grep --threads=1 -c "change" $(git rev-list HEAD) >expect &&
+	git grep --threads=8 -c "change" $(git rev-list HEAD) >actual &&
+	test_cmp expect actual
+'
+
+test_done
@@ -0,0 +1,214 @@
+#!/bin/sh
+
+test_description='incremental multi-pack-index chains'
+. ./test-lib.sh
+
+GIT_TEST_MULTI_PACK_INDEX=0
+export GIT_TEST_MULTI_PACK_INDEX
+
+packdir=.git/objects/pack
+midxdir=$packdir/multi-pack-index.d
+midx_chain=$midxdir/multi-pack-index-chain
+
+# Commit <n> new files and put the resulting <n> + 2 objects into a new
+# pack of their own.
+add_pack () {
+	for i in $(test_seq $1)
+	do
+		echo "$2 $i" >"$2.$i" || return 1
+	done &&
+	git add . &&
+	git commit -q -m "$2" &&
+	git repack -d -q
+}
+
+check_objects () {
+	git -c core.multiPackIndex=false \
+		cat-file --batch-all-objects --batch-check >expect &&
+	git cat-file --batch-all-objects --batch-check >actual &&
+	test_cmp expect actual &&
+	git rev-list --objects --all >objects &&
+	git cat-file --batch-check <objects >/dev/null &&
+	git multi-pack-index verify
+}
+
+test_expect_success 'setup' '
+	git config core.multiPackIndex true &&
+	add_pack 100 big
+'
+
+test_expect_success 'incremental write starts a chain' '
+	git multi-pack-index write --incremental &&
+	test_path_is_missing $packdir/multi-pack-index &&
+	test_path_is_file $midx_chain &&
+	test_line_count = 1 $midx_chain &&
+	layer=$(cat $midx_chain) &&
+	test_path_is_file $midxdir/multi-pack-index-$layer.midx &&
+	check_objects
+'
+
+test_expect_success 'small packs go into new layers' '
+	add_pack 20 medium &&
+	git multi-pack-index write --incremental &&
+	test_line_count = 2 $midx_chain &&
+
+	add_pack 1 small &&
+	git multi-pack-index write --incremental &&
+	test_line_count = 3 $midx_chain &&
+
+	# the bottom layers are left alone
+	head -n 2 $midx_chain >base &&
+	for layer in $(cat base)
+	do
+		test_path_is_file $midxdir/multi-pack-index-$layer.midx || return 1
+	done &&
+	ls $midxdir/*.midx >layers &&
+	test_line_count = 3 layers &&
+	check_objects
+'
+
+test_expect_success 'writing without new packs leaves the chain alone' '
+	cp $midx_chain chain.before &&
+	git multi-pack-index write --incremental &&
+	test_cmp chain.before $midx_chain
+'
+
+test_expect_success 'layers are merged geometrically' '
+	head -n 1 $midx_chain >bottom &&
+
+	# merges the small layer, and then the medium one
+	add_pack 10 merge &&
+	git multi-pack-index write --incremental &&
+	test_line_count = 2 $midx_chain &&
+	head -n 1 $midx_chain >actual &&
+	test_cmp bottom actual &&
+
+	# large enough to merge all the way down
+	add_pack 80 huge &&
+	git multi-pack-index write --incremental &&
+	test_line_count = 1 $midx_chain &&
+	ls $midxdir/*.midx >layers &&
+	test_line_count = 1 layers &&
+	check_objects
+'
+
+test_expect_success 'abbreviations see every layer' '
+	add_pack 1 abbrev &&
+	git multi-pack-index write --incremental &&
+	test_line_count = 2 $midx_chain &&
+	git -c core.multiPackIndex=false log --format="%h %t" --abbrev=4 >expect &&
+	git -c core.multiPackIndex=false ls-tree -r --abbrev=4 HEAD >>expect &&
+	git log --format="%h %t" --abbrev=4 >actual &&
+	git ls-tree -r --abbrev=4 HEAD >>actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'packs in a chain are not reported as garbage' '
+	git count-objects -v >out &&
+	grep "^garbage: 0" out
+'
+
+test_expect_success 'a broken chain falls back to its valid prefix' '
+	cp $midx_chain chain.good &&
+	test_oid deadbeef >>$midx_chain &&
+	git cat-file --batch-all-objects --batch-check >actual 2>err &&
+	test_grep "unable to find all multi-pack-index files" err &&
+	git -c core.multiPackIndex=false \
+		cat-file --batch-all-objects --batch-check >expect &&
+	test_cmp expect actual &&
+	cp chain.good $midx_chain
+'
+
+test_expect_success 'expire and repack refuse to work on a chain' '
+	test_must_fail git multi-pack-index expire 2>err &&
+	test_grep "cannot expire packs from an incremental" err &&
+	test_must_fail git multi-pack-index repack 2>err &&
+	test_grep "cannot repack an incremental" err
+'
+
+check_bitmaps () {
+	git rev-list --test-bitmap HEAD &&
+	git rev-list --objects --all | cut -d" " -f1 | sort >expect &&
+	git rev-list --use-bitmap-index --objects --all |
+		cut -d" " -f1 | sort >actual &&
+	test_cmp expect actual &&
+	git rev-list --count HEAD~2..HEAD >expect &&
+	git rev-list --use-bitmap-index --count HEAD~2..HEAD >actual &&
+	test_cmp expect actual
+}
+
+test_expect_success 'incremental bitmaps' '
+	# the existing layers have no bitmaps, so they are merged
+	add_pack 1 bitmap-one &&
+	git multi-pack-index write --incremental --bitmap &&
+	test_line_count = 1 $midx_chain &&
+	layer=$(cat $midx_chain) &&
+	test_path_is_file $midxdir/multi-pack-index-$layer.bitmap &&
+
+	add_pack 1 bitmap-two &&
+	git multi-pack-index write --incremental --bitmap &&
+	test_line_count = 2 $midx_chain &&
+	for layer in $(cat $midx_chain)
+	do
+		test_path_is_file $midxdir/multi-pack-index-$layer.bitmap ||
+		return 1
+	done &&
+
+	# each layer stores the bitmaps for its own commits
+	test-tool bitmap list-commits >commits &&
+	grep $(git rev-parse HEAD) commits &&
+	grep $(git rev-parse HEAD~1) commits &&
+	check_bitmaps &&
+	check_objects
+'
+
+test_expect_success 'incremental bitmaps on top of a layer without one' '
+	# large enough not to be merged for its size alone
+	add_pack 30 no-bitmap &&
+	git multi-pack-index write --incremental &&
+	plain=$(tail -n 1 $midx_chain) &&
+	test_path_is_missing $midxdir/multi-pack-index-$plain.bitmap &&
+
+	add_pack 1 bitmap-three &&
+	git multi-pack-index write --incremental --bitmap &&
+	! grep $plain $midx_chain &&
+	for layer in $(cat $midx_chain)
+	do
+		test_path_is_file $midxdir/multi-pack-index-$layer.bitmap ||
+		return 1
+	done &&
+	check_bitmaps
+'
+
+test_expect_success 'non-incremental write replaces the chain' '
+	git multi-pack-index write &&
+	test_path_is_file $packdir/multi-pack-index &&
+	test_path_is_missing $midxdir &&
+	check_objects
+'
+
+test_expect_success 'incremental write merges a non-incremental MIDX' '
+	add_pack 1 after-flat &&
+	git multi-pack-index write --incremental &&
+	test_path_is_missing $packdir/multi-pack-index &&
+	test_line_count = 1 $midx_chain &&
+	check_objects
+'
+
+test_expect_success 'every layer can have an object filter' '
+	test_config pack.writeMidxObjectFilter true &&
+	add_pack 50 filtered &&
+	git multi-pack-index write --incremental &&
+	add_pack 1 filtered-small &&
+	git multi-pack-index write --incremental &&
+	test_line_count = 3 $midx_chain &&
+	# the bottom layer was written without a filter
+	for layer in $(tail -n 2 $midx_chain)
+	do
+		grep -q OBFL $midxdir/multi-pack-index-$layer.midx || return 1
+	done &&
+	check_objects &&
+	test_must_fail git cat-file -e $(test_oid deadbeef)
+'
+
+test_done
@@ -0,0 +1,123 @@
+#!/bin/sh
+
+test_description='pseudo-merge bitmaps'
+
+GIT_TEST_MULTI_PACK_INDEX=0
+GIT_TEST_MULTI_PACK_INDEX_WRITE_BITMAP=0
+export GIT_TEST_MULTI_PACK_INDEX GIT_TEST_MULTI_PACK_INDEX_WRITE_BITMAP
+
+. ./test-lib.sh
+
+# Check that a bitmap traversal of <rev>... gives the same answer as a
+# regular one.
+check_rev_list () {
+	git rev-list --objects "$@" | cut -d" " -f1 | sort >expect &&
+	git rev-list --use-bitmap-index --objects "$@" |
+		cut -d" " -f1 | sort >actual &&
+	test_cmp expect actual
+}
+
+pseudo_merges_satisfied () {
+	grep "\"key\":\"pseudo_merges_satisfied\"" "$1" |
+	sed -e 's/.*"value":"\([0-9]*\)".*/\1/' |
+	sort -n | tail -n 1
+}
+
+test_expect_success 'setup' '
+	test_commit_bulk 256 &&
+
+	# Tag every fourth commit, with the tags split between two
+	# "namespaces".
+	for i in $(test_seq 0 63)
+	do
+		echo "create refs/tags/ns-$((i % 2))/t$i HEAD~$((i * 4))" || return 1
+	done >refs &&
+	git update-ref --stdin <refs &&
+	git tag >tags &&
+	test_line_count = 64 tags
+'
+
+test_expect_success 'no pseudo-merges without configuration' '
+	GIT_TRACE2_EVENT="$(pwd)/trace" git repack -adb &&
+	! grep num_pseudo_merges trace &&
+	rm -f trace &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" check_rev_list --tags &&
+	! grep pseudo_merges_satisfied trace
+'
+
+test_expect_success 'write pseudo-merge bitmaps' '
+	git config bitmapPseudoMerge.tags.pattern "refs/tags/(ns-[0-9])/" &&
+	git config bitmapPseudoMerge.tags.maxMerges 4 &&
+
+	GIT_TRACE2_EVENT="$(pwd)/trace" git repack -adb &&
+	grep "\"key\":\"num_pseudo_merges\",\"value\":\"8\"" trace
+'
+
+test_expect_success 'pseudo-merges are used when all their tips are wanted' '
+	rm -f trace &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" check_rev_list --tags &&
+	test 8 = "$(pseudo_merges_satisfied trace)" &&
+
+	git rev-list --count --tags >expect &&
+	git rev-list --use-bitmap-index --count --tags >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'pseudo-merges are used for the haves' '
+	# The older tips have no bitmaps of their own.
+	for i in $(test_seq 16 31)
+	do
+		echo refs/tags/ns-0/t$((i * 2)) || return 1
+	done >haves &&
+
+	for traversal in 0 1
+	do
+		rm -f trace &&
+		GIT_TEST_PACK_USE_BITMAP_BOUNDARY_TRAVERSAL=$traversal \
+		GIT_TRACE2_EVENT="$(pwd)/trace" \
+			check_rev_list HEAD --not $(cat haves) &&
+		test 0 -lt "$(pseudo_merges_satisfied trace)" || return 1
+	done
+'
+
+test_expect_success 'pseudo-merges with only some of their tips wanted' '
+	rm -f trace &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" \
+		check_rev_list refs/tags/ns-0/t60 refs/tags/ns-0/t62 &&
+	test 0 = "$(pseudo_merges_satisfied trace)"
+'
+
+test_expect_success 'GIT_TEST_USE_PSEUDO_MERGES=0 ignores them' '
+	rm -f trace &&
+	GIT_TEST_USE_PSEUDO_MERGES=0 GIT_TRACE2_EVENT="$(pwd)/trace" \
+		check_rev_list --tags &&
+	! grep pseudo_merges_satisfied trace
+'
+
+test_expect_success 'recent tips are left out' '
+	git config bitmapPseudoMerge.recent.pattern "refs/tags/recent/" &&
+	new=$(GIT_COMMITTER_DATE="$(date +%s) +0000" \
+		git commit-tree -p HEAD -m new HEAD^{tree}) &&
+	git update-ref refs/tags/recent/new $new &&
+
+	rm -f trace &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" git repack -adb &&
+	grep "\"key\":\"num_pseudo_merges\",\"value\":\"8\"" trace &&
+	check_rev_list --tags
+'
+
+test_expect_success 'pseudo-merges in a multi-pack bitmap' '
+	test_commit another &&
+	git repack -d &&
+	rm -f trace &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" \
+		git multi-pack-index write --bitmap &&
+	grep "\"key\":\"num_pseudo_merges\",\"value\":\"8\"" trace &&
+
+	rm -f trace &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" check_rev_list --tags &&
+	test 8 = "$(pseudo_merges_satisfied trace)" &&
+	git rev-list --test-bitmap HEAD
+'
+
+test_done
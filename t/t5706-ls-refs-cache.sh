@@ -0,0 +1,175 @@
+#!/bin/sh
+
+test_description='caching of protocol v2 ls-refs responses'
+
+TEST_PASSES_SANITIZE_LEAK=true
+. ./test-lib.sh
+
+if test_have_prereq !REFFILES
+then
+	skip_all='skipping ls-refs cache tests; only the files backend is cached'
+	test_done
+fi
+
+ls_refs () {
+	{
+		echo command=ls-refs &&
+		echo object-format=$(test_oid algo) &&
+		echo 0001 &&
+		for arg in "$@"
+		do
+			echo "$arg" || return 1
+		done &&
+		echo 0000
+	} | test-tool pkt-line pack >in &&
+	rm -f trace &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" \
+		test-tool serve-v2 --stateless-rpc <in >out &&
+	test-tool pkt-line unpack <out >actual &&
+	GIT_CONFIG_COUNT=1 \
+	GIT_CONFIG_KEY_0=lsrefs.cache \
+	GIT_CONFIG_VALUE_0=false \
+		test-tool serve-v2 --stateless-rpc <in >out &&
+	test-tool pkt-line unpack <out >expect &&
+	test_cmp expect actual
+}
+
+test_cache () {
+	grep "\"category\":\"ls-refs\",\"key\":\"cache\",\"value\":\"$1\"" trace
+}
+
+# Responses are only cached once the refs are older than the cache file,
+# so move their timestamps into the past, a little later at every call.
+stamp=1000000000
+backdate_refs () {
+	stamp=$(($stamp + 1)) &&
+	for f in .git/HEAD .git/packed-refs $(find .git/refs -type d)
+	do
+		if test -e "$f"
+		then
+			test-tool chmtime =$stamp "$f" || return 1
+		fi
+	done
+}
+
+test_expect_success 'setup' '
+	test_commit one &&
+	git branch dev &&
+	test_commit two &&
+	git tag -a -m annotated annotated one &&
+	git symbolic-ref refs/heads/release refs/heads/dev &&
+	git config lsrefs.cache true &&
+	backdate_refs
+'
+
+test_expect_success 'responses are cached' '
+	ls_refs &&
+	test_cache miss &&
+	ls .git/ls-refs-cache >entries &&
+	test_line_count = 1 entries &&
+	ls_refs &&
+	test_cache hit &&
+	test_line_count = 8 expect
+'
+
+test_expect_success 'each set of arguments is cached separately' '
+	ls_refs peel symrefs "ref-prefix refs/tags/" &&
+	test_cache miss &&
+	grep peeled: actual &&
+	ls_refs peel symrefs "ref-prefix refs/tags/" &&
+	test_cache hit &&
+	ls_refs symrefs "ref-prefix refs/heads/" &&
+	test_cache miss &&
+	grep symref-target: actual &&
+	ls_refs "ref-prefix refs/heads/" &&
+	test_cache miss &&
+	! grep symref-target: actual &&
+	ls .git/ls-refs-cache >entries &&
+	test_line_count = 4 entries
+'
+
+test_expect_success 'hidden refs are part of the key' '
+	test_config uploadpack.hideRefs refs/tags/ &&
+	ls_refs &&
+	test_cache miss &&
+	! grep refs/tags/ actual
+'
+
+# Make sure that the response to a request is cached, so that a
+# following miss can only be due to what happened in between.
+prime_cache () {
+	backdate_refs &&
+	ls_refs "$@" &&
+	ls_refs "$@" &&
+	test_cache hit
+}
+
+test_expect_success 'updating a loose ref invalidates the cache' '
+	prime_cache &&
+	git update-ref refs/heads/dev HEAD &&
+	ls_refs &&
+	test_cache miss &&
+	grep "$(git rev-parse HEAD) refs/heads/dev" actual
+'
+
+test_expect_success 'creating a ref in a new directory invalidates the cache' '
+	prime_cache &&
+	git update-ref refs/heads/topic/one HEAD &&
+	ls_refs &&
+	test_cache miss &&
+	grep refs/heads/topic/one actual &&
+	prime_cache &&
+	git update-ref refs/heads/topic/two HEAD &&
+	ls_refs &&
+	test_cache miss &&
+	grep refs/heads/topic/two actual
+'
+
+test_expect_success 'rewriting packed-refs invalidates the cache' '
+	git pack-refs --all &&
+	prime_cache &&
+	git pack-refs --all &&
+	ls_refs &&
+	test_cache miss &&
+	prime_cache &&
+	git update-ref -d refs/heads/topic/one &&
+	ls_refs &&
+	test_cache miss &&
+	! grep refs/heads/topic/one actual
+'
+
+test_expect_success 'changing HEAD invalidates the cache' '
+	prime_cache symrefs "ref-prefix HEAD" &&
+	git symbolic-ref HEAD refs/heads/dev &&
+	ls_refs symrefs "ref-prefix HEAD" &&
+	test_cache miss &&
+	grep "symref-target:refs/heads/dev" actual
+'
+
+test_expect_success 'old responses are removed' '
+	prime_cache &&
+	ls .git/ls-refs-cache >entries &&
+	test_line_count = 1 entries
+'
+
+test_expect_success 'the number of responses per state is limited' '
+	for i in $(test_seq 20)
+	do
+		ls_refs "ref-prefix refs/heads/$i" || return 1
+	done &&
+	ls .git/ls-refs-cache >entries &&
+	test_line_count = 16 entries &&
+	ls_refs "ref-prefix refs/heads/20" &&
+	test_cache miss
+'
+
+test_expect_success 'responses are not cached while refs are too recent' '
+	rm -rf .git/ls-refs-cache &&
+	git update-ref refs/heads/recent HEAD &&
+	test-tool chmtime =+100 .git/refs/heads &&
+	ls_refs &&
+	test_cache miss &&
+	test_dir_is_empty .git/ls-refs-cache
+'
+
+test_done
@@ -182,4 +182,36 @@ test_expect_success 'rev-list --unpacked' '
 	test_cmp expect actual
 '
 
+test_expect_success PTHREADS 'rev-list --objects --threads' '
+	mkdir -p deep/a/b &&
+	for i in 1 2 3
+	do
+		echo $i >deep/$i &&
+		echo $i >deep/a/b/$i &&
+		git add deep &&
+		test_tick &&
+		git commit -m "deep $i" || return 1
+	done &&
+
+	for revs in --all "HEAD --not HEAD~2"
+	do
+		git rev-list --objects --no-object-names $revs >expect.raw &&
+		sort expect.raw >expect &&
+		GIT_TRACE2_EVENT="$(pwd)/trace" git rev-list --objects \
+			--no-object-names --threads=4 $revs >actual.raw &&
+		grep "\"category\":\"list-objects\",\"key\":\"threads\",\"value\":\"4\"" trace &&
+		sort actual.raw >actual &&
+		test_cmp expect actual || return 1
+	done
+'
+
+test_expect_success PTHREADS 'rev-list --threads walks filtered trees in order' '
+	git rev-list --objects --filter=blob:limit=1 --all >expect &&
+	rm -f trace &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" git rev-list --objects \
+		--filter=blob:limit=1 --threads=4 --all >actual &&
+	! grep walk-trees-threaded trace &&
+	test_cmp expect actual
+'
+
 test_done
@@ -58,6 +58,15 @@ test_expect_success 'setup' '
 	git -c commitGraph.generationVersion=1 commit-graph write --reachable &&
 	mv .git/objects/info/commit-graph commit-graph-no-gdat &&
 	chmod u+w commit-graph-no-gdat &&
+	git -c commitGraph.writeReachabilityIndex=true \
+		commit-graph write --reachable &&
+	mv .git/objects/info/commit-graph commit-graph-reach &&
+	chmod u+w commit-graph-reach &&
+	git show-ref -s commit-5-5 |
+	git -c commitGraph.writeReachabilityIndex=true \
+		commit-graph write --stdin-commits &&
+	mv .git/objects/info/commit-graph commit-graph-half-reach &&
+	chmod u+w commit-graph-half-reach &&
 	git config core.commitGraph true
 '
 
@@ -73,6 +82,12 @@ run_all_modes () {
 	test_cmp expect actual &&
 	cp commit-graph-no-gdat .git/objects/info/commit-graph &&
 	"$@" <input >actual &&
+	test_cmp expect actual &&
+	cp commit-graph-reach .git/objects/info/commit-graph &&
+	"$@" <input >actual &&
+	test_cmp expect actual &&
+	cp commit-graph-half-reach .git/objects/info/commit-graph &&
+	"$@" <input >actual &&
 	test_cmp expect actual
 }
 
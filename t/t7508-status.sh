@@ -1745,6 +1745,68 @@ test_expect_success 'slow status advice when core.untrackedCache true, and fsmon
 	)
 '
 
+test_expect_success 'preloading the index notices changed files' '
+	git init preload &&
+	(
+		cd preload &&
+		for i in $(test_seq 100)
+		do
+			echo $i >file-$i || return 1
+		done &&
+		test-tool chmtime =-60 file-* &&
+		git add . &&
+		git commit -q -m files &&
+		echo changed >file-50 &&
+		rm file-70 &&
+
+		GIT_TEST_PRELOAD_INDEX=1 GIT_TRACE2_EVENT="$(pwd)/../trace" \
+			git status --porcelain >actual &&
+		grep "\"key\":\"preload/sum_lstat\",\"value\":\"100\"" ../trace &&
+		cat >expect <<-\EOF &&
+		 M file-50
+		 D file-70
+		?? actual
+		EOF
+		test_cmp expect actual
+	)
+'
+
+test_lazy_prereq STAT_BATCH '
+	test-tool stat-batch .
+'
+
+test_expect_success STAT_BATCH,SYMLINKS 'batched lstat reports what lstat does' '
+	test_when_finished "rm -rf batch" &&
+	mkdir batch &&
+	echo content >batch/file &&
+	ln -s file batch/link &&
+	test-tool stat-batch batch/file batch/missing batch/link >actual &&
+	cat >expect <<-\EOF &&
+	batch/file 8 file
+	batch/link 4 link
+	EOF
+	test_cmp expect actual
+'
+
+test_expect_success STAT_BATCH 'preloading the index batches lstat calls' '
+	(
+		cd preload &&
+		echo changed >file-30 &&
+		GIT_TEST_PRELOAD_INDEX=1 GIT_TRACE2_EVENT="$(pwd)/../trace.batch" \
+			git status --porcelain >actual &&
+		grep "\"key\":\"preload/sum_batched_lstat\",\"value\":\"100\"" \
+			../trace.batch &&
+		cat >expect <<-\EOF &&
+		 M file-30
+		 M file-50
+		 D file-70
+		?? actual
+		?? expect
+		EOF
+		test_cmp expect actual
+	)
+'
+
 test_expect_success EXPENSIVE 'status does not re-read unchanged 4 or 8 GiB file' '
 	(
 		mkdir large-file &&
@@ -495,6 +495,26 @@ test_expect_success 'rename directory' '
 	grep "^event: dirrenamed/*$"  .git/trace
 '
 
+test_expect_success 'edit files in a renamed directory' '
+	test_when_finished clean_up_repo_and_stop_daemon &&
+
+	start_daemon --tf "$PWD/.git/trace" &&
+
+	mv dirtorename dirrenamed &&
+	test-tool fsmonitor-client query --token 0 &&
+
+	echo 1 >dirrenamed/a &&
+	mkdir dirrenamed/sub &&
+	test-tool fsmonitor-client query --token 0 &&
+	echo 1 >dirrenamed/sub/new &&
+
+	test-tool fsmonitor-client query --token 0 &&
+
+	grep "^event: dirrenamed/a$"       .git/trace &&
+	grep "^event: dirrenamed/sub/new$" .git/trace &&
+	! grep "^event: dirtorename/a$"    .git/trace
+'
+
 test_expect_success 'file changes to directory' '
 	test_when_finished clean_up_repo_and_stop_daemon &&
 
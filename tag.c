@@ -107,7 +107,7 @@ struct tag *lookup_tag(struct repository *r, const struct object_id *oid)
 {
 	struct object *obj = lookup_object(r, oid);
 	if (!obj)
-		return create_object(r, oid, alloc_tag_node(r));
+		obj = create_object(r, oid, alloc_tag_node(r));
 	return object_as_type(obj, OBJ_TAG, 0);
 }
 
@@ -136,7 +136,7 @@ void release_tag_memory(struct tag *t)
 	t->date = 0;
 }
 
-int parse_tag_buffer(struct repository *r, struct tag *item, const void *data, unsigned long size)
+static int parse_tag_buffer_1(struct repository *r, struct tag *item, const void *data, unsigned long size)
 {
 	struct object_id oid;
 	char type[20];
@@ -206,11 +206,21 @@ int parse_tag_buffer(struct repository *r, struct tag *item, const void *data, u
 	else
 		item->date = 0;
 
-	item->object.parsed = 1;
+	set_object_parsed(&item->object, 1);
 	return 0;
 }
 
-int parse_tag(struct tag *item)
+int parse_tag_buffer(struct repository *r, struct tag *item, const void *data, unsigned long size)
+{
+	int ret;
+
+	object_parse_lock(&item->object.oid);
+	ret = parse_tag_buffer_1(r, item, data, size);
+	object_parse_unlock(&item->object.oid);
+	return ret;
+}
+
+static int parse_tag_1(struct tag *item)
 {
 	enum object_type type;
 	void *data;
@@ -234,6 +244,16 @@ int parse_tag(struct tag *item)
 	return ret;
 }
 
+int parse_tag(struct tag *item)
+{
+	int ret;
+
+	object_parse_lock(&item->object.oid);
+	ret = parse_tag_1(item);
+	object_parse_unlock(&item->object.oid);
+	return ret;
+}
+
 struct object_id *get_tagged_oid(struct tag *tag)
 {
 	if (!tag->tagged)
@@ -168,22 +168,24 @@ struct tree *lookup_tree(struct repository *r, const struct object_id *oid)
 {
 	struct object *obj = lookup_object(r, oid);
 	if (!obj)
-		return create_object(r, oid, alloc_tree_node(r));
+		obj = create_object(r, oid, alloc_tree_node(r));
 	return object_as_type(obj, OBJ_TREE, 0);
 }
 
 int parse_tree_buffer(struct tree *item, void *buffer, unsigned long size)
 {
-	if (item->object.parsed)
-		return 0;
-	item->object.parsed = 1;
-	item->buffer = buffer;
-	item->size = size;
+	object_parse_lock(&item->object.oid);
+	if (!item->object.parsed) {
+		item->buffer = buffer;
+		item->size = size;
+		set_object_parsed(&item->object, 1);
+	}
+	object_parse_unlock(&item->object.oid);
 
 	return 0;
 }
 
-int parse_tree_gently(struct tree *item, int quiet_on_missing)
+static int parse_tree_gently_1(struct tree *item, int quiet_on_missing)
 {
 	 enum object_type type;
 	 void *buffer;
@@ -205,11 +207,21 @@ int parse_tree_gently(struct tree *item, int quiet_on_missing)
 	return parse_tree_buffer(item, buffer, size);
 }
 
+int parse_tree_gently(struct tree *item, int quiet_on_missing)
+{
+	int ret;
+
+	object_parse_lock(&item->object.oid);
+	ret = parse_tree_gently_1(item, quiet_on_missing);
+	object_parse_unlock(&item->object.oid);
+	return ret;
+}
+
 void free_tree_buffer(struct tree *tree)
 {
 	FREE_AND_NULL(tree->buffer);
 	tree->size = 0;
-	tree->object.parsed = 0;
+	set_object_parsed(&tree->object, 0);
 }
 
 struct tree *parse_tree_indirect(const struct object_id *oid)
@@ -1,4 +1,5 @@
 #include "git-compat-util.h"
+#include "gettext.h"
 #include "parse.h"
 #include "run-command.h"
 #include "write-or-die.h"
@@ -55,11 +56,16 @@ void fprintf_or_die(FILE *f, const char *fmt, ...)
 	}
 }
 
-static int maybe_fsync(int fd)
+static int fsync_enabled(void)
 {
 	if (use_fsync < 0)
 		use_fsync = git_env_bool("GIT_TEST_FSYNC", 1);
-	if (!use_fsync)
+	return use_fsync;
+}
+
+static int maybe_fsync(int fd)
+{
+	if (!fsync_enabled())
 		return 0;
 
 	if (fsync_method == FSYNC_METHOD_WRITEOUT_ONLY &&
@@ -88,6 +94,24 @@ void fsync_component_or_die(enum fsync_component component, int fd, const char *
 		fsync_or_die(fd, msg);
 }
 
+int fsync_component_deferred(enum fsync_component component, int fd)
+{
+	static int warned;
+
+	if (!batch_fsync_enabled(component))
+		return fsync_component(component, fd);
+	if (!fsync_enabled())
+		return 0;
+
+	if (git_fsync(fd, FSYNC_WRITEOUT_ONLY) >= 0)
+		return 1;
+	if (errno == ENOSYS && !warned) {
+		warning(_("core.fsyncMethod = batch is unsupported on this platform"));
+		warned = 1;
+	}
+	return git_fsync(fd, FSYNC_HARDWARE_FLUSH);
+}
+
 void write_or_die(int fd, const void *buf, size_t count)
 {
 	if (write_in_full(fd, buf, count) < 0) {
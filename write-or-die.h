@@ -55,6 +55,16 @@ void fsync_or_die(int fd, const char *);
 int fsync_component(enum fsync_component component, int fd);
 void fsync_component_or_die(enum fsync_component component, int fd, const char *msg);
 
+/*
+ * Like fsync_component(), but with core.fsyncMethod=batch only ask for
+ * the data of "fd" to be written out, without flushing the disk cache.
+ * Returns 1 in that case, and the caller has to issue a hardware flush
+ * (e.g. by fsync()ing a dummy file) before making the file visible under
+ * its final name. Returns 0 if nothing more needs to be done, and -1 on
+ * error.
+ */
+int fsync_component_deferred(enum fsync_component component, int fd);
+
 /*
  * A bitmask indicating which components of the repo should be fsynced.
  */